@@ -0,0 +1,58 @@
+// Module: crc32_words
+// Description:
+//   CRC-32 of a stream of 32-bit words, one word per clock, shared by
+//   the encoders and the stream decoders for the per-block payload
+//   check of COMP.BIN (COMPBIN_FLAG_PAYLOAD_CRC).
+//
+//   The value is the one bit_crc32_words() computes in software:
+//   CRC-32 (IEEE 802.3, reflected, as zlib) of the words taken as
+//   big-endian bytes, so each word is folded in from its top byte
+//   down, each byte LSB first. crc has the final inversion applied
+//   and reads 0 for no words.
+//
+// Notes:
+//   - clear restarts the CRC; it is a one-cycle pulse, the cores pass
+//     their own edge-detected clear or start
+//   - clear wins over a word in the same cycle
+//   - The 32 bit steps are unrolled into one XOR network, about one
+//     LUT level per 4 bits of the word
+
+module crc32_words (
+    input  wire        clock,
+    input  wire        reset,
+    input  wire        clear,                    // Restart (one-cycle pulse)
+    input  wire [31:0] data,                     // Word taken this cycle
+    input  wire        valid,
+    output wire [31:0] crc                       // CRC of the words since clear
+);
+
+    localparam [31:0] POLY = 32'hEDB88320;       // reflected 0x04C11DB7
+
+    // One word into the running state, top byte first
+    function [31:0] fold;
+        input [31:0] state;
+        input [31:0] word;
+        integer i;
+        reg [31:0] c;
+        begin
+            c = state;
+            for (i = 0; i < 32; i = i + 1)
+                c = (c >> 1) ^ ((c[0] ^ word[24 - 8 * (i / 8) + (i % 8)]) ? POLY : 32'h0);
+            fold = c;
+        end
+    endfunction
+
+    reg [31:0] state;
+
+    always @(posedge clock or posedge reset) begin
+        if (reset)
+            state <= 32'hFFFFFFFF;
+        else if (clear)
+            state <= 32'hFFFFFFFF;
+        else if (valid)
+            state <= fold(state, data);
+    end
+
+    assign crc = ~state;
+
+endmodule
@@ -0,0 +1,116 @@
+// Module: perf_counters
+// Description:
+//   Performance counter block shared by the IP cores.
+//   Six 32-bit counters that show where a core spends its cycles and
+//   how much it moved. Every cycle since clear falls into exactly one
+//   of the first four, so active + idle + in_stall + out_stall is the
+//   elapsed cycle count:
+//
+//     active    : the core did work (lookup, count, table write, ...)
+//     out_stall : it held a result the consumer did not take
+//     in_stall  : it was running but waited for input
+//     idle      : nothing to do (between streams, waiting on the PS)
+//
+//   items adds the items finished in the cycle (symbols or words,
+//   per core) and bits the payload bits produced (encoders) or
+//   consumed (decoders).
+//
+//   The AXI-Lite wrapper maps perf_count at offset 0x200, word k =
+//   perf_count[32k +: 32]:
+//     0x200 active    0x204 idle       0x208 items
+//     0x20C in_stall  0x210 out_stall  0x214 bits
+//   and clear at bit 0 of 0x218.
+//
+//   bit_parser, Encrypt, decrypt and bit_merger have no clock: their
+//   wrappers instantiate this block with active = the write strobe of
+//   the data register and items = 1 per write.
+//
+// Notes:
+//   - A cycle that is active and stalled counts as active; out_stall
+//     wins over in_stall
+//   - clear is edge-detected (one-shot)
+//   - Counters stop at 2^32 - 1 instead of wrapping (about 43 s of
+//     cycles at 100 MHz)
+//   - ENABLE = 0 removes the counters; perf_count reads as zero
+
+module perf_counters #(
+    parameter ENABLE     = 1,
+    parameter ITEM_WIDTH = 3,                // items per cycle: up to 2^ITEM_WIDTH - 1
+    parameter BITS_WIDTH = 7                 // bits per cycle: up to 2^BITS_WIDTH - 1
+)(
+    input  wire                  clock,
+    input  wire                  reset,
+
+    // ------------------------------------------------------------------
+    // Cycle classification (from the core)
+    // ------------------------------------------------------------------
+    input  wire                  active,
+    input  wire                  in_stall,
+    input  wire                  out_stall,
+    input  wire [ITEM_WIDTH-1:0] items,
+    input  wire [BITS_WIDTH-1:0] bits,
+
+    // ------------------------------------------------------------------
+    // AXI-Lite side
+    // ------------------------------------------------------------------
+    input  wire                  clear,      // Zero all counters (level signal)
+    output wire [191:0]          perf_count  // {bits, out_stall, in_stall, items, idle, active}
+);
+
+    generate
+        if (ENABLE) begin : counters
+            reg  clear_d;
+            wire clear_pulse = clear & ~clear_d;
+
+            always @(posedge clock) begin
+                clear_d <= clear;
+            end
+
+            reg  [31:0] active_cycles, idle_cycles, item_count;
+            reg  [31:0] in_stall_cycles, out_stall_cycles, bit_count;
+
+            wire is_out_stall = !active && out_stall;
+            wire is_in_stall  = !active && !out_stall && in_stall;
+            wire is_idle      = !active && !out_stall && !in_stall;
+
+            // Saturating additions: the carry out means the sum wrapped
+            wire [32:0] items_sum = item_count + items;
+            wire [32:0] bits_sum  = bit_count + bits;
+
+            always @(posedge clock or posedge reset) begin
+                if (reset) begin
+                    active_cycles    <= 0;
+                    idle_cycles      <= 0;
+                    item_count       <= 0;
+                    in_stall_cycles  <= 0;
+                    out_stall_cycles <= 0;
+                    bit_count        <= 0;
+                end else if (clear_pulse) begin
+                    active_cycles    <= 0;
+                    idle_cycles      <= 0;
+                    item_count       <= 0;
+                    in_stall_cycles  <= 0;
+                    out_stall_cycles <= 0;
+                    bit_count        <= 0;
+                end else begin
+                    if (active && !(&active_cycles))
+                        active_cycles <= active_cycles + 1;
+                    if (is_idle && !(&idle_cycles))
+                        idle_cycles <= idle_cycles + 1;
+                    if (is_in_stall && !(&in_stall_cycles))
+                        in_stall_cycles <= in_stall_cycles + 1;
+                    if (is_out_stall && !(&out_stall_cycles))
+                        out_stall_cycles <= out_stall_cycles + 1;
+                    item_count <= items_sum[32] ? 32'hFFFFFFFF : items_sum[31:0];
+                    bit_count  <= bits_sum[32]  ? 32'hFFFFFFFF : bits_sum[31:0];
+                end
+            end
+
+            assign perf_count = {bit_count, out_stall_cycles, in_stall_cycles,
+                                 item_count, idle_cycles, active_cycles};
+        end else begin : no_counters
+            assign perf_count = 192'b0;
+        end
+    endgenerate
+
+endmodule
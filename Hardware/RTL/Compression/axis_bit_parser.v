@@ -0,0 +1,84 @@
+// Module: axis_bit_parser
+// Description:
+//   AXI4-Stream Bit Parser IP core.
+//   Streaming variant of bit_parser: accepts 32-bit configuration
+//   words and emits their four 8-bit symbols, most significant
+//   byte first, one symbol per clock.
+//
+// Example:
+//   Input  : 11110000111111110000111111110000 (tlast = 1)
+//   Output : 11110000, 11111111, 00001111, 11110000 (tlast on the last)
+//
+// Notes:
+//   - Uses bit_parser for the byte split
+//   - Accepts a new word in the same cycle the last byte of the
+//     previous one leaves, so the output runs at one symbol/clock
+//   - tlast of an input word is forwarded on its fourth symbol
+
+module axis_bit_parser(
+    input  wire        clock,
+    input  wire        reset,
+
+    // ------------------------------------------------------------------
+    // 32-bit word input (AXI4-Stream slave)
+    // ------------------------------------------------------------------
+    input  wire [31:0] s_axis_tdata,
+    input  wire        s_axis_tvalid,
+    input  wire        s_axis_tlast,
+    output wire        s_axis_tready,
+
+    // ------------------------------------------------------------------
+    // 8-bit symbol output (AXI4-Stream master)
+    // ------------------------------------------------------------------
+    output wire [7:0]  m_axis_tdata,
+    output wire        m_axis_tvalid,
+    output wire        m_axis_tlast,
+    input  wire        m_axis_tready
+);
+
+    reg  [31:0] word;        // Word being split
+    reg  [1:0]  index;       // Next byte of word to emit (0 = MSB)
+    reg         full;        // word holds unsent bytes
+    reg         last;        // word carried tlast
+
+    wire [7:0]  out_1, out_2, out_3, out_4;
+
+    bit_parser parser (
+        .data_in (word),
+        .out_1   (out_1),
+        .out_2   (out_2),
+        .out_3   (out_3),
+        .out_4   (out_4)
+    );
+
+    wire m_fire    = m_axis_tvalid && m_axis_tready;
+    wire last_byte = (index == 2'd3);
+
+    assign s_axis_tready = !full || (m_fire && last_byte);
+    wire   s_fire        = s_axis_tvalid && s_axis_tready;
+
+    assign m_axis_tvalid = full;
+    assign m_axis_tlast  = full && last && last_byte;
+    assign m_axis_tdata  = (index == 2'd0) ? out_1 :
+                           (index == 2'd1) ? out_2 :
+                           (index == 2'd2) ? out_3 : out_4;
+
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            word  <= 0;
+            index <= 0;
+            full  <= 0;
+            last  <= 0;
+        end else if (s_fire) begin
+            word  <= s_axis_tdata;
+            last  <= s_axis_tlast;
+            index <= 0;
+            full  <= 1;
+        end else if (m_fire) begin
+            index <= index + 1;
+            if (last_byte)
+                full <= 0;
+        end
+    end
+
+endmodule
@@ -0,0 +1,289 @@
+// Module: axis_compression_chain
+// Description:
+//   AXI4-Stream compression chain.
+//   axis_bit_parser -> axis_frequency_counter and axis_word_encoder
+//   between the MM2S and S2MM channels of an AXI DMA, so a whole
+//   block of configuration words is processed per DMA transfer
+//   instead of one AXI-Lite access per word or symbol.
+//
+//   A block is processed in two passes over the same DDR buffer:
+//     mode = 0 (count)  : words -> parser -> frequency counter
+//                         (no output stream), irq when counted
+//     mode = 1 (encode) : words -> 4-lane encoder -> packed words
+//                         to S2MM, tlast on the tail word; one word
+//                         per clock (the count pass takes four)
+//
+//   With protect set the packed words leave through Encrypt
+//   ((~word) ^ key), so the payload reaches DDR already protected and
+//   software only has to protect the archive's header sections.
+//   Software builds the codebook from the histogram between the two
+//   passes and loads it through the encoder table window (or load
+//   interface).
+//
+// Notes:
+//   - The end of the block is taken from block_words, not from the
+//     MM2S tlast, so the DMA may split the block into any number of
+//     transfers
+//   - clear is edge-detected: it resets the histogram, the encoder
+//     and the word counter; set mode and block_words before it
+//   - irq is a one-cycle pulse when the active pass finishes
+//     (count_done / encode_done stay set until the next clear)
+//   - pack_crc is taken on the packed words before Encrypt, so it
+//     matches what the decoder sees after decrypt; encoding a block
+//     archive one block per encode pass gives each block's payload
+//     CRC for the index
+//   - perf_count covers both passes: active = a word, symbol or
+//     packed word moved, in_stall = the pass waits on MM2S, out_stall
+//     = S2MM holds off a packed word, items = symbols, bits = packed
+//     bits sent (32 per word)
+
+module axis_compression_chain #(
+    parameter FIFO_DEPTH_LOG2 = 4,
+    parameter PERF_COUNTERS   = 1                // 1 = include perf_counters
+)(
+    input  wire         clock,
+    input  wire         reset,
+
+    // ------------------------------------------------------------------
+    // Control and status (AXI4-Lite registers)
+    // ------------------------------------------------------------------
+    input  wire         mode,                    // 0 = count, 1 = encode
+    input  wire         clear,                   // Start a pass (level signal)
+    input  wire [31:0]  block_words,             // Words in the block
+    input  wire         protect,                 // Encrypt the packed words (encode pass)
+    input  wire [31:0]  key,                     // Encryption key, written once per session
+    output wire         count_done,
+    output wire         encode_done,
+    output wire         freq_saturated,          // A histogram bin saturated (count pass)
+    output wire [31:0]  symbol_count,            // Symbols of the active pass
+    output wire [31:0]  pack_bits,               // Payload bits (encode pass)
+    output wire [31:0]  pack_crc,                // CRC-32 of the packed words (encode pass, see crc32_words)
+    output reg          irq,
+
+    // ------------------------------------------------------------------
+    // Word input from DMA MM2S (AXI4-Stream slave)
+    // ------------------------------------------------------------------
+    input  wire [31:0]  s_axis_tdata,
+    input  wire         s_axis_tvalid,
+    input  wire         s_axis_tlast,            // Ignored, see block_words
+    output wire         s_axis_tready,
+
+    // ------------------------------------------------------------------
+    // Packed payload output to DMA S2MM (AXI4-Stream master)
+    // ------------------------------------------------------------------
+    output wire [31:0]  m_axis_tdata,
+    output wire         m_axis_tvalid,
+    output wire         m_axis_tlast,
+    input  wire         m_axis_tready,
+
+    // ------------------------------------------------------------------
+    // Histogram read interface
+    // ------------------------------------------------------------------
+    input  wire [7:0]   freq_addr,
+    output wire [31:0]  freq_out,
+
+    // ------------------------------------------------------------------
+    // Huffman table load interface
+    // ------------------------------------------------------------------
+    input  wire [7:0]   load_symbol,
+    input  wire [15:0]  load_code,
+    input  wire [4:0]   load_length,
+    input  wire         load_valid,
+    output wire         load_valid_out,
+
+    // ------------------------------------------------------------------
+    // Huffman table window
+    // ------------------------------------------------------------------
+    input  wire         table_we,
+    input  wire [7:0]   table_addr,
+    input  wire [20:0]  table_wdata,
+    input  wire         table_commit,
+
+    // ------------------------------------------------------------------
+    // Performance counters (see perf_counters)
+    // ------------------------------------------------------------------
+    input  wire         perf_clear,              // Zero the counters (level signal)
+    output wire [191:0] perf_count
+);
+
+    // ------------------------------------------------------------------
+    // Edge detection for clear
+    // ------------------------------------------------------------------
+    reg  clear_d;
+    wire clear_pulse = clear & ~clear_d;
+
+    always @(posedge clock) begin
+        clear_d <= clear;
+    end
+
+    // ------------------------------------------------------------------
+    // Block framing
+    // ------------------------------------------------------------------
+    reg  [31:0] words_in;
+    wire        word_fire = s_axis_tvalid && s_axis_tready;
+    wire        word_last = (words_in == block_words - 1);
+
+    always @(posedge clock or posedge reset) begin
+        if (reset)
+            words_in <= 0;
+        else if (clear_pulse)
+            words_in <= 0;
+        else if (word_fire)
+            words_in <= words_in + 1;
+    end
+
+    // ------------------------------------------------------------------
+    // Bit parser
+    // ------------------------------------------------------------------
+    wire [7:0] sym_tdata;
+    wire       sym_tvalid, sym_tlast, sym_tready;
+    wire       parser_tready;
+
+    wire       encode_tready;
+    wire       word_open = (words_in < block_words);
+
+    // Words beyond block_words are not accepted
+    assign s_axis_tready = (mode ? encode_tready : parser_tready) && word_open;
+
+    axis_bit_parser parser (
+        .clock         (clock),
+        .reset         (reset),
+        .s_axis_tdata  (s_axis_tdata),
+        .s_axis_tvalid (s_axis_tvalid && word_open && !mode),
+        .s_axis_tlast  (word_last),
+        .s_axis_tready (parser_tready),
+        .m_axis_tdata  (sym_tdata),
+        .m_axis_tvalid (sym_tvalid),
+        .m_axis_tlast  (sym_tlast),
+        .m_axis_tready (sym_tready)
+    );
+
+    // ------------------------------------------------------------------
+    // Histogram (count pass)
+    // ------------------------------------------------------------------
+    wire [31:0] count_symbols, encode_symbols;
+
+    axis_frequency_counter counter (
+        .clock         (clock),
+        .reset         (reset),
+        .s_axis_tdata  (sym_tdata),
+        .s_axis_tvalid (sym_tvalid),
+        .s_axis_tlast  (sym_tlast),
+        .s_axis_tready (sym_tready),
+        .clear         (clear_pulse && !mode),
+        .done          (count_done),
+        .symbol_count  (count_symbols),
+        .freq_out      (freq_out),
+        .addr          (freq_addr),
+        .saturated     (freq_saturated)
+    );
+
+    // ------------------------------------------------------------------
+    // Encoder (encode pass), fed with whole words
+    // ------------------------------------------------------------------
+    wire [31:0] packed_tdata, protected_tdata;
+
+    axis_word_encoder #(
+        .FIFO_DEPTH_LOG2(FIFO_DEPTH_LOG2)
+    ) encoder (
+        .clock          (clock),
+        .reset          (reset),
+        .s_axis_tdata   (s_axis_tdata),
+        .s_axis_tvalid  (s_axis_tvalid && word_open && mode),
+        .s_axis_tlast   (word_last),
+        .s_axis_tready  (encode_tready),
+        .m_axis_tdata   (packed_tdata),
+        .m_axis_tvalid  (m_axis_tvalid),
+        .m_axis_tlast   (m_axis_tlast),
+        .m_axis_tready  (m_axis_tready),
+        .clear          (clear_pulse),
+        .done           (encode_done),
+        .symbol_count   (encode_symbols),
+        .pack_bits      (pack_bits),
+        .load_symbol    (load_symbol),
+        .load_code      (load_code),
+        .load_length    (load_length),
+        .load_valid     (load_valid),
+        .load_valid_out (load_valid_out),
+        .table_we       (table_we),
+        .table_addr     (table_addr),
+        .table_wdata    (table_wdata),
+        .table_commit   (table_commit)
+    );
+
+    assign symbol_count = mode ? encode_symbols : count_symbols;
+
+    // ------------------------------------------------------------------
+    // Protection of the packed payload
+    // ------------------------------------------------------------------
+    Encrypt #(
+        .WIDTH(32)
+    ) encryptor (
+        .data_in  (packed_tdata),
+        .key      (key),
+        .data_out (protected_tdata)
+    );
+
+    assign m_axis_tdata = protect ? protected_tdata : packed_tdata;
+
+    // ------------------------------------------------------------------
+    // Payload CRC of the encode pass
+    // ------------------------------------------------------------------
+    crc32_words pack_check (
+        .clock (clock),
+        .reset (reset),
+        .clear (clear_pulse),
+        .data  (packed_tdata),
+        .valid (m_axis_tvalid && m_axis_tready),
+        .crc   (pack_crc)
+    );
+
+    // ------------------------------------------------------------------
+    // Completion interrupt
+    // ------------------------------------------------------------------
+    reg pass_done_d;
+    wire pass_done = mode ? encode_done : count_done;
+
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            pass_done_d <= 0;
+            irq         <= 0;
+        end else begin
+            pass_done_d <= pass_done;
+            irq         <= pass_done & ~pass_done_d;
+        end
+    end
+
+    // ------------------------------------------------------------------
+    // Performance counters
+    // ------------------------------------------------------------------
+    reg  pass_open;   // Cleared, last result not yet out
+    wire sym_fire = sym_tvalid && sym_tready;
+    wire out_fire = m_axis_tvalid && m_axis_tready;
+
+    always @(posedge clock or posedge reset) begin
+        if (reset)
+            pass_open <= 0;
+        else if (clear_pulse)
+            pass_open <= 1;
+        else if (pass_done)
+            pass_open <= 0;
+    end
+
+    perf_counters #(
+        .ENABLE    (PERF_COUNTERS),
+        .ITEM_WIDTH(3),
+        .BITS_WIDTH(6)
+    ) perf (
+        .clock      (clock),
+        .reset      (reset),
+        .active     (word_fire || sym_fire || out_fire),
+        .in_stall   (pass_open && word_open && !s_axis_tvalid),
+        .out_stall  (m_axis_tvalid && !m_axis_tready),
+        .items      (mode ? (word_fire ? 3'd4 : 3'd0) : {2'b0, sym_fire}),
+        .bits       (out_fire ? 6'd32 : 6'd0),
+        .clear      (perf_clear),
+        .perf_count (perf_count)
+    );
+
+endmodule
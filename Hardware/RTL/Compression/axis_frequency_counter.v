@@ -0,0 +1,82 @@
+// Module: axis_frequency_counter
+// Description:
+//   AXI4-Stream Frequency Counter IP core.
+//   Streaming variant of frequency_counter: counts one 8-bit symbol
+//   per clock from an AXI4-Stream and raises done once the symbol
+//   carrying tlast has been counted.
+//
+//   The frequency table is read back exactly like frequency_counter
+//   (addr -> freq_out) once done is set.
+//
+// Notes:
+//   - Always ready: a table row is updated every cycle, back-to-back
+//     repeats of the same symbol read the value written the cycle
+//     before (register file, asynchronous read)
+//   - clear resets the whole table and done (one-cycle pulse)
+//   - Counters are 32 bits wide and saturate; saturated stays set
+//     until clear once any counter has stopped at 2^32 - 1
+
+module axis_frequency_counter (
+    input  wire        clock,
+    input  wire        reset,
+
+    // ------------------------------------------------------------------
+    // Symbol input (AXI4-Stream slave)
+    // ------------------------------------------------------------------
+    input  wire [7:0]  s_axis_tdata,
+    input  wire        s_axis_tvalid,
+    input  wire        s_axis_tlast,
+    output wire        s_axis_tready,
+
+    // ------------------------------------------------------------------
+    // Control, status and read interface (to processor / Vitis)
+    // ------------------------------------------------------------------
+    input  wire        clear,          // Clear table and done (pulse)
+    output reg         done,           // Last symbol of the block counted
+    output reg  [31:0] symbol_count,   // Symbols counted since clear
+    output wire [31:0] freq_out,       // Frequency read data
+    input  wire [7:0]  addr,           // Address to read freq_table
+    output reg         saturated       // A counter reached its maximum
+);
+
+    // ------------------------------------------------------------------
+    // Frequency table
+    // ------------------------------------------------------------------
+    reg [31:0] freq_table [0:255];
+    integer i;
+
+    assign s_axis_tready = 1'b1;
+    wire   s_fire        = s_axis_tvalid;
+    wire [31:0] count_value = freq_table[s_axis_tdata];
+    wire        count_full  = &count_value;
+
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            for (i = 0; i < 256; i = i + 1)
+                freq_table[i] <= 0;
+            done         <= 0;
+            symbol_count <= 0;
+            saturated    <= 0;
+        end else if (clear) begin
+            for (i = 0; i < 256; i = i + 1)
+                freq_table[i] <= 0;
+            done         <= 0;
+            symbol_count <= 0;
+            saturated    <= 0;
+        end else if (s_fire) begin
+            if (count_full)
+                saturated <= 1;
+            else
+                freq_table[s_axis_tdata] <= count_value + 1;
+            symbol_count             <= symbol_count + 1;
+            if (s_axis_tlast)
+                done <= 1;
+        end
+    end
+
+    // ------------------------------------------------------------------
+    // Frequency readout
+    // ------------------------------------------------------------------
+    assign freq_out = freq_table[addr];
+
+endmodule
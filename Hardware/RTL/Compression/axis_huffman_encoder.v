@@ -0,0 +1,212 @@
+// Module: axis_huffman_encoder
+// Description:
+//   AXI4-Stream Huffman Encoder IP core.
+//   Streaming variant of huffman: encodes one 8-bit symbol per clock
+//   from an AXI4-Stream, appends the codeword to a bit_packer and
+//   streams the packed MSB-first 32-bit payload words out, ending
+//   the packet with tlast on the zero-padded tail word.
+//
+//   The codebook is loaded through the same (symbol, codeword,
+//   length) interface or table window (shadow bank + commit) as
+//   huffman before the stream starts.
+//
+// Notes:
+//   - Input stalls (tready low) while the packer FIFO is nearly
+//     full, so no packed word is ever dropped
+//   - The newest packed word is held back until the next one exists
+//     or the stream ends, so tlast can always be set on the last beat
+//   - Once the symbol carrying tlast is accepted the input stays
+//     closed until clear; done rises after the tail word has left
+//   - load_valid and table_commit are edge-detected (one-shot),
+//     clear is a pulse
+//   - Write all 256 table entries before each commit (see huffman)
+
+module axis_huffman_encoder #(
+    parameter FIFO_DEPTH_LOG2 = 4                // 16-word packed FIFO
+)(
+    input  wire         clock,
+    input  wire         reset,
+
+    // ------------------------------------------------------------------
+    // Symbol input (AXI4-Stream slave)
+    // ------------------------------------------------------------------
+    input  wire [7:0]   s_axis_tdata,
+    input  wire         s_axis_tvalid,
+    input  wire         s_axis_tlast,
+    output wire         s_axis_tready,
+
+    // ------------------------------------------------------------------
+    // Packed payload output (AXI4-Stream master)
+    // ------------------------------------------------------------------
+    output wire [31:0]  m_axis_tdata,
+    output wire         m_axis_tvalid,
+    output wire         m_axis_tlast,
+    input  wire         m_axis_tready,
+
+    // ------------------------------------------------------------------
+    // Control and status
+    // ------------------------------------------------------------------
+    input  wire         clear,                   // Start a new stream (pulse)
+    output wire         done,                    // Tail word has been sent
+    output reg  [31:0]  symbol_count,            // Symbols encoded since clear
+    output wire [31:0]  pack_bits,               // Payload bits since clear
+
+    // ------------------------------------------------------------------
+    // Huffman table load interface (from Vitis software)
+    // ------------------------------------------------------------------
+    input  wire [7:0]   load_symbol,             // Symbol index (0–255)
+    input  wire [15:0]  load_code,               // Huffman codeword
+    input  wire [4:0]   load_length,             // Codeword length
+    input  wire         load_valid,              // Load request (level signal)
+    output reg          load_valid_out,          // Acknowledge
+
+    // ------------------------------------------------------------------
+    // Table window (whole-codebook load)
+    // ------------------------------------------------------------------
+    input  wire         table_we,                // Write table_wdata to the shadow bank
+    input  wire [7:0]   table_addr,              // Symbol index
+    input  wire [20:0]  table_wdata,             // {length[20:16], code[15:0]}
+    input  wire         table_commit             // Make the shadow bank active (level signal)
+);
+
+    localparam DEPTH = 1 << FIFO_DEPTH_LOG2;
+
+    // ------------------------------------------------------------------
+    // Huffman lookup tables
+    // ------------------------------------------------------------------
+    // Two banks, {bank, symbol}; the active one is selected by bank
+    reg [15:0] huff_code   [0:511];
+    reg [4:0]  huff_length [0:511];
+    reg        bank;
+
+    // ------------------------------------------------------------------
+    // Huffman table loading logic
+    // ------------------------------------------------------------------
+    reg  load_valid_d, table_commit_d;
+    wire load_valid_pulse = load_valid & ~load_valid_d;
+
+    always @(posedge clock) begin
+        load_valid_d   <= load_valid;
+        table_commit_d <= table_commit;
+    end
+
+    always @(posedge clock) begin
+        if (table_we) begin
+            huff_code[{~bank, table_addr}]   <= table_wdata[15:0];
+            huff_length[{~bank, table_addr}] <= table_wdata[20:16];
+        end else if (load_valid_pulse) begin
+            huff_code[{bank, load_symbol}]   <= load_code;
+            huff_length[{bank, load_symbol}] <= load_length;
+        end
+    end
+
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            load_valid_out <= 0;
+            bank           <= 0;
+        end else begin
+            if (table_commit & ~table_commit_d)
+                bank <= ~bank;
+
+            if (load_valid_pulse) begin
+                load_valid_out <= 1;
+            end else if (!load_valid) begin
+                load_valid_out <= 0;
+            end
+        end
+    end
+
+    // ------------------------------------------------------------------
+    // Stream control
+    // ------------------------------------------------------------------
+    wire [FIFO_DEPTH_LOG2:0] word_count;
+    wire        word_valid;
+    wire [31:0] word_out;
+
+    reg         sealed;          // Last symbol accepted, input closed
+    reg         flush_pending;   // Last codeword appended, tail not yet pushed
+    reg         flushed;         // Tail pushed, FIFO holds the rest of the packet
+
+    // At most one codeword is in flight between tready and the FIFO,
+    // and it completes at most one word.
+    assign s_axis_tready = !sealed && (word_count <= DEPTH - 2);
+    wire   s_fire        = s_axis_tvalid && s_axis_tready;
+
+    wire   flush = flush_pending && (word_count != DEPTH);
+
+    assign m_axis_tvalid = (word_count > 1) || (word_valid && flushed);
+    assign m_axis_tlast  = flushed && (word_count == 1);
+    assign m_axis_tdata  = word_out;
+    wire   m_fire        = m_axis_tvalid && m_axis_tready;
+
+    assign done = flushed && !word_valid;
+
+    // ------------------------------------------------------------------
+    // Huffman encoding logic
+    // ------------------------------------------------------------------
+    // One registered lookup per accepted symbol; the codeword enters
+    // the packer on the following cycle.
+    reg  [15:0] code_word;
+    reg  [4:0]  code_length;
+    reg         code_strobe;
+    reg         code_last;
+
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            code_word     <= 0;
+            code_length   <= 0;
+            code_strobe   <= 0;
+            code_last     <= 0;
+            sealed        <= 0;
+            flush_pending <= 0;
+            flushed       <= 0;
+            symbol_count  <= 0;
+        end else if (clear) begin
+            code_strobe   <= 0;
+            code_last     <= 0;
+            sealed        <= 0;
+            flush_pending <= 0;
+            flushed       <= 0;
+            symbol_count  <= 0;
+        end else begin
+            code_strobe <= s_fire;
+            code_last   <= s_fire && s_axis_tlast;
+            if (s_fire) begin
+                code_word    <= huff_code[{bank, s_axis_tdata}];
+                code_length  <= huff_length[{bank, s_axis_tdata}];
+                symbol_count <= symbol_count + 1;
+                if (s_axis_tlast)
+                    sealed <= 1;
+            end
+
+            if (code_strobe && code_last)
+                flush_pending <= 1;
+            else if (flush) begin
+                flush_pending <= 0;
+                flushed       <= 1;
+            end
+        end
+    end
+
+    // ------------------------------------------------------------------
+    // Bit packer
+    // ------------------------------------------------------------------
+    bit_packer #(
+        .FIFO_DEPTH_LOG2(FIFO_DEPTH_LOG2)
+    ) packer (
+        .clock      (clock),
+        .reset      (reset),
+        .code_in    (code_word),
+        .length_in  (code_length),
+        .code_valid (code_strobe),
+        .flush      (flush),
+        .clear      (clear),
+        .word_out   (word_out),
+        .word_valid (word_valid),
+        .word_read  (m_fire),
+        .word_count (word_count),
+        .total_bits (pack_bits),
+        .overflow   ()
+    );
+
+endmodule
@@ -0,0 +1,281 @@
+// Module: axis_word_encoder
+// Description:
+//   AXI4-Stream 4-lane Huffman Encoder IP core.
+//   Fuses bit_parser, the codebook lookup and the packer: takes whole
+//   32-bit configuration words from an AXI4-Stream, splits each into
+//   its four symbols, looks all four up in parallel and appends the
+//   merged codewords to a word_packer, so one input word is encoded
+//   per clock (axis_bit_parser -> axis_huffman_encoder takes four).
+//   The packed MSB-first 32-bit payload words stream out exactly as
+//   from axis_huffman_encoder, with tlast on the zero-padded tail word.
+//
+//   Pipeline (one word per stage):
+//     lookup : four table reads, one per symbol (lane)
+//     pair   : lanes 0+1 and 2+3 concatenated (up to 32 bits each)
+//     group  : both pairs concatenated (up to 64 bits) -> packer
+//
+//   The codebook is loaded through the same (symbol, codeword,
+//   length) interface or table window (shadow bank + commit) as
+//   huffman before the stream starts; every write goes to all four
+//   lane copies.
+//
+// Notes:
+//   - Each lane has its own copy of both banks (4 x 512 x 21 bits),
+//     so the four lookups need no multi-ported RAM
+//   - Input stalls (tready low) while the packer FIFO could not take
+//     the words of every group in flight (two per group), so no
+//     packed word is ever dropped; FIFO_DEPTH_LOG2 must be >= 4
+//   - The newest packed word is held back until the next one exists
+//     or the stream ends, so tlast can always be set on the last beat
+//   - Once the word carrying tlast is accepted the input stays
+//     closed until clear; done rises after the tail word has left
+//   - symbol_count counts four symbols per word
+//   - load_valid and table_commit are edge-detected (one-shot),
+//     clear is a pulse
+//   - Write all 256 table entries before each commit (see huffman)
+
+module axis_word_encoder #(
+    parameter FIFO_DEPTH_LOG2 = 4                // 16-word packed FIFO
+)(
+    input  wire         clock,
+    input  wire         reset,
+
+    // ------------------------------------------------------------------
+    // Word input (AXI4-Stream slave)
+    // ------------------------------------------------------------------
+    input  wire [31:0]  s_axis_tdata,
+    input  wire         s_axis_tvalid,
+    input  wire         s_axis_tlast,
+    output wire         s_axis_tready,
+
+    // ------------------------------------------------------------------
+    // Packed payload output (AXI4-Stream master)
+    // ------------------------------------------------------------------
+    output wire [31:0]  m_axis_tdata,
+    output wire         m_axis_tvalid,
+    output wire         m_axis_tlast,
+    input  wire         m_axis_tready,
+
+    // ------------------------------------------------------------------
+    // Control and status
+    // ------------------------------------------------------------------
+    input  wire         clear,                   // Start a new stream (pulse)
+    output wire         done,                    // Tail word has been sent
+    output reg  [31:0]  symbol_count,            // Symbols encoded since clear
+    output wire [31:0]  pack_bits,               // Payload bits since clear
+
+    // ------------------------------------------------------------------
+    // Huffman table load interface (from Vitis software)
+    // ------------------------------------------------------------------
+    input  wire [7:0]   load_symbol,             // Symbol index (0–255)
+    input  wire [15:0]  load_code,               // Huffman codeword
+    input  wire [4:0]   load_length,             // Codeword length
+    input  wire         load_valid,              // Load request (level signal)
+    output reg          load_valid_out,          // Acknowledge
+
+    // ------------------------------------------------------------------
+    // Table window (whole-codebook load)
+    // ------------------------------------------------------------------
+    input  wire         table_we,                // Write table_wdata to the shadow bank
+    input  wire [7:0]   table_addr,              // Symbol index
+    input  wire [20:0]  table_wdata,             // {length[20:16], code[15:0]}
+    input  wire         table_commit             // Make the shadow bank active (level signal)
+);
+
+    localparam DEPTH = 1 << FIFO_DEPTH_LOG2;
+
+    // ------------------------------------------------------------------
+    // Huffman table loading logic
+    // ------------------------------------------------------------------
+    reg  bank;
+    reg  load_valid_d, table_commit_d;
+    wire load_valid_pulse = load_valid & ~load_valid_d;
+
+    always @(posedge clock) begin
+        load_valid_d   <= load_valid;
+        table_commit_d <= table_commit;
+    end
+
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            load_valid_out <= 0;
+            bank           <= 0;
+        end else begin
+            if (table_commit & ~table_commit_d)
+                bank <= ~bank;
+
+            if (load_valid_pulse) begin
+                load_valid_out <= 1;
+            end else if (!load_valid) begin
+                load_valid_out <= 0;
+            end
+        end
+    end
+
+    // ------------------------------------------------------------------
+    // Stream control
+    // ------------------------------------------------------------------
+    wire [FIFO_DEPTH_LOG2:0] word_count;
+    wire        word_valid;
+    wire [31:0] word_out;
+
+    reg         sealed;          // Last word accepted, input closed
+    reg         flush_pending;   // Last group appended, tail not yet pushed
+    reg         flushed;         // Tail pushed, FIFO holds the rest of the packet
+
+    // Up to three groups are in flight between tready and the FIFO
+    // (lookup, pair, group) and a fourth is accepted now; each
+    // completes at most two words.
+    assign s_axis_tready = !sealed && (word_count <= DEPTH - 8);
+    wire   s_fire        = s_axis_tvalid && s_axis_tready;
+
+    wire   flush = flush_pending && (word_count != DEPTH);
+
+    assign m_axis_tvalid = (word_count > 1) || (word_valid && flushed);
+    assign m_axis_tlast  = flushed && (word_count == 1);
+    assign m_axis_tdata  = word_out;
+    wire   m_fire        = m_axis_tvalid && m_axis_tready;
+
+    assign done = flushed && !word_valid;
+
+    // ------------------------------------------------------------------
+    // Bit parser
+    // ------------------------------------------------------------------
+    wire [7:0]  out_1, out_2, out_3, out_4;
+    wire [31:0] lane_symbols = {out_1, out_2, out_3, out_4};
+
+    bit_parser parser (
+        .data_in (s_axis_tdata),
+        .out_1   (out_1),
+        .out_2   (out_2),
+        .out_3   (out_3),
+        .out_4   (out_4)
+    );
+
+    // ------------------------------------------------------------------
+    // Lookup lanes
+    // ------------------------------------------------------------------
+    // Lane k encodes byte k of the word (0 = MSB, the first symbol).
+    // Every copy of the table takes every write.
+    genvar k;
+    generate
+        for (k = 0; k < 4; k = k + 1) begin : lane
+            reg [15:0] huff_code   [0:511];
+            reg [4:0]  huff_length [0:511];
+            reg [15:0] code_word;
+            reg [4:0]  code_length;
+            wire [7:0] symbol = lane_symbols[31 - 8 * k -: 8];
+
+            always @(posedge clock) begin
+                if (table_we) begin
+                    huff_code[{~bank, table_addr}]   <= table_wdata[15:0];
+                    huff_length[{~bank, table_addr}] <= table_wdata[20:16];
+                end else if (load_valid_pulse) begin
+                    huff_code[{bank, load_symbol}]   <= load_code;
+                    huff_length[{bank, load_symbol}] <= load_length;
+                end
+            end
+
+            always @(posedge clock) begin
+                if (s_fire) begin
+                    code_word   <= huff_code[{bank, symbol}];
+                    code_length <= huff_length[{bank, symbol}];
+                end
+            end
+        end
+    endgenerate
+
+    // ------------------------------------------------------------------
+    // Codeword merging
+    // ------------------------------------------------------------------
+    // pair  : {lane 0, lane 1} and {lane 2, lane 3}, right-aligned
+    // group : {pair 0, pair 1}, appended to the packer the cycle after
+    reg         lookup_valid, lookup_last;
+    reg  [31:0] pair_hi, pair_lo;
+    reg  [5:0]  pair_hi_length, pair_lo_length;
+    reg         pair_valid, pair_last;
+    reg  [63:0] group_code;
+    reg  [6:0]  group_length;
+    reg         group_valid, group_last;
+
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            lookup_valid   <= 0;
+            lookup_last    <= 0;
+            pair_hi        <= 0;
+            pair_lo        <= 0;
+            pair_hi_length <= 0;
+            pair_lo_length <= 0;
+            pair_valid     <= 0;
+            pair_last      <= 0;
+            group_code     <= 0;
+            group_length   <= 0;
+            group_valid    <= 0;
+            group_last     <= 0;
+            sealed         <= 0;
+            flush_pending  <= 0;
+            flushed        <= 0;
+            symbol_count   <= 0;
+        end else if (clear) begin
+            lookup_valid   <= 0;
+            pair_valid     <= 0;
+            group_valid    <= 0;
+            sealed         <= 0;
+            flush_pending  <= 0;
+            flushed        <= 0;
+            symbol_count   <= 0;
+        end else begin
+            lookup_valid <= s_fire;
+            lookup_last  <= s_fire && s_axis_tlast;
+            if (s_fire) begin
+                symbol_count <= symbol_count + 4;
+                if (s_axis_tlast)
+                    sealed <= 1;
+            end
+
+            pair_valid <= lookup_valid;
+            pair_last  <= lookup_last;
+            if (lookup_valid) begin
+                pair_hi        <= ({16'b0, lane[0].code_word} << lane[1].code_length) | lane[1].code_word;
+                pair_lo        <= ({16'b0, lane[2].code_word} << lane[3].code_length) | lane[3].code_word;
+                pair_hi_length <= lane[0].code_length + lane[1].code_length;
+                pair_lo_length <= lane[2].code_length + lane[3].code_length;
+            end
+
+            group_valid <= pair_valid;
+            group_last  <= pair_valid && pair_last;
+            if (pair_valid) begin
+                group_code   <= ({32'b0, pair_hi} << pair_lo_length) | pair_lo;
+                group_length <= pair_hi_length + pair_lo_length;
+            end
+
+            if (group_valid && group_last)
+                flush_pending <= 1;
+            else if (flush) begin
+                flush_pending <= 0;
+                flushed       <= 1;
+            end
+        end
+    end
+
+    // ------------------------------------------------------------------
+    // Word packer
+    // ------------------------------------------------------------------
+    word_packer #(
+        .FIFO_DEPTH_LOG2(FIFO_DEPTH_LOG2)
+    ) packer (
+        .clock      (clock),
+        .reset      (reset),
+        .code_in    (group_code),
+        .length_in  (group_length),
+        .code_valid (group_valid),
+        .flush      (flush),
+        .clear      (clear),
+        .word_out   (word_out),
+        .word_valid (word_valid),
+        .word_read  (m_fire),
+        .word_count (word_count),
+        .total_bits (pack_bits)
+    );
+
+endmodule
@@ -0,0 +1,154 @@
+// Module: axis_zero_run_encoder
+// Description:
+//   AXI4-Stream zero-run model (ZRLE_MODEL in the software).
+//   Drop-in replacement for axis_bit_parser in front of the
+//   frequency counter / Huffman encoder: accepts 32-bit configuration
+//   words and emits 8-bit tokens of the same alphabet, so runs of
+//   zero or repeated words cost two symbols instead of four per word.
+//
+//   Tokens (E = escape):
+//     b        literal symbol b (b != E), words MSB first
+//     E 00     literal E
+//     E 01-7F  1..127 zero words
+//     E 80-FF  1..128 repeats of the previous word
+//
+// Example (E = 06):
+//   Input  : 00000000, 00000000, 00000000, 12340612 (tlast = 1)
+//   Output : 06 03, 12 34 06 00 12 (tlast on the last)
+//
+// Notes:
+//   - Produces the same tokens as zrle_encode() in zrle.c, one block
+//     per tlast (no run or repeat crosses a block boundary)
+//   - escape must stay constant for the whole block; software picks
+//     the least frequent symbol
+//   - A word is accepted when the previous word's tokens have all
+//     left (up to 10: a closed run plus an escaped literal), one
+//     token per clock
+
+module axis_zero_run_encoder (
+    input  wire        clock,
+    input  wire        reset,
+    input  wire [7:0]  escape,
+
+    // ------------------------------------------------------------------
+    // 32-bit word input (AXI4-Stream slave)
+    // ------------------------------------------------------------------
+    input  wire [31:0] s_axis_tdata,
+    input  wire        s_axis_tvalid,
+    input  wire        s_axis_tlast,
+    output wire        s_axis_tready,
+
+    // ------------------------------------------------------------------
+    // 8-bit token output (AXI4-Stream master)
+    // ------------------------------------------------------------------
+    output wire [7:0]  m_axis_tdata,
+    output wire        m_axis_tvalid,
+    output wire        m_axis_tlast,
+    input  wire        m_axis_tready
+);
+
+    localparam RUN_NONE   = 2'd0;
+    localparam RUN_ZERO   = 2'd1;
+    localparam RUN_REPEAT = 2'd2;
+
+    localparam ZERO_MAX   = 8'd127;
+    localparam REPEAT_MAX = 8'd128;
+
+    // ------------------------------------------------------------------
+    // Run state
+    // ------------------------------------------------------------------
+    reg [1:0]  run_kind;         // open run, not yet emitted
+    reg [7:0]  run_len;
+    reg [31:0] prev_word;
+    reg        have_prev;        // prev_word belongs to this block
+
+    // ------------------------------------------------------------------
+    // Token queue, first token in the top byte
+    // ------------------------------------------------------------------
+    reg [79:0] queue;
+    reg [3:0]  queue_len;
+    reg        queue_last;       // last token of the queue ends the block
+
+    wire m_fire = m_axis_tvalid && m_axis_tready;
+
+    assign m_axis_tvalid = (queue_len != 0);
+    assign m_axis_tdata  = queue[79:72];
+    assign m_axis_tlast  = queue_last && (queue_len == 4'd1);
+    assign s_axis_tready = (queue_len == 0);
+    wire   s_fire        = s_axis_tvalid && s_axis_tready;
+
+    // ------------------------------------------------------------------
+    // Next run state and the tokens of the incoming word
+    // ------------------------------------------------------------------
+    wire is_zero   = (s_axis_tdata == 32'd0);
+    wire is_repeat = !is_zero && have_prev && (s_axis_tdata == prev_word);
+    wire extend    = (is_zero   && run_kind == RUN_ZERO   && run_len < ZERO_MAX) ||
+                     (is_repeat && run_kind == RUN_REPEAT && run_len < REPEAT_MAX);
+
+    wire [1:0] new_kind = is_zero ? RUN_ZERO : is_repeat ? RUN_REPEAT : RUN_NONE;
+    wire [7:0] new_len  = extend ? run_len + 8'd1 : 8'd1;
+
+    wire close_old = (run_kind != RUN_NONE) && !extend;
+    wire close_new = s_axis_tlast && (new_kind != RUN_NONE);
+
+    wire [7:0] old_code = (run_kind == RUN_ZERO) ? run_len : 8'h7F + run_len;
+    wire [7:0] new_code = (new_kind == RUN_ZERO) ? new_len : 8'h7F + new_len;
+
+    reg [79:0] seq;
+    reg [3:0]  seq_len;
+    reg [7:0]  b;
+    integer k;
+
+    always @(*) begin
+        seq     = 80'd0;
+        seq_len = 4'd0;
+
+        if (close_old) begin
+            seq[79 - 8*seq_len -: 8] = escape;   seq_len = seq_len + 1;
+            seq[79 - 8*seq_len -: 8] = old_code; seq_len = seq_len + 1;
+        end
+
+        if (new_kind == RUN_NONE) begin
+            for (k = 0; k < 4; k = k + 1) begin
+                b = s_axis_tdata[31 - 8*k -: 8];
+                seq[79 - 8*seq_len -: 8] = b; seq_len = seq_len + 1;
+                if (b == escape) begin
+                    seq[79 - 8*seq_len -: 8] = 8'h00; seq_len = seq_len + 1;
+                end
+            end
+        end
+
+        if (close_new) begin
+            seq[79 - 8*seq_len -: 8] = escape;   seq_len = seq_len + 1;
+            seq[79 - 8*seq_len -: 8] = new_code; seq_len = seq_len + 1;
+        end
+    end
+
+    // ------------------------------------------------------------------
+    // Sequential logic
+    // ------------------------------------------------------------------
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            run_kind   <= RUN_NONE;
+            run_len    <= 0;
+            prev_word  <= 0;
+            have_prev  <= 0;
+            queue      <= 0;
+            queue_len  <= 0;
+            queue_last <= 0;
+        end else if (s_fire) begin
+            queue      <= seq;
+            queue_len  <= seq_len;
+            queue_last <= s_axis_tlast;
+
+            run_kind   <= s_axis_tlast ? RUN_NONE : new_kind;
+            run_len    <= new_len;
+            prev_word  <= s_axis_tdata;
+            have_prev  <= !s_axis_tlast;
+        end else if (m_fire) begin
+            queue     <= {queue[71:0], 8'd0};
+            queue_len <= queue_len - 1;
+        end
+    end
+
+endmodule
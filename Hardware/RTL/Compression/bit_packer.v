@@ -0,0 +1,130 @@
+// Module: bit_packer
+// Description:
+//   Bit Packer core.
+//   Appends variable-length Huffman codewords to a 64-bit
+//   accumulator and emits every completed 32-bit word, MSB-first,
+//   into a small output FIFO. This is the packed COMP.BIN payload
+//   layout: the first bit of the first codeword lands in bit 31 of
+//   the first word.
+//
+// Example:
+//   Codes  : 1 (len 1), 00001 (len 5), 000101 (len 6), ...
+//   Word 0 : 1 00001 000101 .... (bits 31..20, emitted once 32 are filled)
+//
+// Notes:
+//   - code_in must be right-aligned with zero upper bits
+//   - One codeword is accepted per cycle (code_valid)
+//   - flush pushes the zero-padded partial tail word; it is ignored
+//     in a cycle that also carries code_valid
+//   - total_bits counts every appended bit since the last clear
+//   - overflow is sticky: a word completed while the FIFO was full
+//     (and not popped that cycle) is lost, so software must drain
+//     often enough
+
+module bit_packer #(
+    parameter FIFO_DEPTH_LOG2 = 4                // 16-word output FIFO
+)(
+    input  wire         clock,
+    input  wire         reset,
+
+    // ------------------------------------------------------------------
+    // Codeword input
+    // ------------------------------------------------------------------
+    input  wire [15:0]  code_in,                 // Right-aligned codeword
+    input  wire [4:0]   length_in,               // Valid bits in code_in
+    input  wire         code_valid,              // Append code_in this cycle
+
+    // ------------------------------------------------------------------
+    // Control (one-cycle pulses)
+    // ------------------------------------------------------------------
+    input  wire         flush,                   // Emit the partial tail word
+    input  wire         clear,                   // Start a new stream
+
+    // ------------------------------------------------------------------
+    // Packed word output (FIFO head)
+    // ------------------------------------------------------------------
+    output wire [31:0]  word_out,                // Oldest completed word
+    output wire         word_valid,              // FIFO not empty
+    input  wire         word_read,               // Pop word_out (one-cycle pulse)
+    output reg  [FIFO_DEPTH_LOG2:0] word_count,  // Words waiting in the FIFO
+    output reg  [31:0]  total_bits,              // Bits appended since clear
+    output reg          overflow                 // Word dropped on a full FIFO
+);
+
+    localparam DEPTH = 1 << FIFO_DEPTH_LOG2;
+
+    // ------------------------------------------------------------------
+    // Accumulator
+    // ------------------------------------------------------------------
+    // acc holds the pending bits right-aligned; acc_bits < 32 between
+    // cycles, so one append completes at most one word.
+    reg  [63:0] acc;
+    reg  [5:0]  acc_bits;
+
+    wire [63:0] acc_app  = (acc << length_in) | {48'b0, code_in};
+    wire [6:0]  bits_app = acc_bits + length_in;
+    wire        word_done = code_valid && (bits_app >= 32);
+    wire [63:0] word_sh  = acc_app >> (bits_app - 32);
+
+    wire        tail_push = flush && !code_valid && (acc_bits != 0);
+    wire [31:0] tail_word = acc[31:0] << (32 - acc_bits);
+
+    // ------------------------------------------------------------------
+    // Output FIFO
+    // ------------------------------------------------------------------
+    reg  [31:0] fifo [0:DEPTH-1];
+    reg  [FIFO_DEPTH_LOG2-1:0] wr_ptr, rd_ptr;
+
+    wire push   = word_done || tail_push;
+    wire pop    = word_read && (word_count != 0);
+    wire full   = (word_count == DEPTH);
+    wire accept = push && (!full || pop);
+
+    assign word_out   = fifo[rd_ptr];
+    assign word_valid = (word_count != 0);
+
+    always @(posedge clock) begin
+        if (accept)
+            fifo[wr_ptr] <= word_done ? word_sh[31:0] : tail_word;
+    end
+
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            acc        <= 0;
+            acc_bits   <= 0;
+            total_bits <= 0;
+            wr_ptr     <= 0;
+            rd_ptr     <= 0;
+            word_count <= 0;
+            overflow   <= 0;
+        end else if (clear) begin
+            acc        <= 0;
+            acc_bits   <= 0;
+            total_bits <= 0;
+            wr_ptr     <= 0;
+            rd_ptr     <= 0;
+            word_count <= 0;
+            overflow   <= 0;
+        end else begin
+            // Accumulator update
+            if (code_valid) begin
+                acc        <= acc_app;
+                acc_bits   <= word_done ? bits_app - 32 : bits_app;
+                total_bits <= total_bits + length_in;
+            end else if (tail_push) begin
+                acc      <= 0;
+                acc_bits <= 0;
+            end
+
+            // FIFO pointers
+            if (push && !accept)
+                overflow <= 1;
+            if (accept)
+                wr_ptr <= wr_ptr + 1;
+            if (pop)
+                rd_ptr <= rd_ptr + 1;
+            word_count <= word_count + accept - pop;
+        end
+    end
+
+endmodule
@@ -1,27 +1,33 @@
 // Module: Encrypt
 // Description:
 //   Lightweight encryption IP core.
-//   Applies a reversible transformation to each 8-bit input byte
-//   using bitwise inversion followed by XOR with an 8-bit key.
+//   Applies a reversible transformation to each input word using
+//   bitwise inversion followed by XOR with a key of the same width.
 //
 //   Encryption operation:
 //     data_out = (~data_in) ^ key
 //
+//   WIDTH = 32 protects a whole word (4 archive bytes) per AXI-Lite
+//   write/read pair; with the 8-bit key replicated in every byte lane
+//   the result is the same as byte by byte. The key register only
+//   needs writing once per session.
+//
 // Notes:
 //   - This is NOT cryptographically secure encryption
 //   - Intended as lightweight protection for compressed bitstreams
 //   - Fully reversible when the same key is used for decryption
 //   - Stateless and purely combinational
 
-module Encrypt(
-    input  wire [7:0] data_in,   // Input data byte
-    input  wire [7:0] key,        // 8-bit encryption key
-    output wire [7:0] data_out    // Encrypted output byte
+module Encrypt #(
+    parameter WIDTH = 32
+)(
+    input  wire [WIDTH-1:0] data_in,   // Input data word
+    input  wire [WIDTH-1:0] key,       // Encryption key (keystream word)
+    output wire [WIDTH-1:0] data_out   // Encrypted output word
 );
-    wire [7:0] dash_data_in;
+    wire [WIDTH-1:0] dash_data_in;
 
     // Bitwise inversion of input data
-    // (equivalent to 255 - data_in for 8-bit values)
     assign dash_data_in = ~data_in;
 
     // XOR inverted data with key
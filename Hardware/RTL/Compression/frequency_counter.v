@@ -19,12 +19,35 @@
 //   00000110          1
 //   ........        ....
 //
+// Burst mode:
+//   With burst = 1 the load handshake is ignored and a whole block of
+//   block_words 32-bit words is counted from the stream port, four
+//   symbols per word, MSB first (the bit_parser order). The port can
+//   be fed by an AXI DMA MM2S channel or by one AXI-Lite word write per
+//   beat. block_done rises once when the last symbol has been counted
+//   (right away for block_words = 0) and irq pulses with it.
+//
 // Notes:
-//   - One symbol is counted per load pulse
+//   - One symbol is counted per load pulse, or per symbol_we strobe:
+//     the wrapper raises symbol_we with the write of the symbol
+//     register, so software counts a symbol with that single write (no
+//     load / done round trip)
+//   - Burst mode counts one symbol per clock, so the stream port
+//     accepts a word every 4 cycles: the next word is taken in the
+//     cycle the last lane of the current one is counted
+//   - clear (edge-detected) resets the table and block_done; the
+//     handshake path never clears the table, only reset does
 //   - Frequency table supports up to 256 symbols
+//   - Counters are 32 bits wide and saturate at 2^32 - 1; saturated
+//     is set (until clear or reset) once any counter has stopped,
+//     so a clipped histogram is never mistaken for a real one
 //   - Frequencies are readable asynchronously via addr
+//   - perf_count: active = symbols counted, in_stall = burst block
+//     open but no stream word, items = symbols counted
 
-module frequency_counter (
+module frequency_counter #(
+    parameter PERF_COUNTERS = 1     // 1 = include perf_counters
+)(
     input clk,
     input reset,
 
@@ -33,21 +56,41 @@ module frequency_counter (
     // ------------------------------------------------------------------
     input [7:0] symbol,      // 8-bit symbol to be counted
     input load,              // Load request (level signal)
+    input symbol_we,         // Count symbol now (one cycle, symbol already written)
 
     // ------------------------------------------------------------------
     // Status and read interface (to processor / Vitis)
     // ------------------------------------------------------------------
     output reg done,         // One-cycle acknowledge pulse
-    output [23:0] freq_out,  // Frequency read data
-    input  [7:0] addr        // Address to read freq_table
+    output [31:0] freq_out,  // Frequency read data
+    input  [7:0] addr,       // Address to read freq_table
+    output reg saturated,    // A counter reached its maximum
+
+    // ------------------------------------------------------------------
+    // Burst interface
+    // ------------------------------------------------------------------
+    input         burst,            // 1 = count the stream port
+    input         clear,            // Clear table and block_done (level signal)
+    input  [31:0] block_words,      // Words in the block
+    input  [31:0] s_axis_tdata,     // 4 symbols, MSB first
+    input         s_axis_tvalid,
+    output        s_axis_tready,
+    output reg    block_done,       // Last symbol of the block counted
+    output reg    irq,              // One-cycle pulse when block_done rises
+
+    // ------------------------------------------------------------------
+    // Performance counters (see perf_counters)
+    // ------------------------------------------------------------------
+    input          perf_clear,      // Zero the counters (level signal)
+    output [191:0] perf_count
 );
 
     // ------------------------------------------------------------------
     // Frequency table
     // ------------------------------------------------------------------
     // Each index corresponds directly to one 8-bit symbol
-    // Width allows counting up to 2^24 occurrences per symbol
-    reg [23:0] freq_table [0:255];
+    // Width allows counting up to 2^32 - 1 occurrences per symbol
+    reg [31:0] freq_table [0:255];
     integer i;
 
     // ------------------------------------------------------------------
@@ -64,20 +107,98 @@ module frequency_counter (
     // Rising-edge detection
     assign load_pulse = load & ~load_d;
 
+    reg  clear_d;
+    wire clear_pulse = clear & ~clear_d;
+
+    always @(posedge clk) begin
+        clear_d <= clear;
+    end
+
+    // ------------------------------------------------------------------
+    // Burst word unpacking
+    // ------------------------------------------------------------------
+    // A word is held while its four symbols are counted, one per clock;
+    // the next one is taken with lane 3, so words follow back to back
+    reg  [31:0] burst_word;
+    reg  [1:0]  lane;
+    reg         busy;
+    reg  [31:0] words_in;
+
+    wire   last_lane     = busy && (lane == 2'd3);
+    assign s_axis_tready = burst && (!busy || last_lane) && !block_done && (words_in < block_words);
+    wire   word_fire     = s_axis_tvalid && s_axis_tready;
+    wire   [7:0] burst_symbol = burst_word[31 - 8*lane -: 8];
+    // No word can fire once words_in reaches block_words, so lane 3 of
+    // that word is the last symbol; an empty block is done at once
+    wire   last_symbol   = (last_lane && (words_in == block_words)) ||
+                           (burst && !busy && (block_words == 0));
+
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            burst_word <= 0;
+            lane       <= 0;
+            busy       <= 0;
+            words_in   <= 0;
+            block_done <= 0;
+        end else if (clear_pulse) begin
+            lane       <= 0;
+            busy       <= 0;
+            words_in   <= 0;
+            block_done <= 0;
+        end else begin
+            if (word_fire) begin
+                burst_word <= s_axis_tdata;
+                lane       <= 0;
+                busy       <= 1;
+                words_in   <= words_in + 1;
+            end else if (busy) begin
+                lane <= lane + 1;
+                if (lane == 2'd3)
+                    busy <= 0;
+            end
+
+            if (last_symbol)
+                block_done <= 1;
+        end
+    end
+
     // ------------------------------------------------------------------
     // Frequency counting logic
     // ------------------------------------------------------------------
+    // Symbol being counted this cycle (burst lane or handshake symbol)
+    wire [7:0]  count_symbol = burst ? burst_symbol : symbol;
+    wire [31:0] count_value  = freq_table[count_symbol];
+    wire        count_full   = &count_value;
+
     always @(posedge clk or posedge reset) begin
         if (reset) begin
             // Clear frequency table on reset
             for (i = 0; i < 256; i = i + 1)
                 freq_table[i] <= 0;
+            done      <= 0;
+            saturated <= 0;
+        end else if (clear_pulse) begin
+            for (i = 0; i < 256; i = i + 1)
+                freq_table[i] <= 0;
+            done      <= 0;
+            saturated <= 0;
+        end else if (burst) begin
+            if (busy) begin
+                if (count_full)
+                    saturated <= 1;
+                else
+                    freq_table[count_symbol] <= count_value + 1;
+            end
             done <= 0;
         end else begin
-            if (load_pulse) begin
-                // Increment frequency of the input symbol
-                freq_table[symbol] <= freq_table[symbol] + 1;
-                done <= 1;  // Acknowledge to processor
+            if (load_pulse || symbol_we) begin
+                // Increment frequency of the input symbol, holding at the maximum
+                if (count_full)
+                    saturated <= 1;
+                else
+                    freq_table[count_symbol] <= count_value + 1;
+                if (load_pulse)
+                    done <= 1;  // Acknowledge to processor
             end else if (!load) begin
                 // Clear done when load is deasserted
                 done <= 0;
@@ -85,10 +206,46 @@ module frequency_counter (
         end
     end
 
+    // ------------------------------------------------------------------
+    // Block completion interrupt
+    // ------------------------------------------------------------------
+    reg block_done_d;
+
+    always @(posedge clk or posedge reset) begin
+        if (reset) begin
+            block_done_d <= 0;
+            irq          <= 0;
+        end else begin
+            block_done_d <= block_done;
+            irq          <= block_done & ~block_done_d;
+        end
+    end
+
     // ------------------------------------------------------------------
     // Frequency readout
     // ------------------------------------------------------------------
     // Allows processor to read any symbol's frequency
     assign freq_out = freq_table[addr];
 
+    // ------------------------------------------------------------------
+    // Performance counters
+    // ------------------------------------------------------------------
+    wire counting = burst ? busy : (load_pulse || symbol_we);
+
+    perf_counters #(
+        .ENABLE    (PERF_COUNTERS),
+        .ITEM_WIDTH(1),
+        .BITS_WIDTH(1)
+    ) perf (
+        .clock      (clk),
+        .reset      (reset),
+        .active     (counting),
+        .in_stall   (burst && !busy && !block_done && (words_in < block_words) && !s_axis_tvalid),
+        .out_stall  (1'b0),
+        .items      (counting),
+        .bits       (1'b0),
+        .clear      (perf_clear),
+        .perf_count (perf_count)
+    );
+
 endmodule
\ No newline at end of file
@@ -5,14 +5,42 @@
 //   using a dynamically loaded codebook.
 //
 //   The Huffman codebook (codeword + length) is loaded from software
-//   (Vitis) via an AXI-controlled interface before encoding begins.
+//   (Vitis) via an AXI-controlled interface before encoding begins,
+//   either one entry per load handshake or as a whole table: software
+//   writes all 256 {length, code} words into the table window (one
+//   posted AXI write each, no acknowledge) and pulses table_commit,
+//   which swaps the written shadow bank with the active one.
+//
+//   Every encoded codeword is also appended to an internal
+//   bit_packer, so software can read the packed COMP.BIN payload as
+//   full 32-bit words instead of one codeword/length pair per symbol.
 //
 // Notes:
 //   - Maximum codeword length is limited to 16 bits
 //   - Codebook must be fully loaded before asserting valid_in
-//   - valid_in and load_valid are edge-detected (one-shot)
+//   - valid_in, load_valid, table_commit, pack_clear, pack_flush and
+//     pack_read are edge-detected (one-shot)
+//   - symbol_we is the level-based alternative to valid_in: the
+//     wrapper raises it for one cycle with the write of the symbol
+//     register, and valid_out then stays high (with code_word /
+//     code_length) until the next symbol. One register write per
+//     symbol, no valid_in rise and fall, no wait for valid_out to drop.
+//     code_result packs the whole result into one read; code_seq
+//     toggles with every lookup so software can tell a fresh result
+//     from the previous symbol's
+//   - The shadow bank keeps the table of two commits ago: write every
+//     entry (length 0 for unused symbols) before each commit
+//   - Commit only between streams; load handshakes write the active bank
+//   - pack_crc covers every word popped through pack_read since
+//     pack_clear, the zero-padded tail included: read it once the
+//     FIFO is drained after pack_flush to get the block's payload CRC
+//   - perf_count: active = lookups and table writes, out_stall = the
+//     packer FIFO is full, items = symbols encoded, bits = codeword
+//     bits appended
 
-module huffman (
+module huffman #(
+    parameter PERF_COUNTERS = 1               // 1 = include perf_counters
+)(
     input wire          clock,
     input wire          reset,
 
@@ -21,6 +49,7 @@ module huffman (
     // ------------------------------------------------------------------
     input wire  [7:0]   symbol_in,   // 8-bit input symbol
     input wire          valid_in,     // Assert high to encode symbol
+    input wire          symbol_we,    // Encode symbol_in now (one cycle, symbol already written)
 
     // ------------------------------------------------------------------
     // Huffman encoded output
@@ -28,6 +57,7 @@ module huffman (
     output reg          valid_out,    // Indicates valid code_word output
     output reg  [15:0]  code_word,    // Huffman codeword (MSB-aligned)
     output reg  [4:0]   code_length,  // Number of valid bits in code_word
+    output wire [31:0]  code_result,  // {valid_out, code_seq, 9'b0, code_length, code_word}
 
     // ------------------------------------------------------------------
     // Huffman table load interface (from Vitis software)
@@ -36,15 +66,44 @@ module huffman (
     input wire  [15:0]  load_code,    // Huffman codeword
     input wire  [4:0]   load_length,  // Codeword length
     input wire          load_valid,   // Load request (level signal)
-    output reg          load_valid_out // One-cycle acknowledge pulse
+    output reg          load_valid_out, // One-cycle acknowledge pulse
+
+    // ------------------------------------------------------------------
+    // Table window (whole-codebook load)
+    // ------------------------------------------------------------------
+    input wire          table_we,     // Write table_wdata to the shadow bank
+    input wire  [7:0]   table_addr,   // Symbol index (window word address)
+    input wire  [20:0]  table_wdata,  // {length[20:16], code[15:0]}
+    input wire          table_commit, // Make the shadow bank active
+
+    // ------------------------------------------------------------------
+    // Packed output interface (MSB-first 32-bit words)
+    // ------------------------------------------------------------------
+    input wire          pack_clear,   // Reset packer for a new stream
+    input wire          pack_flush,   // Emit the zero-padded tail word
+    input wire          pack_read,    // Pop pack_word from the FIFO
+    output wire [31:0]  pack_word,    // Oldest completed packed word
+    output wire         pack_valid,   // At least one packed word waiting
+    output wire [4:0]   pack_count,   // Packed words waiting (0-16)
+    output wire [31:0]  pack_bits,    // Payload bits appended since clear
+    output wire         pack_overflow, // Sticky: a packed word was dropped
+    output wire [31:0]  pack_crc,     // CRC-32 of the words read since clear (see crc32_words)
+
+    // ------------------------------------------------------------------
+    // Performance counters (see perf_counters)
+    // ------------------------------------------------------------------
+    input wire          perf_clear,   // Zero the counters (level signal)
+    output wire [191:0] perf_count    // See perf_counters
 );
 
     // ------------------------------------------------------------------
     // Huffman lookup tables
     // ------------------------------------------------------------------
-    // Each symbol index directly maps to its Huffman code and length
-    reg [15:0] huff_code   [0:255];
-    reg [4:0]  huff_length[0:255];
+    // Each symbol index directly maps to its Huffman code and length;
+    // two banks, {bank, symbol}, the active one selected by bank
+    reg [15:0] huff_code   [0:511];
+    reg [4:0]  huff_length[0:511];
+    reg        bank;
 
     // ------------------------------------------------------------------
     // Edge detection for load_valid (software-controlled pulse)
@@ -72,19 +131,45 @@ module huffman (
     // Detect rising edge of valid_in
     assign valid_in_pulse = valid_in & ~valid_in_d;
 
+    // ------------------------------------------------------------------
+    // Edge detection for packer controls
+    // ------------------------------------------------------------------
+    reg  pack_clear_d, pack_flush_d, pack_read_d, table_commit_d;
+
+    always @(posedge clock) begin
+        pack_clear_d   <= pack_clear;
+        pack_flush_d   <= pack_flush;
+        pack_read_d    <= pack_read;
+        table_commit_d <= table_commit;
+    end
+
     // ------------------------------------------------------------------
     // Huffman table loading logic
     // ------------------------------------------------------------------
     // Loads one (symbol, codeword, length) entry per pulse.
     // load_valid_out acts as a one-cycle acknowledge to software.
+    // Window writes fill the shadow bank, load handshakes the active
+    // one; one write port, the window write wins a collision.
+    always @(posedge clock) begin
+        if (table_we) begin
+            huff_code[{~bank, table_addr}]   <= table_wdata[15:0];
+            huff_length[{~bank, table_addr}] <= table_wdata[20:16];
+        end else if (load_valid_pulse) begin
+            huff_code[{bank, load_symbol}]   <= load_code;
+            huff_length[{bank, load_symbol}] <= load_length;
+        end
+    end
+
     always @(posedge clock or posedge reset) begin
         if (reset) begin
             load_valid_out <= 0;
+            bank           <= 0;
         end else begin
+            if (table_commit & ~table_commit_d)
+                bank <= ~bank;
+
             if (load_valid_pulse) begin
-                huff_code[load_symbol]   <= load_code;
-                huff_length[load_symbol] <= load_length;
-                load_valid_out           <= 1;
+                load_valid_out <= 1;
             end else if (!load_valid) begin
                 // Deassert acknowledge when load_valid goes low
                 load_valid_out <= 0;
@@ -98,19 +183,90 @@ module huffman (
     // On valid_in rising edge:
     //   - Lookup Huffman codeword and length
     //   - Assert valid_out for one cycle
+    //
+    // On symbol_we: the same lookup, but valid_out is held until the
+    // next symbol (level protocol).
+    reg code_strobe;   // code_word/code_length were just updated
+    reg code_held;     // valid_out belongs to a symbol_we lookup
+    reg code_seq;      // toggles with every lookup
+
     always @(posedge clock or posedge reset) begin
         if (reset) begin
             valid_out   <= 0;
             code_word   <= 0;
             code_length <= 0;
-        end else if (valid_in_pulse) begin
-            code_word   <= huff_code[symbol_in];
-            code_length <= huff_length[symbol_in];
+            code_strobe <= 0;
+            code_held   <= 0;
+            code_seq    <= 0;
+        end else if (valid_in_pulse || symbol_we) begin
+            code_word   <= huff_code[{bank, symbol_in}];
+            code_length <= huff_length[{bank, symbol_in}];
             valid_out   <= 1;
-        end else if (!valid_in) begin
-            // Clear valid_out when input is idle
-            valid_out <= 0;
+            code_strobe <= 1;
+            code_held   <= symbol_we;
+            code_seq    <= ~code_seq;
+        end else begin
+            code_strobe <= 0;
+            if (!valid_in && !code_held) begin
+                // Clear valid_out when input is idle
+                valid_out <= 0;
+            end
         end
     end
 
+    assign code_result = {valid_out, code_seq, 9'b0, code_length, code_word};
+
+    // ------------------------------------------------------------------
+    // Bit packer
+    // ------------------------------------------------------------------
+    // Appends each looked-up codeword one cycle after the lookup.
+    bit_packer #(
+        .FIFO_DEPTH_LOG2(4)
+    ) packer (
+        .clock      (clock),
+        .reset      (reset),
+        .code_in    (code_word),
+        .length_in  (code_length),
+        .code_valid (code_strobe),
+        .flush      (pack_flush & ~pack_flush_d),
+        .clear      (pack_clear & ~pack_clear_d),
+        .word_out   (pack_word),
+        .word_valid (pack_valid),
+        .word_read  (pack_read & ~pack_read_d),
+        .word_count (pack_count),
+        .total_bits (pack_bits),
+        .overflow   (pack_overflow)
+    );
+
+    // ------------------------------------------------------------------
+    // Payload CRC of the words software reads back
+    // ------------------------------------------------------------------
+    crc32_words pack_check (
+        .clock (clock),
+        .reset (reset),
+        .clear (pack_clear & ~pack_clear_d),
+        .data  (pack_word),
+        .valid (pack_read & ~pack_read_d & pack_valid),
+        .crc   (pack_crc)
+    );
+
+    // ------------------------------------------------------------------
+    // Performance counters
+    // ------------------------------------------------------------------
+    perf_counters #(
+        .ENABLE    (PERF_COUNTERS),
+        .ITEM_WIDTH(1),
+        .BITS_WIDTH(5)
+    ) perf (
+        .clock      (clock),
+        .reset      (reset),
+        .active     (valid_in_pulse || symbol_we || load_valid_pulse || table_we),
+        .in_stall   (1'b0),
+        .out_stall  (pack_count == 5'd16),
+        .items      (code_strobe),
+        .bits       (code_strobe ? code_length : 5'd0),
+        .clear      (perf_clear),
+        .perf_count (perf_count)
+    );
+
 endmodule
\ No newline at end of file
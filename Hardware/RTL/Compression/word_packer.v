@@ -0,0 +1,129 @@
+// Module: word_packer
+// Description:
+//   Wide Bit Packer core.
+//   Variant of bit_packer for the 4-lane encoder: appends a group of
+//   up to 64 bits (four merged codewords) per cycle to a 96-bit
+//   accumulator and pushes the one or two 32-bit words it completes,
+//   MSB-first, into the output FIFO in the same cycle. The payload
+//   layout is the same as bit_packer's.
+//
+// Example:
+//   Group  : 1 00001 000101 ... (len 40)
+//   Word 0 : first 32 bits of the group, pushed at once
+//   Acc    : remaining 8 bits, wait for the next group
+//
+// Notes:
+//   - code_in must be right-aligned with zero upper bits
+//   - One group is accepted per cycle (code_valid)
+//   - flush pushes the zero-padded partial tail word; it is ignored
+//     in a cycle that also carries code_valid
+//   - The FIFO is built from registers (two write ports). The caller
+//     must keep two free entries per group it can still append: there
+//     is no overflow check
+
+module word_packer #(
+    parameter FIFO_DEPTH_LOG2 = 4                // 16-word output FIFO
+)(
+    input  wire         clock,
+    input  wire         reset,
+
+    // ------------------------------------------------------------------
+    // Group input
+    // ------------------------------------------------------------------
+    input  wire [63:0]  code_in,                 // Right-aligned merged codewords
+    input  wire [6:0]   length_in,               // Valid bits in code_in (0-64)
+    input  wire         code_valid,              // Append code_in this cycle
+
+    // ------------------------------------------------------------------
+    // Control (one-cycle pulses)
+    // ------------------------------------------------------------------
+    input  wire         flush,                   // Emit the partial tail word
+    input  wire         clear,                   // Start a new stream
+
+    // ------------------------------------------------------------------
+    // Packed word output (FIFO head)
+    // ------------------------------------------------------------------
+    output wire [31:0]  word_out,                // Oldest completed word
+    output wire         word_valid,              // FIFO not empty
+    input  wire         word_read,               // Pop word_out (one-cycle pulse)
+    output reg  [FIFO_DEPTH_LOG2:0] word_count,  // Words waiting in the FIFO
+    output reg  [31:0]  total_bits               // Bits appended since clear
+);
+
+    localparam DEPTH = 1 << FIFO_DEPTH_LOG2;
+
+    // ------------------------------------------------------------------
+    // Accumulator
+    // ------------------------------------------------------------------
+    // acc holds the pending bits right-aligned; acc_bits < 32 between
+    // cycles, so one append completes at most two words.
+    reg  [95:0] acc;
+    reg  [4:0]  acc_bits;
+
+    wire [95:0] acc_app  = (acc << length_in) | {32'b0, code_in};
+    wire [6:0]  bits_app = acc_bits + length_in;
+    wire        two_done = code_valid && (bits_app >= 64);
+    wire        one_done = code_valid && (bits_app >= 32);
+    wire [95:0] first_sh  = acc_app >> (bits_app - 32);
+    wire [95:0] second_sh = acc_app >> (bits_app - 64);
+
+    wire        tail_push = flush && !code_valid && (acc_bits != 0);
+    wire [31:0] tail_word = acc[31:0] << (32 - acc_bits);
+
+    // ------------------------------------------------------------------
+    // Output FIFO
+    // ------------------------------------------------------------------
+    reg  [31:0] fifo [0:DEPTH-1];
+    reg  [FIFO_DEPTH_LOG2-1:0] wr_ptr, rd_ptr;
+
+    wire [1:0]  pushes = two_done ? 2'd2 : (one_done || tail_push) ? 2'd1 : 2'd0;
+    wire        pop    = word_read && (word_count != 0);
+
+    assign word_out   = fifo[rd_ptr];
+    assign word_valid = (word_count != 0);
+
+    always @(posedge clock) begin
+        if (one_done)
+            fifo[wr_ptr] <= first_sh[31:0];
+        else if (tail_push)
+            fifo[wr_ptr] <= tail_word;
+        if (two_done)
+            fifo[wr_ptr + 1'b1] <= second_sh[31:0];
+    end
+
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            acc        <= 0;
+            acc_bits   <= 0;
+            total_bits <= 0;
+            wr_ptr     <= 0;
+            rd_ptr     <= 0;
+            word_count <= 0;
+        end else if (clear) begin
+            acc        <= 0;
+            acc_bits   <= 0;
+            total_bits <= 0;
+            wr_ptr     <= 0;
+            rd_ptr     <= 0;
+            word_count <= 0;
+        end else begin
+            // Accumulator update
+            if (code_valid) begin
+                acc        <= acc_app;
+                acc_bits   <= two_done ? bits_app - 64 :
+                              one_done ? bits_app - 32 : bits_app;
+                total_bits <= total_bits + length_in;
+            end else if (tail_push) begin
+                acc      <= 0;
+                acc_bits <= 0;
+            end
+
+            // FIFO pointers
+            wr_ptr     <= wr_ptr + pushes;
+            if (pop)
+                rd_ptr <= rd_ptr + 1;
+            word_count <= word_count + pushes - pop;
+        end
+    end
+
+endmodule
@@ -0,0 +1,263 @@
+// Module: axis_decompression_chain
+// Description:
+//   AXI4-Stream decompression chain.
+//   decrypt (32-bit word) -> huffman_stream_decoder -> bit_merger
+//   between the MM2S and S2MM channels of an AXI DMA.
+//
+//   MM2S streams the encrypted payload section of COMP.BIN straight
+//   from DDR; S2MM writes the reconstructed 32-bit configuration
+//   words back to DDR, ready to be handed to the DevC/PCAP.
+//
+// Data flow:
+//   s_axis (4 encrypted bytes) -> decrypt -> packed payload word
+//   -> stream decoder -> 8-bit symbols -> 4 symbols per word
+//   -> bit_merger -> m_axis (tlast on the last word)
+//
+// Notes:
+//   - The codebook is loaded through the huffman_stream_decoder table
+//     window (commit, then wait for table_busy low) or load
+//     interface, and start/symbol_count set before MM2S is started
+//   - Input words arriving after the last symbol (or after an
+//     invalid codeword) are accepted and dropped so the DMA never
+//     hangs on a bad archive
+//   - irq is a one-cycle pulse when the last word has been sent or
+//     the decoder flagged an error
+//   - A block archive is streamed one block per start: symbol_count
+//     and MM2S cover the block, S2MM its words. payload_crc is the
+//     decoder's word_crc, taken after decrypt, so software can compare
+//     it with the block index before the words go anywhere (PCAP)
+//   - perf_count: active = a payload word, symbol or output word
+//     moved or the table filling, in_stall = the decoder waits on
+//     MM2S, out_stall = S2MM holds off a word, items = symbols, bits =
+//     codeword bits consumed
+
+module axis_decompression_chain #(
+    parameter LUT_BITS      = 12,
+    parameter BANK_BITS     = 2,                 // resident lookup tables, see huffman_stream_decoder
+    parameter PERF_COUNTERS = 1                  // 1 = include perf_counters
+)(
+    input  wire         clock,
+    input  wire         reset,
+
+    // ------------------------------------------------------------------
+    // Control and status (AXI4-Lite registers)
+    // ------------------------------------------------------------------
+    input  wire         start,                   // Begin a block (level signal)
+    input  wire [31:0]  symbol_count,            // Symbols in the payload
+    input  wire [31:0]  key,                     // Decryption key, written once per session
+    output wire         done,                    // Last word sent
+    output wire         error,                   // Invalid codeword / table entry
+    output reg  [31:0]  words_out,               // Words sent since start
+    output wire [31:0]  payload_crc,             // CRC-32 of the decrypted words decoded since start
+    output reg          irq,
+
+    // ------------------------------------------------------------------
+    // Encrypted payload from DMA MM2S (AXI4-Stream slave)
+    // ------------------------------------------------------------------
+    input  wire [31:0]  s_axis_tdata,
+    input  wire         s_axis_tvalid,
+    input  wire         s_axis_tlast,            // Ignored, see symbol_count
+    output wire         s_axis_tready,
+
+    // ------------------------------------------------------------------
+    // Configuration words to DMA S2MM (AXI4-Stream master)
+    // ------------------------------------------------------------------
+    output reg  [31:0]  m_axis_tdata,
+    output reg          m_axis_tvalid,
+    output reg          m_axis_tlast,
+    input  wire         m_axis_tready,
+
+    // ------------------------------------------------------------------
+    // Huffman codebook load interface
+    // ------------------------------------------------------------------
+    input  wire [7:0]   load_symbol,
+    input  wire [15:0]  load_code,
+    input  wire [4:0]   load_length,
+    input  wire         load_valid,
+    output wire         load_valid_out,
+
+    // ------------------------------------------------------------------
+    // Huffman codebook table window
+    // ------------------------------------------------------------------
+    input  wire         table_we,
+    input  wire [7:0]   table_addr,
+    input  wire [20:0]  table_wdata,
+    input  wire         table_commit,
+    output wire         table_busy,
+    input  wire [BANK_BITS-1:0] table_bank,
+
+    // ------------------------------------------------------------------
+    // Performance counters (see perf_counters)
+    // ------------------------------------------------------------------
+    input  wire         perf_clear,              // Zero the counters (level signal)
+    output wire [191:0] perf_count
+);
+
+    // ------------------------------------------------------------------
+    // Decryption, one 32-bit word per beat
+    // ------------------------------------------------------------------
+    wire [31:0] plain_word;
+
+    decrypt #(
+        .WIDTH(32)
+    ) decryptor (
+        .data_in  (s_axis_tdata),
+        .key      (key),
+        .data_out (plain_word)
+    );
+
+    // ------------------------------------------------------------------
+    // Huffman stream decoder
+    // ------------------------------------------------------------------
+    wire [7:0]  symbol;
+    wire [4:0]  symbol_length;
+    wire        symbol_valid, symbol_ready;
+    wire        word_ready;
+    wire        dec_done;
+
+    assign s_axis_tready = word_ready || dec_done || error;
+
+    huffman_stream_decoder #(
+        .LUT_BITS     (LUT_BITS),
+        .BANK_BITS    (BANK_BITS),
+        .PERF_COUNTERS(0)                        // Counted at the chain ports
+    ) decoder (
+        .clock          (clock),
+        .reset          (reset),
+        .start          (start),
+        .symbol_count   (symbol_count),
+        .done           (dec_done),
+        .error          (error),
+        .word_in        (plain_word),
+        .word_valid     (s_axis_tvalid),
+        .word_ready     (word_ready),
+        .word_crc       (payload_crc),
+        .symbol_out     (symbol),
+        .length_out     (symbol_length),
+        .symbol_valid   (symbol_valid),
+        .symbol_ready   (symbol_ready),
+        .load_symbol    (load_symbol),
+        .load_code      (load_code),
+        .load_length    (load_length),
+        .load_valid     (load_valid),
+        .load_valid_out (load_valid_out),
+        .table_we       (table_we),
+        .table_addr     (table_addr),
+        .table_wdata    (table_wdata),
+        .table_commit   (table_commit),
+        .table_busy     (table_busy),
+        .table_bank     (table_bank),
+        .perf_clear     (1'b0),
+        .perf_count     ()
+    );
+
+    // ------------------------------------------------------------------
+    // Symbol merging
+    // ------------------------------------------------------------------
+    // The first three symbols of a word are held; the fourth goes
+    // straight into bit_merger with them. The decoder raises done
+    // together with its last symbol, which marks the last word.
+    reg  [7:0]  held [0:2];
+    reg  [1:0]  index;
+    wire [31:0] merged_word;
+
+    bit_merger merger (
+        .in0      (held[0]),
+        .in1      (held[1]),
+        .in2      (held[2]),
+        .in3      (symbol),
+        .out_word (merged_word)
+    );
+
+    wire m_fire     = m_axis_tvalid && m_axis_tready;
+    assign symbol_ready = (index != 2'd3) || !m_axis_tvalid || m_axis_tready;
+    wire sym_fire   = symbol_valid && symbol_ready;
+
+    // start is a level: its rising edge begins a new block
+    reg  start_d;
+    wire start_pulse = start & ~start_d;
+
+    always @(posedge clock) begin
+        start_d <= start;
+    end
+
+    reg sent_last;
+    assign done = sent_last;
+
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            index         <= 0;
+            held[0]       <= 0;
+            held[1]       <= 0;
+            held[2]       <= 0;
+            m_axis_tdata  <= 0;
+            m_axis_tvalid <= 0;
+            m_axis_tlast  <= 0;
+            words_out     <= 0;
+            sent_last     <= 0;
+        end else if (start_pulse) begin
+            index         <= 0;
+            m_axis_tvalid <= 0;
+            m_axis_tlast  <= 0;
+            words_out     <= 0;
+            sent_last     <= 0;
+        end else begin
+            if (m_fire) begin
+                m_axis_tvalid <= 0;
+                words_out     <= words_out + 1;
+                if (m_axis_tlast)
+                    sent_last <= 1;
+            end
+
+            if (sym_fire) begin
+                if (index == 2'd3) begin
+                    m_axis_tdata  <= merged_word;
+                    m_axis_tvalid <= 1;
+                    m_axis_tlast  <= dec_done;
+                    index         <= 0;
+                end else begin
+                    held[index] <= symbol;
+                    index       <= index + 1;
+                end
+            end
+        end
+    end
+
+    // ------------------------------------------------------------------
+    // Completion / error interrupt
+    // ------------------------------------------------------------------
+    reg  event_d;
+    wire event_now = done | error;
+
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            event_d <= 0;
+            irq     <= 0;
+        end else begin
+            event_d <= event_now;
+            irq     <= event_now & ~event_d;
+        end
+    end
+
+    // ------------------------------------------------------------------
+    // Performance counters
+    // ------------------------------------------------------------------
+    wire in_fire = s_axis_tvalid && s_axis_tready;
+
+    perf_counters #(
+        .ENABLE    (PERF_COUNTERS),
+        .ITEM_WIDTH(1),
+        .BITS_WIDTH(5)
+    ) perf (
+        .clock      (clock),
+        .reset      (reset),
+        .active     (in_fire || sym_fire || m_fire || table_busy),
+        .in_stall   (word_ready && !s_axis_tvalid),
+        .out_stall  (m_axis_tvalid && !m_axis_tready),
+        .items      (sym_fire),
+        .bits       (sym_fire ? symbol_length : 5'd0),
+        .clear      (perf_clear),
+        .perf_count (perf_count)
+    );
+
+endmodule
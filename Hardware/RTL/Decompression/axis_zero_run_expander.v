@@ -0,0 +1,136 @@
+// Module: axis_zero_run_expander
+// Description:
+//   AXI4-Stream zero-run expansion, the inverse of
+//   axis_zero_run_encoder. Sits between the Huffman decoder output
+//   and the bit merger: accepts decoded 8-bit tokens and emits the
+//   original symbols, four per configuration word.
+//
+//   Tokens (E = escape):
+//     b        literal symbol b (b != E)
+//     E 00     literal E
+//     E 01-7F  1..127 zero words
+//     E 80-FF  1..128 repeats of the previous word
+//
+// Example (E = 06):
+//   Input  : 06 02 12 34 06 00 12 06 81 (tlast on the last)
+//   Output : 00 x8, 12 34 06 12, 12 34 06 12, 12 34 06 12
+//
+// Notes:
+//   - Literal symbols pass straight through (one symbol/clock); a run
+//     token stalls the input while its 4..512 symbols are emitted
+//   - error is set (until clear) by a run that does not start on a
+//     word boundary, a repeat with no previous word in the block, or
+//     a block that ends on an escape; the offending token is dropped
+//   - tlast of a token is forwarded on the last symbol it expands to
+
+module axis_zero_run_expander (
+    input  wire        clock,
+    input  wire        reset,
+    input  wire [7:0]  escape,
+    input  wire        clear,          // Clear error and block state (pulse)
+    output reg         error,
+
+    // ------------------------------------------------------------------
+    // 8-bit token input (AXI4-Stream slave)
+    // ------------------------------------------------------------------
+    input  wire [7:0]  s_axis_tdata,
+    input  wire        s_axis_tvalid,
+    input  wire        s_axis_tlast,
+    output wire        s_axis_tready,
+
+    // ------------------------------------------------------------------
+    // 8-bit symbol output (AXI4-Stream master)
+    // ------------------------------------------------------------------
+    output wire [7:0]  m_axis_tdata,
+    output wire        m_axis_tvalid,
+    output wire        m_axis_tlast,
+    input  wire        m_axis_tready
+);
+
+    localparam ZERO_MAX = 8'h7F;
+
+    reg        pending;          // escape seen, waiting for its code
+    reg [9:0]  run_left;         // run symbols still to emit
+    reg [31:0] run_word;         // word the run repeats
+    reg        run_last;         // run token carried tlast
+    reg [1:0]  out_pos;          // byte of the current output word
+    reg [23:0] cur;              // first three bytes of that word
+    reg [31:0] prev_word;        // last complete output word
+    reg        have_word;        // prev_word belongs to this block
+
+    wire run_active = (run_left != 0);
+
+    // A token is passed through as one symbol, or consumed without output
+    wire literal    = pending ? (s_axis_tdata == 8'h00) : (s_axis_tdata != escape);
+    wire run_token  = pending && (s_axis_tdata != 8'h00);
+    wire is_repeat  = s_axis_tdata > ZERO_MAX;
+    wire run_bad    = (out_pos != 2'd0) || (is_repeat && !have_word);
+    wire [7:0] run_words = is_repeat ? s_axis_tdata - ZERO_MAX : s_axis_tdata;
+
+    assign m_axis_tvalid = run_active || (s_axis_tvalid && literal);
+    assign m_axis_tdata  = run_active ? run_word[31 - 8*out_pos -: 8] :
+                           pending    ? escape : s_axis_tdata;
+    assign m_axis_tlast  = run_active ? (run_last && run_left == 10'd1) : s_axis_tlast;
+    assign s_axis_tready = !run_active && (!literal || m_axis_tready);
+
+    wire m_fire = m_axis_tvalid && m_axis_tready;
+    wire s_fire = s_axis_tvalid && s_axis_tready;
+
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            error     <= 0;
+            pending   <= 0;
+            run_left  <= 0;
+            run_word  <= 0;
+            run_last  <= 0;
+            out_pos   <= 0;
+            cur       <= 0;
+            prev_word <= 0;
+            have_word <= 0;
+        end else if (clear) begin
+            error     <= 0;
+            pending   <= 0;
+            run_left  <= 0;
+            out_pos   <= 0;
+            have_word <= 0;
+        end else begin
+            // Token side
+            if (s_fire) begin
+                if (!pending && s_axis_tdata == escape) begin
+                    pending <= 1;
+                    if (s_axis_tlast)
+                        error <= 1;
+                end else begin
+                    pending <= 0;
+                    if (run_token) begin
+                        if (run_bad) begin
+                            error <= 1;
+                        end else begin
+                            run_left <= {run_words, 2'b00};
+                            run_word <= is_repeat ? prev_word : 32'd0;
+                            run_last <= s_axis_tlast;
+                        end
+                    end
+                end
+            end
+
+            // Symbol side: track word boundaries for runs and repeats
+            if (m_fire) begin
+                if (run_active)
+                    run_left <= run_left - 1;
+
+                out_pos <= out_pos + 1;
+                cur     <= {cur[15:0], m_axis_tdata};
+                if (out_pos == 2'd3) begin
+                    prev_word <= {cur, m_axis_tdata};
+                    have_word <= 1;
+                end
+                if (m_axis_tlast) begin
+                    out_pos   <= 0;
+                    have_word <= 0;
+                end
+            end
+        end
+    end
+
+endmodule
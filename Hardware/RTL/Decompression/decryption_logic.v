@@ -2,23 +2,29 @@
 // Description:
 //   Lightweight decryption IP core.
 //   Reverses the encryption applied by the Encrypt module using
-//   the same 8-bit key.
+//   the same key.
 //
 //   Decryption operation:
 //     data_out = ~(data_in ^ key)
 //
+//   WIDTH = 32 restores a whole word (4 archive bytes) per AXI-Lite
+//   write/read pair; the key is the 8-bit archive key replicated in
+//   every byte lane and is written once per session.
+//
 // Notes:
 //   - This module is the exact inverse of the Encrypt IP
 //   - Requires the same key used during encryption
 //   - Stateless and purely combinational
 //   - Intended for lightweight protection, not cryptographic security
 
-module decrypt(
-    input  wire [7:0] data_in,   // Encrypted input byte
-    input  wire [7:0] key,        // 8-bit decryption key
-    output wire [7:0] data_out    // Decrypted output byte
+module decrypt #(
+    parameter WIDTH = 32
+)(
+    input  wire [WIDTH-1:0] data_in,   // Encrypted input word
+    input  wire [WIDTH-1:0] key,       // Decryption key (keystream word)
+    output wire [WIDTH-1:0] data_out   // Decrypted output word
 );
-    wire [7:0] dash_data_in;
+    wire [WIDTH-1:0] dash_data_in;
 
     // XOR encrypted data with key (reverse XOR stage)
     assign dash_data_in = data_in ^ key;
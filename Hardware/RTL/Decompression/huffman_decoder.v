@@ -14,8 +14,17 @@
 //   - Intended for correctness and simplicity, not high throughput
 //   - Codebook must be fully loaded before decoding begins
 //   - Designed to mirror the Huffman Encoder IP
+//   - The table window writes an entry directly (no acknowledge, no
+//     commit): a whole codebook is 256 posted writes; length 0
+//     retires a symbol
+//   - The lookup itself has no clock; the wrapper raises code_we with
+//     the write of the codeword register so perf_count can count it
+//     (active = lookups and table writes, items = lookups, bits =
+//     codeword bits consumed)
 
-module huffman_decoder(
+module huffman_decoder #(
+    parameter PERF_COUNTERS = 1          // 1 = include perf_counters
+)(
     input  wire         clock,
     input  wire         reset,
 
@@ -24,6 +33,7 @@ module huffman_decoder(
     // ------------------------------------------------------------------
     input  wire [15:0]  code_word_in,    // Huffman codeword (MSB-aligned)
     input  wire [4:0]   code_length_in,  // Number of valid bits in code_word
+    input  wire         code_we,         // Codeword register written (one cycle)
 
     // ------------------------------------------------------------------
     // Decoded output
@@ -37,7 +47,20 @@ module huffman_decoder(
     input  wire [15:0]  load_code,       // Huffman codeword
     input  wire [4:0]   load_length,     // Huffman code length
     input  wire         load_valid,      // Load request (level signal)
-    output reg          load_valid_out    // One-cycle acknowledge pulse
+    output reg          load_valid_out,   // One-cycle acknowledge pulse
+
+    // ------------------------------------------------------------------
+    // Table window (whole-codebook load)
+    // ------------------------------------------------------------------
+    input  wire         table_we,        // Write table_wdata to entry table_addr
+    input  wire [7:0]   table_addr,      // Symbol index
+    input  wire [20:0]  table_wdata,     // {length[20:16], code[15:0]}
+
+    // ------------------------------------------------------------------
+    // Performance counters (see perf_counters)
+    // ------------------------------------------------------------------
+    input  wire         perf_clear,      // Zero the counters (level signal)
+    output wire [191:0] perf_count
 );
 
     // ------------------------------------------------------------------
@@ -70,15 +93,25 @@ module huffman_decoder(
     // ------------------------------------------------------------------
     // Loads one symbol entry per load_valid pulse.
     // load_valid_out acts as an acknowledge to software.
+    // A table window write takes precedence over a load handshake.
+    always @(posedge clock) begin
+        if (table_we) begin
+            symbol_table[table_addr]     <= table_addr;
+            codeword_table[table_addr]   <= table_wdata[15:0];
+            codelength_table[table_addr] <= table_wdata[20:16];
+        end else if (load_valid_pulse) begin
+            symbol_table[load_symbol]     <= load_symbol;
+            codeword_table[load_symbol]   <= load_code;
+            codelength_table[load_symbol] <= load_length;
+        end
+    end
+
     always @(posedge clock or posedge reset) begin
         if (reset) begin
             load_valid_out <= 0;
         end else begin
             if (load_valid_pulse) begin
-                symbol_table[load_symbol]     <= load_symbol;
-                codeword_table[load_symbol]   <= load_code;
-                codelength_table[load_symbol] <= load_length;
-                load_valid_out                <= 1;
+                load_valid_out <= 1;
             end else if (!load_valid) begin
                 load_valid_out <= 0;
             end
@@ -105,4 +138,23 @@ module huffman_decoder(
         end
     end
 
+    // ------------------------------------------------------------------
+    // Performance counters
+    // ------------------------------------------------------------------
+    perf_counters #(
+        .ENABLE    (PERF_COUNTERS),
+        .ITEM_WIDTH(1),
+        .BITS_WIDTH(5)
+    ) perf (
+        .clock      (clock),
+        .reset      (reset),
+        .active     (code_we || load_valid_pulse || table_we),
+        .in_stall   (1'b0),
+        .out_stall  (1'b0),
+        .items      (code_we),
+        .bits       (code_we ? code_length_in : 5'd0),
+        .clear      (perf_clear),
+        .perf_count (perf_count)
+    );
+
 endmodule
\ No newline at end of file
@@ -0,0 +1,350 @@
+// Module: huffman_stream_decoder
+// Description:
+//   Table-driven Huffman Decoder IP core.
+//   Decodes the packed COMP.BIN payload (codewords concatenated
+//   MSB-first into 32-bit words) back into 8-bit symbols without
+//   being told where each codeword ends.
+//
+//   The next LUT_BITS bits of the stream index a 2^LUT_BITS-entry
+//   lookup table holding (symbol, code length). One lookup yields
+//   one symbol and the number of bits it consumed, so a symbol can
+//   be emitted every clock while the 64-bit bit buffer is refilled
+//   with 32-bit input words in parallel.
+//
+//   The table is filled from the same (symbol, codeword, length)
+//   load interface as huffman_decoder: for each entry the core
+//   writes all 2^(LUT_BITS - length) slots sharing that codeword
+//   as prefix, then acknowledges the load.
+//
+//   A whole codebook can instead be written into the 256-entry table
+//   window ({length, code} per symbol, one posted AXI write each) and
+//   committed: the core then fills the lookup table from every entry
+//   with a non-zero length, one slot per clock, with table_busy high.
+//
+//   The core keeps 2^BANK_BITS lookup tables. table_bank selects the
+//   one a load or commit fills and the one decoding reads, so software
+//   can keep several codebooks resident and switch between them
+//   without reloading.
+//
+// Example (LUT_BITS = 4, code "10" for symbol 0x07):
+//   Slots 1000, 1001, 1010, 1011 <- {symbol 0x07, length 2}
+//
+// Notes:
+//   - Codewords longer than LUT_BITS are rejected (error flag);
+//     build the codebook with MAX_CODE_LEN <= LUT_BITS
+//   - The codebook must be complete (canonical/Huffman codes are)
+//     so that every table slot is written
+//   - symbol_count symbols are decoded per start pulse; trailing
+//     pad bits of the last word are ignored
+//   - load_valid, table_commit and start are edge-detected (one-shot)
+//   - Do not start, load or commit while table_busy is high, and do
+//     not change table_bank while filling or decoding
+//   - word_crc covers every word taken (word_valid && word_ready)
+//     since start; compared with the block's payload CRC it tells a
+//     corrupted block apart before its symbols are used
+//   - perf_count: active = a symbol decoded or a table slot filled,
+//     out_stall = symbol not taken, in_stall = too few bits buffered,
+//     items = symbols, bits = codeword bits consumed
+
+module huffman_stream_decoder #(
+    parameter LUT_BITS      = 12,            // table index width = longest codeword
+    parameter BANK_BITS     = 2,             // 2^BANK_BITS resident lookup tables (>= 1)
+    parameter PERF_COUNTERS = 1              // 1 = include perf_counters
+)(
+    input  wire         clock,
+    input  wire         reset,
+
+    // ------------------------------------------------------------------
+    // Control
+    // ------------------------------------------------------------------
+    input  wire         start,               // Begin decoding (level signal)
+    input  wire [31:0]  symbol_count,        // Symbols to decode after start
+    output reg          done,                // All symbols decoded
+    output reg          error,               // Invalid codeword or table entry
+
+    // ------------------------------------------------------------------
+    // Packed payload input (MSB-first 32-bit words)
+    // ------------------------------------------------------------------
+    input  wire [31:0]  word_in,
+    input  wire         word_valid,
+    output wire         word_ready,
+    output wire [31:0]  word_crc,            // CRC-32 of the words taken since start (see crc32_words)
+
+    // ------------------------------------------------------------------
+    // Decoded output
+    // ------------------------------------------------------------------
+    output reg  [7:0]   symbol_out,          // Decoded 8-bit symbol
+    output reg  [4:0]   length_out,          // Bits consumed by symbol_out
+    output reg          symbol_valid,
+    input  wire         symbol_ready,
+
+    // ------------------------------------------------------------------
+    // Huffman codebook load interface (from Vitis software)
+    // ------------------------------------------------------------------
+    input  wire [7:0]   load_symbol,         // Symbol index (0–255)
+    input  wire [15:0]  load_code,           // Huffman codeword (right-aligned)
+    input  wire [4:0]   load_length,         // Huffman code length
+    input  wire         load_valid,          // Load request (level signal)
+    output reg          load_valid_out,      // Acknowledge once the entry is filled
+
+    // ------------------------------------------------------------------
+    // Table window (whole-codebook load)
+    // ------------------------------------------------------------------
+    input  wire         table_we,            // Write table_wdata to entry table_addr
+    input  wire [7:0]   table_addr,          // Symbol index
+    input  wire [20:0]  table_wdata,         // {length[20:16], code[15:0]}
+    input  wire         table_commit,        // Fill the lookup table from the window (level signal)
+    output wire         table_busy,          // Commit still filling
+    input  wire [BANK_BITS-1:0] table_bank,  // Lookup table filled and decoded from
+
+    // ------------------------------------------------------------------
+    // Performance counters (see perf_counters)
+    // ------------------------------------------------------------------
+    input  wire         perf_clear,          // Zero the counters (level signal)
+    output wire [191:0] perf_count
+);
+
+    // ------------------------------------------------------------------
+    // Lookup tables: {length[4:0], symbol[7:0]} per LUT_BITS-bit prefix
+    // ------------------------------------------------------------------
+    // Written by the fill logic, read every cycle with the prefix of
+    // the next bit-buffer state (synchronous read, block RAM). Bank b
+    // holds slots b * 2^LUT_BITS onwards.
+    (* ram_style = "block" *)
+    reg [12:0] lut [0:(1 << (LUT_BITS + BANK_BITS)) - 1];
+    reg [12:0] lut_q;
+
+    // ------------------------------------------------------------------
+    // Edge detection for load_valid and start
+    // ------------------------------------------------------------------
+    reg  load_valid_d, start_d, table_commit_d;
+    wire load_valid_pulse   = load_valid & ~load_valid_d;
+    wire start_pulse        = start & ~start_d;
+    wire table_commit_pulse = table_commit & ~table_commit_d;
+
+    always @(posedge clock) begin
+        load_valid_d   <= load_valid;
+        start_d        <= start;
+        table_commit_d <= table_commit;
+    end
+
+    // ------------------------------------------------------------------
+    // Table fill logic
+    // ------------------------------------------------------------------
+    // One slot per cycle from load_code << (LUT_BITS - load_length)
+    // up to the last slot sharing that prefix.
+    reg                 filling;
+    reg                 fill_ack;        // entry came from a load handshake
+    reg [LUT_BITS-1:0]  fill_addr;
+    reg [LUT_BITS:0]    fill_left;
+    reg [12:0]          fill_data;
+
+    // ------------------------------------------------------------------
+    // Table window
+    // ------------------------------------------------------------------
+    // Written by software, walked by a commit: win_q is the entry
+    // win_sym one cycle after win_sym was set (synchronous read).
+    reg [20:0] window [0:255];
+    reg [20:0] win_q;
+    reg        win_run;          // commit walking the window
+    reg        win_q_ok;         // win_q holds entry win_sym
+    reg [7:0]  win_sym;
+
+    wire [4:0] win_length = win_q[20:16];
+    wire       win_take   = win_run && win_q_ok && !filling;
+    wire       win_bad    = win_take && (win_length > LUT_BITS);
+
+    assign table_busy = win_run || filling;
+
+    always @(posedge clock) begin
+        if (table_we)
+            window[table_addr] <= table_wdata;
+        win_q <= window[win_sym];
+    end
+
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            filling        <= 0;
+            fill_ack       <= 0;
+            fill_addr      <= 0;
+            fill_left      <= 0;
+            fill_data      <= 0;
+            load_valid_out <= 0;
+            win_run        <= 0;
+            win_q_ok       <= 0;
+            win_sym        <= 0;
+        end else begin
+            // Commit: one window entry per fill (two cycles per empty one)
+            if (table_commit_pulse && !table_busy) begin
+                win_run  <= 1;
+                win_q_ok <= 0;
+                win_sym  <= 0;
+            end else if (win_run && !filling) begin
+                win_q_ok <= !win_q_ok;
+                if (win_q_ok) begin
+                    win_sym <= win_sym + 1;
+                    if (win_sym == 8'd255)
+                        win_run <= 0;
+                end
+            end
+
+            if (win_take && win_length != 0 && !win_bad) begin
+                filling   <= 1;
+                fill_ack  <= 0;
+                fill_addr <= win_q[15:0] << (LUT_BITS - win_length);
+                fill_left <= 1 << (LUT_BITS - win_length);
+                fill_data <= {win_length, win_sym};
+            end else if (load_valid_pulse && !filling) begin
+                if (load_length == 0 || load_length > LUT_BITS) begin
+                    // Cannot be represented in the table; flagged below
+                    load_valid_out <= 1;
+                end else begin
+                    filling   <= 1;
+                    fill_ack  <= 1;
+                    fill_addr <= load_code << (LUT_BITS - load_length);
+                    fill_left <= 1 << (LUT_BITS - load_length);
+                    fill_data <= {load_length, load_symbol};
+                end
+            end else if (filling) begin
+                fill_addr <= fill_addr + 1;
+                fill_left <= fill_left - 1;
+                if (fill_left == 1) begin
+                    filling        <= 0;
+                    load_valid_out <= fill_ack;
+                end
+            end else if (!load_valid) begin
+                load_valid_out <= 0;
+            end
+        end
+    end
+
+    // ------------------------------------------------------------------
+    // Bit buffer
+    // ------------------------------------------------------------------
+    // bitbuf is left-aligned: bit 63 is the next undecoded bit and
+    // bitcnt bits are valid. A word is accepted whenever at least 32
+    // bits are free, so decoding never waits on a refill while the
+    // producer keeps up.
+    reg  [63:0] bitbuf;
+    reg  [6:0]  bitcnt;
+    reg  [31:0] remaining;
+    reg         running;
+
+    wire [7:0]  lut_symbol = lut_q[7:0];
+    wire [4:0]  lut_length = lut_q[12:8];
+
+    wire out_free   = !symbol_valid || symbol_ready;
+    wire can_decode = running && (remaining != 0) && out_free &&
+                      (lut_length != 0) && (bitcnt >= lut_length);
+    wire bad_code   = running && (remaining != 0) &&
+                      (lut_length == 0) && (bitcnt >= LUT_BITS);
+
+    wire [4:0]  consumed = can_decode ? lut_length : 5'd0;
+    wire [6:0]  kept     = bitcnt - consumed;
+
+    assign word_ready = running && (bitcnt <= 32);
+    wire   refill     = word_valid && word_ready;
+
+    wire [63:0] bitbuf_next = (bitbuf << consumed) |
+                              (refill ? ({word_in, 32'b0} >> kept) : 64'b0);
+    wire [6:0]  bitcnt_next = kept + (refill ? 7'd32 : 7'd0);
+
+    // ------------------------------------------------------------------
+    // Table ports
+    // ------------------------------------------------------------------
+    // The read address is the prefix of the *next* buffer state, so
+    // lut_q always describes the codeword at the head of bitbuf.
+    wire [LUT_BITS-1:0] lut_rd_addr = start_pulse ? {LUT_BITS{1'b0}}
+                                                  : bitbuf_next[63 -: LUT_BITS];
+
+    always @(posedge clock) begin
+        if (filling)
+            lut[{table_bank, fill_addr}] <= fill_data;
+        lut_q <= lut[{table_bank, lut_rd_addr}];
+    end
+
+    // ------------------------------------------------------------------
+    // Decode logic
+    // ------------------------------------------------------------------
+    always @(posedge clock or posedge reset) begin
+        if (reset) begin
+            bitbuf       <= 0;
+            bitcnt       <= 0;
+            remaining    <= 0;
+            running      <= 0;
+            done         <= 0;
+            error        <= 0;
+            symbol_out   <= 0;
+            length_out   <= 0;
+            symbol_valid <= 0;
+        end else begin
+            if (symbol_valid && symbol_ready)
+                symbol_valid <= 0;
+
+            if ((load_valid_pulse && !filling &&
+                 (load_length == 0 || load_length > LUT_BITS)) || win_bad)
+                error <= 1;
+
+            if (start_pulse) begin
+                bitbuf       <= 0;
+                bitcnt       <= 0;
+                remaining    <= symbol_count;
+                running      <= (symbol_count != 0);
+                done         <= (symbol_count == 0);
+                error        <= 0;
+                symbol_valid <= 0;
+            end else if (running) begin
+                bitbuf <= bitbuf_next;
+                bitcnt <= bitcnt_next;
+
+                if (can_decode) begin
+                    symbol_out   <= lut_symbol;
+                    length_out   <= lut_length;
+                    symbol_valid <= 1;
+                    remaining    <= remaining - 1;
+                    if (remaining == 1) begin
+                        running <= 0;
+                        done    <= 1;
+                    end
+                end else if (bad_code) begin
+                    running <= 0;
+                    error   <= 1;
+                end
+            end
+        end
+    end
+
+    // ------------------------------------------------------------------
+    // Payload CRC of the words taken in
+    // ------------------------------------------------------------------
+    crc32_words word_check (
+        .clock (clock),
+        .reset (reset),
+        .clear (start_pulse),
+        .data  (word_in),
+        .valid (refill),
+        .crc   (word_crc)
+    );
+
+    // ------------------------------------------------------------------
+    // Performance counters
+    // ------------------------------------------------------------------
+    wire decoding = running && (remaining != 0);
+
+    perf_counters #(
+        .ENABLE    (PERF_COUNTERS),
+        .ITEM_WIDTH(1),
+        .BITS_WIDTH(5)
+    ) perf (
+        .clock      (clock),
+        .reset      (reset),
+        .active     (can_decode || filling),
+        .in_stall   (decoding && !bad_code),
+        .out_stall  (decoding && !out_free),
+        .items      (can_decode),
+        .bits       (consumed),
+        .clear      (perf_clear),
+        .perf_count (perf_count)
+    );
+
+endmodule
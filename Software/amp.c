@@ -0,0 +1,221 @@
+/*
+ * amp.c
+ *
+ * Dual-core ring shared by the compression and decompression
+ * applications and the CPU1 I/O server. See amp.h.
+ */
+
+#include "amp.h"
+#include "perf.h"
+#include "xil_mmu.h"
+#include "xil_cache.h"
+#include "xil_printf.h"
+#include "xpseudo_asm.h"
+#include <string.h>
+
+void amp_map_ocm(void) {
+    Xil_SetTlbAttributes(AMP_OCM_BASE, AMP_OCM_ATTR);
+}
+
+// End of the running image, heap and stack included (Vitis linker script)
+extern char _end[];
+
+int amp_start_cpu1(void) {
+    AmpShared *sh = AMP_SHARED;
+    if ((UINTPTR)_end > AMP_CPU1_ENTRY) {
+        xil_printf("ERROR: CPU0's image ends at 0x%08lX, inside CPU1's DDR at 0x%08X\r\n",
+                   (unsigned long)(UINTPTR)_end, AMP_CPU1_ENTRY);
+        return -1;
+    }
+    memset(sh, 0, sizeof(*sh));
+    dmb();
+
+    *(volatile u32 *)AMP_CPU1_START_ADDR = AMP_CPU1_ENTRY;
+    dmb();
+    sev();
+
+    for (u32 to = AMP_TIMEOUT; to > 0; to--)
+        if (sh->cpu1_ready == AMP_READY)
+            return 0;
+    return -1;
+}
+
+int amp_push(AmpRing *r, const AmpMsg *m) {
+    u32 head = r->head;
+    if (head - r->tail == AMP_RING_SLOTS)
+        return -1;
+
+    memcpy(&r->slot[head % AMP_RING_SLOTS], m, sizeof(*m));
+    dmb();                  // slot before index
+    r->head = head + 1;
+    return 0;
+}
+
+int amp_pop(AmpRing *r, AmpMsg *m) {
+    u32 tail = r->tail;
+    if (r->head == tail)
+        return -1;
+
+    dmb();                  // index before slot
+    memcpy(m, &r->slot[tail % AMP_RING_SLOTS], sizeof(*m));
+    dmb();                  // slot read before it is handed back
+    r->tail = tail + 1;
+    return 0;
+}
+
+int amp_send(AmpRing *r, const AmpMsg *m) {
+    for (u32 to = AMP_TIMEOUT; to > 0; to--)
+        if (amp_push(r, m) == 0)
+            return 0;
+    return -1;
+}
+
+int amp_recv(AmpRing *r, AmpMsg *m) {
+    for (u32 to = AMP_TIMEOUT; to > 0; to--)
+        if (amp_pop(r, m) == 0)
+            return 0;
+    return -1;
+}
+
+// ----------------------------------------------------------------------
+// CPU0 side
+// ----------------------------------------------------------------------
+
+static struct {
+    u32 input_addr;         // read-ahead destination
+    u32 input_size;
+    u32 input_ready;        // bytes arrived and invalidated
+    int size_known;         // AMP_OP_SIZE seen
+    int closed;             // AMP_OP_CLOSED seen
+    u32 closed_bytes;
+    int decoded;            // AMP_OP_DECODED seen
+    int failed;             // AMP_OP_ERROR seen, or CPU1 hung
+} amp;
+
+static int request(u32 op, const char *name, u32 addr, u32 bytes) {
+    AmpMsg m;
+    memset(&m, 0, sizeof(m));
+    m.op    = op;
+    m.addr  = addr;
+    m.bytes = bytes;
+    if (name)
+        strncpy(m.name, name, AMP_NAME_MAX - 1);
+
+    if (amp_send(&AMP_SHARED->to_cpu1, &m) != 0) {
+        xil_printf("ERROR: CPU1 request ring stuck (op %u)\r\n", op);
+        amp.failed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+// Every reply that has arrived
+static void drain_replies(void) {
+    AmpMsg m;
+    while (amp_pop(&AMP_SHARED->to_cpu0, &m) == 0) {
+        switch (m.op) {
+        case AMP_OP_SIZE:
+            amp.input_size = m.bytes;
+            amp.size_known = 1;
+            break;
+        case AMP_OP_DATA:
+            // Drop whatever CPU0 cached of the new bytes
+            Xil_DCacheInvalidateRange(amp.input_addr + amp.input_ready, m.bytes - amp.input_ready);
+            amp.input_ready = m.bytes;
+            break;
+        case AMP_OP_CLOSED:
+            amp.closed_bytes = m.bytes;
+            amp.closed = 1;
+            break;
+        case AMP_OP_DECODED:
+            amp.decoded = 1;
+            break;
+        default:
+            xil_printf("ERROR: CPU1 request %u failed (FRESULT %u)\r\n", m.arg, m.bytes);
+            amp.failed = 1;
+            break;
+        }
+    }
+}
+
+// Spin on the replies until *flag is set
+static int wait_for(volatile int *flag) {
+    for (u32 to = AMP_TIMEOUT; to > 0; to--) {
+        perf_polls(1);
+        drain_replies();
+        if (amp.failed)
+            return -1;
+        if (*flag)
+            return 0;
+    }
+    xil_printf("ERROR: CPU1 is not answering\r\n");
+    amp.failed = 1;
+    return -1;
+}
+
+int amp_open_input(const char *name, u32 *size) {
+    amp.size_known = 0;
+    if (request(AMP_OP_OPEN, name, 0, 0) != 0 || wait_for(&amp.size_known) != 0)
+        return -1;
+    *size = amp.input_size;
+    return 0;
+}
+
+int amp_read_input(u32 dst, u32 size) {
+    amp.input_addr  = dst;
+    amp.input_size  = size;
+    amp.input_ready = 0;
+    // No dirty line of CPU0 may land on the bytes CPU1 writes
+    Xil_DCacheInvalidateRange(dst, size);
+    return request(AMP_OP_READ, NULL, dst, size);
+}
+
+int amp_input_wait(u32 need, u32 *ready) {
+    if (need > amp.input_size)
+        need = amp.input_size;
+
+    for (u32 to = AMP_TIMEOUT; amp.input_ready < need; to--) {
+        perf_polls(1);
+        drain_replies();
+        if (amp.failed || to == 0) {
+            if (!amp.failed)
+                xil_printf("ERROR: CPU1 is not answering\r\n");
+            amp.failed = 1;
+            return -1;
+        }
+    }
+    *ready = amp.input_ready;
+    return 0;
+}
+
+int amp_write_begin(const char *name, u32 expect) {
+    return request(AMP_OP_CREATE, name, 0, expect);
+}
+
+int amp_write_chunk(u32 addr, u32 bytes) {
+    Xil_DCacheFlushRange(addr, bytes);
+    return request(AMP_OP_WRITE, NULL, addr, bytes);
+}
+
+int amp_write_end(u32 bytes) {
+    amp.closed = 0;
+    if (request(AMP_OP_CLOSE, NULL, 0, 0) != 0 || wait_for(&amp.closed) != 0)
+        return -1;
+    return amp.closed_bytes == bytes ? 0 : -1;
+}
+
+int amp_decode_start(void) {
+    amp.decoded = 0;
+    return request(AMP_OP_DECODE, NULL, 0, 0);
+}
+
+int amp_decode_poll(void) {
+    drain_replies();
+    if (amp.failed)
+        return -1;
+    return amp.decoded;
+}
+
+void amp_stop(void) {
+    request(AMP_OP_EXIT, NULL, 0, 0);
+}
@@ -0,0 +1,180 @@
+/*
+ * amp.h
+ *
+ * Dual-core (AMP_MODE = 1) support shared by the compression and
+ * decompression applications and the CPU1 I/O server (amp_io.c).
+ *
+ * CPU0 runs the application and drives the IP cores. CPU1 runs
+ * amp_io.c, a separate standalone application that owns the SD card:
+ * it streams input files into DDR ahead of the pipeline (read-ahead),
+ * writes output buffers behind it (write-behind) and, for block
+ * archives, decodes blocks in software while CPU0 decodes others
+ * through the IP.
+ *
+ * The cores talk through two single-producer/single-consumer rings in
+ * the top 64 KB of OCM, mapped uncached on both sides:
+ *
+ *   to_cpu1   requests, written by CPU0
+ *   to_cpu0   replies,  written by CPU1
+ *
+ * head is only written by the producer and tail only by the consumer,
+ * so no lock is needed; a dmb orders the slot contents before the
+ * index update. Buffers a message points at are in DDR: the sender
+ * flushes them from its data cache before posting, the receiver
+ * invalidates them before reading.
+ *
+ * Requests (CPU0 -> CPU1) and their replies:
+ *
+ *   AMP_OP_OPEN    name         AMP_OP_SIZE {bytes}
+ *   AMP_OP_READ    addr, bytes  read the open file into addr: one
+ *                               AMP_OP_DATA {bytes so far} per
+ *                               AMP_CHUNK_BYTES
+ *   AMP_OP_CREATE  name, bytes  create (replace) the output file,
+ *                               bytes preallocated (estimate, 0: none)
+ *   AMP_OP_WRITE   addr, bytes  append to it, no reply
+ *   AMP_OP_CLOSE                AMP_OP_CLOSED {bytes written}
+ *   AMP_OP_DECODE               decode AmpShared.job, AMP_OP_DECODED
+ *   AMP_OP_EXIT                 unmount the card and park CPU1
+ *
+ * A failed request is answered with AMP_OP_ERROR {arg: the request,
+ * bytes: FRESULT}; a failed create or write is reported by the close.
+ *
+ * The amp_* file and decode helpers at the end are CPU0's side of this
+ * protocol. They keep the read-ahead state (bytes arrived so far) and
+ * print their own errors.
+ */
+
+#ifndef AMP_H
+#define AMP_H
+
+#include <xil_types.h>
+
+#define AMP_OCM_BASE        0xFFFF0000   // top 64 KB of OCM, shared by both cores
+#define AMP_OCM_ATTR        0x14DE2      // its 1 MB section: normal, shareable, non-cacheable
+#define AMP_CPU1_START_ADDR 0xFFFFFFF0   // boot ROM: CPU1 jumps to the address written here on sev
+#define AMP_CPU1_ENTRY      0x08000000   // start of the amp_io.c image (CPU1 linker script DDR base)
+#define AMP_CPU1_IMAGE_BYTES 0x04000000  // amp_io.c code, data, heap and stack (CPU1 linker script DDR length)
+#define AMP_CPU1_SCRATCH    0x0C000000   // DDR only CPU1 touches (zero-run tokens of its blocks)
+#define AMP_SCRATCH_BYTES   0x04000000
+#define AMP_CPU1_DDR_END    (AMP_CPU1_SCRATCH + AMP_SCRATCH_BYTES)  // CPU0's DDR buffers start here or above
+#define AMP_READY           0x414D5031   // "AMP1", set by CPU1 once the card is mounted
+#define AMP_RING_SLOTS      64           // messages per ring, power of two
+#define AMP_CHUNK_BYTES     (256 * 1024) // read-ahead / write-behind transfer, multiple of 512
+#define AMP_NAME_MAX        16           // 8.3 file name and NUL
+#define AMP_TIMEOUT         200000000    // polls before the other core is declared hung
+
+#if AMP_CPU1_ENTRY + AMP_CPU1_IMAGE_BYTES > AMP_CPU1_SCRATCH
+#error "CPU1's image would run into AMP_CPU1_SCRATCH"
+#endif
+
+// Requests
+#define AMP_OP_OPEN         1
+#define AMP_OP_READ         2
+#define AMP_OP_CREATE       3
+#define AMP_OP_WRITE        4
+#define AMP_OP_CLOSE        5
+#define AMP_OP_DECODE       6
+#define AMP_OP_EXIT         7
+
+// Replies
+#define AMP_OP_SIZE         16
+#define AMP_OP_DATA         17
+#define AMP_OP_CLOSED       18
+#define AMP_OP_DECODED      19
+#define AMP_OP_ERROR        20
+
+typedef struct {
+    u32  op;                // AMP_OP_*
+    u32  addr;              // DDR buffer
+    u32  bytes;
+    u32  arg;
+    char name[AMP_NAME_MAX];
+} AmpMsg;
+
+typedef struct {
+    volatile u32 head;      // next slot the producer fills
+    volatile u32 tail;      // next slot the consumer reads
+    AmpMsg slot[AMP_RING_SLOTS];
+} AmpRing;
+
+// One block of a COMPBIN_FLAG_BLOCKS archive, decoded by CPU1 in
+// software: codewords (checked against payload_crc) -> symbols (or
+// tokens, then symbols) -> words in place, checked against crc32.
+// symbols must start and end on a cache line so CPU0's neighbouring
+// blocks never share one.
+typedef struct {
+    u32 payload;            // first codeword word
+    u32 payload_bits;
+    u32 symbol_count;
+    u32 lengths;            // 256 canonical code lengths
+    u32 zrle;               // 1: the codewords are zero-run tokens (decoded to AMP_CPU1_SCRATCH)
+    u32 escape;             // their escape symbol
+    u32 symbols;            // n_words * 4 symbols, overwritten by the words
+    u32 n_words;
+    u32 crc32;
+    u32 has_payload_crc;    // 1: check the codewords against payload_crc first
+    u32 payload_crc;        // COMPBIN_FLAG_PAYLOAD_CRC of the block
+    s32 status;             // AMP_JOB_*, written by CPU1
+} AmpBlockJob;
+
+#define AMP_JOB_OK          0
+#define AMP_JOB_DECODE     -1   // invalid or truncated codeword
+#define AMP_JOB_EXPAND     -2   // zero-run tokens do not expand to n_words
+#define AMP_JOB_CRC        -3   // words do not match crc32
+#define AMP_JOB_PAYLOAD    -4   // codewords do not match payload_crc
+
+typedef struct {
+    volatile u32 cpu1_ready;    // AMP_READY
+    AmpRing      to_cpu1;
+    AmpRing      to_cpu0;
+    volatile AmpBlockJob job;
+} AmpShared;
+
+#define AMP_SHARED          ((AmpShared *)AMP_OCM_BASE)
+
+// Both cores, before the rings are touched: OCM section uncached
+void amp_map_ocm(void);
+
+// CPU0: clear the rings, release CPU1 from the boot ROM and wait for
+// it to mount the card. Returns 0, or -1 if it does not report ready.
+int  amp_start_cpu1(void);
+
+// Non-blocking: 0, or -1 if the ring is full / empty
+int  amp_push(AmpRing *r, const AmpMsg *m);
+int  amp_pop(AmpRing *r, AmpMsg *m);
+
+// Blocking: spin until there is room / a message. Return 0, or -1
+// after AMP_TIMEOUT polls.
+int  amp_send(AmpRing *r, const AmpMsg *m);
+int  amp_recv(AmpRing *r, AmpMsg *m);
+
+// ---- CPU0 ----
+
+// Size of input file name, opened on CPU1. Returns 0 or -1.
+int  amp_open_input(const char *name, u32 *size);
+
+// Start reading the open input (size bytes) into dst; returns at once
+int  amp_read_input(u32 dst, u32 size);
+
+// Wait until at least need bytes of the input are in DDR (and out of
+// CPU0's cache) and store the number that are in *ready. Returns 0,
+// or -1 if the read failed or CPU1 stopped answering.
+int  amp_input_wait(u32 need, u32 *ready);
+
+// Write-behind: create name (about expect bytes, 0 if unknown), append
+// buffers in the order given (they must stay untouched until
+// amp_write_end), then close. amp_write_end returns 0 once exactly
+// bytes have been written.
+int  amp_write_begin(const char *name, u32 expect);
+int  amp_write_chunk(u32 addr, u32 bytes);
+int  amp_write_end(u32 bytes);
+
+// Decode AMP_SHARED->job on CPU1. amp_decode_poll returns 1 once it is
+// done (status in the job), 0 while it runs, -1 if CPU1 failed.
+int  amp_decode_start(void);
+int  amp_decode_poll(void);
+
+// Park CPU1 (it unmounts the card)
+void amp_stop(void);
+
+#endif
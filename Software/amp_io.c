@@ -0,0 +1,183 @@
+/*
+ * amp_io.c
+ *
+ * CPU1 application for AMP_MODE = 1 (see amp.h).
+ *
+ * Target platform : ZedBoard (Zynq-7000), ps7_cortexa9_1
+ * Toolchain       : Vivado / Vitis 2023.x, standalone BSP with
+ *                   USE_AMP=1, linked at AMP_CPU1_ENTRY
+ *
+ * Owns the SD card while CPU0 runs compression.c or decompression.c:
+ * serves the file requests of the to_cpu1 ring (chunked reads into
+ * DDR, appended writes from DDR) and decodes blocks of block archives
+ * in software. Prints nothing; every failure is reported to CPU0.
+ */
+#include "xil_printf.h"
+#include "xil_cache.h"
+#include "ff.h"
+#include "sdCard.h"
+#include "amp.h"
+#include "codebook.h"
+#include "bitstream.h"
+#include "zrle.h"
+#include <string.h>
+
+static FIL *f_read_file  = NULL;    // AMP_OP_OPEN
+static FIL *f_write_file = NULL;    // AMP_OP_CREATE
+static u32  write_bytes  = 0;
+static int  write_failed = 0;
+
+static void reply(u32 op, u32 addr, u32 bytes, u32 arg) {
+    AmpMsg m;
+    memset(&m, 0, sizeof(m));
+    m.op    = op;
+    m.addr  = addr;
+    m.bytes = bytes;
+    m.arg   = arg;
+    // CPU0 drains its ring while it waits; there is no timeout here
+    while (amp_push(&AMP_SHARED->to_cpu0, &m) != 0)
+        ;
+}
+
+static void serve_open(const AmpMsg *m) {
+    if (f_read_file)
+        closeFile(f_read_file);
+    f_read_file = openFile((char *)m->name, 'r');
+    if (!f_read_file) {
+        reply(AMP_OP_ERROR, 0, FR_NO_FILE, AMP_OP_OPEN);
+        return;
+    }
+    reply(AMP_OP_SIZE, 0, f_size(f_read_file), 0);
+}
+
+// Whole chunks, so every read but the last moves complete sectors
+static void serve_read(const AmpMsg *m) {
+    u8 *dst = (u8 *)m->addr;
+    u32 done = 0;
+
+    if (!f_read_file) {
+        reply(AMP_OP_ERROR, m->addr, FR_INVALID_OBJECT, AMP_OP_READ);
+        return;
+    }
+    if (f_lseek(f_read_file, 0) != FR_OK) {
+        closeFile(f_read_file);
+        f_read_file = NULL;
+        reply(AMP_OP_ERROR, m->addr, FR_INVALID_OBJECT, AMP_OP_READ);
+        return;
+    }
+
+    while (done < m->bytes) {
+        u32 chunk = m->bytes - done < AMP_CHUNK_BYTES ? m->bytes - done : AMP_CHUNK_BYTES;
+        if (readChunk(f_read_file, (u32)(dst + done), chunk) != (int)chunk) {
+            closeFile(f_read_file);
+            f_read_file = NULL;
+            reply(AMP_OP_ERROR, m->addr, FR_DISK_ERR, AMP_OP_READ);
+            return;
+        }
+        Xil_DCacheFlushRange((UINTPTR)(dst + done), chunk);
+        done += chunk;
+        reply(AMP_OP_DATA, m->addr, done, 0);
+    }
+
+    closeFile(f_read_file);
+    f_read_file = NULL;
+}
+
+static void serve_create(const AmpMsg *m) {
+    if (f_write_file)
+        closeFile(f_write_file);
+    f_write_file = createFile((char *)m->name, m->bytes);
+    write_bytes  = 0;
+    write_failed = (f_write_file == NULL);
+}
+
+static void serve_write(const AmpMsg *m) {
+    if (write_failed)
+        return;
+    Xil_DCacheInvalidateRange(m->addr, m->bytes);
+    if (writeFile(f_write_file, m->bytes, m->addr) != (int)m->bytes)
+        write_failed = 1;
+    else
+        write_bytes += m->bytes;
+}
+
+static void serve_close(void) {
+    int failed = write_failed;
+    if (f_write_file && closeFile(f_write_file) != XST_SUCCESS)
+        failed = 1;
+    f_write_file = NULL;
+
+    if (failed)
+        reply(AMP_OP_ERROR, 0, FR_DISK_ERR, AMP_OP_CLOSE);
+    else
+        reply(AMP_OP_CLOSED, 0, write_bytes, 0);
+}
+
+// Same steps as CPU0's block loop, with the codewords resolved by
+// codebook_decode() and the Merger IP replaced by shifts
+static s32 decode_block(volatile AmpBlockJob *job) {
+    AmpBlockJob j;
+    memcpy(&j, (const void *)job, sizeof(j));
+
+    u8 *symbols = (u8 *)j.symbols;
+    u8 *decoded = j.zrle ? (u8 *)AMP_CPU1_SCRATCH : symbols;
+    u32 n_symbols = j.n_words * 4;
+
+    Xil_DCacheInvalidateRange(j.payload, (j.payload_bits + 31) / 32 * 4);
+    Xil_DCacheInvalidateRange(j.lengths, 256);
+
+    if (j.has_payload_crc &&
+        bit_crc32_words((const u32 *)j.payload, (j.payload_bits + 31) / 32) != j.payload_crc)
+        return AMP_JOB_PAYLOAD;
+
+    if (j.zrle && j.symbol_count > AMP_SCRATCH_BYTES)
+        return AMP_JOB_EXPAND;
+    if (codebook_decode((const u8 *)j.lengths, (const u32 *)j.payload, j.payload_bits,
+                        j.symbol_count, decoded) != 0)
+        return AMP_JOB_DECODE;
+    if (j.zrle &&
+        zrle_expand(decoded, j.symbol_count, (u8)j.escape, symbols, n_symbols) != (int)n_symbols)
+        return AMP_JOB_EXPAND;
+
+    // Word i overwrites its own four symbols
+    u32 *words = (u32 *)symbols;
+    for (u32 w = 0; w < j.n_words; w++)
+        words[w] = bit_load_be32(symbols + 4 * w);
+
+    s32 status = bit_crc32_words(words, j.n_words) == j.crc32 ? AMP_JOB_OK : AMP_JOB_CRC;
+    Xil_DCacheFlushRange(j.symbols, n_symbols);
+    return status;
+}
+
+int main() {
+    amp_map_ocm();
+
+    if (SD_Init() != XST_SUCCESS)
+        return -1;
+    AMP_SHARED->cpu1_ready = AMP_READY;
+
+    for (;;) {
+        AmpMsg m;
+        if (amp_pop(&AMP_SHARED->to_cpu1, &m) != 0)
+            continue;
+
+        switch (m.op) {
+        case AMP_OP_OPEN:   serve_open(&m);   break;
+        case AMP_OP_READ:   serve_read(&m);   break;
+        case AMP_OP_CREATE: serve_create(&m); break;
+        case AMP_OP_WRITE:  serve_write(&m);  break;
+        case AMP_OP_CLOSE:  serve_close();    break;
+        case AMP_OP_DECODE:
+            AMP_SHARED->job.status = decode_block(&AMP_SHARED->job);
+            reply(AMP_OP_DECODED, 0, 0, 0);
+            break;
+        case AMP_OP_EXIT:
+            SD_Eject();
+            AMP_SHARED->cpu1_ready = 0;
+            return 0;
+        default:
+            reply(AMP_OP_ERROR, 0, FR_INVALID_PARAMETER, m.op);
+            break;
+        }
+    }
+}
@@ -0,0 +1,249 @@
+/*
+ * batch.c
+ *
+ * Batch runs shared by the compression and decompression
+ * applications. See batch.h.
+ */
+
+#include "batch.h"
+#include "ff.h"
+#include "xil_printf.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MANIFEST_MAX  16384           // bytes of BATCH_MANIFEST read
+
+static char manifest[MANIFEST_MAX + 1];
+
+static char upper(char c) {
+    return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+}
+
+// Characters kept in a short name ('~' so names made here survive the
+// next pass); the rest, even where FAT would allow it, becomes '_'
+static char short_char(char c) {
+    c = upper(c);
+    if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '~')
+        return c;
+    return '_';
+}
+
+static int ext_matches(const char *name, const char *ext) {
+    const char *dot = strrchr(name, '.');
+    if (!dot || strlen(dot + 1) != strlen(ext))
+        return 0;
+    for (const char *p = dot + 1; *p; p++, ext++)
+        if (upper(*p) != upper(*ext))
+            return 0;
+    return 1;
+}
+
+// dst = dir/name, or name for the root; -1 if it does not fit
+static int join(char *dst, const char *dir, const char *name) {
+    int n = dir[0] ? snprintf(dst, BATCH_PATH_MAX, "%s/%s", dir, name)
+                   : snprintf(dst, BATCH_PATH_MAX, "%s", name);
+    return (n < 0 || n >= BATCH_PATH_MAX) ? -1 : 0;
+}
+
+static int add_input(BatchList *b, const char *dir, const char *name) {
+    if (b->n == BATCH_MAX_FILES) {
+        xil_printf("NOTE: more than %d inputs, %s and later ones skipped\r\n",
+                   BATCH_MAX_FILES, name);
+        return -1;
+    }
+    BatchEntry *e = &b->e[b->n];
+    memset(e, 0, sizeof(*e));
+    if (join(e->in, dir, name) != 0) {
+        xil_printf("NOTE: %s skipped, its path is longer than %d characters\r\n",
+                   name, BATCH_PATH_MAX - 1);
+        return 0;
+    }
+    b->n++;
+    return 0;
+}
+
+// One input per line of the manifest, in its order; names without
+// the input extension are not inputs of this application
+static int list_manifest(BatchList *b, FIL *f, const char *name, const char *dir,
+                         const char *ext) {
+    UINT br;
+    if (f_size(f) > MANIFEST_MAX) {
+        xil_printf("ERROR: %s is larger than %d bytes\r\n", name, MANIFEST_MAX);
+        return -1;
+    }
+    if (f_read(f, manifest, f_size(f), &br) != FR_OK || br != f_size(f)) {
+        xil_printf("ERROR: Reading %s\r\n", name);
+        return -1;
+    }
+    manifest[br] = '\0';
+
+    for (char *line = manifest; line; ) {
+        char *next = strchr(line, '\n');
+        if (next)
+            *next++ = '\0';
+        while (*line == ' ' || *line == '\t')
+            line++;
+        char *end = line + strlen(line);
+        while (end > line && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+            *--end = '\0';
+        if (*line && *line != '#') {
+            if (!ext_matches(line, ext))
+                xil_printf("NOTE: %s skipped, not a .%s file\r\n", line, ext);
+            else if (add_input(b, dir, line) != 0)
+                break;
+        }
+        line = next;
+    }
+    return 0;
+}
+
+// Every file NAME.ext of dir, sorted by name
+static int list_dir(BatchList *b, const char *dir, const char *ext) {
+    DIR d;
+    FILINFO fno;
+
+    FRESULT rc = f_opendir(&d, dir[0] ? dir : "/");
+    if (rc != FR_OK) {
+        xil_printf("ERROR: Cannot open directory %s (err=%d)\r\n", dir, rc);
+        return -1;
+    }
+    for (;;) {
+        rc = f_readdir(&d, &fno);
+        if (rc != FR_OK || fno.fname[0] == '\0')
+            break;
+        if ((fno.fattrib & AM_DIR) || !ext_matches(fno.fname, ext))
+            continue;
+        if (add_input(b, dir, fno.fname) != 0)
+            break;
+    }
+    f_closedir(&d);
+    if (rc != FR_OK) {
+        xil_printf("ERROR: Reading directory %s (err=%d)\r\n", dir, rc);
+        return -1;
+    }
+
+    // Directory order is creation order on FAT: sort, so runs repeat
+    for (u32 i = 1; i < b->n; i++) {
+        BatchEntry e = b->e[i];
+        u32 j = i;
+        for (; j > 0 && strcmp(b->e[j - 1].in, e.in) > 0; j--)
+            b->e[j] = b->e[j - 1];
+        b->e[j] = e;
+    }
+    return 0;
+}
+
+static int out_taken(const BatchList *b, u32 n, const char *path) {
+    for (u32 i = 0; i < n; i++)
+        if (strcmp(b->e[i].out, path) == 0)
+            return 1;
+    return 0;
+}
+
+// 8.3 output name of entry i, unique among the entries before it
+static int make_out_name(BatchList *b, u32 i, const char *out_dir, const char *out_ext) {
+    const char *name = b->e[i].in;
+    const char *slash = strrchr(name, '/');
+    if (slash)
+        name = slash + 1;
+    const char *dot = strrchr(name, '.');
+    u32 len = dot ? (u32)(dot - name) : strlen(name);
+
+    char base[9], cand[13], tail[8];
+    u32 keep = len < 8 ? len : 8;
+    for (u32 k = 0; k < keep; k++)
+        base[k] = short_char(name[k]);
+    if (keep == 0)
+        base[keep++] = '_';
+    base[keep] = '\0';
+
+    for (u32 n = 0; n <= BATCH_MAX_FILES; n++) {
+        if (n == 0) {
+            if (len > 8)
+                continue;
+            sprintf(cand, "%s.%s", base, out_ext);
+        } else {
+            int t = sprintf(tail, "~%lu", (unsigned long)n);
+            u32 k = keep < 8 - (u32)t ? keep : 8 - (u32)t;
+            sprintf(cand, "%.*s%s.%s", (int)k, base, tail, out_ext);
+        }
+        if (join(b->e[i].out, out_dir, cand) != 0)
+            return -1;
+        if (!out_taken(b, i, b->e[i].out))
+            return 0;
+    }
+    return -1;
+}
+
+int batch_list(BatchList *b, const char *in_dir, const char *in_ext, const char *manifest,
+               const char *out_dir, const char *out_ext) {
+    char path[BATCH_PATH_MAX];
+    FIL f;
+    int rc;
+
+    b->n = 0;
+    if (out_dir[0]) {
+        FRESULT mk = f_mkdir(out_dir);
+        if (mk != FR_OK && mk != FR_EXIST) {
+            xil_printf("ERROR: Cannot create directory %s (err=%d)\r\n", out_dir, mk);
+            return -1;
+        }
+    }
+
+    if (join(path, in_dir, manifest) == 0 && f_open(&f, path, FA_READ) == FR_OK) {
+        xil_printf("Batch inputs from %s\r\n", path);
+        rc = list_manifest(b, &f, path, in_dir, in_ext);
+        f_close(&f);
+    } else {
+        xil_printf("Batch inputs: *.%s in %s\r\n", in_ext, in_dir[0] ? in_dir : "/");
+        rc = list_dir(b, in_dir, in_ext);
+    }
+    if (rc != 0)
+        return -1;
+
+    for (u32 i = 0; i < b->n; i++) {
+        if (make_out_name(b, i, out_dir, out_ext) != 0) {
+            xil_printf("ERROR: No output name for %s in %s\r\n", b->e[i].in, out_dir);
+            return -1;
+        }
+    }
+    return (int)b->n;
+}
+
+static u32 ratio_x1000(u64 plain, u64 packed) {
+    return packed ? (u32)(plain * 1000 / packed) : 0;
+}
+
+static u32 kbps(u64 bytes, u64 us) {
+    return us ? (u32)(bytes * 1000000 / us / 1024) : 0;
+}
+
+void batch_report(const char *app, const BatchList *b) {
+    u64 plain = 0, packed = 0, us = 0;
+    u32 done = 0;
+
+    xil_printf("\n---- Batch result (%s): %u files ----\r\n", app, b->n);
+    xil_printf("  %-28s %-28s %10s %10s %9s %10s %8s\r\n",
+               "input", "output", "plain", "packed", "ratio", "time us", "KB/s");
+    for (u32 i = 0; i < b->n; i++) {
+        const BatchEntry *e = &b->e[i];
+        if (e->status != 0) {
+            xil_printf("  %-28s %-28s FAILED\r\n", e->in, e->out);
+            continue;
+        }
+        u32 r = ratio_x1000(e->plain_bytes, e->packed_bytes);
+        xil_printf("  %-28s %-28s %10u %10u %5u.%03u %10u %8u\r\n",
+                   e->in, e->out, e->plain_bytes, e->packed_bytes,
+                   r / 1000, r % 1000, e->us, kbps(e->plain_bytes, e->us));
+        plain  += e->plain_bytes;
+        packed += e->packed_bytes;
+        us     += e->us;
+        done++;
+    }
+
+    u32 r = ratio_x1000(plain, packed);
+    xil_printf("  %-28s %-28s %10u %10u %5u.%03u %10u %8u\r\n",
+               "total", "", (u32)plain, (u32)packed, r / 1000, r % 1000, (u32)us, kbps(plain, us));
+    if (done != b->n)
+        xil_printf("FAILED: %u of %u files\r\n", b->n - done, b->n);
+}
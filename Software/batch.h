@@ -0,0 +1,55 @@
+/*
+ * batch.h
+ *
+ * Batch runs shared by the compression and decompression applications
+ * (BATCH_MODE = 1): every input of a directory goes through the
+ * in-memory pipeline in one session, with the card mounted once.
+ *
+ * batch_list() builds the list of inputs. If the directory holds the
+ * application's manifest (BATCH.TXT for compression, UNPACK.TXT for
+ * decompression, so the two never read each other's list), the files
+ * it names are taken in its order, one name per line; blank lines and
+ * lines starting with '#' are skipped, and so, with a note, are names
+ * without the input extension. Otherwise every file of the directory
+ * with the input extension is taken, sorted by name. Each input gets an 8.3 output
+ * name: its base name upper-cased, characters FAT does not allow in a
+ * short name replaced by '_', and cut to "XXXXXX~N" when it is longer
+ * than 8 characters or already taken by an earlier input.
+ *
+ * The application runs each entry, fills in its sizes, time and
+ * status, and batch_report() prints one line per file with the ratio
+ * and time, and the totals.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <xil_types.h>
+
+#define BATCH_MAX_FILES   256
+#define BATCH_PATH_MAX    80          // "DIR/NAME.EXT"; longer names are skipped
+
+typedef struct {
+    char in[BATCH_PATH_MAX];          // input, path on the card
+    char out[BATCH_PATH_MAX];         // output, 8.3 name in the output directory
+    u32  plain_bytes;                 // bitstream: compression input, decompression output
+    u32  packed_bytes;                // archive
+    u32  us;                          // wall time of the file, read to write
+    int  status;                      // 0 done, -1 failed
+} BatchEntry;
+
+typedef struct {
+    BatchEntry e[BATCH_MAX_FILES];
+    u32        n;
+} BatchList;
+
+// Inputs NAME.in_ext of in_dir, or those its manifest file names ->
+// outputs NAME.out_ext in out_dir, which is created if missing.
+// Returns the number of entries, or -1.
+int  batch_list(BatchList *b, const char *in_dir, const char *in_ext, const char *manifest,
+                const char *out_dir, const char *out_ext);
+
+// UART table of the entries and their totals
+void batch_report(const char *app, const BatchList *b);
+
+#endif
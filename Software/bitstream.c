@@ -0,0 +1,469 @@
+/*
+ * bitstream.c
+ *
+ * Bitstream container helpers shared by the compression and
+ * decompression applications. See bitstream.h.
+ */
+
+#include "bitstream.h"
+#include <string.h>
+
+#if BITSTR_NEON
+#include <arm_neon.h>
+#endif
+
+static const u8 bit_preamble[9] = { 0x0F, 0xF0, 0x0F, 0xF0, 0x0F, 0xF0, 0x0F, 0xF0, 0x00 };
+
+static const char *const month_names[12] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+static const char *const day_names[7] = {
+    "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+};
+
+static u32 load_be16(const u8 *p) {
+    return ((u32)p[0] << 8) | p[1];
+}
+
+// One 'key' u16-length NUL-terminated string field at data[*pos]
+static int parse_string_field(const u8 *data, u32 size, u32 *pos, u8 key,
+                              char *dst, u32 room) {
+    if (*pos + 3 > size || data[*pos] != key)
+        return -1;
+    u32 len = load_be16(data + *pos + 1);
+    *pos += 3;
+    if (len == 0 || len > room || *pos + len > size || data[*pos + len - 1] != '\0')
+        return -1;
+    memcpy(dst, data + *pos, len);
+    *pos += len;
+    return 0;
+}
+
+int bit_parse_header(const u8 *data, u32 size, BitHeader *h) {
+    u32 pos = 0;
+
+    memset(h, 0, sizeof(*h));
+    if (size < 13 || load_be16(data) != sizeof(bit_preamble) ||
+        memcmp(data + 2, bit_preamble, sizeof(bit_preamble)) != 0 ||
+        load_be16(data + 11) != 1)
+        return -1;
+    pos = 13;
+
+    if (parse_string_field(data, size, &pos, 'a', h->design, sizeof(h->design)) != 0 ||
+        parse_string_field(data, size, &pos, 'b', h->part,   sizeof(h->part))   != 0 ||
+        parse_string_field(data, size, &pos, 'c', h->date,   sizeof(h->date))   != 0 ||
+        parse_string_field(data, size, &pos, 'd', h->time,   sizeof(h->time))   != 0)
+        return -1;
+
+    if (pos + 5 > size || data[pos] != 'e')
+        return -1;
+    h->payload_bytes = bit_load_be32(data + pos + 1);
+    h->header_bytes  = pos + 5;
+    return 0;
+}
+
+static u32 put_string_field(u8 *dst, u8 key, const char *s) {
+    u32 len = strlen(s) + 1;
+    dst[0] = key;
+    dst[1] = len >> 8;
+    dst[2] = len;
+    memcpy(dst + 3, s, len);
+    return 3 + len;
+}
+
+u32 bit_write_header(u8 *dst, const BitHeader *h, u32 payload_bytes) {
+    u32 n = 0;
+
+    dst[n++] = 0;
+    dst[n++] = sizeof(bit_preamble);
+    memcpy(dst + n, bit_preamble, sizeof(bit_preamble));
+    n += sizeof(bit_preamble);
+    dst[n++] = 0;
+    dst[n++] = 1;
+
+    n += put_string_field(dst + n, 'a', h->design);
+    n += put_string_field(dst + n, 'b', h->part);
+    n += put_string_field(dst + n, 'c', h->date);
+    n += put_string_field(dst + n, 'd', h->time);
+
+    dst[n++] = 'e';
+    bit_store_be32(dst + n, payload_bytes);
+    return n + 4;
+}
+
+// Value of an "<key>  \t<value>" header line, copied into dst if the
+// line starts with key
+static int rbt_field(const char *line, u32 len, const char *key,
+                     char *dst, u32 room) {
+    u32 klen = strlen(key);
+    if (len < klen || strncmp(line, key, klen) != 0)
+        return 0;
+
+    u32 i = klen;
+    while (i < len && (line[i] == ' ' || line[i] == '\t'))
+        i++;
+    u32 n = len - i;
+    if (n > room - 1)
+        n = room - 1;
+    memcpy(dst, line + i, n);
+    dst[n] = '\0';
+    return 1;
+}
+
+// "Thu Aug 21 16:14:43 2025" -> "2025/08/21", "16:14:43"
+static void split_rbt_date(const char *s, BitHeader *h) {
+    char mon[4] = {0};
+    int day = 0, year = 0, m;
+    const char *p = s;
+
+    // Skip the weekday
+    while (*p && *p != ' ') p++;
+    while (*p == ' ') p++;
+    for (int i = 0; i < 3 && *p; i++)
+        mon[i] = *p++;
+    while (*p == ' ') p++;
+    while (*p >= '0' && *p <= '9') day = day * 10 + (*p++ - '0');
+    while (*p == ' ') p++;
+    const char *t = p;
+    while (*p && *p != ' ') p++;
+    u32 tlen = p - t;
+    while (*p == ' ') p++;
+    while (*p >= '0' && *p <= '9') year = year * 10 + (*p++ - '0');
+
+    for (m = 0; m < 12 && strcmp(mon, month_names[m]) != 0; m++)
+        ;
+    if (m == 12 || day < 1 || day > 31 || year < 1000 || year > 9999 ||
+        tlen == 0 || tlen >= sizeof(h->time))
+        return;
+
+    char *d = h->date;
+    d[0] = '0' + year / 1000;
+    d[1] = '0' + year / 100 % 10;
+    d[2] = '0' + year / 10 % 10;
+    d[3] = '0' + year % 10;
+    d[4] = '/';
+    d[5] = '0' + (m + 1) / 10;
+    d[6] = '0' + (m + 1) % 10;
+    d[7] = '/';
+    d[8] = '0' + day / 10;
+    d[9] = '0' + day % 10;
+    d[10] = '\0';
+    memcpy(h->time, t, tlen);
+    h->time[tlen] = '\0';
+}
+
+int bit_header_from_rbt(const char *text, u32 n, BitHeader *h) {
+    char date[64] = {0};
+    u32 pos = 0;
+
+    memset(h, 0, sizeof(*h));
+    while (pos < n) {
+        const char *line = text + pos;
+        u32 len = 0;
+        while (pos + len < n && line[len] != '\n')
+            len++;
+        pos += len + 1;
+        if (len > 0 && line[len - 1] == '\r')
+            len--;
+
+        if (!rbt_field(line, len, "Design name:", h->design, sizeof(h->design)) &&
+            !rbt_field(line, len, "Part:", h->part, sizeof(h->part)))
+            rbt_field(line, len, "Date:", date, sizeof(date));
+    }
+
+    if (date[0])
+        split_rbt_date(date, h);
+    return 0;
+}
+
+static u32 put_str(char *dst, const char *s) {
+    u32 len = strlen(s);
+    memcpy(dst, s, len);
+    return len;
+}
+
+static u32 put_uint(char *dst, u32 v) {
+    char tmp[10];
+    u32 n = 0, len = 0;
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    while (n)
+        dst[len++] = tmp[--n];
+    return len;
+}
+
+// Device family as Vivado names it in the .rbt "Architecture:" line
+static const char *part_family(const char *part) {
+    if (strncmp(part, "xc", 2) == 0)
+        part += 2;
+    if (strncmp(part, "7z", 2) == 0) return "zynq";
+    if (strncmp(part, "7a", 2) == 0) return "artix7";
+    if (strncmp(part, "7k", 2) == 0) return "kintex7";
+    if (strncmp(part, "7v", 2) == 0) return "virtex7";
+    if (strncmp(part, "7s", 2) == 0) return "spartan7";
+    return "unknown";
+}
+
+// "2025/08/21" + "16:14:43" -> "Thu Aug 21 16:14:43 2025"; anything
+// else is passed through as "<date> <time>"
+static u32 put_rbt_date(char *dst, const BitHeader *h) {
+    static const int month_offset[12] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+    const char *d = h->date;
+    u32 n = 0;
+
+    int ok = strlen(d) == 10 && d[4] == '/' && d[7] == '/';
+    for (int i = 0; ok && i < 10; i++)
+        if (i != 4 && i != 7 && (d[i] < '0' || d[i] > '9'))
+            ok = 0;
+
+    int year  = ok ? (d[0] - '0') * 1000 + (d[1] - '0') * 100 + (d[2] - '0') * 10 + (d[3] - '0') : 0;
+    int month = ok ? (d[5] - '0') * 10 + (d[6] - '0') : 0;
+    int day   = ok ? (d[8] - '0') * 10 + (d[9] - '0') : 0;
+
+    if (!ok || month < 1 || month > 12 || day < 1 || day > 31) {
+        n += put_str(dst + n, h->date);
+        dst[n++] = ' ';
+        n += put_str(dst + n, h->time);
+        return n;
+    }
+
+    // Day of the week (Sakamoto)
+    int y = year - (month < 3);
+    int wday = (y + y / 4 - y / 100 + y / 400 + month_offset[month - 1] + day) % 7;
+
+    n += put_str(dst + n, day_names[wday]);
+    dst[n++] = ' ';
+    n += put_str(dst + n, month_names[month - 1]);
+    dst[n++] = ' ';
+    dst[n++] = day < 10 ? ' ' : '0' + day / 10;
+    dst[n++] = '0' + day % 10;
+    dst[n++] = ' ';
+    n += put_str(dst + n, h->time);
+    dst[n++] = ' ';
+    n += put_uint(dst + n, year);
+    return n;
+}
+
+u32 rbt_header_from_bit(char *dst, const BitHeader *h, u32 n_words) {
+    u32 n = 0;
+
+    n += put_str(dst + n, "Xilinx ASCII Bitstream\n");
+    n += put_str(dst + n, "Created by Bitstream (header rebuilt from .bit fields)\n");
+    n += put_str(dst + n, "Design name: \t");
+    n += put_str(dst + n, h->design);
+    n += put_str(dst + n, "\nArchitecture:\t");
+    n += put_str(dst + n, part_family(h->part));
+    n += put_str(dst + n, "\nPart:        \t");
+    n += put_str(dst + n, h->part);
+    n += put_str(dst + n, "\nDate:        \t");
+    n += put_rbt_date(dst + n, h);
+    n += put_str(dst + n, "\nBits:        \t");
+    n += put_uint(dst + n, n_words * 32);
+    dst[n++] = '\n';
+    return n;
+}
+
+// ----------------------------------------------------------------------
+// CRC-32
+// ----------------------------------------------------------------------
+
+static u32 crc_table[256];
+static int crc_table_ready = 0;
+
+static void crc_init_table(void) {
+    for (u32 n = 0; n < 256; n++) {
+        u32 c = n;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[n] = c;
+    }
+    crc_table_ready = 1;
+}
+
+u32 bit_crc32_words(const u32 *words, u32 n_words) {
+    if (!crc_table_ready)
+        crc_init_table();
+
+    u32 crc = 0xFFFFFFFFu;
+    for (u32 i = 0; i < n_words; i++) {
+        u32 w = words[i];
+        for (int shift = 24; shift >= 0; shift -= 8)
+            crc = crc_table[(crc ^ (w >> shift)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// ----------------------------------------------------------------------
+// Archive protection
+// ----------------------------------------------------------------------
+// (~b) ^ key and ~(b ^ key) are both b ^ ~key, so one kernel encrypts
+// and decrypts. The mask is the same in every byte lane, so words can
+// be XORed whole whatever their byte order.
+
+void bit_protect_scalar(u8 *buf, u32 n, u8 key) {
+    u8  mask   = (u8)~key;
+    u32 mask32 = mask * 0x01010101u;
+    u32 i = 0;
+
+    for (; i < n && ((UINTPTR)(buf + i) & 3); i++)
+        buf[i] ^= mask;
+    for (; i + 4 <= n; i += 4)
+        *(u32 *)(buf + i) ^= mask32;
+    for (; i < n; i++)
+        buf[i] ^= mask;
+}
+
+#if BITSTR_NEON
+// 64 bytes per iteration in four q registers, the rest word-wide
+void bit_protect(u8 *buf, u32 n, u8 key) {
+    uint8x16_t mask = vdupq_n_u8((u8)~key);
+    u32 i = 0;
+
+    for (; i + 64 <= n; i += 64) {
+        uint8x16_t a = vld1q_u8(buf + i);
+        uint8x16_t b = vld1q_u8(buf + i + 16);
+        uint8x16_t c = vld1q_u8(buf + i + 32);
+        uint8x16_t d = vld1q_u8(buf + i + 48);
+        vst1q_u8(buf + i,      veorq_u8(a, mask));
+        vst1q_u8(buf + i + 16, veorq_u8(b, mask));
+        vst1q_u8(buf + i + 32, veorq_u8(c, mask));
+        vst1q_u8(buf + i + 48, veorq_u8(d, mask));
+    }
+    bit_protect_scalar(buf + i, n - i, key);
+}
+#else
+void bit_protect(u8 *buf, u32 n, u8 key) {
+    bit_protect_scalar(buf, n, key);
+}
+#endif
+
+// ----------------------------------------------------------------------
+// '0'/'1' text <-> binary
+// ----------------------------------------------------------------------
+
+int rbt_pack_word_scalar(const char *s, u32 *word) {
+    u32 v = 0;
+    for (int i = 0; i < 32; i++) {
+        if (s[i] != '0' && s[i] != '1')
+            return -1;
+        v = (v << 1) | (u32)(s[i] - '0');
+    }
+    *word = v;
+    return 0;
+}
+
+void rbt_unpack_word_scalar(u32 word, char *out) {
+    for (int i = 0; i < 32; i++)
+        out[i] = ((word >> (31 - i)) & 1) ? '1' : '0';
+}
+
+int rbt_pack_byte_scalar(const char *s, u8 *byte) {
+    u32 v = 0;
+    for (int i = 0; i < 8; i++) {
+        if (s[i] != '0' && s[i] != '1')
+            return -1;
+        v = (v << 1) | (u32)(s[i] - '0');
+    }
+    *byte = v;
+    return 0;
+}
+
+void rbt_unpack_byte_scalar(u8 byte, char *out) {
+    for (int i = 0; i < 8; i++)
+        out[i] = ((byte >> (7 - i)) & 1) ? '1' : '0';
+}
+
+#if BITSTR_NEON
+
+// Shift that moves a 0/1 digit to its bit position within the byte, and
+// the bit each character position tests, MSB first
+static const int8_t bit_shifts[16]  = { 7, 6, 5, 4, 3, 2, 1, 0, 7, 6, 5, 4, 3, 2, 1, 0 };
+static const u8     bit_weights[16] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                        0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+
+// 32 characters -> 32 digits (0/1) in two q registers; the bits are
+// placed at their position in the byte (disjoint, so adding them packs
+// them) and three pairwise-add rounds narrow 32 bytes to 4.
+int rbt_pack_word(const char *s, u32 *word) {
+    uint8x16_t zero = vdupq_n_u8('0');
+    uint8x16_t one  = vdupq_n_u8(1);
+    uint8x16_t lo   = vsubq_u8(vld1q_u8((const u8 *)s), zero);
+    uint8x16_t hi   = vsubq_u8(vld1q_u8((const u8 *)s + 16), zero);
+
+    // Any digit above 1 (including the wrap-around below '0') fails
+    uint8x16_t bad = vorrq_u8(vcgtq_u8(lo, one), vcgtq_u8(hi, one));
+    uint8x8_t  any = vorr_u8(vget_low_u8(bad), vget_high_u8(bad));
+    if (vget_lane_u32(vreinterpret_u32_u8(any), 0) |
+        vget_lane_u32(vreinterpret_u32_u8(any), 1))
+        return -1;
+
+    int8x16_t shifts = vld1q_s8(bit_shifts);
+    lo = vshlq_u8(lo, shifts);
+    hi = vshlq_u8(hi, shifts);
+
+    uint8x8_t p0 = vpadd_u8(vget_low_u8(lo), vget_high_u8(lo));
+    uint8x8_t p1 = vpadd_u8(vget_low_u8(hi), vget_high_u8(hi));
+    uint8x8_t p2 = vpadd_u8(p0, p1);
+    uint8x8_t p3 = vpadd_u8(p2, p2);
+
+    // Bytes 0..3 of p3 are the word MSB first
+    *word = __builtin_bswap32(vget_lane_u32(vreinterpret_u32_u8(p3), 0));
+    return 0;
+}
+
+// Each byte is broadcast over its 8 character positions, tested against
+// the position's bit, and the 0x00/0xFF mask turned into '0'/'1'
+void rbt_unpack_word(u32 word, char *out) {
+    uint8x8_t  b    = vreinterpret_u8_u32(vdup_n_u32(__builtin_bswap32(word)));
+    uint8x16_t w    = vld1q_u8(bit_weights);
+    uint8x16_t zero = vdupq_n_u8('0');
+    uint8x16_t lo   = vcombine_u8(vdup_lane_u8(b, 0), vdup_lane_u8(b, 1));
+    uint8x16_t hi   = vcombine_u8(vdup_lane_u8(b, 2), vdup_lane_u8(b, 3));
+
+    vst1q_u8((u8 *)out,      vsubq_u8(zero, vtstq_u8(lo, w)));
+    vst1q_u8((u8 *)out + 16, vsubq_u8(zero, vtstq_u8(hi, w)));
+}
+
+int rbt_pack_byte(const char *s, u8 *byte) {
+    uint8x8_t d = vsub_u8(vld1_u8((const u8 *)s), vdup_n_u8('0'));
+    uint8x8_t bad = vcgt_u8(d, vdup_n_u8(1));
+    if (vget_lane_u32(vreinterpret_u32_u8(bad), 0) |
+        vget_lane_u32(vreinterpret_u32_u8(bad), 1))
+        return -1;
+
+    d = vshl_u8(d, vld1_s8(bit_shifts));
+    d = vpadd_u8(d, d);
+    d = vpadd_u8(d, d);
+    d = vpadd_u8(d, d);
+    *byte = vget_lane_u8(d, 0);
+    return 0;
+}
+
+void rbt_unpack_byte(u8 byte, char *out) {
+    uint8x8_t mask = vtst_u8(vdup_n_u8(byte), vld1_u8(bit_weights));
+    vst1_u8((u8 *)out, vsub_u8(vdup_n_u8('0'), mask));
+}
+
+#else
+
+int rbt_pack_word(const char *s, u32 *word) {
+    return rbt_pack_word_scalar(s, word);
+}
+
+void rbt_unpack_word(u32 word, char *out) {
+    rbt_unpack_word_scalar(word, out);
+}
+
+int rbt_pack_byte(const char *s, u8 *byte) {
+    return rbt_pack_byte_scalar(s, byte);
+}
+
+void rbt_unpack_byte(u8 byte, char *out) {
+    rbt_unpack_byte_scalar(byte, out);
+}
+
+#endif
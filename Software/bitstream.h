@@ -0,0 +1,116 @@
+/*
+ * bitstream.h
+ *
+ * Bitstream container helpers shared by the compression and
+ * decompression applications.
+ *
+ * Three containers carry the same 32-bit configuration words:
+ *
+ *   .rbt  ASCII text header, then one '0'/'1' character per bit
+ *   .bit  Vivado binary header (TLV fields, see below), then the words
+ *   .bin  the words only
+ *
+ * In .bit and .bin files the words are big-endian, so bit 31 of a
+ * word is the first character of its .rbt line.
+ *
+ * .bit header layout (all lengths big-endian):
+ *
+ *   u16 9, 9 bytes 0F F0 0F F0 0F F0 0F F0 00
+ *   u16 1
+ *   'a' u16 len  design name, NUL terminated
+ *   'b' u16 len  part,        NUL terminated
+ *   'c' u16 len  date,        NUL terminated (yyyy/mm/dd)
+ *   'd' u16 len  time,        NUL terminated (hh:mm:ss)
+ *   'e' u32 len  payload bytes, which follow immediately
+ *
+ * The rbt_pack_* / rbt_unpack_* kernels convert between '0'/'1' text
+ * (MSB first) and binary. With BITSTR_NEON they use the Cortex-A9 NEON
+ * unit (build with -mfpu=neon); the _scalar versions are always
+ * available for comparison.
+ */
+
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+
+#include <xil_types.h>
+
+#define BIT_FORMAT_RBT      0     // Xilinx ASCII bitstream
+#define BIT_FORMAT_BIT      1     // Vivado .bit
+#define BIT_FORMAT_BIN      2     // raw configuration words
+
+#ifndef BITSTR_NEON
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BITSTR_NEON         1     // vector bit-string kernels
+#else
+#define BITSTR_NEON         0
+#endif
+#endif
+
+#define BIT_HEADER_MAX      512   // longest .bit header bit_write_header() emits
+#define RBT_HEADER_MAX      512   // longest .rbt header rbt_header_from_bit() emits
+
+typedef struct {
+    char design[256];       // 'a'
+    char part[32];          // 'b'
+    char date[16];          // 'c'
+    char time[16];          // 'd'
+    u32  payload_bytes;     // 'e'
+    u32  header_bytes;      // offset of the first payload byte
+} BitHeader;
+
+static inline u32 bit_load_be32(const u8 *p) {
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+}
+
+static inline void bit_store_be32(u8 *p, u32 v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+// Parse the .bit header at the start of data (size bytes available).
+// Returns 0 on success, -1 if the preamble or a field is malformed,
+// a field does not fit BitHeader, or the header runs past size.
+int bit_parse_header(const u8 *data, u32 size, BitHeader *h);
+
+// Write a .bit header for payload_bytes of configuration data.
+// Returns the header length (at most BIT_HEADER_MAX).
+u32 bit_write_header(u8 *dst, const BitHeader *h, u32 payload_bytes);
+
+// Fill h from the "Design name:", "Part:" and "Date:" lines of an
+// .rbt header (n bytes, '\n' or CRLF lines). Missing lines leave
+// the field empty. Always returns 0.
+int bit_header_from_rbt(const char *text, u32 n, BitHeader *h);
+
+// Write an .rbt header ('\n' lines, ending with "Bits:") for
+// n_words configuration words described by h. Returns its length
+// (at most RBT_HEADER_MAX).
+u32 rbt_header_from_bit(char *dst, const BitHeader *h, u32 n_words);
+
+// CRC-32 (IEEE 802.3, reflected, as zlib) of n_words words taken as
+// big-endian bytes, i.e. as they appear in a .bin file
+u32 bit_crc32_words(const u32 *words, u32 n_words);
+
+// Archive protection of the Encrypt / decrypt IP cores, b = (~b) ^ key,
+// applied to n bytes in place; the same call undoes it. With
+// BITSTR_NEON 64 bytes per step, otherwise a 32-bit word per step.
+void bit_protect(u8 *buf, u32 n, u8 key);
+void bit_protect_scalar(u8 *buf, u32 n, u8 key);
+
+// Pack the 32 characters at s (one .rbt line) into *word. Returns 0,
+// or -1 (and *word unchanged) if any of them is not '0' or '1'.
+int  rbt_pack_word(const char *s, u32 *word);
+int  rbt_pack_word_scalar(const char *s, u32 *word);
+
+// Write word as 32 '0'/'1' characters (no terminator)
+void rbt_unpack_word(u32 word, char *out);
+void rbt_unpack_word_scalar(u32 word, char *out);
+
+// Same for one 8-bit symbol
+int  rbt_pack_byte(const char *s, u8 *byte);
+int  rbt_pack_byte_scalar(const char *s, u8 *byte);
+void rbt_unpack_byte(u8 byte, char *out);
+void rbt_unpack_byte_scalar(u8 byte, char *out);
+
+#endif
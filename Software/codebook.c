@@ -0,0 +1,205 @@
+/*
+ * codebook.c
+ *
+ * Huffman codebook helpers shared by the compression and
+ * decompression applications. See codebook.h.
+ */
+
+#include "codebook.h"
+#include "bitstream.h"
+#include <stdio.h>
+
+#define PM_PACKAGE  0xFFFF      // list item is a package, not a leaf
+
+int codebook_canonical(const u8 *lengths, u32 *codes) {
+    u32 bl_count[CODEBOOK_MAX_BITS + 1] = {0};
+    u32 next_code[CODEBOOK_MAX_BITS + 1];
+
+    for (int s = 0; s < CODEBOOK_SYMBOLS; s++) {
+        if (lengths[s] > CODEBOOK_MAX_BITS)
+            return -1;
+        bl_count[lengths[s]]++;
+    }
+    bl_count[0] = 0;
+
+    // First code of each length, as in RFC 1951 section 3.2.2
+    u32 code = 0;
+    for (int len = 1; len <= CODEBOOK_MAX_BITS; len++) {
+        code = (code + bl_count[len - 1]) << 1;
+        next_code[len] = code;
+        // Over-subscribed: this length would run past 2^len codes
+        if (code + bl_count[len] > (1u << len))
+            return -1;
+    }
+
+    for (int s = 0; s < CODEBOOK_SYMBOLS; s++) {
+        int len = lengths[s];
+        codes[s] = len ? next_code[len]++ : 0;
+    }
+    return 0;
+}
+
+/*
+ * Package-merge (Larmore & Hirschberg).
+ *
+ * Level max_bits-1 holds the used symbols sorted by frequency. Each
+ * shallower level is the same leaves merged with "packages" formed by
+ * pairing consecutive items of the level below. Taking the 2n-2
+ * cheapest items of level 0 and expanding every selected package into
+ * the two items it was built from gives each symbol one unit of code
+ * length per level it is selected at. Because packages are built and
+ * merged in order, the selected packages of a level are always its
+ * first p packages, i.e. the first 2p items of the next level, so only
+ * the leaf/package layout of each level needs to be kept.
+ */
+int codebook_limit_lengths(const u32 *freqs, int max_bits, u8 *lengths) {
+    static u16 items[CODEBOOK_LIMIT_BITS][2 * CODEBOOK_SYMBOLS];
+    static u64 weight[2][2 * CODEBOOK_SYMBOLS];
+    int level_count[CODEBOOK_LIMIT_BITS];
+    u16 sorted[CODEBOOK_SYMBOLS];
+    int n = 0;
+
+    for (int s = 0; s < CODEBOOK_SYMBOLS; s++)
+        lengths[s] = 0;
+
+    // Used symbols in ascending (frequency, symbol) order
+    for (int s = 0; s < CODEBOOK_SYMBOLS; s++) {
+        if (!freqs[s]) continue;
+        int i = n++;
+        while (i > 0 && freqs[sorted[i - 1]] > freqs[s]) {
+            sorted[i] = sorted[i - 1];
+            i--;
+        }
+        sorted[i] = (u16)s;
+    }
+
+    if (n == 0)
+        return 0;
+    if (n == 1) {
+        lengths[sorted[0]] = 1;
+        return 0;
+    }
+    if (max_bits < 1 || max_bits > CODEBOOK_LIMIT_BITS || (1 << max_bits) < n)
+        return -1;
+
+    // Deepest level: leaves only
+    int deepest = max_bits - 1;
+    int count = n;
+    u64 *prev = weight[0], *cur = weight[1];
+    for (int i = 0; i < n; i++) {
+        items[deepest][i] = sorted[i];
+        prev[i] = freqs[sorted[i]];
+    }
+    level_count[deepest] = n;
+
+    // Shallower levels: leaves merged with packages of the level below
+    for (int d = deepest - 1; d >= 0; d--) {
+        int packages = count / 2;
+        int li = 0, pi = 0, k = 0;
+        while (li < n || pi < packages) {
+            u64 pw = (pi < packages) ? prev[2 * pi] + prev[2 * pi + 1] : 0;
+            if (li < n && (pi >= packages || freqs[sorted[li]] <= pw)) {
+                items[d][k] = sorted[li];
+                cur[k++] = freqs[sorted[li++]];
+            } else {
+                items[d][k] = PM_PACKAGE;
+                cur[k++] = pw;
+                pi++;
+            }
+        }
+        count = k;
+        level_count[d] = k;
+        u64 *t = prev; prev = cur; cur = t;
+    }
+
+    // Select the 2n-2 cheapest items of level 0 and expand downwards
+    int take = 2 * n - 2;
+    for (int d = 0; d < max_bits && take > 0; d++) {
+        if (take > level_count[d])
+            return -1;
+        int packages = 0;
+        for (int k = 0; k < take; k++) {
+            if (items[d][k] == PM_PACKAGE)
+                packages++;
+            else
+                lengths[items[d][k]]++;
+        }
+        take = 2 * packages;
+    }
+    return 0;
+}
+
+/*
+ * Canonical decoding without a table: codes of each length are
+ * consecutive, so after every bit the code read so far is either one
+ * of the count[len] codes starting at first (a symbol, taken from the
+ * symbols sorted by (length, symbol)) or the prefix of a longer code.
+ */
+int codebook_decode(const u8 *lengths, const u32 *payload, u32 payload_bits,
+                    u32 n_symbols, u8 *out) {
+    u32 count[CODEBOOK_MAX_BITS + 1] = {0};
+    u32 start[CODEBOOK_MAX_BITS + 2];
+    u8  sorted[CODEBOOK_SYMBOLS];
+
+    for (int s = 0; s < CODEBOOK_SYMBOLS; s++) {
+        if (lengths[s] > CODEBOOK_MAX_BITS)
+            return -1;
+        count[lengths[s]]++;
+    }
+    count[0] = 0;
+
+    start[1] = 0;
+    for (int len = 1; len <= CODEBOOK_MAX_BITS; len++)
+        start[len + 1] = start[len] + count[len];
+    for (int s = 0; s < CODEBOOK_SYMBOLS; s++)
+        if (lengths[s])
+            sorted[start[lengths[s]]++] = (u8)s;
+    // start[len] is now the end of length len; step back to its start
+    for (int len = CODEBOOK_MAX_BITS; len >= 1; len--)
+        start[len] -= count[len];
+
+    u32 n = 0;
+    u32 code = 0, first = 0;
+    int len = 1;
+
+    for (u32 i = 0; i < payload_bits; i++) {
+        code |= (payload[i >> 5] >> (31 - (i & 31))) & 1;
+        if (code - first < count[len]) {
+            if (n == n_symbols)
+                return -1;
+            out[n++] = sorted[start[len] + code - first];
+            code = first = 0;
+            len = 1;
+            continue;
+        }
+        first = (first + count[len]) << 1;
+        code <<= 1;
+        if (++len > CODEBOOK_MAX_BITS)
+            return -1;
+    }
+    return (n == n_symbols && len == 1 && code == 0) ? 0 : -1;
+}
+
+u32 codebook_id(const u8 *lengths) {
+    u32 words[CODEBOOK_SYMBOLS / 4];
+
+    // Big-endian words, so the CRC runs over the lengths in symbol order
+    for (int i = 0; i < CODEBOOK_SYMBOLS / 4; i++)
+        words[i] = ((u32)lengths[4 * i] << 24) | ((u32)lengths[4 * i + 1] << 16) |
+                   ((u32)lengths[4 * i + 2] << 8) | lengths[4 * i + 3];
+
+    u32 crc = bit_crc32_words(words, CODEBOOK_SYMBOLS / 4);
+    return crc ? crc : 1;
+}
+
+void codebook_file_name(u32 id, char *name) {
+    snprintf(name, CODEBOOK_NAME_MAX, "%08lX.CB", (unsigned long)id);
+}
+
+int codebook_file_check(const CodebookFile *f, u32 id) {
+    u32 codes[CODEBOOK_SYMBOLS];
+
+    if (f->magic != CODEBOOK_FILE_MAGIC || f->id != id || codebook_id(f->lengths) != id)
+        return -1;
+    return codebook_canonical(f->lengths, codes);
+}
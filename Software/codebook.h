@@ -0,0 +1,68 @@
+/*
+ * codebook.h
+ *
+ * Huffman codebook helpers shared by the compression and
+ * decompression applications.
+ *
+ * A canonical codebook is fully described by the code length of
+ * each of the 256 symbols: codes are handed out in (length, symbol)
+ * order, so both sides rebuild identical codewords from the
+ * lengths alone.
+ *
+ * A trained codebook is a canonical codebook built once from the
+ * histograms of many bitstreams (host/train_codebook) and kept on the
+ * card as a CodebookFile named after its ID. Archives coded with it
+ * carry only the ID, and the compressor skips the histogram pass. The
+ * ID is the CRC-32 of the 256 lengths, so it names one exact code: a
+ * stale or edited file does not match the archive.
+ */
+
+#ifndef CODEBOOK_H
+#define CODEBOOK_H
+
+#include <xil_types.h>
+
+#define CODEBOOK_SYMBOLS    256
+#define CODEBOOK_MAX_BITS   31    // widest codeword the helpers accept
+#define CODEBOOK_LIMIT_BITS 16    // widest limit codebook_limit_lengths() supports
+
+#define CODEBOOK_FILE_MAGIC 0x42434648   // "HFCB" read as little-endian u32
+#define CODEBOOK_NAME_MAX   13           // "XXXXXXXX.CB" and NUL
+
+// Trained codebook file, little-endian
+typedef struct {
+    u32 magic;                          // CODEBOOK_FILE_MAGIC
+    u32 id;                             // codebook_id(lengths)
+    u8  lengths[CODEBOOK_SYMBOLS];      // canonical code lengths, 0 = unused
+} CodebookFile;
+
+// Assign canonical codewords (right-aligned) from per-symbol lengths.
+// A length of 0 marks an unused symbol; its code is set to 0.
+// Returns 0 on success, -1 if the lengths violate the Kraft inequality
+// or exceed CODEBOOK_MAX_BITS.
+int codebook_canonical(const u8 *lengths, u32 *codes);
+
+// Optimal code lengths with no codeword longer than max_bits
+// (package-merge). freqs[s] == 0 gives lengths[s] == 0; a single used
+// symbol gets length 1. Returns 0 on success, -1 if max_bits is out of
+// range or too small for the number of used symbols.
+int codebook_limit_lengths(const u32 *freqs, int max_bits, u8 *lengths);
+
+// Software decoder for a canonical code: n_symbols symbols from the
+// first payload_bits bits of payload (codewords packed MSB-first, as in
+// COMP.BIN) into out. Returns 0 when exactly n_symbols codewords fill
+// payload_bits, -1 on an invalid or truncated codeword.
+int codebook_decode(const u8 *lengths, const u32 *payload, u32 payload_bits,
+                    u32 n_symbols, u8 *out);
+
+// CRC-32 of the 256 code lengths taken as bytes; never 0, so 0 can
+// stand for "no ID" (a codebook with explicit codewords)
+u32 codebook_id(const u8 *lengths);
+
+// Card file of trained codebook id: "%08X.CB", CODEBOOK_NAME_MAX bytes
+void codebook_file_name(u32 id, char *name);
+
+// 0 if f is trained codebook id and its lengths form a prefix code
+int codebook_file_check(const CodebookFile *f, u32 id);
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * compbin.h
+ *
+ * On-card layout of the packed COMP.BIN archive, shared by the
+ * compression and decompression applications.
+ *
+ *   +--------------------------+
+ *   | CompBinHeader            |  fixed size, little-endian
+ *   | CompBinZrle              |  only with COMPBIN_FLAG_ZRLE
+ *   | CompBinBlocks            |  only with COMPBIN_FLAG_BLOCKS,
+ *   | CompBinBlock index       |  block_count records
+ *   | block payload CRCs       |  only with COMPBIN_FLAG_PAYLOAD_CRC,
+ *   |                          |  block_count x u32
+ *   | bitstream header         |  rbt_header_bytes, zero-padded to 4
+ *   | codebook section         |  see below
+ *   | packed payload           |  payload_words x u32
+ *   +--------------------------+
+ *
+ * The bitstream header is the .rbt header text or, with
+ * COMPBIN_FLAG_BIT_HEADER, the binary header of a Vivado .bit file
+ * (see bitstream.h). A .bin input leaves it empty.
+ *
+ * The codebook section is either codebook_entries x CompBinCodeEntry
+ * (explicit codewords) or, with COMPBIN_FLAG_CANONICAL, 256 u8 code
+ * lengths indexed by symbol (0 = unused) from which the canonical
+ * codewords are rebuilt with codebook_canonical(). With
+ * COMPBIN_FLAG_TRAINED (always together with COMPBIN_FLAG_CANONICAL)
+ * it is a CompBinTrained record instead: the 256 lengths are those of
+ * a trained codebook kept on the card (see codebook.h).
+ *
+ * The payload is the concatenation of all Huffman codewords in
+ * symbol order, packed MSB-first: the first bit of the first
+ * codeword is bit 31 of payload word 0. The last word is padded
+ * with zeros; payload_bits gives the number of valid bits.
+ *
+ * With COMPBIN_FLAG_ZRLE the encoded symbols are zero-run tokens
+ * (see zrle.h): symbol_count is the token count, word_count * 4 the
+ * symbol count after expansion, and header_bytes includes the
+ * CompBinZrle record that follows CompBinHeader.
+ *
+ * With COMPBIN_FLAG_BLOCKS the configuration words are split into
+ * blocks of block_words words (the last one may be shorter), each
+ * encoded on its own so it can be decoded without the others. Every
+ * block starts on a payload word at CompBinBlock.offset; a block with
+ * COMPBIN_BLOCK_LOCAL holds 256 canonical code lengths (64 words)
+ * there, then its codewords, while the others use the codebook
+ * section. Zero-run tokens (COMPBIN_FLAG_ZRLE) never cross a block.
+ * symbol_count and payload_bits are the sums over all blocks, and
+ * header_bytes includes CompBinBlocks and the index (and the payload
+ * CRCs).
+ *
+ * COMPBIN_FLAG_PAYLOAD_CRC (only with COMPBIN_FLAG_BLOCKS) adds one
+ * u32 per block after the index: bit_crc32_words() of the block's
+ * codeword words, (payload_bits + 31) / 32 words from after its local
+ * code lengths, unencrypted. This is the stream the encoder packs and
+ * the decoder takes in, so the IPs compute it on the fly and a
+ * corrupted block is caught before its words are used; the index CRC
+ * still checks the decoded words.
+ *
+ * The legacy ASCII archive (header text, HMCODES table and one
+ * '0'/'1' codeword per line) has no magic and is still accepted
+ * by the decompressor.
+ */
+
+#ifndef COMPBIN_H
+#define COMPBIN_H
+
+#include <xil_types.h>
+
+#define COMPBIN_MAGIC        0x43424648   // "HFBC" read as little-endian u32
+#define COMPBIN_VERSION      1
+
+// Header flags
+#define COMPBIN_FLAG_CANONICAL   0x0001   // codebook section is 256 code lengths
+#define COMPBIN_FLAG_BIT_HEADER  0x0002   // header section is a .bit header, not .rbt text
+#define COMPBIN_FLAG_ZRLE        0x0004   // payload encodes zero-run tokens, CompBinZrle follows the header
+#define COMPBIN_FLAG_BLOCKS      0x0008   // independent blocks, CompBinBlocks and the block index follow
+#define COMPBIN_FLAG_TRAINED     0x0010   // codebook section names a trained codebook
+#define COMPBIN_FLAG_PAYLOAD_CRC 0x0020   // block payload CRCs follow the block index
+#define COMPBIN_KNOWN_FLAGS      (COMPBIN_FLAG_CANONICAL | COMPBIN_FLAG_BIT_HEADER | \
+                                  COMPBIN_FLAG_ZRLE | COMPBIN_FLAG_BLOCKS | \
+                                  COMPBIN_FLAG_TRAINED | COMPBIN_FLAG_PAYLOAD_CRC)
+
+// Block flags
+#define COMPBIN_BLOCK_LOCAL      0x0001   // block starts with its own 256 code lengths
+
+typedef struct {
+    u32 magic;              // COMPBIN_MAGIC
+    u16 version;            // COMPBIN_VERSION
+    u16 flags;              // COMPBIN_FLAG_*
+    u32 header_bytes;       // sizeof(CompBinHeader)
+    u32 word_count;         // original 32-bit configuration words
+    u32 symbol_count;       // encoded 8-bit symbols (4 per word)
+    u32 payload_bits;       // valid bits in the packed payload
+    u32 rbt_header_bytes;   // length of the bitstream header section
+    u32 codebook_entries;   // CompBinCodeEntry records, or 256 lengths
+    u32 payload_words;      // number of packed 32-bit payload words
+} CompBinHeader;
+
+typedef struct {
+    u8  escape;             // escape symbol of the zero-run tokens
+    u8  reserved[3];        // 0
+} CompBinZrle;
+
+typedef struct {
+    u32 block_words;        // configuration words per block
+    u32 block_count;        // CompBinBlock records that follow
+} CompBinBlocks;
+
+typedef struct {
+    u32 offset;             // first payload word of the block
+    u32 payload_bits;       // valid codeword bits (local code lengths excluded)
+    u32 symbol_count;       // encoded symbols (or zero-run tokens)
+    u32 crc32;              // bit_crc32_words() of the block's configuration words
+    u16 flags;              // COMPBIN_BLOCK_*
+    u16 reserved;           // 0
+} CompBinBlock;
+
+// Words of a block's local code lengths
+#define COMPBIN_LOCAL_CODEBOOK_WORDS  (256 / 4)
+
+typedef struct {
+    u32 codebook_id;        // codebook_id() of the lengths, names the card file
+} CompBinTrained;
+
+typedef struct {
+    u8  symbol;             // 8-bit source symbol
+    u8  length;             // codeword length in bits
+    u16 reserved;           // 0
+    u32 code;               // codeword, right-aligned
+} CompBinCodeEntry;
+
+// Size of a section once padded to the next 32-bit boundary
+#define COMPBIN_PAD4(n)      (((n) + 3u) & ~3u)
+
+#endif
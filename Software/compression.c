@@ -16,26 +16,42 @@
 #include "xil_printf.h"
 #include "ff.h"
 #include "sdCard.h"
+#include "compbin.h"
+#include "codebook.h"
+#include "bitstream.h"
+#include "zrle.h"
+#include "amp.h"
+#include "batch.h"
 #include <stdlib.h>
 #include <string.h>
-#include <sleep.h>
 #include "xtime_l.h"
+#include "perf.h"         // after xil_io.h and ff.h: counts their calls
 
 // ======================= IP BASE ADDRESSES ================================
 #define BITPARSER_IP_BASE     0x43C00000
 #define FREQ_COUNTER_IP_BASE  0x43C10000
 #define HUFFMAN_IP_BASE       0x43C20000
 #define ENCRYPT_IP_BASE       0x43C30000   // New encryption IP
+#define CHAIN_IP_BASE         0x43C40000   // axis_compression_chain (AXIS_DMA = 1)
 
 // ======================= FREQUENCY COUNTER REGISTERS ======================
-#define REG_SYMBOL        (FREQ_COUNTER_IP_BASE + 0x00)
+#define REG_SYMBOL        (FREQ_COUNTER_IP_BASE + 0x00)   // write: counts the symbol (symbol_we)
 #define REG_LOAD          (FREQ_COUNTER_IP_BASE + 0x04)
 #define REG_DONE          (FREQ_COUNTER_IP_BASE + 0x08)
 #define REG_FREQ          (FREQ_COUNTER_IP_BASE + 0x0C)
 #define REG_ADDR          (FREQ_COUNTER_IP_BASE + 0x10)
+#define REG_BURST_CTRL    (FREQ_COUNTER_IP_BASE + 0x14)   // bit0: burst, bit1: clear (edge-detected)
+#define REG_BLOCK_WORDS   (FREQ_COUNTER_IP_BASE + 0x18)   // words in the burst block
+#define REG_BURST_WORD    (FREQ_COUNTER_IP_BASE + 0x1C)   // write: one word (4 symbols) to the stream port
+#define REG_BURST_STATUS  (FREQ_COUNTER_IP_BASE + 0x20)   // {saturated[1], block_done[0]}
+
+#define BURST_CTRL_ENABLE     0x1
+#define BURST_CTRL_CLEAR      0x2
+#define BURST_STATUS_DONE     0x1
+#define FREQ_STATUS_SATURATED 0x2   // a 32-bit counter stopped at its maximum (any mode)
 
 // ======================= HUFFMAN ENCODER REGISTERS ========================
-#define REG_SYMBOL_IN     0x00
+#define REG_SYMBOL_IN     0x00   // write: encodes the symbol (symbol_we)
 #define REG_VALID_IN      0x04
 #define REG_VALID_OUT     0x08
 #define REG_CODEWORD      0x0C
@@ -45,13 +61,53 @@
 #define REG_LOAD_LENGTH   0x1C
 #define REG_LOAD_VALID    0x20
 #define REG_LOAD_DONE     0x24
+#define REG_PACK_CTRL     0x28   // bit0: clear, bit1: flush (edge-detected)
+#define REG_PACK_WORD     0x2C   // read: oldest packed word, pops the FIFO
+#define REG_PACK_STATUS   0x30   // {overflow[5], count[4:0]}
+#define REG_PACK_BITS     0x34   // payload bits appended since clear
+#define REG_TABLE_COMMIT  0x38   // bit0: swap the written table in (edge-detected)
+#define REG_CODE_RESULT   0x3C   // {valid[31], seq[30], length[20:16], code[15:0]}
+#define REG_PACK_CRC      0x40   // CRC-32 of the packed words read since clear (bit_crc32_words)
+#define REG_TABLE_BASE    0x400  // table window: word s = {length[20:16], code[15:0]} of symbol s
+
+#define PACK_CTRL_CLEAR       0x1
+#define PACK_CTRL_FLUSH       0x2
+#define PACK_STATUS_COUNT     0x1F
+#define PACK_STATUS_OVERFLOW  0x20
+#define CODE_RESULT_VALID     0x80000000
+#define CODE_RESULT_SEQ       0x40000000
 
 #define IP_WRITE(o,v)     Xil_Out32(HUFFMAN_IP_BASE + (o), (v))
 #define IP_READ(o)        Xil_In32 (HUFFMAN_IP_BASE + (o))
 
+// ======================= STREAM CHAIN REGISTERS ===========================
+// Load registers and the table window sit at the same offsets as in
+// the Huffman encoder IP
+#define REG_CHAIN_CTRL    0x00   // bit0: mode (0 count, 1 encode), bit1: clear (edge-detected)
+#define REG_CHAIN_STATUS  0x04   // {freq_saturated[2], encode_done[1], count_done[0]}
+#define REG_CHAIN_FADDR   0x08   // histogram read address
+#define REG_CHAIN_FREQ    0x0C   // histogram read data
+#define REG_CHAIN_SYMBOLS 0x10   // symbols seen by the active pass
+#define REG_CHAIN_BITS    0x28   // payload bits of the encode pass
+#define REG_CHAIN_KEY     0x30   // protection key of the packed words (key in every byte)
+#define REG_CHAIN_CRC     0x34   // CRC-32 of the packed words of the encode pass, before protection
+#define REG_CHAIN_WORDS   0x2C   // words in the block (sets the end of the stream)
+
+#define CHAIN_MODE_COUNT      0x0
+#define CHAIN_MODE_ENCODE     0x1
+#define CHAIN_CTRL_CLEAR      0x2
+#define CHAIN_CTRL_PROTECT    0x4   // encode pass: packed words leave encrypted
+#define CHAIN_STATUS_COUNTED  0x1
+#define CHAIN_STATUS_ENCODED  0x2
+#define CHAIN_STATUS_SATURATED 0x4
+
+#define CHAIN_WRITE(o,v)  Xil_Out32(CHAIN_IP_BASE + (o), (v))
+#define CHAIN_READ(o)     Xil_In32 (CHAIN_IP_BASE + (o))
+
 // ======================= ENCRYPTION IP REGISTERS ==========================
+// 32-bit lanes: one word (4 archive bytes) per write/read pair
 #define ENC_REG_DATA_IN   0x00
-#define ENC_REG_KEY       0x04
+#define ENC_REG_KEY       0x04   // key in every byte, written once
 #define ENC_REG_DATA_OUT  0x08
 
 #define ENC_WRITE(o,v)    Xil_Out32(ENCRYPT_IP_BASE + (o), (v))
@@ -59,8 +115,8 @@
 
 // ======================= MEMORY BUFFERS ===================================
 #define MEMORY_BASE_ADDR  0x10000000
-#define SYMBOL_BUF_ADDR   (MEMORY_BASE_ADDR)
-#define FREQ_BUF_ADDR     (MEMORY_BASE_ADDR + 0x10000)
+#define DMA_MAX_BYTES     0x02000000                        // per buffer; <= 2^26 - 1 (DMA length width)
+#define ARENA_SIZE        0x08000000                        // every stage buffer (see DDR ARENA), from MEMORY_BASE_ADDR
 
 #define BUFFER_SIZE       4096
 #define MAX_LINE_LEN      32
@@ -68,8 +124,10 @@
 
 // ======================= FILE NAMES =======================================
 
-// Input / Initial parsing
-#define INPUT_FILE        "ZFO.rbt"
+// Input / Initial parsing (INPUT_FORMAT selects the input file)
+#define RBT_INPUT_FILE    "ZFO.rbt"
+#define BIT_INPUT_FILE    "ZFO.bit"
+#define BIN_INPUT_FILE    "ZFO.bin"
 #define HEADER_FILE       "HEAZFO.txt"
 #define PARSED_FILE       "PARZFO.txt"
 
@@ -85,30 +143,218 @@
 #define CODEBOOK_FILE     "HMCZFO.txt"
 
 // Huffman encoder output
-#define OUTPUT_FILE       "OUTZFO.txt"
+#define OUTPUT_FILE       "OUTZFO.txt"    // ASCII codeword lines (TEXT_PAYLOAD = 1)
+#define PAYLOAD_FILE      "OUTZFO.BIN"    // packed 32-bit payload words
 
 // Bundling & encryption
 #define COMP_FILE         "COMPZFO.BIN"
 #define ENCR_FILE         "ENCRZFO.BIN"
+
+// Stage profile (PERF_REPORT), one CSV line per stage and run
+#define PERF_FILE         "PERFC.CSV"
+// Run result (PERF_REPORT): ratio, bits/symbol, entropy, peak buffers; one CSV line per run
+#define RUN_FILE          "RUNC.CSV"
+#define BATCH_DIR         "BATCH"         // BATCH_MODE: inputs, and the archives NAME.ENC beside them
+#define BATCH_OUT_EXT     "ENC"
+#define BATCH_MANIFEST    "BATCH.TXT"     // BATCH_MODE: inputs to take, in BATCH_DIR (see batch.h)
+// IP core whose counters (perf_ip) each stage reports, 0 = runs on the A9
+#define PERF_IP_PARSE     (AXIS_DMA ? 0 : BITPARSER_IP_BASE)
+#define PERF_IP_FREQ      (FREQ_MODE == FREQ_SOFTWARE ? 0 : AXIS_DMA ? CHAIN_IP_BASE : FREQ_COUNTER_IP_BASE)
+#define PERF_IP_ENCODE    (AXIS_DMA ? CHAIN_IP_BASE : HUFFMAN_IP_BASE)
+#define PERF_IP_ENCRYPT   (ENCRYPT_MODE == ENC_IP ? ENCRYPT_IP_BASE : 0)
 // key for encryption
 #define ENCRYPT_KEY   0x5A
 
 // ======================= CONFIG MACROS ====================================
 #define CLEANUP           0   // 1 = delete helper files after run, 0 = keep for debug
+#define TEXT_PAYLOAD      0   // 1 = legacy ASCII '0'/'1' codeword archive (debug), 0 = packed COMP.BIN
+#define CANONICAL_CODES   1   // 1 = canonical codes, archive stores code lengths only
+#define HW_PACKER         1   // 1 = encoder IP packs codewords, software reads 32-bit words
+#define PACK_DRAIN_SYMBOLS 16 // symbols between FIFO drains (16 x 16 bits fit the 16-word FIFO)
+#define MAX_CODE_LEN      12  // longest codeword allowed; 16 = IP register width, 12 = stream decoder LUT_BITS
+#define AXIS_DMA          0   // 1 = stream whole blocks through axis_compression_chain with AXI DMA
+#define DMA_TIMEOUT       100000000  // polling iterations before a DMA pass is declared hung
+#define LITE_TIMEOUT      1000       // polls of a per-symbol AXI-Lite result before the IP is declared hung
+#define STAGE_FILES       0   // 1 = file per stage on the SD card (debug, use with CLEANUP = 0), 0 = in-memory pipeline
+#define FREQ_MODE         FREQ_LITE  // FREQ_LITE, FREQ_BURST or FREQ_SOFTWARE, see below
+#define ENCRYPT_MODE      ENC_SOFTWARE  // ENC_SOFTWARE or ENC_IP, see below
+#define ZRLE_MODEL        0   // 1 = zero-run tokens (zrle.h) between the bit parser and the frequency counter
+#define BLOCK_WORDS       0   // 0 = one stream; else words per independently decodable block (e.g. 65536)
+#define BLOCK_CODEBOOK    BLOCK_CB_AUTO  // BLOCK_CB_GLOBAL, BLOCK_CB_LOCAL or BLOCK_CB_AUTO, see below
+#define AMP_MODE          0   // 1 = CPU1 runs amp_io.c: SD read-ahead of the input, write-behind of ENCR_FILE (needs STAGE_FILES = 0)
+#define BITSTR_BENCH      0   // 1 = time the '0'/'1' text kernels (vector vs scalar) before the pipeline
+#define TRAINED_CODEBOOK  0   // 0 = codebook from the input's histogram; else ID of a trained codebook on the card (codebook.h), no frequency pass
+#define BATCH_MODE        0   // 1 = every input of BATCH_DIR (or those its BATCH.TXT names) in one session, see batch.h (needs STAGE_FILES = 0, AMP_MODE = 0)
+#define PERF_REPORT       1   // 1 = per-stage time, bytes, MMIO, FatFs and poll counts (perf.h) on the UART and in PERF_FILE, run result in RUN_FILE
+#define INPUT_FORMAT      BIT_FORMAT_RBT  // BIT_FORMAT_RBT (ASCII), BIT_FORMAT_BIT (Vivado .bit) or BIT_FORMAT_BIN (raw words)
+
+#if INPUT_FORMAT == BIT_FORMAT_BIT
+#define INPUT_FILE        BIT_INPUT_FILE
+#define BATCH_IN_EXT      "BIT"
+#elif INPUT_FORMAT == BIT_FORMAT_BIN
+#define INPUT_FILE        BIN_INPUT_FILE
+#define BATCH_IN_EXT      "BIN"
+#else
+#define INPUT_FILE        RBT_INPUT_FILE
+#define BATCH_IN_EXT      "RBT"
+#endif
+
+// Frequency counting (FREQ_MODE); with AXIS_DMA = 1 the chain counts
+// unless FREQ_MODE is FREQ_SOFTWARE
+#define FREQ_LITE         0   // frequency counter IP, one register write per symbol
+#define FREQ_BURST        1   // frequency counter IP burst mode, one register write per word
+#define FREQ_SOFTWARE     2   // on the A9, 4 interleaved 256-entry tables
+
+// Archive protection (ENCRYPT_MODE); with AXIS_DMA = 1 and STAGE_FILES = 0
+// the chain protects the payload as it streams out, whatever the mode
+#define ENC_SOFTWARE      0   // word-wide XOR on the A9 (NEON with BITSTR_NEON)
+#define ENC_IP            1   // encryption IP, one write and one read per 32-bit word
+
+// Codebook of each block (BLOCK_WORDS > 0)
+#define BLOCK_CB_GLOBAL   0   // every block uses the archive codebook
+#define BLOCK_CB_LOCAL    1   // every block stores its own code lengths
+#define BLOCK_CB_AUTO     2   // local where it saves more than the 256 bytes it costs
+
+#if BLOCK_WORDS && (STAGE_FILES || !CANONICAL_CODES)
+#error "BLOCK_WORDS needs the in-memory pipeline (STAGE_FILES = 0) and CANONICAL_CODES = 1"
+#endif
+
+#if BLOCK_WORDS && AXIS_DMA && BLOCK_CODEBOOK != BLOCK_CB_GLOBAL
+#error "The stream chain encodes every block with the global codebook; set BLOCK_CODEBOOK to BLOCK_CB_GLOBAL"
+#endif
+
+#if TRAINED_CODEBOOK && (AMP_MODE || TEXT_PAYLOAD || !CANONICAL_CODES)
+#error "TRAINED_CODEBOOK reads the codebook file on CPU0 into a packed canonical archive: AMP_MODE = 0, TEXT_PAYLOAD = 0, CANONICAL_CODES = 1"
+#endif
+
+#if AMP_MODE && STAGE_FILES
+#error "AMP_MODE overlaps the SD card with the in-memory pipeline; set STAGE_FILES to 0"
+#endif
+
+#if AMP_MODE && MEMORY_BASE_ADDR < AMP_CPU1_DDR_END
+#error "AMP_MODE: the DDR arena overlaps CPU1's image or scratch (see AMP_CPU1_DDR_END)"
+#endif
+
+#if BATCH_MODE && (STAGE_FILES || AMP_MODE)
+#error "BATCH_MODE runs the in-memory pipeline on CPU0, which lists the directory: STAGE_FILES = 0, AMP_MODE = 0"
+#endif
+
+#if BLOCK_CODEBOOK < BLOCK_CB_GLOBAL || BLOCK_CODEBOOK > BLOCK_CB_AUTO
+#error "BLOCK_CODEBOOK must be BLOCK_CB_GLOBAL, BLOCK_CB_LOCAL or BLOCK_CB_AUTO"
+#endif
+
+#if ZRLE_MODEL && (AXIS_DMA || TEXT_PAYLOAD)
+#error "ZRLE_MODEL needs the AXI-Lite path (AXIS_DMA = 0) and the packed archive (TEXT_PAYLOAD = 0)"
+#endif
+
+#if FREQ_MODE < FREQ_LITE || FREQ_MODE > FREQ_SOFTWARE
+#error "FREQ_MODE must be FREQ_LITE, FREQ_BURST or FREQ_SOFTWARE"
+#endif
+
+#if ENCRYPT_MODE != ENC_SOFTWARE && ENCRYPT_MODE != ENC_IP
+#error "ENCRYPT_MODE must be ENC_SOFTWARE or ENC_IP"
+#endif
+
+#if MAX_CODE_LEN < 8 || MAX_CODE_LEN > 16
+#error "MAX_CODE_LEN must be between 8 and 16 (8 bits are needed for 256 symbols)"
+#endif
+
+#if AXIS_DMA && TEXT_PAYLOAD
+#error "AXIS_DMA produces the packed payload only; set TEXT_PAYLOAD to 0"
+#endif
+
+#if TEXT_PAYLOAD && INPUT_FORMAT != BIT_FORMAT_RBT
+#error "The ASCII codeword archive keeps a text header; use an .rbt input or set TEXT_PAYLOAD to 0"
+#endif
+
+#if TEXT_PAYLOAD && !STAGE_FILES
+#error "The ASCII codeword archive is only built by the file stages; set STAGE_FILES to 1"
+#endif
+
+#if AXIS_DMA
+#include "xaxidma.h"
+#include "xscugic.h"
+#include "xil_exception.h"
+#include "xil_cache.h"
+
+#define DMA_DEV_ID        XPAR_AXIDMA_0_DEVICE_ID
+#define GIC_DEV_ID        XPAR_SCUGIC_SINGLE_DEVICE_ID
+#define DMA_S2MM_IRQ_ID   XPAR_FABRIC_AXIDMA_0_S2MM_INTROUT_VEC_ID
+#define CHAIN_IRQ_ID      XPAR_FABRIC_AXIS_COMPRESSION_CHAIN_0_IRQ_INTR
+#endif
+
+// ======================= PIPELINE STATE ===================================
+// Counters carried from one stage to the next for the COMP.BIN header
+u32 parsed_word_count   = 0;
+u32 encoded_symbol_count = 0;
+u32 payload_bit_count   = 0;
+u8  zrle_escape         = 0;   // escape symbol of the zero-run tokens (ZRLE_MODEL)
+u32 block_count         = 0;   // entries of the block index (BLOCK_WORDS)
+
+// Codeword length cap used by the codebook generator; defaults to the
+// build-time MAX_CODE_LEN and may be lowered at run time (>= 8)
+int max_code_len = MAX_CODE_LEN;
+
+// ======================= DDR ARENA ======================================
+// Every buffer of both pipelines comes from one arena over
+// MEMORY_BASE_ADDR .. + ARENA_SIZE. The in-memory pipeline keeps what
+// it allocates to the end; main() gives each file stage's buffers back
+// when the stage returns (arena_reset), so the stages share the space.
+typedef struct {
+    u8  *base;
+    u32  size;
+    u32  used;
+    u32  peak;              // most bytes ever in use
+} Arena;
+
+static Arena ddr;
+static u32  *parsed_words;      // file stages with AXIS_DMA: the parsed words, kept for every pass
+
+static void arena_init(Arena *a, u32 base, u32 size) {
+    a->base = (u8 *)base;
+    a->size = size;
+    a->used = 0;
+    a->peak = 0;
+}
+
+// Cache-line aligned so every buffer can be handed to the DMA
+static void *arena_alloc(Arena *a, u32 bytes) {
+    u32 start = (a->used + 63) & ~63u;
+    if (start > a->size || bytes > a->size - start) {
+        xil_printf("ERROR: Arena full (%u of %u bytes used, %u requested)\r\n",
+                   a->used, a->size, bytes);
+        return NULL;
+    }
+    a->used = start + bytes;
+    if (a->used > a->peak)
+        a->peak = a->used;
+    return a->base + start;
+}
+
+// Frees everything allocated since used was mark
+static void arena_reset(Arena *a, u32 mark) {
+    a->used = mark;
+}
+
+// A whole file read into the arena; returns its bytes, or -1
+static int arena_read_file(FIL *fil, u8 **data) {
+    u32 bytes = f_size(fil);
+    *data = arena_alloc(&ddr, bytes);
+    if (!*data || readFile(fil, (u32)*data) != (int)bytes)
+        return -1;
+    return (int)bytes;
+}
 
 
 // ----------------------- Utility functions (keep them all) ---------------------
 
 // --- Data helpers ---
-void write_binary_string(FIL *fptr, u32 byte_value) {
+void write_binary_string(LineWriter *w, u32 byte_value) {
     char buffer[9]; // 8 bits + newline
-    for (int i = 7; i >= 0; i--) {
-        buffer[7 - i] = ((byte_value >> i) & 1) ? '1' : '0';
-    }
+    rbt_unpack_byte((u8)byte_value, buffer);
     buffer[8] = '\n';
 
-    UINT bw;
-    if (f_write(fptr, buffer, 9, &bw) != FR_OK) {
+    if (writeBuffered(w, buffer, 9) != XST_SUCCESS) {
         xil_printf("ERROR: Failed to write binary string\r\n");
     }
 }
@@ -128,35 +374,110 @@ static inline int binstr_to_int(const char *s) {
 }
 
 // --- Frequency Counter helpers ---
+// The write itself counts the symbol: no load / done handshake
 void send_symbol(u32 symbol) {
     Xil_Out32(REG_SYMBOL, symbol);
-    Xil_Out32(REG_LOAD, 1);
-    while ((Xil_In32(REG_DONE) & 0x1) == 0);
-    Xil_Out32(REG_LOAD, 0);
 }
 
 u32 read_symbol_frequency(u32 symbol) {
     Xil_Out32(REG_ADDR, symbol);
-    return (Xil_In32(REG_FREQ) & 0x00FFFFFF);
+    return Xil_In32(REG_FREQ);
 }
 
 // --- Huffman IP helpers ---
-static int wait_valid_out(void) {
-    int to = 100000;
-    while (!IP_READ(REG_VALID_OUT) && to--) usleep(10);
-    return (to <= 0) ? -1 : 0;
+// The result of a symbol write is ready a few clocks later, so this
+// spins on the register instead of sleeping. seq is the toggle the
+// result must carry (a stale result still shows the previous one).
+static int wait_code_result(u32 seq, u32 *result) {
+    for (u32 to = LITE_TIMEOUT; to > 0; to--) {
+        perf_polls(1);
+        u32 r = IP_READ(REG_CODE_RESULT);
+        if ((r & CODE_RESULT_VALID) && (r & CODE_RESULT_SEQ) == seq) {
+            *result = r;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// --- Bit packing helpers (packed COMP.BIN payload) ---
+typedef struct {
+    FIL *fp;                    // output file, or NULL to append to out
+    u32 *out;                   // in-memory output (fp == NULL)
+    u32  out_words;             // words appended to out so far
+    u64  acc;                   // pending bits, right-aligned
+    int  nbits;                 // number of pending bits in acc (< 32)
+    u32  nwords;                // words buffered in buf
+    u32  total_bits;            // valid bits appended so far
+    u32  buf[BUFFER_SIZE / 4];
+} BitPacker;
+
+static BitPacker packer;
+
+static void packer_init(BitPacker *p, FIL *fp) {
+    p->fp = fp;
+    p->out = NULL;
+    p->out_words = 0;
+    p->acc = 0;
+    p->nbits = 0;
+    p->nwords = 0;
+    p->total_bits = 0;
+}
+
+// In-memory variant: words are appended to out instead of a file
+static void packer_init_mem(BitPacker *p, u32 *out) {
+    packer_init(p, NULL);
+    p->out = out;
+}
+
+static void packer_flush_words(BitPacker *p) {
+    if (p->nwords > 0) {
+        if (p->fp)
+            writeFile(p->fp, p->nwords * 4, (u32)p->buf);
+        else
+            memcpy(p->out + p->out_words, p->buf, p->nwords * 4);
+        p->out_words += p->nwords;
+        p->nwords = 0;
+    }
+}
+
+// Append a right-aligned codeword of len bits (0..31), MSB first
+static void packer_put(BitPacker *p, u32 code, int len) {
+    p->acc = (p->acc << len) | (code & ((1ULL << len) - 1));
+    p->nbits += len;
+    p->total_bits += len;
+    if (p->nbits >= 32) {
+        p->nbits -= 32;
+        p->buf[p->nwords++] = (u32)(p->acc >> p->nbits);
+        if (p->nwords == BUFFER_SIZE / 4)
+            packer_flush_words(p);
+    }
 }
 
-// --- File reading helper ---
-static int f_readline(FIL *fp, char *buf, UINT len) {
-    unsigned i = 0; char c;
-    UINT br;
-    while (i < len-1 && f_read(fp, &c, 1, &br) == FR_OK && br > 0) {
-        if (c == '\n') break;
-        if (c != '\r') buf[i++] = c;
+// Append a word that was already packed by the encoder IP
+static void packer_put_word(BitPacker *p, u32 word) {
+    p->buf[p->nwords++] = word;
+    if (p->nwords == BUFFER_SIZE / 4)
+        packer_flush_words(p);
+}
+
+// Zero-pad the tail into a last full word and write everything out
+static void packer_finish(BitPacker *p) {
+    if (p->nbits > 0) {
+        p->buf[p->nwords++] = (u32)(p->acc << (32 - p->nbits));
+        p->nbits = 0;
     }
-    buf[i] = '\0';
-    return (i == 0 && f_eof(fp)) ? 0 : 1;
+    packer_flush_words(p);
+}
+
+// Move every word waiting in the encoder's packed-word FIFO to the packer
+static int drain_packed_words(BitPacker *p) {
+    u32 status = IP_READ(REG_PACK_STATUS);
+    if (status & PACK_STATUS_OVERFLOW)
+        return -1;
+    for (u32 n = status & PACK_STATUS_COUNT; n > 0; n--)
+        packer_put_word(p, IP_READ(REG_PACK_WORD));
+    return 0;
 }
 
 static FRESULT copy_file(FIL *fin, FIL *fout, u8 *buf) {
@@ -168,7 +489,8 @@ static FRESULT copy_file(FIL *fin, FIL *fout, u8 *buf) {
         if (rc != FR_OK) return rc;
         if (br > 0) {
             rc = f_write(fout, buf, br, &bw);
-            if (rc != FR_OK || bw != br) return rc;
+            if (rc != FR_OK) return rc;
+            if (bw != br) return FR_DENIED;    // card full
         }
     } while (br > 0);
 
@@ -182,32 +504,192 @@ double get_time_ms() {
     return ((double)tCur) / (COUNTS_PER_SECOND / 1000.0);
 }
 
-// ======================= BIT PARSER STAGE (Hardware-accelerated) ================================
-int stage_bit_parser() {
-    FIL *input_file  = openFile(INPUT_FILE,  'r');
-    FIL *header_file = openFile(HEADER_FILE, 'w');
-    FIL *parsed_file = openFile(PARSED_FILE, 'w');
+#if AXIS_DMA
+// ======================= AXI DMA STREAMING ==============================
+// Both passes stream the parsed words from the arena through the
+// chain in one MM2S transfer. The count pass ends with the chain IRQ,
+// the encode pass with the S2MM IRQ once the packed payload is back
+// in DDR.
+static XAxiDma dma;
+static XScuGic gic;
+static int dma_ready = 0;
+static volatile int chain_irq_seen = 0;
+static volatile int s2mm_irq_seen  = 0;
+static volatile int dma_error      = 0;
+
+static void chain_irq_handler(void *ref) {
+    (void)ref;
+    chain_irq_seen = 1;
+}
 
-    if (!input_file || !header_file || !parsed_file) {
-        xil_printf("ERROR: Failed to open files for Bit Parser stage.\r\n");
-        if (input_file)  closeFile(input_file);
-        if (header_file) closeFile(header_file);
-        if (parsed_file) closeFile(parsed_file);
+static void s2mm_irq_handler(void *ref) {
+    XAxiDma *d = (XAxiDma *)ref;
+    u32 irq = XAxiDma_IntrGetIrq(d, XAXIDMA_DEVICE_TO_DMA);
+    XAxiDma_IntrAckIrq(d, irq, XAXIDMA_DEVICE_TO_DMA);
+
+    if (irq & XAXIDMA_IRQ_ERROR_MASK)
+        dma_error = 1;
+    if (irq & XAXIDMA_IRQ_IOC_MASK)
+        s2mm_irq_seen = 1;
+}
+
+static int dma_init(void) {
+    if (dma_ready)
+        return 0;
+
+    XAxiDma_Config *cfg = XAxiDma_LookupConfig(DMA_DEV_ID);
+    if (!cfg || XAxiDma_CfgInitialize(&dma, cfg) != XST_SUCCESS) {
+        xil_printf("ERROR: AXI DMA init failed\r\n");
+        return -1;
+    }
+    if (XAxiDma_HasSg(&dma)) {
+        xil_printf("ERROR: AXI DMA must be built in simple (non-SG) mode\r\n");
         return -1;
     }
 
-    xil_printf("\n---- Bit Parsing Stage ----\r\n");
+    XScuGic_Config *gcfg = XScuGic_LookupConfig(GIC_DEV_ID);
+    if (!gcfg || XScuGic_CfgInitialize(&gic, gcfg, gcfg->CpuBaseAddress) != XST_SUCCESS) {
+        xil_printf("ERROR: interrupt controller init failed\r\n");
+        return -1;
+    }
+
+    // The chain IRQ is a one-cycle pulse (rising edge), the DMA IRQ a level
+    XScuGic_SetPriorityTriggerType(&gic, CHAIN_IRQ_ID,    0xA0, 0x3);
+    XScuGic_SetPriorityTriggerType(&gic, DMA_S2MM_IRQ_ID, 0xA0, 0x1);
+    if (XScuGic_Connect(&gic, CHAIN_IRQ_ID, chain_irq_handler, NULL) != XST_SUCCESS ||
+        XScuGic_Connect(&gic, DMA_S2MM_IRQ_ID, s2mm_irq_handler, &dma) != XST_SUCCESS) {
+        xil_printf("ERROR: connecting DMA interrupts failed\r\n");
+        return -1;
+    }
+    XScuGic_Enable(&gic, CHAIN_IRQ_ID);
+    XScuGic_Enable(&gic, DMA_S2MM_IRQ_ID);
+
+    Xil_ExceptionInit();
+    Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT,
+                                 (Xil_ExceptionHandler)XScuGic_InterruptHandler, &gic);
+    Xil_ExceptionEnable();
+
+    // MM2S completion is implied by the chain/S2MM interrupts
+    XAxiDma_IntrDisable(&dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DMA_TO_DEVICE);
+    XAxiDma_IntrEnable(&dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DEVICE_TO_DMA);
+
+    // Keyed once; CHAIN_CTRL_PROTECT decides per pass
+    CHAIN_WRITE(REG_CHAIN_KEY, ENCRYPT_KEY * 0x01010101u);
+
+    dma_ready = 1;
+    return 0;
+}
+
+// Reset the chain for a new pass over a block of n_words
+static void chain_start(u32 mode, u32 n_words) {
+    CHAIN_WRITE(REG_CHAIN_WORDS, n_words);
+    CHAIN_WRITE(REG_CHAIN_CTRL, mode | CHAIN_CTRL_CLEAR);
+    CHAIN_WRITE(REG_CHAIN_CTRL, mode);
+    chain_irq_seen = 0;
+    s2mm_irq_seen  = 0;
+    dma_error      = 0;
+}
+
+static int wait_irq_flag(volatile int *flag, const char *what) {
+    u32 to = DMA_TIMEOUT;
+    while (!*flag && !dma_error && --to) ;
+    perf_polls(DMA_TIMEOUT - to);
+    if (dma_error || !to) {
+        xil_printf("ERROR: %s %s\r\n", what, dma_error ? "DMA error" : "timeout");
+        return -1;
+    }
+    return 0;
+}
+
+// Pass 1: histogram of every symbol in the n_words at words
+static int dma_count_pass(const u32 *words, u32 n_words) {
+    u32 bytes = n_words * 4;
 
+    if (dma_init() != 0)
+        return -1;
+
+    chain_start(CHAIN_MODE_COUNT, n_words);
+    Xil_DCacheFlushRange((UINTPTR)words, bytes);
+
+    if (XAxiDma_SimpleTransfer(&dma, (UINTPTR)words, bytes, XAXIDMA_DMA_TO_DEVICE) != XST_SUCCESS) {
+        xil_printf("ERROR: MM2S transfer rejected\r\n");
+        return -1;
+    }
+    return wait_irq_flag(&chain_irq_seen, "count pass");
+}
+
+// Pass 2: packed payload of the block into dst (room bytes, worst
+// case is 2 bytes per symbol), encrypted by the chain if protect;
+// returns its size in bytes, or -1
+static int dma_encode_pass(const u32 *words, u32 n_words, u32 *dst, u32 room, int protect) {
+    u32 bytes = n_words * 4;
+
+    // The count pass is skipped with FREQ_MODE = FREQ_SOFTWARE
+    if (dma_init() != 0)
+        return -1;
+
+    chain_start(CHAIN_MODE_ENCODE | (protect ? CHAIN_CTRL_PROTECT : 0), n_words);
+    Xil_DCacheFlushRange((UINTPTR)words, bytes);
+    Xil_DCacheInvalidateRange((UINTPTR)dst, room);
+
+    if (XAxiDma_SimpleTransfer(&dma, (UINTPTR)dst, room, XAXIDMA_DEVICE_TO_DMA) != XST_SUCCESS ||
+        XAxiDma_SimpleTransfer(&dma, (UINTPTR)words, bytes, XAXIDMA_DMA_TO_DEVICE) != XST_SUCCESS) {
+        xil_printf("ERROR: DMA transfer rejected\r\n");
+        return -1;
+    }
+    if (wait_irq_flag(&s2mm_irq_seen, "encode pass") != 0)
+        return -1;
+
+    Xil_DCacheInvalidateRange((UINTPTR)dst, room);
+    return (int)XAxiDma_ReadReg(dma.RxBdRing[0].ChanBase, XAXIDMA_BUFFLEN_OFFSET);
+}
+#endif
+
+// ======================= BIT PARSER STAGE (Hardware-accelerated) ================================
+// Send one 32-bit word through the bit parser IP and write its four
+// symbols to PARSED_FILE, or (AXIS_DMA) queue it in the DMA source buffer
+static int parse_word(LineWriter *parsed_file, u32 word, u32 index) {
+    if (AXIS_DMA) {
+        if ((index + 1) * 4 > DMA_MAX_BYTES / 2) {
+            xil_printf("ERROR: Bitstream exceeds the %u-byte DMA buffer\r\n", DMA_MAX_BYTES / 2);
+            return -1;
+        }
+        parsed_words[index] = word;
+        return 0;
+    }
+
+    // Send data to BITPARSER_IP hardware
+    Xil_Out32(BITPARSER_IP_BASE + 0, word);
+
+    // Read 4 output bytes
+    u32 out1 = Xil_In32(BITPARSER_IP_BASE + 4)  & 0xFF;
+    u32 out2 = Xil_In32(BITPARSER_IP_BASE + 8)  & 0xFF;
+    u32 out3 = Xil_In32(BITPARSER_IP_BASE + 12) & 0xFF;
+    u32 out4 = Xil_In32(BITPARSER_IP_BASE + 16) & 0xFF;
+
+    // Write outputs as binary strings
+    write_binary_string(parsed_file, out1);
+    write_binary_string(parsed_file, out2);
+    write_binary_string(parsed_file, out3);
+    write_binary_string(parsed_file, out4);
+    return 0;
+}
+
+// .rbt: header lines up to "Bits:" to HEADER_FILE, then every '0'/'1'
+// character is one configuration bit, MSB first
+static int parse_rbt_input(LineReader *input_file, LineWriter *header_file,
+                           LineWriter *parsed_file, u32 *n_words) {
     int in_header = 1;
-    char linebuf[256];
+    char *linebuf;
     u32 input_word = 0;
     int bit_count = 0;
     u32 words_processed = 0;
 
-    while (f_readline(input_file, linebuf, sizeof(linebuf))) {
+    int line_len;
+    while ((line_len = readLine(input_file, &linebuf)) >= 0) {
         if (in_header) {
-            writeFile(header_file, strlen(linebuf), (u32)linebuf);
-            writeFile(header_file, 1, (u32)"\n");
+            writeBuffered(header_file, linebuf, line_len);
+            writeBuffered(header_file, "\n", 1);
 
             if (strncmp(linebuf, "Bits:", 5) == 0) {
                 in_header = 0;
@@ -215,26 +697,25 @@ int stage_bit_parser() {
             continue;
         }
 
+        // A clean 32-character line is one word
+        if (line_len == 32 && bit_count == 0 &&
+            rbt_pack_word(linebuf, &input_word) == 0) {
+            if (parse_word(parsed_file, input_word, words_processed) != 0)
+                return -1;
+            input_word = 0;
+            if (++words_processed % 500000 == 0)
+                xil_printf("Bit Parser: Processed %u 32-bit words.\r\n", words_processed);
+            continue;
+        }
+
         for (int i = 0; linebuf[i] != '\0'; i++) {
             if (linebuf[i] == '0' || linebuf[i] == '1') {
                 input_word = (input_word << 1) | (linebuf[i] - '0');
                 bit_count++;
 
                 if (bit_count == 32) {
-                    // Send data to BITPARSER_IP hardware
-                    Xil_Out32(BITPARSER_IP_BASE + 0, input_word);
-
-                    // Read 4 output bytes
-                    u32 out1 = Xil_In32(BITPARSER_IP_BASE + 4)  & 0xFF;
-                    u32 out2 = Xil_In32(BITPARSER_IP_BASE + 8)  & 0xFF;
-                    u32 out3 = Xil_In32(BITPARSER_IP_BASE + 12) & 0xFF;
-                    u32 out4 = Xil_In32(BITPARSER_IP_BASE + 16) & 0xFF;
-
-                    // Write outputs as binary strings
-                    write_binary_string(parsed_file, out1);
-                    write_binary_string(parsed_file, out2);
-                    write_binary_string(parsed_file, out3);
-                    write_binary_string(parsed_file, out4);
+                    if (parse_word(parsed_file, input_word, words_processed) != 0)
+                        return -1;
 
                     input_word = 0;
                     bit_count = 0;
@@ -251,78 +732,378 @@ int stage_bit_parser() {
     // Handle leftover bits (pad with zeros)
     if (bit_count > 0) {
         input_word <<= (32 - bit_count);
-        Xil_Out32(BITPARSER_IP_BASE + 0, input_word);
+        if (parse_word(parsed_file, input_word, words_processed) != 0)
+            return -1;
+        words_processed++;
+    }
 
-        u32 out1 = Xil_In32(BITPARSER_IP_BASE + 4)  & 0xFF;
-        u32 out2 = Xil_In32(BITPARSER_IP_BASE + 8)  & 0xFF;
-        u32 out3 = Xil_In32(BITPARSER_IP_BASE + 12) & 0xFF;
-        u32 out4 = Xil_In32(BITPARSER_IP_BASE + 16) & 0xFF;
+    *n_words = words_processed;
+    return 0;
+}
 
-        write_binary_string(parsed_file, out1);
-        write_binary_string(parsed_file, out2);
-        write_binary_string(parsed_file, out3);
-        write_binary_string(parsed_file, out4);
+// Payload bytes of a .bit / .bin input -> big-endian words. The
+// word being assembled and the byte count carry across calls.
+static int parse_payload_bytes(LineWriter *parsed_file, const u8 *data, u32 n,
+                               u32 *input_word, int *byte_count, u32 *n_words) {
+    for (u32 i = 0; i < n; i++) {
+        *input_word = (*input_word << 8) | data[i];
+        if (++*byte_count == 4) {
+            if (parse_word(parsed_file, *input_word, *n_words) != 0)
+                return -1;
+            *input_word = 0;
+            *byte_count = 0;
+            if (++*n_words % 500000 == 0)
+                xil_printf("Bit Parser: Processed %u 32-bit words.\r\n", *n_words);
+        }
+    }
+    return 0;
+}
 
-        words_processed++;
+// .bit: the binary header goes to HEADER_FILE verbatim and the 'e'
+// field gives the payload length. .bin: no header, every byte is payload.
+static int parse_binary_input(LineReader *input_file, LineWriter *header_file,
+                              LineWriter *parsed_file, u32 *n_words) {
+    static u8 head[BIT_HEADER_MAX];
+    const u8 *span;
+    u32 got = 0, n;
+    u32 payload_left = 0xFFFFFFFF;
+    u32 skip = 0;
+
+    if (INPUT_FORMAT == BIT_FORMAT_BIT) {
+        BitHeader h;
+        while (got < sizeof(head) && (n = readSpan(input_file, &span, sizeof(head) - got)) > 0) {
+            memcpy(head + got, span, n);
+            got += n;
+        }
+        if (bit_parse_header(head, got, &h) != 0) {
+            xil_printf("ERROR: %s does not start with a .bit header\r\n", INPUT_FILE);
+            return -1;
+        }
+        xil_printf("Design %s, part %s, %u payload bytes\r\n",
+                   h.design, h.part, h.payload_bytes);
+        writeBuffered(header_file, head, h.header_bytes);
+        payload_left = h.payload_bytes;
+        skip = h.header_bytes;
     }
 
-    xil_printf("Bit Parsing complete. Total 32-bit words processed: %u\r\n", words_processed);
+    u32 input_word = 0;
+    int byte_count = 0;
+    *n_words = 0;
+
+    // Payload bytes already read with the header
+    n = got - skip;
+    if (n > payload_left)
+        n = payload_left;
+    if (parse_payload_bytes(parsed_file, head + skip, n, &input_word, &byte_count, n_words) != 0)
+        return -1;
+    payload_left -= n;
 
-    closeFile(input_file);
-    closeFile(header_file);
-    closeFile(parsed_file);
+    while (payload_left > 0 && (n = readSpan(input_file, &span, payload_left)) > 0) {
+        if (parse_payload_bytes(parsed_file, span, n, &input_word, &byte_count, n_words) != 0)
+            return -1;
+        payload_left -= n;
+    }
+
+    if (INPUT_FORMAT == BIT_FORMAT_BIT && payload_left > 0) {
+        xil_printf("ERROR: %s ends %u bytes before the end of its payload\r\n",
+                   INPUT_FILE, payload_left);
+        return -1;
+    }
+
+    // A padded last word would come back as data: the round trip
+    // could not restore the exact length
+    if (byte_count > 0) {
+        xil_printf("ERROR: %s payload is not a whole number of 32-bit words (%d bytes over)\r\n",
+                   INPUT_FILE, byte_count);
+        return -1;
+    }
     return 0;
 }
 
-// ======================= FREQUENCY COUNTER STAGE ========================
-int stage_freq_counter() {
-    xil_printf("\n---- Frequency Counting Stage ----\r\n");
+// PARSED_FILE: four "bbbbbbbb\n" lines per word, at most one word
+// per 32 input characters (.rbt) or 4 input bytes
+static u32 parsed_file_estimate(const LineReader *input_file) {
+    u32 in = f_size(input_file->fp);
+    return ((INPUT_FORMAT == BIT_FORMAT_RBT ? in / 32 : in / 4) + 1) * 36;
+}
 
-    FIL *input_file  = openFile(PARSED_FILE, 'r');
-    if (!input_file) {
-        xil_printf("ERROR: Cannot open %s\r\n", PARSED_FILE);
+int stage_bit_parser() {
+    LineReader input_file  = {0};
+    LineWriter header_file = {0};
+    LineWriter parsed_file = {0};
+
+    if (openReader(&input_file, INPUT_FILE) != XST_SUCCESS ||
+        openWriter(&header_file, HEADER_FILE, 'w') != XST_SUCCESS ||
+        (!AXIS_DMA && openWriterSized(&parsed_file, PARSED_FILE,
+                                      parsed_file_estimate(&input_file)) != XST_SUCCESS)) {
+        xil_printf("ERROR: Failed to open files for Bit Parser stage.\r\n");
+        closeReader(&input_file);
+        closeWriter(&header_file);
+        closeWriter(&parsed_file);
         return -1;
     }
 
-    FIL *output_file = openFile(FREQ_FILE, 'w');
-    if (!output_file) {
-        xil_printf("ERROR: Cannot create %s\r\n", FREQ_FILE);
-        closeFile(input_file);
+    xil_printf("\n---- Bit Parsing Stage ----\r\n");
+
+    if (AXIS_DMA && !(parsed_words = arena_alloc(&ddr, DMA_MAX_BYTES / 2))) {
+        closeReader(&input_file);
+        closeWriter(&header_file);
         return -1;
     }
 
-    u32 file_size = readFile(input_file, MEMORY_BASE_ADDR);
-    if (file_size <= 0) {
-        xil_printf("ERROR: File read error or empty file.\r\n");
-        closeFile(input_file);
-        closeFile(output_file);
+    u32 words_processed = 0;
+    int rc = (INPUT_FORMAT == BIT_FORMAT_RBT)
+                 ? parse_rbt_input(&input_file, &header_file, &parsed_file, &words_processed)
+                 : parse_binary_input(&input_file, &header_file, &parsed_file, &words_processed);
+
+    closeReader(&input_file);
+    if (closeWriter(&header_file) != XST_SUCCESS || closeWriter(&parsed_file) != XST_SUCCESS) {
+        xil_printf("ERROR: Writing %s or %s\r\n", HEADER_FILE, PARSED_FILE);
+        return -1;
+    }
+
+    if (rc != 0)
+        return -1;
+
+    parsed_word_count = words_processed;
+    xil_printf("Bit Parsing complete. Total 32-bit words processed: %u\r\n", words_processed);
+    return 0;
+}
+
+// ======================= ZERO-RUN MODEL STAGE ===========================
+// PARSED_FILE -> symbol bytes in the arena: the '0'/'1' symbol lines
+// are packed in place
+static int load_parsed_symbols(u8 **symbols, u32 *n_symbols) {
+    FIL *input_file  = openFile(PARSED_FILE, 'r');
+    if (!input_file) {
+        xil_printf("ERROR: Cannot open %s\r\n", PARSED_FILE);
         return -1;
     }
 
-    u8 *file_buffer = (u8 *)MEMORY_BASE_ADDR;
+    u8 *file_buffer;
+    int read = arena_read_file(input_file, &file_buffer);
+    closeFile(input_file);
+    if (read <= 0) {
+        xil_printf("ERROR: File read error or empty file.\r\n");
+        return -1;
+    }
+    u32 file_size = (u32)read;
     u32 symbol_value = 0;
     int bit_count = 0;
     u32 symbol_counter = 0;
 
+    // symbol_counter never passes i / 8, so the packed bytes never
+    // overwrite text that is still to be read
     for (u32 i = 0; i < file_size; i++) {
+        // Whole 8-character symbol lines go through the vector kernel
+        u8 sym;
+        if (bit_count == 0 && file_size - i >= 8 &&
+            rbt_pack_byte((const char *)file_buffer + i, &sym) == 0) {
+            file_buffer[symbol_counter++] = sym;
+            i += 7;
+            continue;
+        }
+
         if (file_buffer[i] == '0' || file_buffer[i] == '1') {
             symbol_value = (symbol_value << 1) | (file_buffer[i] - '0');
             bit_count++;
             if (bit_count == 8) {
-                send_symbol(symbol_value);
+                file_buffer[symbol_counter++] = symbol_value;
                 bit_count = 0;
                 symbol_value = 0;
-                symbol_counter++;
             }
         }
     }
 
+    *symbols   = file_buffer;
+    *n_symbols = symbol_counter;
+    return 0;
+}
+
+// ZRLE_MODEL = 1: PARSED_FILE is rewritten as zero-run tokens, one
+// symbol line per token, so the later stages count and encode tokens
+int stage_zrle_model() {
+    xil_printf("\n---- Zero-Run Model Stage ----\r\n");
+
+    u8 *symbols;
+    u32 n_symbols;
+    if (load_parsed_symbols(&symbols, &n_symbols) != 0)
+        return -1;
+
+    // The tokens go right behind the packed symbols, over text already read
+    u8 *tokens = symbols + COMPBIN_PAD4(n_symbols);
+    zrle_escape = zrle_pick_escape(symbols, n_symbols);
+    u32 n_tokens = zrle_encode(symbols, n_symbols / 4, zrle_escape, tokens);
+
+    LineWriter parsed_file = {0};
+    if (openWriter(&parsed_file, PARSED_FILE, 'w') != XST_SUCCESS) {
+        xil_printf("ERROR: Cannot create %s\r\n", PARSED_FILE);
+        return -1;
+    }
+    for (u32 i = 0; i < n_tokens; i++)
+        write_binary_string(&parsed_file, tokens[i]);
+    if (closeWriter(&parsed_file) != XST_SUCCESS) {
+        xil_printf("ERROR: writing %s\r\n", PARSED_FILE);
+        return -1;
+    }
+
+    xil_printf("Zero-run model: %u symbols -> %u tokens (escape 0x%02X)\r\n",
+               n_symbols, n_tokens, zrle_escape);
+    return 0;
+}
+
+// ======================= FREQUENCY COUNTER STAGE ========================
+// One AXI-Lite load handshake per symbol
+static void count_symbols_lite(const u8 *symbols, u32 n) {
+    for (u32 i = 0; i < n; i++)
+        send_symbol(symbols[i]);
+}
+
+// Burst mode: the table is cleared, then one register write per word
+// (4 symbols, MSB first) feeds the IP's stream port. A trailing partial
+// word goes through the handshake path.
+static int count_symbols_burst(const u8 *symbols, u32 n) {
+    u32 n_words = n / 4;
+
+    Xil_Out32(REG_BLOCK_WORDS, n_words);
+    Xil_Out32(REG_BURST_CTRL, BURST_CTRL_ENABLE | BURST_CTRL_CLEAR);
+    Xil_Out32(REG_BURST_CTRL, BURST_CTRL_ENABLE);
+
+    for (u32 i = 0; i < n_words; i++)
+        Xil_Out32(REG_BURST_WORD, bit_load_be32(symbols + 4 * i));
+
+    if (n_words) {
+        u32 to = DMA_TIMEOUT;
+        while (!(Xil_In32(REG_BURST_STATUS) & BURST_STATUS_DONE) && --to);
+        perf_polls(DMA_TIMEOUT - to);
+        if (!to) {
+            Xil_Out32(REG_BURST_CTRL, 0);
+            xil_printf("ERROR: Frequency counter burst did not complete (%u words)\r\n", n_words);
+            return -1;
+        }
+    }
+    Xil_Out32(REG_BURST_CTRL, 0);
+
+    count_symbols_lite(symbols + 4 * n_words, n - 4 * n_words);
+    return 0;
+}
+
+// Software histogram. Consecutive symbols go to separate tables so
+// repeated symbols do not serialise on the same counter.
+static void count_symbols_sw(const u8 *symbols, u32 n, u32 *freqs) {
+    static u32 bank[4][MAX_SYMBOLS];
+    memset(bank, 0, sizeof(bank));
+
+    u32 i = 0;
+    for (; i + 4 <= n; i += 4) {
+        bank[0][symbols[i]]++;
+        bank[1][symbols[i + 1]]++;
+        bank[2][symbols[i + 2]]++;
+        bank[3][symbols[i + 3]]++;
+    }
+    for (; i < n; i++)
+        bank[0][symbols[i]]++;
+
+    for (int symbol = 0; symbol < MAX_SYMBOLS; symbol++)
+        freqs[symbol] = bank[0][symbol] + bank[1][symbol] + bank[2][symbol] + bank[3][symbol];
+}
+
+// Histogram of n symbol bytes with the FREQ_MODE backend
+static int count_symbols(const u8 *symbols, u32 n, u32 *freqs) {
+    static const char *mode_name[] = { "lite", "burst", "software" };
+    XTime t0, t1;
+    XTime_GetTime(&t0);
+
+    if (FREQ_MODE == FREQ_SOFTWARE) {
+        count_symbols_sw(symbols, n, freqs);
+    } else {
+        if (FREQ_MODE == FREQ_BURST) {
+            if (count_symbols_burst(symbols, n) != 0)
+                return -1;
+        } else {
+            // The handshake path only adds to the table: start from zero,
+            // not from the previous input of a batch
+            Xil_Out32(REG_BURST_CTRL, BURST_CTRL_CLEAR);
+            Xil_Out32(REG_BURST_CTRL, 0);
+            count_symbols_lite(symbols, n);
+        }
+        for (int symbol = 0; symbol < MAX_SYMBOLS; symbol++)
+            freqs[symbol] = read_symbol_frequency(symbol);
+
+        // A saturated counter would skew the codebook without any error
+        if (Xil_In32(REG_BURST_STATUS) & FREQ_STATUS_SATURATED) {
+            xil_printf("WARNING: frequency counter saturated, recounting in software\r\n");
+            count_symbols_sw(symbols, n, freqs);
+        }
+    }
+
+    XTime_GetTime(&t1);
+    xil_printf("Frequency counting (%s): %u symbols in %u us\r\n", mode_name[FREQ_MODE], n,
+               (u32)((t1 - t0) / (COUNTS_PER_SECOND / 1000000)));
+    return 0;
+}
+
+// Histogram of PARSED_FILE, counted in one pass
+static int count_symbols_file(u32 *freqs, u32 *n_symbols) {
+    u8 *symbols;
+    if (load_parsed_symbols(&symbols, n_symbols) != 0)
+        return -1;
+    return count_symbols(symbols, *n_symbols, freqs);
+}
+
+// Histogram of n_words at words, counted by the stream chain
+static int count_symbols_dma(const u32 *words, u32 n_words, u32 *freqs, u32 *n_symbols) {
+#if AXIS_DMA
+    if (dma_count_pass(words, n_words) != 0)
+        return -1;
+
+    for (int symbol = 0; symbol < 256; symbol++) {
+        CHAIN_WRITE(REG_CHAIN_FADDR, symbol);
+        freqs[symbol] = CHAIN_READ(REG_CHAIN_FREQ);
+    }
+    *n_symbols = CHAIN_READ(REG_CHAIN_SYMBOLS);
+
+    if (CHAIN_READ(REG_CHAIN_STATUS) & CHAIN_STATUS_SATURATED) {
+        xil_printf("WARNING: chain histogram saturated, recounting in software\r\n");
+        count_symbols_sw((const u8 *)words, 4 * n_words, freqs);
+    }
+    return 0;
+#else
+    (void)words; (void)n_words; (void)freqs; (void)n_symbols;
+    return -1;
+#endif
+}
+
+int stage_freq_counter() {
+    xil_printf("\n---- Frequency Counting Stage ----\r\n");
+
+    static u32 symbol_freq[MAX_SYMBOLS];
+    u32 symbol_counter = 0;
+
+    int rc;
+    if (AXIS_DMA && FREQ_MODE != FREQ_SOFTWARE) {
+        rc = count_symbols_dma(parsed_words, parsed_word_count, symbol_freq, &symbol_counter);
+    } else if (AXIS_DMA) {
+        symbol_counter = 4 * parsed_word_count;
+        rc = count_symbols((const u8 *)parsed_words, symbol_counter, symbol_freq);
+    } else {
+        rc = count_symbols_file(symbol_freq, &symbol_counter);
+    }
+    if (rc != 0)
+        return -1;
+
+    FIL *output_file = openFile(FREQ_FILE, 'w');
+    if (!output_file) {
+        xil_printf("ERROR: Cannot create %s\r\n", FREQ_FILE);
+        return -1;
+    }
+
     // Write main frequency table
     writeFile(output_file, strlen("Symbol        Frequency\r\n"), (u32)"Symbol        Frequency\r\n");
     writeFile(output_file, strlen("-------------------------\r\n"), (u32)"-------------------------\r\n");
 
     for (int symbol = 0; symbol < 256; symbol++) {
-        u32 freq = read_symbol_frequency(symbol);
+        u32 freq = symbol_freq[symbol];
         if (freq > 0) {
             char symbol_str[9], line_buffer[50];
             get_binary_string(symbol, symbol_str);
@@ -332,26 +1113,32 @@ int stage_freq_counter() {
     }
 
     // Write separate symbol/frequency helper files
-    FIL *sym_file = openFile(SYMBOL_FILE, 'w');
-    FIL *cnt_file = openFile(COUNT_FILE, 'w');
+    LineWriter sym_file = {0}, cnt_file = {0};
+    if (openWriter(&sym_file, SYMBOL_FILE, 'w') != XST_SUCCESS ||
+        openWriter(&cnt_file, COUNT_FILE, 'w') != XST_SUCCESS) {
+        xil_printf("ERROR: Cannot create %s or %s\r\n", SYMBOL_FILE, COUNT_FILE);
+        closeWriter(&sym_file);
+        closeWriter(&cnt_file);
+        closeFile(output_file);
+        return -1;
+    }
 
     for (int symbol = 0; symbol < 256; symbol++) {
-        u32 freq = read_symbol_frequency(symbol);
+        u32 freq = symbol_freq[symbol];
         if (freq > 0) {
             char symbol_str[9];
             get_binary_string(symbol, symbol_str);
-            writeFile(sym_file, 8, (u32)symbol_str);
-            writeFile(sym_file, 1, (u32)"\n");
+            symbol_str[8] = '\n';
+            writeBuffered(&sym_file, symbol_str, 9);
 
             char freq_str[20];
             int freq_len = sprintf(freq_str, "%u\n", freq);
-            writeFile(cnt_file, freq_len, (u32)freq_str);
+            writeBuffered(&cnt_file, freq_str, freq_len);
         }
     }
 
-    closeFile(sym_file);
-    closeFile(cnt_file);
-    closeFile(input_file);
+    closeWriter(&sym_file);
+    closeWriter(&cnt_file);
     closeFile(output_file);
 
     xil_printf("Frequency Counting Stage Complete: %u symbols processed\r\n", symbol_counter);
@@ -360,56 +1147,62 @@ int stage_freq_counter() {
 
 // ======================= CODEBOOK GENERATOR STAGE =======================
 
+// Codebook entry of one symbol
+typedef struct {
+    u32 freq;
+    u32 code;               // codeword, right-aligned in code_len bits
+    u8  code_len;
+} HuffCode;
+
+// Tree node. A node is created after both its children, so walking
+// node_pool from the root down reaches every node after its parent.
 typedef struct {
-    int symbol;
-    int freq;
-    char code[256];
-    int code_len;
-} HuffmanNode;
-
-typedef struct HuffNode {
-    int symbol;
-    int freq;
-    struct HuffNode *left, *right;
+    u64 freq;               // subtree weight, can exceed 32 bits near the root
+    s16 symbol;             // leaf symbol, -1 for a merged node
+    s16 left, right;        // node_pool indices of the children
+    u16 depth;              // codeword length
+    u32 code;               // codeword (meaningless beyond 32 bits, see limit_code_lengths)
 } HuffNode;
 
 typedef struct {
-    HuffNode *nodes[MAX_SYMBOLS];
+    s16 nodes[MAX_SYMBOLS]; // node_pool indices
     int size;
 } MinHeap;
 
-HuffmanNode huff_table[MAX_SYMBOLS];
-int freq_table[MAX_SYMBOLS] = {0};
+HuffCode huff_table[MAX_SYMBOLS];
+u32 freq_table[MAX_SYMBOLS] = {0};
+u8 code_lengths[MAX_SYMBOLS] = {0};
 HuffNode node_pool[2 * MAX_SYMBOLS];
 int node_index = 0;
 
-HuffNode *new_node(int symbol, int freq, HuffNode *left, HuffNode *right) {
-    HuffNode *n = &node_pool[node_index++];
+static int new_node(int symbol, u64 freq, int left, int right) {
+    HuffNode *n = &node_pool[node_index];
     n->symbol = symbol;
     n->freq = freq;
     n->left = left;
     n->right = right;
-    return n;
+    return node_index++;
 }
 
-void heap_push(MinHeap *heap, HuffNode *node) {
+static void heap_push(MinHeap *heap, int node) {
     int i = heap->size++;
-    while (i > 0 && node->freq < heap->nodes[(i - 1) / 2]->freq) {
+    while (i > 0 && node_pool[node].freq < node_pool[heap->nodes[(i - 1) / 2]].freq) {
         heap->nodes[i] = heap->nodes[(i - 1) / 2];
         i = (i - 1) / 2;
     }
     heap->nodes[i] = node;
 }
 
-HuffNode *heap_pop(MinHeap *heap) {
-    HuffNode *res = heap->nodes[0];
-    HuffNode *last = heap->nodes[--heap->size];
+static int heap_pop(MinHeap *heap) {
+    int res = heap->nodes[0];
+    int last = heap->nodes[--heap->size];
     int i = 0;
     while (2 * i + 1 < heap->size) {
         int smallest = 2 * i + 1;
-        if (smallest + 1 < heap->size && heap->nodes[smallest + 1]->freq < heap->nodes[smallest]->freq)
+        if (smallest + 1 < heap->size &&
+            node_pool[heap->nodes[smallest + 1]].freq < node_pool[heap->nodes[smallest]].freq)
             smallest++;
-        if (last->freq <= heap->nodes[smallest]->freq)
+        if (node_pool[last].freq <= node_pool[heap->nodes[smallest]].freq)
             break;
         heap->nodes[i] = heap->nodes[smallest];
         i = smallest;
@@ -418,82 +1211,206 @@ HuffNode *heap_pop(MinHeap *heap) {
     return res;
 }
 
-void assign_codes(HuffNode *node, char *prefix) {
-    if (!node->left && !node->right) {
-        strcpy(huff_table[node->symbol].code, prefix);
-        huff_table[node->symbol].code_len = strlen(prefix);
-        return;
+// Depth and codeword of every node, from the root down without
+// recursion; the leaves are copied to huff_table
+static void assign_codes(int root) {
+    node_pool[root].depth = 0;
+    node_pool[root].code  = 0;
+    for (int i = root; i >= 0; i--) {
+        const HuffNode *n = &node_pool[i];
+        if (n->symbol >= 0) {
+            huff_table[n->symbol].code     = n->code;
+            huff_table[n->symbol].code_len = (u8)n->depth;
+            continue;
+        }
+        node_pool[n->left].depth  = n->depth + 1;
+        node_pool[n->left].code   = n->code << 1;
+        node_pool[n->right].depth = n->depth + 1;
+        node_pool[n->right].code  = (n->code << 1) | 1;
     }
-    char left_code[256], right_code[256];
-    sprintf(left_code, "%s0", prefix);
-    sprintf(right_code, "%s1", prefix);
-    if (node->left) assign_codes(node->left, left_code);
-    if (node->right) assign_codes(node->right, right_code);
 }
 
 void generate_huffman_codes() {
     MinHeap heap = { .size = 0 };
     node_index = 0;
     for (int i = 0; i < MAX_SYMBOLS; i++) {
-        if (freq_table[i] > 0) {
-            HuffNode *n = new_node(i, freq_table[i], NULL, NULL);
-            heap_push(&heap, n);
-        }
+        if (freq_table[i] > 0)
+            heap_push(&heap, new_node(i, freq_table[i], -1, -1));
     }
     while (heap.size > 1) {
-        HuffNode *left = heap_pop(&heap);
-        HuffNode *right = heap_pop(&heap);
-        HuffNode *merged = new_node(-1, left->freq + right->freq, left, right);
-        heap_push(&heap, merged);
+        int left  = heap_pop(&heap);
+        int right = heap_pop(&heap);
+        heap_push(&heap, new_node(-1, node_pool[left].freq + node_pool[right].freq, left, right));
     }
-    if (heap.size == 1) assign_codes(heap.nodes[0], "");
+    if (heap.size == 1) assign_codes(heap.nodes[0]);
 }
 
-void parse_sym_freq_files(u8 *sym_buf, u32 sym_size, u8 *freq_buf, u32 freq_size) {
-    u32 si = 0, fi = 0;
-    int line_num = 0;
-    while (si < sym_size && fi < freq_size && line_num < MAX_SYMBOLS) {
-        char sym_line[32] = {0}, freq_line[32] = {0};
-        int sj = 0, fj = 0;
+// Rebuild the code lengths with package-merge when the tree produced a
+// codeword longer than the limit. The old tree codewords are then no
+// longer valid, so the caller must assign canonical codes afterwards.
+// Returns 1 if the lengths were rebuilt, 0 if already within the limit.
+int limit_code_lengths(int max_bits) {
+    int longest = 0;
+    for (int i = 0; i < MAX_SYMBOLS; i++)
+        if (huff_table[i].freq > 0 && huff_table[i].code_len > longest)
+            longest = huff_table[i].code_len;
 
-        while (si < sym_size && sym_buf[si] != '\n' && sj < 31) {
-            if (sym_buf[si] != '\r') sym_line[sj++] = sym_buf[si];
-            si++;
-        } sym_line[sj] = '\0'; si++;
+    if (longest <= max_bits)
+        return 0;
 
-        while (fi < freq_size && freq_buf[fi] != '\n' && fj < 31) {
-            if (freq_buf[fi] != '\r') freq_line[fj++] = freq_buf[fi];
-            fi++;
-        } freq_line[fj] = '\0'; fi++;
+    xil_printf("Longest codeword is %d bits, limiting to %d\r\n", longest, max_bits);
 
-        int symbol = strtol(sym_line, NULL, 2);
-        int freq   = atoi(freq_line);
-        if (symbol >= 0 && symbol < MAX_SYMBOLS && freq > 0) {
-            freq_table[symbol] = freq;
-            huff_table[symbol].symbol = symbol;
-            huff_table[symbol].freq = freq;
-            line_num++;
+    u32 freqs[MAX_SYMBOLS];
+    for (int i = 0; i < MAX_SYMBOLS; i++)
+        freqs[i] = huff_table[i].freq;
+
+    if (codebook_limit_lengths(freqs, max_bits, code_lengths) != 0) {
+        xil_printf("ERROR: cannot build codes of at most %d bits\r\n", max_bits);
+        return -1;
+    }
+
+    for (int i = 0; i < MAX_SYMBOLS; i++)
+        huff_table[i].code_len = code_lengths[i];
+    return 1;
+}
+
+// Keep the tree's code lengths but reassign the codewords in
+// (length, symbol) order, so the lengths alone describe the codebook.
+int make_canonical_codes() {
+    u32 codes[MAX_SYMBOLS];
+
+    for (int i = 0; i < MAX_SYMBOLS; i++) {
+        int len = huff_table[i].code_len;
+        if (huff_table[i].freq > 0 && len == 0)
+            len = 1;                // single-symbol input: root is a leaf
+        code_lengths[i] = (huff_table[i].freq > 0) ? (u8)len : 0;
+    }
+
+    if (codebook_canonical(code_lengths, codes) != 0) {
+        xil_printf("ERROR: code lengths do not form a valid prefix code\r\n");
+        return -1;
+    }
+
+    for (int i = 0; i < MAX_SYMBOLS; i++) {
+        huff_table[i].code     = codes[i];
+        huff_table[i].code_len = code_lengths[i];
+    }
+    return 0;
+}
+
+void parse_sym_freq_files(u8 *sym_buf, u32 sym_size, u8 *freq_buf, u32 freq_size) {
+    u32 si = 0, fi = 0;
+    int line_num = 0;
+    while (si < sym_size && fi < freq_size && line_num < MAX_SYMBOLS) {
+        char sym_line[32] = {0}, freq_line[32] = {0};
+        int sj = 0, fj = 0;
+
+        while (si < sym_size && sym_buf[si] != '\n' && sj < 31) {
+            if (sym_buf[si] != '\r') sym_line[sj++] = sym_buf[si];
+            si++;
+        } sym_line[sj] = '\0'; si++;
+
+        while (fi < freq_size && freq_buf[fi] != '\n' && fj < 31) {
+            if (freq_buf[fi] != '\r') freq_line[fj++] = freq_buf[fi];
+            fi++;
+        } freq_line[fj] = '\0'; fi++;
+
+        int symbol = strtol(sym_line, NULL, 2);
+        u32 freq   = strtoul(freq_line, NULL, 10);
+        if (symbol >= 0 && symbol < MAX_SYMBOLS && freq > 0) {
+            freq_table[symbol] = freq;
+            huff_table[symbol].freq = freq;
+            line_num++;
         }
     }
 }
 
-int stage_codebook_gen() {
-    xil_printf("\n---- Huffman Codebook Generator Stage ----\r\n");
+// Codeword limited to the 16-bit IP width
+static u32 huff_codeword(const HuffCode *e) {
+    return e->code & 0xFFFF;
+}
+
+// Huffman tree -> length limit -> canonical codes, from freq_table
+static int build_codebook(void) {
+    generate_huffman_codes();
+
+    int limited = limit_code_lengths(max_code_len);
+    if (limited < 0 || ((CANONICAL_CODES || limited) && make_canonical_codes() != 0))
+        return -1;
+    return 0;
+}
+
+// TRAINED_CODEBOOK: the code lengths of the trained codebook on the
+// card, in place of the Huffman tree. The input is never looked at,
+// so the codebook must code every symbol, within max_code_len. The
+// file is read once; every later run of a batch reuses it.
+static int load_trained_codebook(void) {
+    static CodebookFile cb;
+    static int cb_read = 0;
+    char name[CODEBOOK_NAME_MAX];
+
+    codebook_file_name(TRAINED_CODEBOOK, name);
+    if (!cb_read) {
+        FIL *f = openFile(name, 'r');
+        if (!f) {
+            xil_printf("ERROR: Cannot open trained codebook %s\r\n", name);
+            return -1;
+        }
+        int n = f_size(f) == sizeof(cb) ? readChunk(f, (u32)&cb, sizeof(cb)) : -1;
+        closeFile(f);
+        if (n != (int)sizeof(cb) || codebook_file_check(&cb, TRAINED_CODEBOOK) != 0) {
+            xil_printf("ERROR: %s is not trained codebook %08X\r\n", name, TRAINED_CODEBOOK);
+            return -1;
+        }
+        cb_read = 1;
+    }
+
+    for (int i = 0; i < MAX_SYMBOLS; i++) {
+        if (cb.lengths[i] == 0 || cb.lengths[i] > max_code_len) {
+            xil_printf("ERROR: %s codes symbol %02X with %u bits (need 1 to %d)\r\n",
+                       name, i, cb.lengths[i], max_code_len);
+            return -1;
+        }
+        huff_table[i].freq     = 1;     // every symbol is in use
+        huff_table[i].code_len = cb.lengths[i];
+    }
+    if (make_canonical_codes() != 0)
+        return -1;
+
+    xil_printf("Trained codebook %s loaded\r\n", name);
+    return 0;
+}
 
+// SYMBOL_FILE / COUNT_FILE -> freq_table -> codebook
+static int codebook_from_count_files(void) {
     FIL *sym_file = openFile(SYMBOL_FILE, 'r');
     FIL *cnt_file = openFile(COUNT_FILE, 'r');
     if (!sym_file || !cnt_file) {
         xil_printf("ERROR: File open failed %s or %s\r\n", SYMBOL_FILE, COUNT_FILE);
+        if (sym_file) closeFile(sym_file);
+        if (cnt_file) closeFile(cnt_file);
         return -1;
     }
 
-    u32 sym_size = readFile(sym_file, SYMBOL_BUF_ADDR);
-    u32 cnt_size = readFile(cnt_file, FREQ_BUF_ADDR);
-    u8 *sym_buf  = (u8 *)SYMBOL_BUF_ADDR;
-    u8 *cnt_buf  = (u8 *)FREQ_BUF_ADDR;
+    u8 *sym_buf, *cnt_buf;
+    int sym_size = arena_read_file(sym_file, &sym_buf);
+    int cnt_size = arena_read_file(cnt_file, &cnt_buf);
+    closeFile(sym_file);
+    closeFile(cnt_file);
+    if (sym_size < 0 || cnt_size < 0) {
+        xil_printf("ERROR: Reading %s or %s\r\n", SYMBOL_FILE, COUNT_FILE);
+        return -1;
+    }
 
     parse_sym_freq_files(sym_buf, sym_size, cnt_buf, cnt_size);
-    generate_huffman_codes();
+    return build_codebook();
+}
+
+int stage_codebook_gen() {
+    xil_printf("\n---- Huffman Codebook Generator Stage ----\r\n");
+
+    if ((TRAINED_CODEBOOK ? load_trained_codebook() : codebook_from_count_files()) != 0)
+        return -1;
 
     FIL *out       = openFile(CODEBOOK_FILE, 'w');
     FIL *sym_out   = openFile(SYMIN_FILE, 'w');
@@ -517,10 +1434,7 @@ int stage_codebook_gen() {
             writeFile(sym_out, len, (u32)line);
 
             // Codeword (up to 16-bit binary string)
-            unsigned int codeword = 0;
-            for (int b = 0; b < huff_table[i].code_len; b++)
-                if (huff_table[i].code[b] == '1')
-                    codeword |= (1 << (huff_table[i].code_len - 1 - b));
+            unsigned int codeword = huff_codeword(&huff_table[i]);
 
             char code_bin[17];
             for (int b = 15; b >= 0; b--)
@@ -540,15 +1454,16 @@ int stage_codebook_gen() {
             len = sprintf(line, "%s\r\n", len_bin);
             writeFile(codelen_out, len, (u32)line);
 
-            // Debug table
-            len = sprintf(line, "%-10s %-20s %2d\r\n",
-                          sym_bin, huff_table[i].code, huff_table[i].code_len);
+            // Debug table: the codeword as code_len '0'/'1' characters
+            char code_str[17];
+            for (unsigned int b = 0; b < clen; b++)
+                code_str[b] = (codeword >> (clen - 1 - b)) & 1 ? '1' : '0';
+            code_str[clen] = '\0';
+            len = sprintf(line, "%-10s %-20s %2d\r\n", sym_bin, code_str, clen);
             writeFile(out, len, (u32)line);
         }
     }
 
-    closeFile(sym_file);
-    closeFile(cnt_file);
     closeFile(out);
     closeFile(sym_out);
     closeFile(codew_out);
@@ -559,97 +1474,267 @@ int stage_codebook_gen() {
 }
 
 // ======================= HUFFMAN ENCODER STAGE ==========================
-int stage_huffman_encode() {
-    xil_printf("\n---- Huffman Compression Stage ----\r\n");
-    xil_printf("Loading Huffman table into hardware...\r\n");
+// Whole codebook into the encoder at base (Huffman encoder IP or stream
+// chain): one posted write per symbol into the shadow table, length 0
+// for unused ones, then the commit that swaps it in. No handshake, so
+// a table costs 257 AXI-Lite writes and can be swapped per block.
+// The table last committed stays active until the next commit, so
+// the same table again (every file of a batch with a trained
+// codebook) is not written twice.
+static struct {
+    u32 base;               // encoder it was committed to, 0 = none
+    u32 entry[MAX_SYMBOLS];
+} active_table;
+
+static void load_table(u32 base, const u32 *codes, const u8 *lengths) {
+    static u32 entry[MAX_SYMBOLS];
+
+    for (int s = 0; s < MAX_SYMBOLS; s++)
+        entry[s] = lengths[s] ? ((u32)lengths[s] << 16) | (codes[s] & 0xFFFF) : 0;
+    if (active_table.base == base && memcmp(active_table.entry, entry, sizeof(entry)) == 0)
+        return;
 
-    FIL *f_symin   = openFile(SYMIN_FILE,   'r');
-    FIL *f_codewin = openFile(CODEWIN_FILE, 'r');
-    FIL *f_codelen = openFile(CODELEN_FILE, 'r');
-    FIL *f_parsed  = openFile(PARSED_FILE,  'r');
-    FIL *f_out     = openFile(OUTPUT_FILE,  'w');
+    for (int s = 0; s < MAX_SYMBOLS; s++)
+        Xil_Out32(base + REG_TABLE_BASE + 4 * s, entry[s]);
+    Xil_Out32(base + REG_TABLE_COMMIT, 1);
+    Xil_Out32(base + REG_TABLE_COMMIT, 0);
+    active_table.base = base;
+    memcpy(active_table.entry, entry, sizeof(entry));
+}
 
-    if (!f_symin || !f_codewin || !f_codelen || !f_parsed || !f_out) {
-        xil_printf("ERROR: Opening table or output files failed\r\n");
+// Load the SYMIN/CODEWIN/CODELEN codebook into the encoder at base
+// (Huffman encoder IP or stream chain, same load registers)
+static int load_huffman_table(u32 base) {
+    LineReader f_symin = {0}, f_codewin = {0}, f_codelen = {0};
+
+    if (openReader(&f_symin,   SYMIN_FILE)   != XST_SUCCESS ||
+        openReader(&f_codewin, CODEWIN_FILE) != XST_SUCCESS ||
+        openReader(&f_codelen, CODELEN_FILE) != XST_SUCCESS) {
+        xil_printf("ERROR: Opening table files failed\r\n");
+        closeReader(&f_symin);
+        closeReader(&f_codewin);
+        closeReader(&f_codelen);
         return -1;
     }
 
-    char lsym[MAX_LINE_LEN];
-    char lcode[MAX_LINE_LEN];
-    char llen[MAX_LINE_LEN];
+    static u32 codes[MAX_SYMBOLS];
+    static u8  lengths[MAX_SYMBOLS];
+    char *lsym, *lcode, *llen;
 
-    // --- Load Huffman table into IP ---
-    while ( f_readline(f_symin , lsym ,  MAX_LINE_LEN) &&
-            f_readline(f_codewin,lcode, MAX_LINE_LEN) &&
-            f_readline(f_codelen,llen , MAX_LINE_LEN) )
+    memset(lengths, 0, sizeof(lengths));
+    while ( readLine(&f_symin,   &lsym)  >= 0 &&
+            readLine(&f_codewin, &lcode) >= 0 &&
+            readLine(&f_codelen, &llen)  >= 0 )
     {
-        uint8_t  symbol = binstr_to_int(lsym);
-        uint32_t code   = binstr_to_int(lcode);
-        uint8_t  len    = binstr_to_int(llen);
+        uint8_t symbol = binstr_to_int(lsym);
+        codes[symbol]   = binstr_to_int(lcode);
+        lengths[symbol] = binstr_to_int(llen);
+    }
 
-        IP_WRITE(REG_LOAD_SYMBOL,  symbol);
-        IP_WRITE(REG_LOAD_CODE,    code);
-        IP_WRITE(REG_LOAD_LENGTH,  len);
-        IP_WRITE(REG_LOAD_VALID,   1);
+    closeReader(&f_symin);
+    closeReader(&f_codewin);
+    closeReader(&f_codelen);
 
-        int to = 10000;
-        while (!IP_READ(REG_LOAD_DONE) && to--) usleep(10);
-        IP_WRITE(REG_LOAD_VALID, 0);
+    load_table(base, codes, lengths);
+    return 0;
+}
 
-        if (!to) {
-            xil_printf("ERROR: Timeout loading symbol %02X\r\n", symbol);
-            return -1;
-        }
-    }
+// Encode n_words at words with the stream chain into dst (room bytes),
+// protected with ENCRYPT_KEY if protect, and return the packed payload
+// size in bytes, or -1
+static int encode_symbols_dma(const u32 *words, u32 n_words, u32 *dst, u32 room, int protect) {
+#if AXIS_DMA
+    int bytes = dma_encode_pass(words, n_words, dst, room, protect);
+    if (bytes < 0)
+        return -1;
 
-    // --- Rewind parsed file for encoding ---
-    f_lseek(f_parsed, 0);
-    uint32_t total = 0;
+    encoded_symbol_count = CHAIN_READ(REG_CHAIN_SYMBOLS);
+    payload_bit_count    = CHAIN_READ(REG_CHAIN_BITS);
+    if ((u32)bytes != (payload_bit_count + 31) / 32 * 4) {
+        xil_printf("ERROR: S2MM returned %d bytes for %u payload bits\r\n",
+                   bytes, payload_bit_count);
+        return -1;
+    }
 
-    while (f_readline(f_parsed, lsym, MAX_LINE_LEN)) {
-        uint8_t symbol = binstr_to_int(lsym);
+    xil_printf("Huffman Compression: DONE. Encoded %u symbols\r\n", encoded_symbol_count);
+    return bytes;
+#else
+    (void)words; (void)n_words; (void)dst; (void)room; (void)protect;
+    return -1;
+#endif
+}
 
-        IP_WRITE(REG_SYMBOL_IN, symbol);
-        IP_WRITE(REG_VALID_IN, 1);
+// --- Per-symbol encoding through the Huffman encoder IP ---
+// Codewords go to the packer (read back from the IP's FIFO with
+// HW_PACKER), or as '0'/'1' lines to f_text with TEXT_PAYLOAD.
+static int hw_pack_pending = 0;
+static u32 code_seq = 0;            // seq bit of the last result
+
+static void encode_begin(void) {
+    hw_pack_pending = 0;
+    code_seq = IP_READ(REG_CODE_RESULT) & CODE_RESULT_SEQ;
+    if (HW_PACKER && !TEXT_PAYLOAD) {
+        IP_WRITE(REG_PACK_CTRL, PACK_CTRL_CLEAR);
+        IP_WRITE(REG_PACK_CTRL, 0);
+    }
+}
 
-        if (wait_valid_out() != 0) {
-            xil_printf("ERROR: TIMEOUT @symbol %u\r\n", total);
-            break;
+static int encode_symbol(LineWriter *f_text, u8 symbol, u32 index) {
+    // One write per symbol: the IP looks it up and holds the result
+    IP_WRITE(REG_SYMBOL_IN, symbol);
+    code_seq ^= CODE_RESULT_SEQ;
+
+    if (HW_PACKER && !TEXT_PAYLOAD) {
+        // The packer keeps the codeword; words are read back in batches
+        if (++hw_pack_pending == PACK_DRAIN_SYMBOLS) {
+            hw_pack_pending = 0;
+            if (drain_packed_words(&packer) != 0) {
+                xil_printf("ERROR: packed-word FIFO overflow @symbol %u\r\n", index);
+                return -1;
+            }
         }
+        return 0;
+    }
 
-        uint32_t cw16 = IP_READ(REG_CODEWORD) & 0xFFFFFF;
-        uint8_t  len5 = IP_READ(REG_CODELEN)  & 0x1F;
+    u32 result;
+    if (wait_code_result(code_seq, &result) != 0) {
+        xil_printf("ERROR: TIMEOUT @symbol %u\r\n", index);
+        return -1;
+    }
 
-        IP_WRITE(REG_VALID_IN, 0);
-        while (IP_READ(REG_VALID_OUT)) { usleep(5); }
+    uint32_t cw16 = result & 0xFFFF;
+    uint8_t  len5 = (result >> 16) & 0x1F;
 
+    if (TEXT_PAYLOAD) {
         // Write trimmed codeword only
+        char lcode[MAX_LINE_LEN];
         for (int i = len5 - 1; i >= 0; i--)
             lcode[len5 - 1 - i] = (cw16 >> i) & 1 ? '1' : '0';
         lcode[len5] = '\0';
 
-        writeFile(f_out, strlen(lcode), (u32)lcode);
-        writeFile(f_out, 2, (u32)"\r\n");
+        writeLine(f_text, lcode, len5);
+    } else {
+        packer_put(&packer, cw16, len5);
+    }
+    return 0;
+}
+
+// Flush the tail word into the packer
+static int encode_flush(void) {
+    int failed = 0;
+
+    if (HW_PACKER && !TEXT_PAYLOAD) {
+        IP_WRITE(REG_PACK_CTRL, PACK_CTRL_FLUSH);
+        IP_WRITE(REG_PACK_CTRL, 0);
+        if (drain_packed_words(&packer) != 0) {
+            xil_printf("ERROR: packed-word FIFO overflow at flush\r\n");
+            failed = 1;
+        }
+        packer.total_bits = IP_READ(REG_PACK_BITS);
+    }
+    if (!TEXT_PAYLOAD)
+        packer_finish(&packer);
+    return failed ? -1 : 0;
+}
+
+// Flush the tail word and record the payload size
+static int encode_end(u32 total) {
+    int rc = encode_flush();
+
+    encoded_symbol_count = total;
+    payload_bit_count    = packer.total_bits;
+
+    xil_printf("Huffman Compression: DONE. Encoded %u symbols\r\n", total);
+    return rc;
+}
+
+// Size of OUTPUT_FILE (text: one "codeword\r\n" line per symbol) or
+// PAYLOAD_FILE, known from the histogram and the code lengths
+static u32 encoded_file_bytes(int text) {
+    u64 bits = 0, symbols = 0;
+    for (int s = 0; s < MAX_SYMBOLS; s++) {
+        bits    += (u64)huff_table[s].freq * huff_table[s].code_len;
+        symbols += huff_table[s].freq;
+    }
+    return (u32)(text ? bits + 2 * symbols : (bits + 31) / 32 * 4);
+}
+
+int stage_huffman_encode() {
+    xil_printf("\n---- Huffman Compression Stage ----\r\n");
+    xil_printf("Loading Huffman table into hardware...\r\n");
+
+    if (load_huffman_table(AXIS_DMA ? CHAIN_IP_BASE : HUFFMAN_IP_BASE) != 0)
+        return -1;
+
+    if (AXIS_DMA) {
+        u32 *payload = arena_alloc(&ddr, DMA_MAX_BYTES);
+        int bytes = payload ? encode_symbols_dma(parsed_words, parsed_word_count,
+                                                 payload, DMA_MAX_BYTES, 0) : -1;
+        if (bytes < 0)
+            return -1;
+
+        FIL *f_out = createFile(PAYLOAD_FILE, bytes);
+        if (!f_out) {
+            xil_printf("ERROR: Cannot create %s\r\n", PAYLOAD_FILE);
+            return -1;
+        }
+        writeFile(f_out, bytes, (u32)payload);
+        closeFile(f_out);
+        return 0;
+    }
+
+    // The packer writes whole blocks itself; ASCII codewords are lines
+    LineReader f_parsed = {0};
+    LineWriter f_text   = {0};
+    FIL *f_out = NULL;
+
+    if (openReader(&f_parsed, PARSED_FILE) != XST_SUCCESS ||
+        (TEXT_PAYLOAD ? openWriterSized(&f_text, OUTPUT_FILE, encoded_file_bytes(1)) != XST_SUCCESS
+                      : !(f_out = createFile(PAYLOAD_FILE, encoded_file_bytes(0))))) {
+        xil_printf("ERROR: Opening parsed or output files failed\r\n");
+        closeReader(&f_parsed);
+        closeWriter(&f_text);
+        return -1;
+    }
+
+    char *lsym;
+
+    // --- Encode the parsed symbols ---
+    uint32_t total = 0;
+    int failed = 0;
+    packer_init(&packer, f_out);
+    encode_begin();
+
+    while (readLine(&f_parsed, &lsym) >= 0) {
+        uint8_t symbol = binstr_to_int(lsym);
+
+        if (encode_symbol(&f_text, symbol, total) != 0) {
+            failed = 1;
+            break;
+        }
 
         if (++total % 500000 == 0) {
             xil_printf("  %u Symbols Processed\r\n", total);
         }
     }
 
-    xil_printf("Huffman Compression: DONE. Encoded %u symbols\r\n", total);
+    if (encode_end(total) != 0)
+        failed = 1;
 
-    closeFile(f_symin);
-    closeFile(f_codewin);
-    closeFile(f_codelen);
-    closeFile(f_parsed);
-    closeFile(f_out);
+    closeReader(&f_parsed);
+    if (f_out)
+        closeFile(f_out);
+    if (closeWriter(&f_text) != XST_SUCCESS)
+        failed = 1;
 
-    return 0;
+    return failed ? -1 : 0;
 }
 
 // ======================= BUNDLING STAGE ===============================
-int stage_create_comp_bin() {
-    xil_printf("\n---- Bundling Stage ----\r\n");
+static int bundle_text_comp_bin() {
+    u8 *buf = arena_alloc(&ddr, BUFFER_SIZE);
+    if (!buf)
+        return -1;
 
     FIL *f_header   = openFile(HEADER_FILE,   'r');
     FIL *f_codebook = openFile(CODEBOOK_FILE, 'r');
@@ -665,33 +1750,198 @@ int stage_create_comp_bin() {
         return -1;
     }
 
-    u8 *buf = (u8*)MEMORY_BASE_ADDR;
-    FRESULT rc;
+    int failed = 0;
 
-    if ((rc = copy_file(f_header,   f_comp, buf)) != FR_OK)
+    if (copy_file(f_header, f_comp, buf) != FR_OK) {
         xil_printf("ERROR copying %s\r\n", HEADER_FILE);
-
-    if ((rc = copy_file(f_codebook, f_comp, buf)) != FR_OK)
+        failed = 1;
+    }
+    if (!failed && copy_file(f_codebook, f_comp, buf) != FR_OK) {
         xil_printf("ERROR copying %s\r\n", CODEBOOK_FILE);
-
-    if ((rc = copy_file(f_output,   f_comp, buf)) != FR_OK)
+        failed = 1;
+    }
+    if (!failed && copy_file(f_output, f_comp, buf) != FR_OK) {
         xil_printf("ERROR copying %s\r\n", OUTPUT_FILE);
+        failed = 1;
+    }
 
     closeFile(f_header);
     closeFile(f_codebook);
     closeFile(f_output);
-    closeFile(f_comp);
+    if (closeFile(f_comp) != XST_SUCCESS)
+        failed = 1;
+
+    if (failed) {
+        xil_printf("ERROR: %s is incomplete\r\n", COMP_FILE);
+        return -1;
+    }
+    return 0;
+}
+
+// COMP.BIN codebook section: the trained codebook's ID, 256 canonical
+// code lengths, or one CompBinCodeEntry per used symbol. Returns its
+// size in bytes.
+static u32 build_codebook_section(u8 *dst) {
+    if (TRAINED_CODEBOOK) {
+        CompBinTrained t = { TRAINED_CODEBOOK };
+        memcpy(dst, &t, sizeof(t));
+        return sizeof(t);
+    }
+    if (CANONICAL_CODES) {
+        memcpy(dst, code_lengths, MAX_SYMBOLS);
+        return MAX_SYMBOLS;
+    }
+
+    CompBinCodeEntry *entries = (CompBinCodeEntry *)dst;
+    u32 n_entries = 0;
+
+    for (int i = 0; i < MAX_SYMBOLS; i++) {
+        if (huff_table[i].freq > 0) {
+            entries[n_entries].symbol   = (u8)i;
+            entries[n_entries].length   = (u8)huff_table[i].code_len;
+            entries[n_entries].reserved = 0;
+            entries[n_entries].code     = huff_codeword(&huff_table[i]);
+            n_entries++;
+        }
+    }
+    return n_entries * sizeof(CompBinCodeEntry);
+}
+
+static void fill_comp_header(CompBinHeader *hdr, u32 rbt_header_bytes, u32 payload_words) {
+    u32 n_entries = 0;
+    for (int i = 0; i < MAX_SYMBOLS; i++)
+        if (huff_table[i].freq > 0)
+            n_entries++;
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic            = COMPBIN_MAGIC;
+    hdr->version          = COMPBIN_VERSION;
+    hdr->flags            = (CANONICAL_CODES ? COMPBIN_FLAG_CANONICAL : 0) |
+                            (INPUT_FORMAT == BIT_FORMAT_BIT ? COMPBIN_FLAG_BIT_HEADER : 0) |
+                            (ZRLE_MODEL ? COMPBIN_FLAG_ZRLE : 0) |
+                            (BLOCK_WORDS ? COMPBIN_FLAG_BLOCKS | COMPBIN_FLAG_PAYLOAD_CRC : 0) |
+                            (TRAINED_CODEBOOK ? COMPBIN_FLAG_TRAINED : 0);
+    hdr->header_bytes     = sizeof(CompBinHeader) + (ZRLE_MODEL ? sizeof(CompBinZrle) : 0) +
+                            (BLOCK_WORDS ? sizeof(CompBinBlocks) +
+                                           block_count * (sizeof(CompBinBlock) + 4) : 0);
+    hdr->word_count       = parsed_word_count;
+    hdr->symbol_count     = encoded_symbol_count;
+    hdr->payload_bits     = payload_bit_count;
+    hdr->rbt_header_bytes = rbt_header_bytes;
+    hdr->codebook_entries = CANONICAL_CODES ? MAX_SYMBOLS : n_entries;
+    hdr->payload_words    = payload_words;
+}
+
+// CompBinZrle record of this run
+static void fill_zrle_record(CompBinZrle *z) {
+    memset(z, 0, sizeof(*z));
+    z->escape = zrle_escape;
+}
+
+static int bundle_packed_comp_bin() {
+    u8 *buf = arena_alloc(&ddr, BUFFER_SIZE);
+    if (!buf)
+        return -1;
+
+    FIL *f_header  = openFile(HEADER_FILE,  'r');
+    FIL *f_payload = openFile(PAYLOAD_FILE, 'r');
+    FIL *f_comp    = NULL;
+
+    static u8 codebook_section[MAX_SYMBOLS * sizeof(CompBinCodeEntry)];
+    u32 cb_bytes = build_codebook_section(codebook_section);
+    CompBinHeader hdr;
+
+    if (f_header && f_payload) {
+        fill_comp_header(&hdr, f_size(f_header), f_size(f_payload) / 4);
+        f_comp = createFile(COMP_FILE, hdr.header_bytes + COMPBIN_PAD4(hdr.rbt_header_bytes) +
+                                       cb_bytes + hdr.payload_words * 4);
+    }
+    if (!f_header || !f_payload || !f_comp) {
+        xil_printf("ERROR: Cannot open one or more input files or create %s\r\n", COMP_FILE);
+        if (f_header)  closeFile(f_header);
+        if (f_payload) closeFile(f_payload);
+        if (f_comp)    closeFile(f_comp);
+        return -1;
+    }
+
+    const u32 zero = 0;
+    u32 pad = COMPBIN_PAD4(hdr.rbt_header_bytes) - hdr.rbt_header_bytes;
+    int failed = writeFile(f_comp, sizeof(hdr), (u32)&hdr) != sizeof(hdr);
+    if (!failed && ZRLE_MODEL) {
+        CompBinZrle z;
+        fill_zrle_record(&z);
+        failed = writeFile(f_comp, sizeof(z), (u32)&z) != sizeof(z);
+    }
+
+    if (!failed && copy_file(f_header, f_comp, buf) != FR_OK) {
+        xil_printf("ERROR copying %s\r\n", HEADER_FILE);
+        failed = 1;
+    }
+    if (!failed)
+        failed = writeFile(f_comp, pad, (u32)&zero) != (int)pad ||
+                 writeFile(f_comp, cb_bytes, (u32)codebook_section) != (int)cb_bytes;
+
+    if (!failed && copy_file(f_payload, f_comp, buf) != FR_OK) {
+        xil_printf("ERROR copying %s\r\n", PAYLOAD_FILE);
+        failed = 1;
+    }
+
+    closeFile(f_header);
+    closeFile(f_payload);
+    if (closeFile(f_comp) != XST_SUCCESS)
+        failed = 1;
+
+    if (failed) {
+        xil_printf("ERROR: %s is incomplete\r\n", COMP_FILE);
+        return -1;
+    }
+
+    xil_printf("Packed %u symbols into %u payload bits (%u words)\r\n",
+               hdr.symbol_count, hdr.payload_bits, hdr.payload_words);
+    return 0;
+}
+
+int stage_create_comp_bin() {
+    xil_printf("\n---- Bundling Stage ----\r\n");
+
+    int rc = TEXT_PAYLOAD ? bundle_text_comp_bin() : bundle_packed_comp_bin();
+    if (rc != 0)
+        return rc;
 
     xil_printf("Successfully Completed Bundling.\r\n");
     return 0;
 }
 
 // ======================= ENCRYPTION STAGE ==============================
+// Encrypt n bytes in place: word-wide in software, or (ENC_IP) one
+// Encryption IP write/read per word with the key set once
+static void encrypt_bytes(u8 *buf, u32 n, u8 key) {
+    static int ip_key = -1;
+
+    if (ENCRYPT_MODE == ENC_SOFTWARE) {
+        bit_protect(buf, n, key);
+        return;
+    }
+
+    if (ip_key != key) {
+        ENC_WRITE(ENC_REG_KEY, key * 0x01010101u);
+        ip_key = key;
+    }
+    for (u32 i = 0; i < n; i += 4) {
+        u32 len = n - i < 4 ? n - i : 4;
+        u32 w = 0;
+        memcpy(&w, buf + i, len);
+        ENC_WRITE(ENC_REG_DATA_IN, w);
+        w = ENC_READ(ENC_REG_DATA_OUT);
+        memcpy(buf + i, &w, len);
+    }
+}
+
 int stage_encrypt_comp_bin(const char *infile, const char *outfile, u8 key) {
     xil_printf("\n---- Encryption Stage ----\r\n");
 
     FIL *fin  = openFile((char*)infile,  'r');
-    FIL *fout = openFile((char*)outfile, 'w');
+    FIL *fout = fin ? createFile((char*)outfile, f_size(fin)) : NULL;
     if (!fin || !fout) {
         xil_printf("ERROR: opening %s or creating %s\r\n", infile, outfile);
         if (fin)  closeFile(fin);
@@ -699,25 +1949,25 @@ int stage_encrypt_comp_bin(const char *infile, const char *outfile, u8 key) {
         return -1;
     }
 
-    u8 *buf = (u8*)MEMORY_BASE_ADDR;
-    UINT br, bw;
-    const UINT BSZ = BUFFER_SIZE;
-    FRESULT rc;
+    // Whole SD commands in and out
+    const u32 BSZ = SD_XFER_SECTORS * SD_SECTOR;
+    u8 *buf = arena_alloc(&ddr, BSZ);
+    int br;
+
+    if (!buf) {
+        closeFile(fin);
+        closeFile(fout);
+        return -1;
+    }
 
     do {
-        rc = f_read(fin, buf, BSZ, &br);
-        if (rc != FR_OK) {
+        br = readChunk(fin, (u32)buf, BSZ);
+        if (br < 0) {
             xil_printf("ERROR: Reading %s\r\n", infile);
             break;
         }
-        for (UINT i = 0; i < br; ++i) {
-            ENC_WRITE(ENC_REG_DATA_IN, buf[i]);
-            ENC_WRITE(ENC_REG_KEY, key);
-            u32 result = ENC_READ(ENC_REG_DATA_OUT);
-            buf[i] = (u8)(result & 0xFF);
-        }
-        rc = f_write(fout, buf, br, &bw);
-        if (rc != FR_OK || bw != br) {
+        encrypt_bytes(buf, br, key);
+        if (br > 0 && writeFile(fout, br, (u32)buf) != br) {
             xil_printf("ERROR: Writing %s\r\n", outfile);
             break;
         }
@@ -731,6 +1981,808 @@ int stage_encrypt_comp_bin(const char *infile, const char *outfile, u8 key) {
     return 0;
 }
 
+// ======================= IN-MEMORY PIPELINE =============================
+// STAGE_FILES = 0: the input is read once, every intermediate result
+// (parsed words and symbols, histogram, codebook, payload, archive)
+// lives in the DDR arena and only ENCR_FILE is written back. The
+// archive is byte-identical to the one built by the file stages.
+
+typedef struct {
+    u8   *input;            // INPUT_FILE as read from the SD card
+    u32   input_bytes;
+    u32   input_ready;      // bytes of input already in DDR (AMP_MODE: grows while parsing)
+    char *rbt_header;       // bitstream header, same bytes as HEADER_FILE
+    u32   rbt_header_bytes;
+    u32  *words;            // parsed 32-bit configuration words
+    u8   *symbols;          // 4 symbols per word, or zero-run tokens (AXI-Lite path only)
+    u32   n_symbols;        // entries of symbols, counted and encoded
+    u32   n_blocks;         // BLOCK_WORDS: independently encoded blocks
+    u32  *block_first;      // first entry of symbols in each block, n_blocks + 1 entries
+    CompBinBlock *blocks;   // block index, filled by the encoder
+    u32  *block_crcs;       // payload CRC of each block, as the encoder packed it
+    u32   freqs[MAX_SYMBOLS];
+    u32  *payload;          // packed payload words
+    u32   payload_words;
+    u8   *archive;          // COMP.BIN, encrypted in place
+    u32   archive_bytes;
+    u32   plain_bytes;      // leading archive bytes still to encrypt (AXIS_DMA: the payload is done)
+} MemPipeline;
+
+static MemPipeline mp;
+
+// Files of the in-memory pipeline: INPUT_FILE and ENCR_FILE, or the
+// entry of a batch run (BATCH_MODE)
+static const char *input_name  = INPUT_FILE;
+static const char *output_name = ENCR_FILE;
+
+#if AMP_MODE
+// CPU1 streams the file in; the parsers wait on mem_input_wait()
+static int mem_read_input(void) {
+    if (amp_open_input(input_name, &mp.input_bytes) != 0) {
+        xil_printf("ERROR: Cannot open %s\r\n", input_name);
+        return -1;
+    }
+
+    mp.input = arena_alloc(&ddr, mp.input_bytes);
+    mp.input_ready = 0;
+    if (!mp.input || amp_read_input((u32)mp.input, mp.input_bytes) != 0) {
+        xil_printf("ERROR: Reading %s\r\n", input_name);
+        return -1;
+    }
+    return 0;
+}
+
+// At least need bytes (or the whole input) in DDR
+static int mem_input_wait(u32 need) {
+    if (need <= mp.input_ready)
+        return 0;
+    if (amp_input_wait(need, &mp.input_ready) != 0) {
+        xil_printf("ERROR: Reading %s\r\n", input_name);
+        return -1;
+    }
+    return 0;
+}
+#else
+static int mem_read_input(void) {
+    FIL *f_in = openFile((char *)input_name, 'r');
+    if (!f_in) {
+        xil_printf("ERROR: Cannot open %s\r\n", input_name);
+        return -1;
+    }
+
+    mp.input_bytes = f_size(f_in);
+    mp.input = arena_alloc(&ddr, mp.input_bytes);
+    if (!mp.input || readFile(f_in, (u32)mp.input) != (int)mp.input_bytes) {
+        xil_printf("ERROR: Reading %s\r\n", input_name);
+        closeFile(f_in);
+        return -1;
+    }
+    closeFile(f_in);
+    mp.input_ready = mp.input_bytes;
+    return 0;
+}
+
+static int mem_input_wait(u32 need) {
+    (void)need;
+    return 0;
+}
+#endif
+
+// .rbt input: header text and one '0'/'1' character per bit
+static int mem_parse_rbt(void) {
+    // Header: every line up to and including "Bits:", '\r' dropped and
+    // '\n' terminated, as stage_bit_parser writes HEADER_FILE
+    mp.rbt_header = arena_alloc(&ddr, mp.input_bytes + 1);
+    if (!mp.rbt_header)
+        return -1;
+
+    u32 pos = 0, hlen = 0;
+    int found_bits = 0;
+
+    while (pos < mp.input_bytes && !found_bits) {
+        u32 line_start = hlen;
+        while (pos < mp.input_bytes) {
+            if (pos >= mp.input_ready && mem_input_wait(pos + 1) != 0)
+                return -1;
+            if (mp.input[pos] == '\n')
+                break;
+            if (mp.input[pos] != '\r')
+                mp.rbt_header[hlen++] = mp.input[pos];
+            pos++;
+        }
+        pos++;
+        found_bits = (hlen - line_start >= 5 &&
+                      strncmp(&mp.rbt_header[line_start], "Bits:", 5) == 0);
+        mp.rbt_header[hlen++] = '\n';
+    }
+    if (!found_bits) {
+        xil_printf("ERROR: No \"Bits:\" line in %s\r\n", input_name);
+        return -1;
+    }
+    mp.rbt_header_bytes = hlen;
+
+    // Every '0'/'1' after the header is a configuration bit
+    u32 max_words = (mp.input_bytes - (pos < mp.input_bytes ? pos : mp.input_bytes)) / 32 + 1;
+    mp.words = arena_alloc(&ddr, max_words * 4);
+    if (!mp.words)
+        return -1;
+
+    u32 input_word = 0;
+    int bit_count = 0;
+    u32 n_words = 0;
+
+    for (; pos < mp.input_bytes; pos++) {
+        if (pos + 32 > mp.input_ready && mem_input_wait(pos + 32) != 0)
+            return -1;
+
+        // Whole 32-character lines go through the vector kernel
+        if (bit_count == 0 && mp.input_bytes - pos >= 32 &&
+            rbt_pack_word((const char *)mp.input + pos, &input_word) == 0) {
+            mp.words[n_words++] = input_word;
+            input_word = 0;
+            pos += 31;
+            continue;
+        }
+
+        u8 c = mp.input[pos];
+        if (c == '0' || c == '1') {
+            input_word = (input_word << 1) | (c - '0');
+            if (++bit_count == 32) {
+                mp.words[n_words++] = input_word;
+                input_word = 0;
+                bit_count = 0;
+            }
+        }
+    }
+
+    // Handle leftover bits (pad with zeros)
+    if (bit_count > 0)
+        mp.words[n_words++] = input_word << (32 - bit_count);
+
+    parsed_word_count = n_words;
+    return 0;
+}
+
+// .bit / .bin input: the header (if any) stays where it was read and
+// the payload is loaded four big-endian bytes per word
+static int mem_parse_binary(void) {
+    u32 payload_off = 0;
+    u32 payload_bytes = mp.input_bytes;
+
+    if (INPUT_FORMAT == BIT_FORMAT_BIT) {
+        // The header fits in the first chunk CPU1 delivers
+        BitHeader h;
+        if (mem_input_wait(AMP_CHUNK_BYTES) != 0)
+            return -1;
+        if (bit_parse_header(mp.input, mp.input_ready, &h) != 0) {
+            xil_printf("ERROR: %s does not start with a .bit header\r\n", input_name);
+            return -1;
+        }
+        if (h.payload_bytes > mp.input_bytes - h.header_bytes) {
+            xil_printf("ERROR: %s ends %u bytes before the end of its payload\r\n",
+                       input_name, h.payload_bytes - (mp.input_bytes - h.header_bytes));
+            return -1;
+        }
+        xil_printf("Design %s, part %s, %u payload bytes\r\n",
+                   h.design, h.part, h.payload_bytes);
+        payload_off   = h.header_bytes;
+        payload_bytes = h.payload_bytes;
+    }
+    mp.rbt_header       = (char *)mp.input;
+    mp.rbt_header_bytes = payload_off;
+
+    // A padded last word would come back as data: the round trip
+    // could not restore the exact length
+    if (payload_bytes % 4) {
+        xil_printf("ERROR: %s payload is not a whole number of 32-bit words (%u bytes over)\r\n",
+                   input_name, payload_bytes % 4);
+        return -1;
+    }
+    u32 n_words = payload_bytes / 4;
+    mp.words = arena_alloc(&ddr, n_words * 4);
+    if (!mp.words)
+        return -1;
+
+    const u8 *src = mp.input + payload_off;
+    for (u32 i = 0; i < n_words; i++) {
+        if (payload_off + 4 * i + 4 > mp.input_ready &&
+            mem_input_wait(payload_off + 4 * i + AMP_CHUNK_BYTES) != 0)
+            return -1;
+        mp.words[i] = bit_load_be32(src + 4 * i);
+    }
+
+    parsed_word_count = n_words;
+    return 0;
+}
+
+// First word of block b (parsed_word_count past the last block)
+static u32 block_start_word(u32 b) {
+    u32 w = b * BLOCK_WORDS;
+    return w < parsed_word_count ? w : parsed_word_count;
+}
+
+// BLOCK_WORDS > 0: split the words into blocks, 4 symbols per word
+// until the zero-run model renumbers them
+static int mem_plan_blocks(void) {
+    u32 n = 0;
+    while (block_start_word(n) < parsed_word_count)
+        n++;
+
+    mp.n_blocks    = n;
+    mp.block_first = arena_alloc(&ddr, (n + 1) * 4);
+    mp.blocks      = arena_alloc(&ddr, n * sizeof(CompBinBlock));
+    mp.block_crcs  = arena_alloc(&ddr, n * 4);
+    if (!mp.block_first || !mp.blocks || !mp.block_crcs)
+        return -1;
+
+    for (u32 b = 0; b <= n; b++)
+        mp.block_first[b] = 4 * block_start_word(b);
+    block_count = n;
+    return 0;
+}
+
+static int mem_bit_parser(void) {
+    xil_printf("\n---- Bit Parsing Stage ----\r\n");
+
+    int rc = (INPUT_FORMAT == BIT_FORMAT_RBT) ? mem_parse_rbt() : mem_parse_binary();
+    if (rc != 0)
+        return -1;
+
+    u32 n_words = parsed_word_count;
+
+    // The stream chain parses the words itself
+    if (!AXIS_DMA) {
+        mp.symbols = arena_alloc(&ddr, n_words * 4);
+        if (!mp.symbols)
+            return -1;
+
+        for (u32 i = 0; i < n_words; i++) {
+            Xil_Out32(BITPARSER_IP_BASE + 0, mp.words[i]);
+            mp.symbols[4 * i + 0] = Xil_In32(BITPARSER_IP_BASE + 4)  & 0xFF;
+            mp.symbols[4 * i + 1] = Xil_In32(BITPARSER_IP_BASE + 8)  & 0xFF;
+            mp.symbols[4 * i + 2] = Xil_In32(BITPARSER_IP_BASE + 12) & 0xFF;
+            mp.symbols[4 * i + 3] = Xil_In32(BITPARSER_IP_BASE + 16) & 0xFF;
+
+            if ((i + 1) % 500000 == 0)
+                xil_printf("Bit Parser: Processed %u 32-bit words.\r\n", i + 1);
+        }
+    }
+
+    mp.n_symbols = n_words * 4;
+    xil_printf("Bit Parsing complete. Total 32-bit words processed: %u\r\n", n_words);
+    return BLOCK_WORDS ? mem_plan_blocks() : 0;
+}
+
+// ZRLE_MODEL = 1: mp.symbols is replaced by its zero-run tokens
+static int mem_zrle_model(void) {
+    xil_printf("\n---- Zero-Run Model Stage ----\r\n");
+
+    u8 *tokens = arena_alloc(&ddr, ZRLE_MAX_TOKENS(parsed_word_count));
+    if (!tokens)
+        return -1;
+
+    zrle_escape = zrle_pick_escape(mp.symbols, mp.n_symbols);
+    u32 n_tokens = 0;
+
+    if (BLOCK_WORDS) {
+        // No run crosses a block, so every block expands on its own
+        for (u32 b = 0; b < mp.n_blocks; b++) {
+            u32 w0 = block_start_word(b);
+            mp.block_first[b] = n_tokens;
+            n_tokens += zrle_encode(mp.symbols + 4 * w0, block_start_word(b + 1) - w0,
+                                    zrle_escape, tokens + n_tokens);
+        }
+        mp.block_first[mp.n_blocks] = n_tokens;
+    } else {
+        n_tokens = zrle_encode(mp.symbols, parsed_word_count, zrle_escape, tokens);
+    }
+
+    xil_printf("Zero-run model: %u symbols -> %u tokens (escape 0x%02X)\r\n",
+               mp.n_symbols, n_tokens, zrle_escape);
+    mp.symbols   = tokens;
+    mp.n_symbols = n_tokens;
+    return 0;
+}
+
+static int mem_freq_counter(void) {
+    xil_printf("\n---- Frequency Counting Stage ----\r\n");
+
+    u32 n_symbols = 0;
+
+#if AXIS_DMA
+    if (FREQ_MODE != FREQ_SOFTWARE) {
+        if (count_symbols_dma(mp.words, parsed_word_count, mp.freqs, &n_symbols) != 0)
+            return -1;
+    } else {
+        // Byte order within a word does not matter for the histogram
+        n_symbols = parsed_word_count * 4;
+        if (count_symbols((const u8 *)mp.words, n_symbols, mp.freqs) != 0)
+            return -1;
+    }
+#else
+    n_symbols = mp.n_symbols;
+    if (count_symbols(mp.symbols, n_symbols, mp.freqs) != 0)
+        return -1;
+#endif
+
+    xil_printf("Frequency Counting Stage Complete: %u symbols processed\r\n", n_symbols);
+    return 0;
+}
+
+static int mem_codebook_gen(void) {
+    xil_printf("\n---- Huffman Codebook Generator Stage ----\r\n");
+
+    if (TRAINED_CODEBOOK)
+        return load_trained_codebook();
+
+    for (int s = 0; s < MAX_SYMBOLS; s++) {
+        if (mp.freqs[s] > 0) {
+            freq_table[s] = mp.freqs[s];
+            huff_table[s].freq = mp.freqs[s];
+        }
+    }
+    if (build_codebook() != 0)
+        return -1;
+
+    xil_printf("Huffman Codebook Generation : done.\r\n");
+    return 0;
+}
+
+// Global codebook into the encoder at base
+static void load_global_table(u32 base) {
+    static u32 codes[MAX_SYMBOLS];
+    static u8  lengths[MAX_SYMBOLS];
+
+    for (int s = 0; s < MAX_SYMBOLS; s++) {
+        int used   = huff_table[s].freq > 0;
+        codes[s]   = used ? huff_codeword(&huff_table[s]) : 0;
+        lengths[s] = used ? huff_table[s].code_len : 0;
+    }
+    load_table(base, codes, lengths);
+}
+
+// Codeword bits of a block with histogram freqs and code lengths len
+static u64 block_code_bits(const u32 *freqs, const u8 *len) {
+    u64 bits = 0;
+    for (int s = 0; s < MAX_SYMBOLS; s++)
+        bits += (u64)freqs[s] * len[s];
+    return bits;
+}
+
+// BLOCK_WORDS > 0: every block is packed on its own, from a word
+// boundary, with the global codebook or (BLOCK_CODEBOOK) its own
+// canonical lengths stored in front of its codewords
+static int mem_encode_blocks(void) {
+    static u32 freqs[MAX_SYMBOLS];
+    static u8  lengths[MAX_SYMBOLS];
+    static u32 codes[MAX_SYMBOLS];
+
+    // Worst case 16 bits per symbol, plus a padded tail word and local lengths per block
+    u32 room = mp.n_symbols * 2 + mp.n_blocks * (4 + MAX_SYMBOLS);
+    mp.payload = arena_alloc(&ddr, room);
+    if (!mp.payload)
+        return -1;
+
+    int global_loaded = 1;
+    u32 offset = 0, total_bits = 0, n_local = 0;
+
+    for (u32 b = 0; b < mp.n_blocks; b++) {
+        u32 first = mp.block_first[b];
+        u32 n     = mp.block_first[b + 1] - first;
+        int local = 0;
+
+        if (BLOCK_CODEBOOK != BLOCK_CB_GLOBAL) {
+            count_symbols_sw(mp.symbols + first, n, freqs);
+            if (codebook_limit_lengths(freqs, max_code_len, lengths) != 0 ||
+                codebook_canonical(lengths, codes) != 0) {
+                xil_printf("ERROR: No codebook for block %u\r\n", b);
+                return -1;
+            }
+            local = BLOCK_CODEBOOK == BLOCK_CB_LOCAL ||
+                    block_code_bits(freqs, lengths) + MAX_SYMBOLS * 8 <
+                    block_code_bits(freqs, code_lengths);
+        }
+
+        if (local) {
+            load_table(HUFFMAN_IP_BASE, codes, lengths);
+            global_loaded = 0;
+            n_local++;
+        } else if (!global_loaded) {
+            load_global_table(HUFFMAN_IP_BASE);
+            global_loaded = 1;
+        }
+
+        CompBinBlock *blk = &mp.blocks[b];
+        memset(blk, 0, sizeof(*blk));
+        blk->offset = offset;
+        blk->flags  = local ? COMPBIN_BLOCK_LOCAL : 0;
+
+        u32 *out = mp.payload + offset;
+        if (local) {
+            memcpy(out, lengths, MAX_SYMBOLS);
+            out    += COMPBIN_LOCAL_CODEBOOK_WORDS;
+            offset += COMPBIN_LOCAL_CODEBOOK_WORDS;
+        }
+
+        packer_init_mem(&packer, out);
+        encode_begin();
+        for (u32 i = 0; i < n; i++) {
+            if (encode_symbol(NULL, mp.symbols[first + i], first + i) != 0)
+                return -1;
+            if ((first + i + 1) % 500000 == 0)
+                xil_printf("  %u Symbols Processed\r\n", first + i + 1);
+        }
+        if (encode_flush() != 0)
+            return -1;
+
+        u32 w0 = block_start_word(b);
+        blk->payload_bits = packer.total_bits;
+        blk->symbol_count = n;
+        blk->crc32        = bit_crc32_words(mp.words + w0, block_start_word(b + 1) - w0);
+
+        // The encoder IP checksums the words as they are read back
+        mp.block_crcs[b] = HW_PACKER ? IP_READ(REG_PACK_CRC)
+                                     : bit_crc32_words(out, packer.out_words);
+
+        offset     += packer.out_words;
+        total_bits += packer.total_bits;
+    }
+
+    encoded_symbol_count = mp.n_symbols;
+    payload_bit_count    = total_bits;
+    mp.payload_words     = offset;
+
+    xil_printf("Blocks: %u of %u words, %u with a local codebook\r\n",
+               mp.n_blocks, BLOCK_WORDS, n_local);
+    xil_printf("Huffman Compression: DONE. Encoded %u symbols\r\n", mp.n_symbols);
+    return 0;
+}
+
+// AXIS_DMA with BLOCK_WORDS: one encode pass of the chain per block,
+// with the global codebook. Each pass restarts the packer, so every
+// block begins on a payload word, and the chain's CRC of the pass is
+// the block's payload CRC. The words leave the chain protected.
+static int mem_encode_blocks_dma(void) {
+#if AXIS_DMA
+    // Worst case 16 bits per symbol, plus a padded tail word per block
+    u32 room = mp.n_symbols * 2 + mp.n_blocks * 4;
+    mp.payload = arena_alloc(&ddr, room);
+    if (!mp.payload)
+        return -1;
+
+    u32 offset = 0, total_bits = 0;
+    for (u32 b = 0; b < mp.n_blocks; b++) {
+        u32 w0 = block_start_word(b);
+        u32 n_words = block_start_word(b + 1) - w0;
+
+        int bytes = dma_encode_pass(mp.words + w0, n_words, mp.payload + offset,
+                                    room - 4 * offset, 1);
+        if (bytes < 0)
+            return -1;
+        u32 bits = CHAIN_READ(REG_CHAIN_BITS);
+        if ((u32)bytes != (bits + 31) / 32 * 4) {
+            xil_printf("ERROR: S2MM returned %d bytes for %u payload bits in block %u\r\n",
+                       bytes, bits, b);
+            return -1;
+        }
+
+        CompBinBlock *blk = &mp.blocks[b];
+        memset(blk, 0, sizeof(*blk));
+        blk->offset       = offset;
+        blk->payload_bits = bits;
+        blk->symbol_count = CHAIN_READ(REG_CHAIN_SYMBOLS);
+        blk->crc32        = bit_crc32_words(mp.words + w0, n_words);
+        mp.block_crcs[b]  = CHAIN_READ(REG_CHAIN_CRC);
+
+        offset     += bytes / 4;
+        total_bits += bits;
+    }
+
+    encoded_symbol_count = mp.n_symbols;
+    payload_bit_count    = total_bits;
+    mp.payload_words     = offset;
+
+    xil_printf("Blocks: %u of %u words, one encode pass each\r\n", mp.n_blocks, BLOCK_WORDS);
+    xil_printf("Huffman Compression: DONE. Encoded %u symbols\r\n", mp.n_symbols);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+static int mem_huffman_encode(void) {
+    xil_printf("\n---- Huffman Compression Stage ----\r\n");
+    xil_printf("Loading Huffman table into hardware...\r\n");
+
+    load_global_table(AXIS_DMA ? CHAIN_IP_BASE : HUFFMAN_IP_BASE);
+    xil_printf("Huffman table loaded successfully.\r\n");
+
+    if (BLOCK_WORDS)
+        return AXIS_DMA ? mem_encode_blocks_dma() : mem_encode_blocks();
+
+    // Worst case 16 bits per symbol, plus the zero-padded tail word
+    u32 room = mp.n_symbols * 2 + 4;
+    mp.payload = arena_alloc(&ddr, room);
+    if (!mp.payload)
+        return -1;
+
+    if (AXIS_DMA) {
+        int bytes = encode_symbols_dma(mp.words, parsed_word_count, mp.payload, room, 1);
+        if (bytes < 0)
+            return -1;
+        mp.payload_words = bytes / 4;
+        return 0;
+    }
+
+    u32 total = mp.n_symbols;
+    int failed = 0;
+    packer_init_mem(&packer, mp.payload);
+    encode_begin();
+
+    for (u32 i = 0; i < total; i++) {
+        if (encode_symbol(NULL, mp.symbols[i], i) != 0) {
+            failed = 1;
+            total = i;
+            break;
+        }
+        if ((i + 1) % 500000 == 0)
+            xil_printf("  %u Symbols Processed\r\n", i + 1);
+    }
+
+    if (encode_end(total) != 0 || failed)
+        return -1;
+
+    mp.payload_words = packer.out_words;
+    return 0;
+}
+
+static int mem_create_comp_bin(void) {
+    xil_printf("\n---- Bundling Stage ----\r\n");
+
+    u32 pad      = COMPBIN_PAD4(mp.rbt_header_bytes) - mp.rbt_header_bytes;
+    u32 max_size = sizeof(CompBinHeader) + sizeof(CompBinZrle) +
+                   sizeof(CompBinBlocks) + mp.n_blocks * (sizeof(CompBinBlock) + 4) +
+                   mp.rbt_header_bytes + pad +
+                   MAX_SYMBOLS * sizeof(CompBinCodeEntry) + mp.payload_words * 4;
+
+    mp.archive = arena_alloc(&ddr, max_size);
+    if (!mp.archive)
+        return -1;
+
+    CompBinHeader hdr;
+    fill_comp_header(&hdr, mp.rbt_header_bytes, mp.payload_words);
+
+    u8 *p = mp.archive;
+    memcpy(p, &hdr, sizeof(hdr));                     p += sizeof(hdr);
+    if (ZRLE_MODEL) {
+        CompBinZrle z;
+        fill_zrle_record(&z);
+        memcpy(p, &z, sizeof(z));                     p += sizeof(z);
+    }
+    if (BLOCK_WORDS) {
+        CompBinBlocks bk = { BLOCK_WORDS, mp.n_blocks };
+        memcpy(p, &bk, sizeof(bk));                   p += sizeof(bk);
+        memcpy(p, mp.blocks, mp.n_blocks * sizeof(CompBinBlock));
+        p += mp.n_blocks * sizeof(CompBinBlock);
+        memcpy(p, mp.block_crcs, mp.n_blocks * 4);   p += mp.n_blocks * 4;
+    }
+    memcpy(p, mp.rbt_header, mp.rbt_header_bytes);    p += mp.rbt_header_bytes;
+    memset(p, 0, pad);                                p += pad;
+    p += build_codebook_section(p);
+    mp.plain_bytes = p - mp.archive;
+    memcpy(p, mp.payload, mp.payload_words * 4);      p += mp.payload_words * 4;
+    mp.archive_bytes = p - mp.archive;
+    if (!AXIS_DMA)
+        mp.plain_bytes = mp.archive_bytes;
+
+    xil_printf("Packed %u symbols into %u payload bits (%u words)\r\n",
+               hdr.symbol_count, hdr.payload_bits, hdr.payload_words);
+    xil_printf("Successfully Completed Bundling.\r\n");
+    return 0;
+}
+
+#if AMP_MODE
+// Each chunk goes to CPU1 as soon as it is encrypted, so the card
+// writes the archive while the rest of it is being encrypted
+static int mem_encrypt_and_write(u8 key) {
+    xil_printf("\n---- Encryption Stage ----\r\n");
+
+    if (amp_write_begin(output_name, mp.archive_bytes) != 0)
+        return -1;
+    for (u32 off = 0; off < mp.archive_bytes; off += AMP_CHUNK_BYTES) {
+        u32 n = mp.archive_bytes - off < AMP_CHUNK_BYTES ? mp.archive_bytes - off : AMP_CHUNK_BYTES;
+        if (off < mp.plain_bytes)
+            encrypt_bytes(mp.archive + off, mp.plain_bytes - off < n ? mp.plain_bytes - off : n, key);
+        if (amp_write_chunk((u32)(mp.archive + off), n) != 0)
+            return -1;
+    }
+    if (amp_write_end(mp.archive_bytes) != 0) {
+        xil_printf("ERROR: Writing %s\r\n", output_name);
+        return -1;
+    }
+
+    xil_printf("Encryption complete: %u bytes -> %s (key=0x%02X)\r\n",
+               mp.archive_bytes, output_name, key);
+    return 0;
+}
+#else
+static int mem_encrypt_and_write(u8 key) {
+    xil_printf("\n---- Encryption Stage ----\r\n");
+
+    encrypt_bytes(mp.archive, mp.plain_bytes, key);
+
+    // The card write is a stage of its own
+    perf_end(mp.plain_bytes, mp.plain_bytes, 0);
+    perf_begin("write");
+
+    FIL *fout = createFile((char *)output_name, mp.archive_bytes);
+    if (!fout) {
+        xil_printf("ERROR: creating %s\r\n", output_name);
+        return -1;
+    }
+    int rc = writeFile(fout, mp.archive_bytes, (u32)mp.archive);
+    closeFile(fout);
+    if (rc != (int)mp.archive_bytes) {
+        xil_printf("ERROR: Writing %s\r\n", output_name);
+        return -1;
+    }
+
+    xil_printf("Encryption complete: %u bytes -> %s (key=0x%02X)\r\n",
+               mp.archive_bytes, output_name, key);
+    return 0;
+}
+#endif
+
+int run_in_memory_pipeline(void) {
+    memset(&mp, 0, sizeof(mp));
+
+    // AMP_MODE: "read" only posts the request, the parser waits for the data
+    perf_begin("read");
+    if (mem_read_input()      != 0) { xil_printf("Reading input failed\r\n");        return -1; }
+    perf_end(mp.input_bytes, mp.input_bytes, 0);
+
+    perf_begin("bit_parse");
+    perf_ip(PERF_IP_PARSE);
+    if (mem_bit_parser()      != 0) { xil_printf("Bit Parser failed\r\n");           return -1; }
+    perf_end(mp.input_bytes, parsed_word_count * 4, mp.n_symbols);
+
+    if (ZRLE_MODEL) {
+        perf_begin("zrle");
+        if (mem_zrle_model()  != 0) { xil_printf("Zero-Run Model failed\r\n");       return -1; }
+        perf_end(parsed_word_count * 4, mp.n_symbols, mp.n_symbols);
+    }
+
+    // A trained codebook does not depend on the input: one pass
+    if (!TRAINED_CODEBOOK) {
+        perf_begin("freq_count");
+        perf_ip(PERF_IP_FREQ);
+        if (mem_freq_counter() != 0) { xil_printf("Frequency Counter failed\r\n");    return -1; }
+        perf_end(mp.n_symbols, sizeof(mp.freqs), mp.n_symbols);
+    }
+
+    perf_begin("codebook");
+    if (mem_codebook_gen()    != 0) { xil_printf("Codebook Generation failed\r\n");  return -1; }
+    perf_end(TRAINED_CODEBOOK ? sizeof(CodebookFile) : sizeof(mp.freqs), MAX_SYMBOLS, 0);
+
+    perf_begin("encode");
+    perf_ip(PERF_IP_ENCODE);
+    if (mem_huffman_encode()  != 0) { xil_printf("Huffman Encoding failed\r\n");     return -1; }
+    perf_end(mp.n_symbols, mp.payload_words * 4, mp.n_symbols);
+
+    perf_begin("bundle");
+    if (mem_create_comp_bin() != 0) { xil_printf("Bundling failed\r\n");             return -1; }
+    perf_end(mp.payload_words * 4, mp.archive_bytes, 0);
+
+    perf_begin("encrypt");
+    perf_ip(PERF_IP_ENCRYPT);
+    if (mem_encrypt_and_write(ENCRYPT_KEY) != 0) { xil_printf("Encryption failed\r\n"); return -1; }
+    perf_end(mp.archive_bytes, mp.archive_bytes, 0);
+
+    xil_printf("In-memory pipeline: %u of %u arena bytes used\r\n", ddr.used, ddr.size);
+    perf_run.plain_bytes  = mp.input_bytes;
+    perf_run.packed_bytes = mp.archive_bytes;
+    return 0;
+}
+
+// ======================= BIT-STRING MICROBENCHMARK ======================
+// BITSTR_BENCH = 1: the .rbt <-> binary kernels of bitstream.c on
+// BENCH_LINES random lines in DDR, scalar against the build's vector
+// version (the same code unless BITSTR_NEON). Results are cross-checked.
+#define BENCH_LINES       100000
+
+// Hundredths of a nanosecond per line
+static u32 bench_ns_x100(XTime ticks) {
+    return (u32)((u64)ticks * 100000000000ULL / COUNTS_PER_SECOND / BENCH_LINES);
+}
+
+static void bench_report(const char *what, XTime scalar, XTime vector) {
+    u32 s = bench_ns_x100(scalar);
+    u32 v = bench_ns_x100(vector);
+    u32 x = v ? (u32)((u64)s * 100 / v) : 0;
+    xil_printf("  %s: scalar %u.%02u ns/line, vector %u.%02u ns/line, speedup %u.%02ux\r\n",
+               what, s / 100, s % 100, v / 100, v % 100, x / 100, x % 100);
+}
+
+void bench_bitstr_kernels(void) {
+    char *text  = arena_alloc(&ddr, BENCH_LINES * (32 + 32 + 4));
+    if (!text)
+        return;
+    char *out   = text + BENCH_LINES * 32;
+    u32  *words = (u32 *)(out + BENCH_LINES * 32);
+    u32 seed = 12345, sum_s = 0, sum_v = 0;
+    XTime t0, t1, t2;
+    int ok = 1;
+
+    for (u32 i = 0; i < BENCH_LINES; i++) {
+        seed = seed * 1103515245 + 12345;
+        words[i] = seed;
+        rbt_unpack_word_scalar(seed, text + 32 * i);
+    }
+
+    xil_printf("\n---- Bit-string kernels (%s, %u lines) ----\r\n",
+               BITSTR_NEON ? "NEON" : "scalar build", BENCH_LINES);
+
+    // 32 characters -> word (Bit Parser, .rbt input)
+    XTime_GetTime(&t0);
+    for (u32 i = 0; i < BENCH_LINES; i++) {
+        u32 w = 0;
+        rbt_pack_word_scalar(text + 32 * i, &w);
+        sum_s += w;
+    }
+    XTime_GetTime(&t1);
+    for (u32 i = 0; i < BENCH_LINES; i++) {
+        u32 w = 0;
+        rbt_pack_word(text + 32 * i, &w);
+        sum_v += w;
+    }
+    XTime_GetTime(&t2);
+    ok &= (sum_s == sum_v);
+    bench_report("pack 32", t1 - t0, t2 - t1);
+
+    // word -> 32 characters (.rbt output)
+    XTime_GetTime(&t0);
+    for (u32 i = 0; i < BENCH_LINES; i++)
+        rbt_unpack_word_scalar(words[i], out + 32 * i);
+    XTime_GetTime(&t1);
+    for (u32 i = 0; i < BENCH_LINES; i++)
+        rbt_unpack_word(words[i], out + 32 * i);
+    XTime_GetTime(&t2);
+    ok &= (memcmp(text, out, BENCH_LINES * 32) == 0);
+    bench_report("unpack 32", t1 - t0, t2 - t1);
+
+    // 8 characters -> symbol (PARSED_FILE lines)
+    sum_s = sum_v = 0;
+    XTime_GetTime(&t0);
+    for (u32 i = 0; i < BENCH_LINES; i++) {
+        u8 b = 0;
+        rbt_pack_byte_scalar(text + 32 * i, &b);
+        sum_s += b;
+    }
+    XTime_GetTime(&t1);
+    for (u32 i = 0; i < BENCH_LINES; i++) {
+        u8 b = 0;
+        rbt_pack_byte(text + 32 * i, &b);
+        sum_v += b;
+    }
+    XTime_GetTime(&t2);
+    ok &= (sum_s == sum_v);
+    bench_report("pack 8", t1 - t0, t2 - t1);
+
+    // symbol -> 8 characters
+    XTime_GetTime(&t0);
+    for (u32 i = 0; i < BENCH_LINES; i++)
+        rbt_unpack_byte_scalar(words[i] >> 24, out + 32 * i);
+    XTime_GetTime(&t1);
+    for (u32 i = 0; i < BENCH_LINES; i++)
+        rbt_unpack_byte(words[i] >> 24, out + 32 * i);
+    XTime_GetTime(&t2);
+    ok &= (memcmp(text, out, BENCH_LINES * 32) == 0);
+    bench_report("unpack 8", t1 - t0, t2 - t1);
+
+    if (!ok)
+        xil_printf("ERROR: vector and scalar kernels disagree\r\n");
+}
+
 // ============================ FILE CLEANUP STAGE ===========================
 void cleanup_helper_files() {
     if (CLEANUP == 0) {
@@ -746,6 +2798,7 @@ void cleanup_helper_files() {
 			CODELEN_FILE,
 			COMP_FILE,
 			OUTPUT_FILE,
+			PAYLOAD_FILE,
 			CODEBOOK_FILE,
 			FREQ_FILE,
 			PARSED_FILE,
@@ -765,32 +2818,185 @@ void cleanup_helper_files() {
         xil_printf("Cleanup complete.\r\n");
     }
 
+// Figures both pipelines know at the end; the sizes are filled in by
+// the pipeline (STAGE_FILES = 0) or taken from the card
+static void record_run(void) {
+    perf_run.input         = input_name;
+    perf_run.symbols       = encoded_symbol_count;
+    perf_run.payload_bits  = payload_bit_count;
+    perf_run.entropy_mbits = perf_entropy_mbits(freq_table, MAX_SYMBOLS);
+    perf_run.peak_bytes    = ddr.peak;
+    if (STAGE_FILES)
+        perf_run_files(INPUT_FILE, ENCR_FILE);
+}
+
+// ======================= BATCH MODE =====================================
+// BATCH_MODE = 1: every input of BATCH_DIR through the in-memory
+// pipeline, with the card mounted once. The arena is rewound for each
+// file; what does not depend on the input stays: the DMA and interrupt
+// set-up, the encryption IP key, the encoder table last committed and
+// a trained codebook. Each file is profiled on its own (PERF_FILE,
+// RUN_FILE), then one table sums up the batch.
+static BatchList batch;
+
+// Pipeline state one input leaves behind
+static void reset_pipeline_state(void) {
+    parsed_word_count    = 0;
+    encoded_symbol_count = 0;
+    payload_bit_count    = 0;
+    zrle_escape          = 0;
+    block_count          = 0;
+    memset(huff_table,   0, sizeof(huff_table));
+    memset(freq_table,   0, sizeof(freq_table));
+    memset(code_lengths, 0, sizeof(code_lengths));
+}
+
+static int run_batch(void) {
+    if (batch_list(&batch, BATCH_DIR, BATCH_IN_EXT, BATCH_MANIFEST, BATCH_DIR, BATCH_OUT_EXT) <= 0) {
+        xil_printf("No inputs in %s\r\n", BATCH_DIR);
+        return -1;
+    }
+
+    u32 mark = ddr.used;
+    int failed = 0;
+    for (u32 i = 0; i < batch.n; i++) {
+        BatchEntry *e = &batch.e[i];
+        XTime t0, t1;
+
+        xil_printf("\n==== [%u/%u] %s -> %s ====\r\n", i + 1, batch.n, e->in, e->out);
+        input_name  = e->in;
+        output_name = e->out;
+        reset_pipeline_state();
+        perf_reset();
+        arena_reset(&ddr, mark);
+        ddr.peak = mark;
+
+        XTime_GetTime(&t0);
+        e->status = run_in_memory_pipeline();
+        XTime_GetTime(&t1);
+        e->us           = (u32)((t1 - t0) / (COUNTS_PER_SECOND / 1000000));
+        e->plain_bytes  = mp.input_bytes;
+        e->packed_bytes = mp.archive_bytes;
+        failed |= e->status != 0;
+        if (e->status != 0)
+            xil_printf("%s failed, going on with the next input\r\n", e->in);
+
+        if (PERF_REPORT) {
+            perf_report("compression", PERF_FILE);
+            if (e->status == 0) {
+                record_run();
+                perf_run_report("compression", RUN_FILE);
+            }
+        }
+    }
+
+    batch_report("compression", &batch);
+    return failed ? -1 : 0;
+}
+
 // ======================= MAIN: RUN ALL STAGES SEQUENTIALLY ==============
 int main() {
     XTime tStart, tEnd;
+    int ok = 0;
 
     xil_printf("\n==== Huffman Compression + Encryption Chain: START ====\r\n");
+    arena_init(&ddr, MEMORY_BASE_ADDR, ARENA_SIZE);
+    if (BITSTR_BENCH) {
+        bench_bitstr_kernels();
+        arena_init(&ddr, MEMORY_BASE_ADDR, ARENA_SIZE);   // its buffers do not count as the pipeline's
+    }
     XTime_GetTime(&tStart);
 
+#if AMP_MODE
+    // CPU1 mounts the card and serves every file access
+    amp_map_ocm();
+    if (amp_start_cpu1() != 0) {
+        xil_printf("CPU1 did not start (is amp_io.elf loaded at 0x%08X?)\r\n", AMP_CPU1_ENTRY);
+        return -1;
+    }
+#else
     if (SD_Init() != XST_SUCCESS) {
         xil_printf("SD card init failed\r\n");
         return -1;
     }
+#endif
+
+    if (BATCH_MODE) {
+        run_batch();   // reports every file itself
+        goto done;
+    }
 
+    if (!STAGE_FILES) {
+        ok = run_in_memory_pipeline() == 0;
+        goto done;
+    }
+
+    // Every stage reads and writes files: its data volume is in the fs columns
+    perf_begin("bit_parse");
+    perf_ip(PERF_IP_PARSE);
     if (stage_bit_parser()      != 0) { xil_printf("Bit Parser failed\r\n");          goto done; }
-    if (stage_freq_counter()    != 0) { xil_printf("Frequency Counter failed\r\n");   goto done; }
+    perf_end(0, parsed_word_count * 4, parsed_word_count * 4);
+
+    // Only the parsed words (AXIS_DMA) outlive their stage
+    u32 kept = ddr.used;
+
+    if (ZRLE_MODEL) {
+        perf_begin("zrle");
+        if (stage_zrle_model()  != 0) { xil_printf("Zero-Run Model failed\r\n");      goto done; }
+        perf_end(parsed_word_count * 4, 0, 0);
+        arena_reset(&ddr, kept);
+    }
+
+    if (!TRAINED_CODEBOOK) {
+        perf_begin("freq_count");
+        perf_ip(PERF_IP_FREQ);
+        if (stage_freq_counter() != 0) { xil_printf("Frequency Counter failed\r\n");   goto done; }
+        perf_end(0, MAX_SYMBOLS * 4, 0);
+        arena_reset(&ddr, kept);
+    }
+
+    perf_begin("codebook");
     if (stage_codebook_gen()    != 0) { xil_printf("Codebook Generation failed\r\n"); goto done; }
+    perf_end(MAX_SYMBOLS * 4, MAX_SYMBOLS, 0);
+    arena_reset(&ddr, kept);
+
+    perf_begin("encode");
+    perf_ip(PERF_IP_ENCODE);
     if (stage_huffman_encode()  != 0) { xil_printf("Huffman Encoding failed\r\n");    goto done; }
+    perf_end(0, (payload_bit_count + 31) / 32 * 4, encoded_symbol_count);
+    arena_reset(&ddr, kept);
+
+    perf_begin("bundle");
     if (stage_create_comp_bin() != 0) { xil_printf("Bundling failed\r\n");            goto done; }
+    perf_end((payload_bit_count + 31) / 32 * 4, 0, 0);
+    arena_reset(&ddr, kept);
+
+    perf_begin("encrypt");
+    perf_ip(PERF_IP_ENCRYPT);
     if (stage_encrypt_comp_bin(COMP_FILE, ENCR_FILE, ENCRYPT_KEY) != XST_SUCCESS) {
         xil_printf("Encryption failed\r\n");
         goto done;
     }
+    perf_end(0, 0, 0);
+    ok = 1;
 
     cleanup_helper_files();   // run cleanup according to CLEANUP flag
 
 done:
+    // CPU1 owns the card in AMP_MODE: the profile goes to the UART only
+    if (PERF_REPORT && !BATCH_MODE) {
+        perf_report("compression", AMP_MODE ? NULL : PERF_FILE);
+        if (ok) {
+            record_run();
+            perf_run_report("compression", AMP_MODE ? NULL : RUN_FILE);
+        }
+    }
+
+#if AMP_MODE
+    amp_stop();
+#else
     SD_Eject();
+#endif
     XTime_GetTime(&tEnd);
 
     // ====================== Print total execution time ======================
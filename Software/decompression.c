@@ -8,7 +8,7 @@
  * Toolchain       : Vivado / Vitis 2023.x
  *
  * This application performs decryption, Huffman decoding,
- * symbol merging, and final .rbt reconstruction.
+ * symbol merging, and final .rbt / .bit / .bin reconstruction.
  */
 
 #include "xparameters.h"
@@ -16,13 +16,19 @@
 #include "xil_printf.h"
 #include "ff.h"
 #include "sdCard.h"
+#include "compbin.h"
+#include "codebook.h"
+#include "bitstream.h"
+#include "zrle.h"
+#include "amp.h"
+#include "batch.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 #include <ctype.h>
-#include <sleep.h>
 #include <stdio.h>
 #include "xtime_l.h"
+#include "perf.h"         // after xil_io.h and ff.h: counts their calls
 
 // ======================= File Names ========================================
 #define ENCRYPT_FILE        "ENCR.bin"    // input encrypted file
@@ -35,9 +41,19 @@
 #define CODELEN_FILE        "CODLEN.txt"
 #define OUTCW_FILE          "OTCW.txt"
 #define OUTLEN_FILE         "OTLEN.txt"
+#define PAYLOAD_FILE        "PAYLD.bin"   // packed payload words (STREAM_DECODER)
 #define PARRGN_FILE         "RGN.txt"
 #define MERGED_FILE         "MERGED.txt"
-#define DECOMP_FILE         "DECOMP.rbt"
+#define DECOMP_RBT_FILE     "DECOMP.rbt"
+#define DECOMP_BIT_FILE     "DECOMP.bit"
+#define DECOMP_BIN_FILE     "DECOMP.bin"  // big-endian words, as Vivado writes .bin
+#define CONFIG_FILE         "CONFIG.bin"  // little-endian words (PCAP_CONFIG = 0 or OUTPUT_WORDS)
+#define PERF_FILE           "PERFD.CSV"   // stage profile (PERF_REPORT), one CSV line per stage and run
+#define RUN_FILE            "RUND.CSV"    // run result (PERF_REPORT): sizes, ratio, peak buffers
+#define BATCH_DIR           "BATCH"       // BATCH_MODE: archives NAME.ENC, as the compressor leaves them
+#define BATCH_IN_EXT        "ENC"
+#define BATCH_MANIFEST      "UNPACK.TXT"  // BATCH_MODE: archives to take, in BATCH_DIR (not the compressor's BATCH.TXT)
+#define BATCH_OUT_DIR       "BATCH/OUT"   // BATCH_MODE: outputs NAME.<BATCH_OUT_EXT>
 
 // ======================= Decryption Parameters ============================
 #define DECRYPT_KEY   0x5A   // must match encryption key from compression
@@ -54,6 +70,24 @@
 #define REG_CODELEN_IN     0x18
 #define REG_CODEWORD_IN    0x1C
 #define REG_SYMBOL_OUT     0x20
+#define REG_TABLE_COMMIT   0x28   // bit0: stream decoder fills its lookup table from the window (edge-detected)
+#define REG_TABLE_BANK     0x2C   // stream decoder: lookup table the commit fills and decoding reads
+#define REG_TABLE_BASE     0x400  // table window: word s = {length[20:16], code[15:0]} of symbol s
+
+// huffman_stream_decoder (STREAM_DECODER = 1): same load registers, plus
+#define REG_SD_CTRL        0x14   // bit0: start (edge-detected)
+#define REG_SD_COUNT       0x18   // symbols to decode after start
+#define REG_SD_WORD_IN     0x1C   // write: push one packed payload word
+#define REG_SD_SYMBOL_OUT  0x20   // read: {valid[31], length[12:8], symbol[7:0]}, pops when valid
+#define REG_SD_STATUS      0x24   // {table_busy[4], symbol_valid[3], word_ready[2], error[1], done[0]}
+#define REG_SD_CRC         0x30   // CRC-32 of the payload words taken since start (bit_crc32_words)
+
+#define SD_STATUS_DONE          0x1
+#define SD_STATUS_ERROR         0x2
+#define SD_STATUS_WORD_READY    0x4
+#define SD_STATUS_SYMBOL_VALID  0x8
+#define SD_STATUS_TABLE_BUSY    0x10
+#define SD_SYMBOL_VALID         0x80000000
 
 #define IP_WRITE(offset, value) Xil_Out32(HUFFDEC_BASE_ADDR + (offset), (value))
 #define IP_READ(offset)         Xil_In32(HUFFDEC_BASE_ADDR + (offset))
@@ -72,13 +106,124 @@
 // ======================= Decryption IP BASE ADDR ============================
 #define DECRYPT_BASE_ADDR 0x43C20000  // base address of decryption IP
 
-#define DECRYPT_REG0      (DECRYPT_BASE_ADDR + 0x00)  // data_in
-#define DECRYPT_REG1      (DECRYPT_BASE_ADDR + 0x04)  // key
+#define DECRYPT_REG0      (DECRYPT_BASE_ADDR + 0x00)  // data_in, one 32-bit word (4 archive bytes)
+#define DECRYPT_REG1      (DECRYPT_BASE_ADDR + 0x04)  // key in every byte, written once
 #define DECRYPT_REG2      (DECRYPT_BASE_ADDR + 0x08)  // data_out
 
+// ======================= Stream Decompression Chain (AXIS_DMA) ==============
+#define DCHAIN_BASE_ADDR  0x43C30000  // axis_decompression_chain
+
+// Load registers, table window, REG_SD_CTRL, REG_SD_COUNT and
+// REG_SD_STATUS as in the stream decoder IP
+#define REG_DC_KEY         0x1C   // decryption key in every byte, written once per session
+#define REG_DC_WORDS       0x20   // configuration words sent since start
+
+#define DC_WRITE(offset, value) Xil_Out32(DCHAIN_BASE_ADDR + (offset), (value))
+#define DC_READ(offset)         Xil_In32(DCHAIN_BASE_ADDR + (offset))
+
+// ======================= DDR Buffers (AXIS_DMA, STAGE_FILES = 0) ============
+#define ARCHIVE_BUF_ADDR  0x10000000  // ENCR.bin as read from the card
+#define CONFIG_BUF_ADDR   0x14000000  // reconstructed configuration words
+#define DMA_MAX_BYTES     0x03FFFFFC  // per buffer: largest word multiple <= 2^26 - 1 (DMA length width)
+#define RBT_BUF_ADDR      0x18000000  // DECOMP_FILE image (STAGE_FILES = 0)
+#define RBT_MAX_BYTES     0x08000000
+
 // ======================= Helpers ==========================================
 #define MAX_LINE_LEN  256
 #define CLEANUP 1   // 1 = delete helper files after run, 0 = keep all for debug
+#define STREAM_DECODER  1   // 1 = huffman_stream_decoder IP decodes the packed payload,
+                            // 0 = huffman_decoder IP fed one (codeword, length) at a time
+#define STREAM_LUT_BITS 12  // LUT_BITS of the huffman_stream_decoder instance
+#define STREAM_TIMEOUT  1000000   // status polls before giving up on the decoder
+#define DECODER_BANKS   4   // lookup tables the stream decoder keeps resident (2^BANK_BITS of the instance)
+#define DECRYPT_MODE    DEC_SOFTWARE  // DEC_SOFTWARE (word-wide XOR on the A9, NEON with BITSTR_NEON)
+                            // or DEC_IP (decrypt IP, one write and one read per word); the
+                            // AXIS_DMA chain decrypts the payload itself
+#define AXIS_DMA        0   // 1 = decrypt/decode/merge in axis_decompression_chain fed by AXI DMA,
+                            //     output stays in DDR (no DECOMP.rbt)
+#define PCAP_CONFIG     1   // AXIS_DMA only: 1 = configure the fabric from DDR through DevC/PCAP,
+                            // 0 = write the configuration words to CONFIG_FILE
+#define DMA_TIMEOUT     100000000 // polling iterations before a DMA or PCAP transfer is declared hung
+#define STAGE_FILES     0   // 1 = file per stage on the SD card (debug, keep with CLEANUP = 0),
+                            // 0 = in-memory pipeline, ENCR.bin read once and one output write
+#define OUTPUT_WORDS    3   // OUTPUT_FORMAT value: CONFIG_FILE, words as handed to the PCAP
+#define OUTPUT_FORMAT   BIT_FORMAT_RBT  // BIT_FORMAT_RBT, BIT_FORMAT_BIT, BIT_FORMAT_BIN or OUTPUT_WORDS;
+                            //     a header missing from the archive is synthesised
+#define AMP_MODE        0   // 1 = CPU1 runs amp_io.c: SD read-ahead and write-behind, and it decodes
+                            //     blocks of block archives from the tail (needs STAGE_FILES = 0)
+#define PERF_REPORT     1   // 1 = per-stage time, bytes, MMIO, FatFs and poll counts (perf.h)
+                            //     on the UART and in PERF_FILE
+#define BATCH_MODE      0   // 1 = every archive of BATCH_DIR (or those its UNPACK.TXT names) in one
+                            //     session, outputs in BATCH_OUT_DIR, see batch.h (needs STAGE_FILES = 0,
+                            //     AMP_MODE = 0 and, with AXIS_DMA, PCAP_CONFIG = 0)
+
+// IP core whose counters (perf_ip) each stage reports, 0 = runs on the A9
+#define PERF_IP_DECRYPT (DECRYPT_MODE == DEC_IP ? DECRYPT_BASE_ADDR : 0)
+
+#if OUTPUT_FORMAT == BIT_FORMAT_BIT
+#define DECOMP_FILE     DECOMP_BIT_FILE
+#define DECOMP_EXT      "BIT"
+#elif OUTPUT_FORMAT == BIT_FORMAT_BIN
+#define DECOMP_FILE     DECOMP_BIN_FILE
+#define DECOMP_EXT      "BIN"
+#elif OUTPUT_FORMAT == OUTPUT_WORDS
+#define DECOMP_FILE     CONFIG_FILE
+#define DECOMP_EXT      "CFG"
+#else
+#define DECOMP_FILE     DECOMP_RBT_FILE
+#define DECOMP_EXT      "RBT"
+#endif
+
+// BATCH_MODE outputs: the format's extension, or the words of CONFIG_FILE
+#if AXIS_DMA
+#define BATCH_OUT_EXT   "CFG"
+#else
+#define BATCH_OUT_EXT   DECOMP_EXT
+#endif
+
+#define DEC_SOFTWARE    0
+#define DEC_IP          1
+
+#if DECRYPT_MODE != DEC_SOFTWARE && DECRYPT_MODE != DEC_IP
+#error "DECRYPT_MODE must be DEC_SOFTWARE or DEC_IP"
+#endif
+
+#if AMP_MODE && STAGE_FILES
+#error "AMP_MODE overlaps the SD card with the in-memory pipeline; set STAGE_FILES to 0"
+#endif
+
+#if AMP_MODE && (ARCHIVE_BUF_ADDR < AMP_CPU1_DDR_END || CONFIG_BUF_ADDR < AMP_CPU1_DDR_END || \
+                 RBT_BUF_ADDR < AMP_CPU1_DDR_END)
+#error "AMP_MODE: the DDR buffers overlap CPU1's image or scratch (see AMP_CPU1_DDR_END)"
+#endif
+
+#if BATCH_MODE && (STAGE_FILES || AMP_MODE)
+#error "BATCH_MODE runs the in-memory pipeline on CPU0, which lists the directory: STAGE_FILES = 0, AMP_MODE = 0"
+#endif
+
+#if BATCH_MODE && AXIS_DMA && PCAP_CONFIG
+#error "BATCH_MODE writes one output per archive; set PCAP_CONFIG to 0"
+#endif
+
+#if AMP_MODE
+#include "xil_cache.h"
+#endif
+
+#if AXIS_DMA
+#include "xaxidma.h"
+#include "xscugic.h"
+#include "xil_exception.h"
+#include "xil_cache.h"
+#if PCAP_CONFIG
+#include "xdevcfg.h"
+#endif
+
+#define DMA_DEV_ID        XPAR_AXIDMA_0_DEVICE_ID
+#define GIC_DEV_ID        XPAR_SCUGIC_SINGLE_DEVICE_ID
+#define DCFG_DEV_ID       XPAR_XDCFG_0_DEVICE_ID
+#define DMA_S2MM_IRQ_ID   XPAR_FABRIC_AXIDMA_0_S2MM_INTROUT_VEC_ID
+#define DCHAIN_IRQ_ID     XPAR_FABRIC_AXIS_DECOMPRESSION_CHAIN_0_IRQ_INTR
+#endif
 
 //================== helpers / utility functions =============================
 
@@ -89,6 +234,13 @@ static inline int binstr_to_int(const char *s) {
     return v;
 }
 
+static inline uint32_t binstr_to_u32(const char *s) {
+    uint32_t v = 0;
+    while (*s == '0' || *s == '1')
+        v = (v << 1) | (uint32_t)(*s++ - '0');
+    return v;
+}
+
 static inline int is_binstr(const char *s) {
     if (!s || !*s) return 0;
     while (*s) {
@@ -113,40 +265,40 @@ static void rstrip(char *s) {
     }
 }
 
-static int f_readline(FIL *fp, char *buf, UINT len) {
-    unsigned i = 0;
-    char c;
-    UINT br;
-    while (i < len-1) {
-        FRESULT rc = f_read(fp, &c, 1, &br);
-        if (rc != FR_OK || br == 0) break;   // EOF
-        if (c == '\n') break;
-        if (c != '\r') buf[i++] = c;
-    }
-    buf[i] = '\0';
-    return (i > 0) ? 1 : 0;
-}
-
-static inline uint8_t binstr_to_byte(const char *s) {
-    uint8_t v = 0;
-    for (int i = 0; i < 8 && (s[i] == '0' || s[i] == '1'); i++) {
-        v = (v << 1) | (s[i] - '0');
-    }
-    return v;
-}
-
 static void uint32_to_binstr(uint32_t val, char *out) {
-    for (int i = 31; i >= 0; i--) {
-        out[31 - i] = ((val >> i) & 1) ? '1' : '0';
-    }
+    rbt_unpack_word(val, out);
     out[32] = '\0';
 }
 // ==========================================================================
 // Part 1: Decrypt ENCR.bin -> COMP.bin
 // ==========================================================================
+// Decrypt n bytes in place: word-wide in software, or (DEC_IP) one
+// Decrypt IP write/read per word with the key set once
+static void decrypt_bytes(u8 *buffer, u32 n) {
+    static int keyed = 0;
+
+    if (DECRYPT_MODE == DEC_SOFTWARE) {
+        bit_protect(buffer, n, DECRYPT_KEY);
+        return;
+    }
+
+    if (!keyed) {
+        Xil_Out32(DECRYPT_REG1, DECRYPT_KEY * 0x01010101u);
+        keyed = 1;
+    }
+    for (u32 i = 0; i < n; i += 4) {
+        u32 len = n - i < 4 ? n - i : 4;
+        u32 w = 0;
+        memcpy(&w, buffer + i, len);
+        Xil_Out32(DECRYPT_REG0, w);
+        w = Xil_In32(DECRYPT_REG2);
+        memcpy(buffer + i, &w, len);
+    }
+}
+
 int decrypt_file() {
     FIL *fp_in  = openFile(ENCRYPT_FILE,  'r');   // ENCR.bin
-    FIL *fp_out = openFile(DECRYPTED_FILE,  'w');   // COMP.bin
+    FIL *fp_out = fp_in ? createFile(DECRYPTED_FILE, f_size(fp_in)) : NULL;   // COMP.bin
 
     if (!fp_in || !fp_out) {
         xil_printf("ERROR: opening %s or creating %s\r\n",
@@ -159,29 +311,21 @@ int decrypt_file() {
     xil_printf("---- Decrypting %s ----\r\n",
                ENCRYPT_FILE);
 
-    UINT br, bw;
-    const UINT BSZ = 4096;
-    u8 buffer[BSZ];
+    // Whole SD commands in and out, through the (unused) archive buffer
+    u8 *buffer = (u8 *)ARCHIVE_BUF_ADDR;
+    const u32 BSZ = SD_XFER_SECTORS * SD_SECTOR;
+    int br;
 
     do {
-        FRESULT rc = f_read(fp_in, buffer, BSZ, &br);
-        if (rc != FR_OK) {
+        br = readChunk(fp_in, (u32)buffer, BSZ);
+        if (br < 0) {
             xil_printf("ERROR: Reading %s\r\n", ENCRYPT_FILE);
             break;
         }
 
-        for (UINT i = 0; i < br; i++) {
-            // Send encrypted byte + key to Decrypt IP
-            Xil_Out32(DECRYPT_REG0, buffer[i]);
-            Xil_Out32(DECRYPT_REG1, DECRYPT_KEY);   // use defined key
-
-            // Read decrypted byte
-            u32 result = Xil_In32(DECRYPT_REG2);
-            buffer[i] = (u8)(result & 0xFF);
-        }
+        decrypt_bytes(buffer, br);
 
-        rc = f_write(fp_out, buffer, br, &bw);
-        if (rc != FR_OK || bw != br) {
+        if (br > 0 && writeFile(fp_out, br, (u32)buffer) != br) {
             xil_printf("ERROR: Writing %s\r\n", DECRYPTED_FILE);
             break;
         }
@@ -194,35 +338,689 @@ int decrypt_file() {
     return 0;
 }
 
-int split_comp_bin() {
-    FIL *fp_in     = openFile(DECRYPTED_FILE, 'r');   // COMP.bin
-    FIL *fp_header = openFile(HEADER_FILE,   'w');    // HEADER.txt
-    FIL *fp_codes  = openFile(CODEBOOK_FILE, 'w');    // HMCODES.txt
-    FIL *fp_output = openFile(OUTPUT_FILE,   'w');    // OUTPUT.txt
+static u32 archive_ready = 0;    // bytes of ENCR.bin in DDR so far
 
-    if (!fp_in || !fp_header || !fp_codes || !fp_output) {
-        xil_printf("ERROR: opening COMP.bin or creating output files\r\n");
-        if (fp_in)     closeFile(fp_in);
-        if (fp_header) closeFile(fp_header);
-        if (fp_codes)  closeFile(fp_codes);
-        if (fp_output) closeFile(fp_output);
+// Files of the single-pass pipelines: ENCRYPT_FILE and DECOMP_FILE (or
+// CONFIG_FILE with AXIS_DMA), or the entry of a batch run (BATCH_MODE)
+static const char *archive_name = ENCRYPT_FILE;
+static const char *output_name  = AXIS_DMA ? CONFIG_FILE : DECOMP_FILE;
+
+#if AMP_MODE
+// ENCR.bin -> ARCHIVE_BUF_ADDR, streamed in by CPU1; archive_wait()
+// blocks until a prefix has arrived
+static int read_archive(u32 *size) {
+    if (amp_open_input(archive_name, size) != 0) {
+        xil_printf("ERROR: opening %s\r\n", archive_name);
+        return -1;
+    }
+    if (*size < sizeof(CompBinHeader) || *size > DMA_MAX_BYTES) {
+        xil_printf("ERROR: %s size %lu not supported\r\n", archive_name, (unsigned long)*size);
+        return -1;
+    }
+    archive_ready = 0;
+    return amp_read_input(ARCHIVE_BUF_ADDR, *size);
+}
+
+static int archive_wait(u32 need) {
+    if (need <= archive_ready)
+        return 0;
+    if (amp_input_wait(need, &archive_ready) != 0) {
+        xil_printf("ERROR: Reading %s\r\n", archive_name);
+        return -1;
+    }
+    return 0;
+}
+#else
+// ENCR.bin -> ARCHIVE_BUF_ADDR in one read, still encrypted
+static int read_archive(u32 *size) {
+    FIL *fp_in = openFile((char *)archive_name, 'r');
+    if (!fp_in) {
+        xil_printf("ERROR: opening %s\r\n", archive_name);
+        return -1;
+    }
+    *size = f_size(fp_in);
+    if (*size < sizeof(CompBinHeader) || *size > DMA_MAX_BYTES) {
+        xil_printf("ERROR: %s size %lu not supported\r\n", archive_name, (unsigned long)*size);
+        closeFile(fp_in);
+        return -1;
+    }
+    int rc = readFile(fp_in, ARCHIVE_BUF_ADDR);
+    closeFile(fp_in);
+    if (rc != (int)*size) {
+        xil_printf("ERROR: Reading %s\r\n", archive_name);
+        return -1;
+    }
+    archive_ready = *size;
+    return 0;
+}
+
+static int archive_wait(u32 need) {
+    (void)need;
+    return 0;
+}
+#endif
+
+// Output file built in DDR front to back. out_commit() hands every
+// complete AMP_CHUNK_BYTES below bytes to CPU1 (AMP_MODE), so the card
+// writes while the rest is formatted; otherwise out_end() writes it
+// all at once.
+static struct {
+    const char *name;
+    u32 addr;
+    u32 posted;
+} out;
+
+// expect: final size, or an upper bound (the file is trimmed)
+static int out_begin(const char *name, u32 addr, u32 expect) {
+    out.name   = name;
+    out.addr   = addr;
+    out.posted = 0;
+#if AMP_MODE
+    return amp_write_begin(name, expect);
+#else
+    (void)expect;
+    return 0;
+#endif
+}
+
+static int out_commit(u32 bytes) {
+#if AMP_MODE
+    while (bytes - out.posted >= AMP_CHUNK_BYTES) {
+        if (amp_write_chunk(out.addr + out.posted, AMP_CHUNK_BYTES) != 0)
+            return -1;
+        out.posted += AMP_CHUNK_BYTES;
+    }
+#else
+    (void)bytes;
+#endif
+    return 0;
+}
+
+static int out_end(u32 bytes) {
+#if AMP_MODE
+    if ((bytes > out.posted && amp_write_chunk(out.addr + out.posted, bytes - out.posted) != 0) ||
+        amp_write_end(bytes) != 0) {
+        xil_printf("ERROR: Writing %s\r\n", out.name);
+        return -1;
+    }
+#else
+    FIL *fp_out = createFile((char *)out.name, bytes);
+    if (!fp_out) {
+        xil_printf("ERROR: creating %s\r\n", out.name);
+        return -1;
+    }
+    int rc = writeFile(fp_out, bytes, out.addr);
+    closeFile(fp_out);
+    if (rc != (int)bytes) {
+        xil_printf("ERROR: Writing %s\r\n", out.name);
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+// ==========================================================================
+// Part 2: Split COMP.bin -> HEADER.txt / HMCODES.txt / OUTPUT.txt
+// ==========================================================================
+
+// Binary decode tree for the packed payload: child index per bit,
+// a leaf is stored as -1 - symbol, 0 means "no child".
+static int16_t dec_tree[2 * 256][2];
+static int dec_tree_nodes;
+
+static int dec_tree_insert(uint8_t symbol, uint32_t code, int len) {
+    int node = 0;
+    for (int b = len - 1; b >= 0; b--) {
+        int bit = (code >> b) & 1;
+        int16_t next = dec_tree[node][bit];
+        if (b == 0) {
+            if (next != 0) return -1;                // code already used
+            dec_tree[node][bit] = (int16_t)(-1 - symbol);
+        } else {
+            if (next < 0) return -1;                 // prefix is a leaf
+            if (next == 0) {
+                if (dec_tree_nodes >= 2 * 256) return -1;
+                next = (int16_t)dec_tree_nodes++;
+                dec_tree[node][bit] = next;
+            }
+            node = next;
+        }
+    }
+    return 0;
+}
+
+// Set once split_comp_bin() has written SYMIN/CODWIN/CODLEN straight
+// from a binary codebook, so HMCODES.txt need not be parsed again.
+static int codebook_tables_ready = 0;
+
+// Symbols and bits of the packed payload, for decompress_packed_stream()
+static uint32_t packed_symbol_count = 0;
+static uint32_t packed_payload_bits = 0;
+
+// Run result of the single-pass pipelines (perf.h); peak = DDR buffer bytes in use
+static void record_run(u32 archive_bytes, u32 out_bytes, const CompBinHeader *hdr, u32 peak) {
+    perf_run.input        = archive_name;
+    perf_run.plain_bytes  = out_bytes;
+    perf_run.packed_bytes = archive_bytes;
+    perf_run.symbols      = hdr->symbol_count;
+    perf_run.payload_bits = hdr->payload_bits;
+    perf_run.peak_bytes   = peak;
+}
+
+// Archive header flags (0 for the legacy text archive), for
+// merge_header_and_data()
+static u16 archive_flags = 0;
+static u8  archive_escape = 0;   // CompBinZrle escape (COMPBIN_FLAG_ZRLE)
+
+// Codebooks resident in the decoder: the stream decoder keeps a lookup
+// table per bank, huffman_decoder only bank 0. Each entry holds the
+// codebook_id() of the canonical codebook in that bank (0: none, or
+// explicit codewords) and its lengths, so a codebook that is already
+// loaded is selected rather than written again (select_codebook) and a
+// resident trained codebook is not read from the card again.
+static struct {
+    u32 id;
+    u32 last_use;           // resident_clock when last selected
+    u8  lengths[256];
+} resident[DECODER_BANKS];
+static u32 resident_clock = 0;
+static u32 current_bank   = 0;  // bank the decoder reads from
+
+#if AMP_MODE
+// Through CPU1 into RBT_BUF_ADDR, which is free until the output is
+// formatted; the archive has been read in full by then
+static int read_codebook_file(const char *name, CodebookFile *cb) {
+    u32 size, ready;
+    if (amp_open_input(name, &size) != 0 || size != sizeof(*cb) ||
+        amp_read_input(RBT_BUF_ADDR, size) != 0 || amp_input_wait(size, &ready) != 0)
+        return -1;
+    memcpy(cb, (const void *)RBT_BUF_ADDR, sizeof(*cb));
+    return 0;
+}
+#else
+static int read_codebook_file(const char *name, CodebookFile *cb) {
+    FIL *f = openFile((char *)name, 'r');
+    if (!f)
+        return -1;
+    int n = f_size(f) == sizeof(*cb) ? readChunk(f, (u32)cb, sizeof(*cb)) : -1;
+    closeFile(f);
+    return n == (int)sizeof(*cb) ? 0 : -1;
+}
+#endif
+
+// Lengths of trained codebook id (COMPBIN_FLAG_TRAINED): from the bank
+// that holds it, else from its file on the card
+static int trained_lengths(u32 id, u8 *lengths) {
+    static CodebookFile cb;
+    char name[CODEBOOK_NAME_MAX];
+
+    for (int b = 0; b < DECODER_BANKS; b++) {
+        if (resident[b].id == id) {
+            memcpy(lengths, resident[b].lengths, 256);
+            return 0;
+        }
+    }
+
+    codebook_file_name(id, name);
+    if (read_codebook_file(name, &cb) != 0 || codebook_file_check(&cb, id) != 0) {
+        xil_printf("ERROR: trained codebook %s missing or invalid\r\n", name);
+        return -1;
+    }
+    memcpy(lengths, cb.lengths, 256);
+    xil_printf("Trained codebook %s read from the card\r\n", name);
+    return 0;
+}
+
+// SYMIN / CODWIN / CODLEN in the layout load_huffman_table_from_files() reads
+static int write_table_files(const u8 *lengths, const u32 *codes) {
+    LineWriter fsym = {0}, fcode = {0}, flen = {0};
+
+    if (openWriter(&fsym,  SYMIN_FILE,   'w') != XST_SUCCESS ||
+        openWriter(&fcode, CODEWIN_FILE, 'w') != XST_SUCCESS ||
+        openWriter(&flen,  CODELEN_FILE, 'w') != XST_SUCCESS) {
+        xil_printf("ERROR: creating Huffman helper files\r\n");
+        closeWriter(&fsym);
+        closeWriter(&fcode);
+        closeWriter(&flen);
+        return -1;
+    }
+
+    char sym8[9], code16[17], len5[6];
+    for (int s = 0; s < 256; s++) {
+        if (!lengths[s]) continue;
+        uint_to_binstr((uint32_t)s, 8, sym8);
+        uint_to_binstr(codes[s], 16, code16);
+        uint_to_binstr(lengths[s], 5, len5);
+        writeLine(&fsym, sym8, 8);
+        writeLine(&fcode, code16, 16);
+        writeLine(&flen, len5, 5);
+    }
+
+    int rc = closeWriter(&fsym);
+    rc |= closeWriter(&fcode);
+    rc |= closeWriter(&flen);
+    return rc == XST_SUCCESS ? 0 : -1;
+}
+
+// Packed payload -> PAYLOAD_FILE, unchanged, for the stream decoder
+static int copy_payload_words(FIL *fp_in, const CompBinHeader *hdr,
+                              u8 *buffer, UINT bsz) {
+    FIL *fp_payload = createFile(PAYLOAD_FILE, hdr->payload_words * 4);
+    if (!fp_payload) {
+        xil_printf("ERROR: creating %s\r\n", PAYLOAD_FILE);
+        return -1;
+    }
+
+    UINT br;
+    u32 remaining = hdr->payload_words * 4;
+    while (remaining > 0) {
+        UINT chunk = remaining < bsz ? remaining : bsz;
+        if (f_read(fp_in, buffer, chunk, &br) != FR_OK || br != chunk) {
+            xil_printf("ERROR: truncated payload in %s\r\n", DECRYPTED_FILE);
+            closeFile(fp_payload);
+            return -1;
+        }
+        if (writeFile(fp_payload, br, (u32)buffer) != (int)br) {
+            xil_printf("ERROR: writing %s\r\n", PAYLOAD_FILE);
+            closeFile(fp_payload);
+            return -1;
+        }
+        remaining -= br;
+    }
+
+    if (closeFile(fp_payload) != XST_SUCCESS) {
+        xil_printf("ERROR: closing %s\r\n", PAYLOAD_FILE);
         return -1;
     }
+    packed_symbol_count = hdr->symbol_count;
+    packed_payload_bits = hdr->payload_bits;
+    return 0;
+}
+
+// Header fields this decompressor can handle
+static int compbin_header_ok(const CompBinHeader *hdr) {
+    return hdr->magic == COMPBIN_MAGIC &&
+           hdr->version == COMPBIN_VERSION &&
+           hdr->header_bytes >= sizeof(CompBinHeader) +
+                                ((hdr->flags & COMPBIN_FLAG_ZRLE) ? sizeof(CompBinZrle) : 0) +
+                                ((hdr->flags & COMPBIN_FLAG_BLOCKS) ? sizeof(CompBinBlocks) : 0) &&
+           !(hdr->flags & ~COMPBIN_KNOWN_FLAGS) &&
+           (!(hdr->flags & COMPBIN_FLAG_TRAINED) || (hdr->flags & COMPBIN_FLAG_CANONICAL)) &&
+           (!(hdr->flags & COMPBIN_FLAG_PAYLOAD_CRC) || (hdr->flags & COMPBIN_FLAG_BLOCKS)) &&
+           hdr->codebook_entries != 0 && hdr->codebook_entries <= 256;
+}
+
+static u32 compbin_codebook_bytes(const CompBinHeader *hdr) {
+    if (hdr->flags & COMPBIN_FLAG_TRAINED)
+        return sizeof(CompBinTrained);
+    return (hdr->flags & COMPBIN_FLAG_CANONICAL)
+               ? 256 : hdr->codebook_entries * sizeof(CompBinCodeEntry);
+}
+
+// Residency key of an archive's codebook; explicit codewords have none
+static u32 archive_codebook_id(const CompBinHeader *hdr, const u8 *lengths) {
+    return (hdr->flags & COMPBIN_FLAG_CANONICAL) ? codebook_id(lengths) : 0;
+}
+
+// Codebook and payload offsets of an archive held in memory (size
+// bytes); fails if a section runs past the end or the words would not
+// fit one DDR buffer
+static int compbin_sections(const CompBinHeader *hdr, u32 size,
+                            u32 *cb_off, u32 *payload_off) {
+    *cb_off      = hdr->header_bytes + COMPBIN_PAD4(hdr->rbt_header_bytes);
+    *payload_off = *cb_off + compbin_codebook_bytes(hdr);
+
+    // Zero-run tokens are decoded to RBT_BUF_ADDR and expanded from there
+    int tokens_ok = (hdr->flags & COMPBIN_FLAG_ZRLE)
+                        ? hdr->symbol_count <= ZRLE_MAX_TOKENS(hdr->word_count) &&
+                          hdr->symbol_count <= RBT_MAX_BYTES
+                        : hdr->symbol_count == hdr->word_count * 4;
+    if (*payload_off + hdr->payload_words * 4 > size ||
+        hdr->word_count * 4 > DMA_MAX_BYTES || !tokens_ok) {
+        xil_printf("ERROR: inconsistent section sizes in %s\r\n", archive_name);
+        return -1;
+    }
+    return 0;
+}
+
+// Per-symbol codebook -> dec_tree; rejects codes the IPs cannot hold
+static int build_decode_tree(const u8 *lengths, const u32 *codes) {
+    memset(dec_tree, 0, sizeof(dec_tree));
+    dec_tree_nodes = 1;
+
+    for (int s = 0; s < 256; s++) {
+        int len = lengths[s];
+        if (!len) continue;
+        if (len > 16 || dec_tree_insert((uint8_t)s, codes[s], len) != 0) {
+            xil_printf("ERROR: invalid codebook entry for symbol %02X\r\n", s);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// The stream decoder IP resolves every codeword with one table lookup
+static int stream_lut_fits(const u8 *lengths) {
+    for (int s = 0; s < 256; s++) {
+        if (lengths[s] > STREAM_LUT_BITS) {
+            xil_printf("ERROR: %d-bit codeword exceeds the %d-bit decode table;"
+                       " compress with MAX_CODE_LEN <= %d\r\n",
+                       lengths[s], STREAM_LUT_BITS, STREAM_LUT_BITS);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Codebook section (already decrypted) -> per-symbol lengths and codewords
+static int codebook_from_section(const CompBinHeader *hdr, const u8 *section,
+                                 u8 *lengths, u32 *codes) {
+    if (hdr->flags & COMPBIN_FLAG_CANONICAL) {
+        if (hdr->flags & COMPBIN_FLAG_TRAINED) {
+            CompBinTrained t;
+            memcpy(&t, section, sizeof(t));
+            if (trained_lengths(t.codebook_id, lengths) != 0)
+                return -1;
+        } else {
+            memcpy(lengths, section, 256);
+        }
+        if (codebook_canonical(lengths, codes) != 0) {
+            xil_printf("ERROR: invalid canonical code lengths\r\n");
+            return -1;
+        }
+        return 0;
+    }
+
+    const CompBinCodeEntry *entries = (const CompBinCodeEntry *)section;
+    memset(lengths, 0, 256);
+    for (u32 e = 0; e < hdr->codebook_entries; e++) {
+        lengths[entries[e].symbol] = entries[e].length;
+        codes[entries[e].symbol]   = entries[e].code;
+    }
+    return 0;
+}
+
+// One entry of the block index, as the block decoders walk it
+typedef struct {
+    CompBinBlock blk;
+    u32 w0, n_words;        // configuration words of the block
+    const u32 *data;        // its codewords (after the local lengths)
+    const u8  *lengths;     // local code lengths, or NULL
+    int has_payload_crc;    // COMPBIN_FLAG_PAYLOAD_CRC
+    u32 payload_crc;        // CRC of the codeword words, see compbin.h
+} BlockRef;
+
+static CompBinBlocks block_hdr;
+static u32 block_index_off;
+static u32 block_crc_off;   // payload CRCs, 0 without COMPBIN_FLAG_PAYLOAD_CRC
+
+static void block_ref(const CompBinHeader *hdr, const u8 *archive, u32 payload_off,
+                      u32 b, BlockRef *r) {
+    memcpy(&r->blk, archive + block_index_off + b * sizeof(CompBinBlock), sizeof(CompBinBlock));
+    r->w0 = b * block_hdr.block_words;
+    r->n_words = hdr->word_count - r->w0 < block_hdr.block_words ? hdr->word_count - r->w0
+                                                                  : block_hdr.block_words;
+    r->data = (const u32 *)(archive + payload_off) + r->blk.offset;
+    r->lengths = NULL;
+    if (r->blk.flags & COMPBIN_BLOCK_LOCAL) {
+        r->lengths = (const u8 *)r->data;
+        r->data += COMPBIN_LOCAL_CODEBOOK_WORDS;
+    }
+    r->has_payload_crc = block_crc_off != 0;
+    r->payload_crc = 0;
+    if (r->has_payload_crc)
+        memcpy(&r->payload_crc, archive + block_crc_off + b * 4, 4);
+}
+
+static void block_error(u32 b, s32 status, const BlockRef *r) {
+    if (status == AMP_JOB_DECODE)
+        xil_printf("ERROR: block %lu does not decode\r\n", (unsigned long)b);
+    else if (status == AMP_JOB_EXPAND)
+        xil_printf("ERROR: zero-run tokens of block %lu do not expand to %lu symbols\r\n",
+                   (unsigned long)b, (unsigned long)r->n_words * 4);
+    else if (status == AMP_JOB_PAYLOAD)
+        xil_printf("ERROR: payload CRC mismatch in block %lu, the archive is corrupted\r\n",
+                   (unsigned long)b);
+    else
+        xil_printf("ERROR: CRC mismatch in block %lu (words %lu-%lu)\r\n",
+                   (unsigned long)b, (unsigned long)r->w0,
+                   (unsigned long)(r->w0 + r->n_words - 1));
+}
 
+// COMPBIN_FLAG_BLOCKS: block index of an archive whose header sections
+// are decrypted, checked against the header; counts the blocks with a
+// local codebook into *n_local
+static int block_index(const CompBinHeader *hdr, const u8 *archive, u32 payload_off,
+                       u32 *n_local) {
+    int zrle = (hdr->flags & COMPBIN_FLAG_ZRLE) != 0;
+    block_index_off = sizeof(CompBinHeader) + (zrle ? sizeof(CompBinZrle) : 0);
+    memcpy(&block_hdr, archive + block_index_off, sizeof(block_hdr));
+    block_index_off += sizeof(block_hdr);
+
+    u32 record_bytes = sizeof(CompBinBlock) + ((hdr->flags & COMPBIN_FLAG_PAYLOAD_CRC) ? 4 : 0);
+    if (block_hdr.block_words == 0 ||
+        block_hdr.block_count !=
+            (u32)(((u64)hdr->word_count + block_hdr.block_words - 1) / block_hdr.block_words) ||
+        (u64)block_hdr.block_count * record_bytes > hdr->header_bytes - block_index_off) {
+        xil_printf("ERROR: inconsistent block index in %s\r\n", archive_name);
+        return -1;
+    }
+    block_crc_off = (hdr->flags & COMPBIN_FLAG_PAYLOAD_CRC)
+                        ? block_index_off + block_hdr.block_count * sizeof(CompBinBlock) : 0;
+
+    // Whole index first, so any core can take any block
+    u32 n_tokens = 0;
+    *n_local = 0;
+    for (u32 b = 0; b < block_hdr.block_count; b++) {
+        BlockRef r;
+        block_ref(hdr, archive, payload_off, b, &r);
+        u64 end = (u64)r.blk.offset + (r.lengths ? COMPBIN_LOCAL_CODEBOOK_WORDS : 0) +
+                  ((u64)r.blk.payload_bits + 31) / 32;
+
+        if (end > hdr->payload_words ||
+            r.blk.symbol_count > hdr->symbol_count - n_tokens ||
+            (!zrle && r.blk.symbol_count != r.n_words * 4)) {
+            xil_printf("ERROR: block %lu does not fit the archive\r\n", (unsigned long)b);
+            return -1;
+        }
+        n_tokens += r.blk.symbol_count;
+        *n_local += r.lengths != NULL;
+    }
+    if (n_tokens != hdr->symbol_count) {
+        xil_printf("ERROR: blocks hold %lu symbols, header says %lu\r\n",
+                   (unsigned long)n_tokens, (unsigned long)hdr->symbol_count);
+        return -1;
+    }
+    return 0;
+}
 
+// Packed archive: rebuild the same files the text split produces,
+// so the IP stages below are unchanged.
+static int split_packed_comp_bin(FIL *fp_in, LineWriter *fp_header,
+                                 LineWriter *fp_codes, LineWriter *fp_output) {
+    CompBinHeader hdr;
+    UINT br;
+    const UINT BSZ = 4096;
+    static u8 buffer[4096];
+    static u8  lengths[256];
+    static u32 codes[256];
     char line[MAX_LINE_LEN];
+
+    f_lseek(fp_in, 0);
+    if (f_read(fp_in, &hdr, sizeof(hdr), &br) != FR_OK || br != sizeof(hdr) ||
+        !compbin_header_ok(&hdr)) {
+        xil_printf("ERROR: unsupported %s header (version %u)\r\n",
+                   DECRYPTED_FILE, hdr.version);
+        return -1;
+    }
+
+    xil_printf("---- Packed archive v%u: %lu symbols, %lu payload bits ----\r\n",
+               hdr.version, (unsigned long)hdr.symbol_count,
+               (unsigned long)hdr.payload_bits);
+    archive_flags = hdr.flags;
+
+    if (hdr.flags & COMPBIN_FLAG_BLOCKS) {
+        xil_printf("ERROR: block archives need STAGE_FILES = 0\r\n");
+        return -1;
+    }
+
+    if (hdr.flags & COMPBIN_FLAG_ZRLE) {
+        CompBinZrle z;
+        if (f_read(fp_in, &z, sizeof(z), &br) != FR_OK || br != sizeof(z)) {
+            xil_printf("ERROR: truncated zero-run record in %s\r\n", DECRYPTED_FILE);
+            return -1;
+        }
+        archive_escape = z.escape;
+    }
+
+    // Bitstream header section, copied verbatim
+    f_lseek(fp_in, hdr.header_bytes);
+    u32 remaining = hdr.rbt_header_bytes;
+    while (remaining > 0) {
+        UINT chunk = remaining < BSZ ? remaining : BSZ;
+        if (f_read(fp_in, buffer, chunk, &br) != FR_OK || br != chunk) {
+            xil_printf("ERROR: truncated header section in %s\r\n", DECRYPTED_FILE);
+            return -1;
+        }
+        writeBuffered(fp_header, buffer, br);
+        remaining -= br;
+    }
+
+    // Codebook section -> per-symbol lengths and codewords
+    f_lseek(fp_in, hdr.header_bytes + COMPBIN_PAD4(hdr.rbt_header_bytes));
+    UINT cb_bytes = compbin_codebook_bytes(&hdr);
+    if (f_read(fp_in, buffer, cb_bytes, &br) != FR_OK || br != cb_bytes) {
+        xil_printf("ERROR: truncated codebook section in %s\r\n", DECRYPTED_FILE);
+        return -1;
+    }
+    if (codebook_from_section(&hdr, buffer, lengths, codes) != 0)
+        return -1;
+
+    // Codebook -> HMCODES.txt table, helper files and decode tree
+    const char *table_hdr = "Symbol       Codeword         Length\r\n"
+                            "--------------------------------------\r\n";
+    writeBuffered(fp_codes, table_hdr, strlen(table_hdr));
+
+    if (build_decode_tree(lengths, codes) != 0)
+        return -1;
+
+    for (int s = 0; s < 256; s++) {
+        char sym_bin[9], code_bin[33];
+        int len = lengths[s];
+        if (!len) continue;
+        uint_to_binstr((uint32_t)s, 8, sym_bin);
+        uint_to_binstr(codes[s], len, code_bin);
+        int n = sprintf(line, "%-10s %-20s %2d\r\n", sym_bin, code_bin, len);
+        writeBuffered(fp_codes, line, n);
+    }
+
+    if (write_table_files(lengths, codes) != 0)
+        return -1;
+    codebook_tables_ready = 1;
+
+    if (STREAM_DECODER) {
+        // The stream decoder IP consumes the packed words as they are
+        if (!stream_lut_fits(lengths))
+            return -1;
+        return copy_payload_words(fp_in, &hdr, buffer, BSZ);
+    }
+
+    // Packed payload -> one codeword per line in OUTPUT.txt
+    uint32_t bits_left = hdr.payload_bits;
+    uint32_t symbols = 0;
+    uint32_t code = 0;
+    int code_len = 0;
+    int node = 0;
+
+    while (bits_left > 0) {
+        if (f_read(fp_in, buffer, BSZ, &br) != FR_OK || br < 4) {
+            xil_printf("ERROR: truncated payload in %s\r\n", DECRYPTED_FILE);
+            return -1;
+        }
+        const u32 *words = (const u32 *)buffer;
+        for (UINT w = 0; w < br / 4 && bits_left > 0; w++) {
+            u32 word = words[w];
+            int nbits = bits_left < 32 ? (int)bits_left : 32;
+            for (int b = 31; b > 31 - nbits; b--) {
+                int bit = (word >> b) & 1;
+                int16_t next = dec_tree[node][bit];
+                code = (code << 1) | bit;
+                code_len++;
+                if (next == 0) {
+                    xil_printf("ERROR: invalid codeword at symbol %lu\r\n",
+                               (unsigned long)symbols);
+                    return -1;
+                }
+                if (next < 0) {
+                    uint_to_binstr(code, code_len, line);
+                    writeLine(fp_output, line, code_len);
+                    symbols++;
+                    code = 0;
+                    code_len = 0;
+                    node = 0;
+                } else {
+                    node = next;
+                }
+            }
+            bits_left -= nbits;
+        }
+    }
+
+    if (symbols != hdr.symbol_count) {
+        xil_printf("WARN: decoded %lu symbols, header says %lu\r\n",
+                   (unsigned long)symbols, (unsigned long)hdr.symbol_count);
+    }
+    return 0;
+}
+
+int split_comp_bin() {
+    FIL *fp_in = openFile(DECRYPTED_FILE, 'r');   // COMP.bin
+    LineWriter fp_header = {0};                   // HEADER.txt
+    LineWriter fp_codes  = {0};                   // HMCODES.txt
+    LineWriter fp_output = {0};                   // OUTPUT.txt
+    LineReader fp_text   = {0};                   // COMP.bin, legacy text layout
+    int rc = -1;
+
+    if (!fp_in ||
+        openWriter(&fp_header, HEADER_FILE,   'w') != XST_SUCCESS ||
+        openWriter(&fp_codes,  CODEBOOK_FILE, 'w') != XST_SUCCESS ||
+        openWriter(&fp_output, OUTPUT_FILE,   'w') != XST_SUCCESS) {
+        xil_printf("ERROR: opening COMP.bin or creating output files\r\n");
+        goto split_end;
+    }
+
+    // Packed archives start with COMPBIN_MAGIC; anything else is the
+    // legacy text layout.
+    u32 magic = 0;
+    UINT br;
+    if (f_read(fp_in, &magic, sizeof(magic), &br) == FR_OK &&
+        br == sizeof(magic) && magic == COMPBIN_MAGIC) {
+        rc = split_packed_comp_bin(fp_in, &fp_header, &fp_codes, &fp_output);
+        goto split_end;
+    }
+
+    if (STREAM_DECODER) {
+        xil_printf("ERROR: legacy text archive needs STREAM_DECODER = 0\r\n");
+        goto split_end;
+    }
+
+    closeFile(fp_in);
+    fp_in = NULL;
+    if (openReader(&fp_text, DECRYPTED_FILE) != XST_SUCCESS)
+        goto split_end;
+
+    char *line;
+    int len;
     int state = 0; // 0=header, 1=codebook, 2=output
 
-    while (f_readline(fp_in, line, MAX_LINE_LEN)) {
+    while ((len = readLine(&fp_text, &line)) >= 0) {
         if (state == 0) {
             // Look for start of HMCODES section
             if (strncmp(line, "Symbol", 6) == 0) {
                 state = 1;
-                writeFile(fp_codes, strlen(line), (u32)line);
-                writeFile(fp_codes, 2, (u32)"\r\n");
+                writeLine(&fp_codes, line, len);
             } else {
-                writeFile(fp_header, strlen(line), (u32)line);
-                writeFile(fp_header, 2, (u32)"\r\n");
+                writeLine(&fp_header, line, len);
             }
         }
         else if (state == 1) {
@@ -241,58 +1039,62 @@ int split_comp_bin() {
 
             if (token_count == 1 && is_binstr(line)) {
                 state = 2;
-                writeFile(fp_output, strlen(line), (u32)line);
-                writeFile(fp_output, 2, (u32)"\r\n");
+                writeLine(&fp_output, line, len);
             } else {
-                writeFile(fp_codes, strlen(line), (u32)line);
-                writeFile(fp_codes, 2, (u32)"\r\n");
+                writeLine(&fp_codes, line, len);
             }
         }
         else if (state == 2) {
             // All remaining lines are OUTPUT stream
-            writeFile(fp_output, strlen(line), (u32)line);
-            writeFile(fp_output, 2, (u32)"\r\n");
+            writeLine(&fp_output, line, len);
         }
     }
-
-    closeFile(fp_in);
-    closeFile(fp_header);
-    closeFile(fp_codes);
-    closeFile(fp_output);
-
-    return 0;
+    rc = 0;
+
+split_end:
+    if (fp_in) closeFile(fp_in);
+    closeReader(&fp_text);
+    if (closeWriter(&fp_header) != XST_SUCCESS ||
+        closeWriter(&fp_codes)  != XST_SUCCESS ||
+        closeWriter(&fp_output) != XST_SUCCESS)
+        rc = -1;
+    return rc;
 }
 
 // ==========================================================================
 // Part 3: Generate SYMIN / CODEWIN / CODELEN from HMCODES.TXT
 // ==========================================================================
 int generate_huffman_table_files_from_HMCODES() {
-    FIL *fin   = openFile(CODEBOOK_FILE, 'r');   // HMCODES.TXT
-    FIL *fsym  = openFile(SYMIN_FILE,    'w');   // SYMIN.txt
-    FIL *fcode = openFile(CODEWIN_FILE,  'w');   // CODEWIN.txt
-    FIL *flen  = openFile(CODELEN_FILE,  'w');   // CODELEN.txt
-
-    if (!fin || !fsym || !fcode || !flen) {
+    // Already written from the binary codebook by split_comp_bin()
+    if (codebook_tables_ready)
+        return 0;
+
+    LineReader fin   = {0};   // HMCODES.TXT
+    LineWriter fsym  = {0};   // SYMIN.txt
+    LineWriter fcode = {0};   // CODEWIN.txt
+    LineWriter flen  = {0};   // CODELEN.txt
+    int rc = -1;
+
+    if (openReader(&fin, CODEBOOK_FILE) != XST_SUCCESS ||
+        openWriter(&fsym,  SYMIN_FILE,   'w') != XST_SUCCESS ||
+        openWriter(&fcode, CODEWIN_FILE, 'w') != XST_SUCCESS ||
+        openWriter(&flen,  CODELEN_FILE, 'w') != XST_SUCCESS) {
         xil_printf("ERROR: opening %s or creating output files\r\n", CODEBOOK_FILE);
-        if (fin)   closeFile(fin);
-        if (fsym)  closeFile(fsym);
-        if (fcode) closeFile(fcode);
-        if (flen)  closeFile(flen);
-        return -1;
+        goto table_end;
     }
 
-    char line[MAX_LINE_LEN];
+    char *line;
     char symbol[64], codeword[128], lenstr[64];
     xil_printf("---- Regenerating Helper Files ----\r\n");
 
     // Skip header line if present
-    if (f_readline(fin, line, MAX_LINE_LEN)) {
+    if (readLine(&fin, &line) >= 0) {
         if (strncmp(line, "Symbol", 6) == 0)
-            f_readline(fin, line, MAX_LINE_LEN);
+            readLine(&fin, &line);
     }
 
     uint32_t count = 0;
-    while (f_readline(fin, line, MAX_LINE_LEN)) {
+    while (readLine(&fin, &line) >= 0) {
         rstrip(line);
         if (!line[0]) continue;
 
@@ -321,11 +1123,10 @@ int generate_huffman_table_files_from_HMCODES() {
         int cwlen = strlen(codeword);
         if (cwlen > 16) {
             xil_printf("WARN: codeword >16 bits\r\n");
-            return -1;
+            goto table_end;
         }
 
-        writeFile(fsym, 8, (u32)symbol);
-        writeFile(fsym, 2, (u32)"\r\n");
+        writeLine(&fsym, symbol, 8);
 
         uint32_t codeval = 0;
         for (int c=0; codeword[c]; c++)
@@ -333,46 +1134,46 @@ int generate_huffman_table_files_from_HMCODES() {
 
         char code16[17];
         uint_to_binstr(codeval,16,code16);
-        writeFile(fcode,16,(u32)code16);
-        writeFile(fcode,2,(u32)"\r\n");
+        writeLine(&fcode, code16, 16);
 
         char len5[6];
         uint_to_binstr((uint32_t)length,5,len5);
-        writeFile(flen,5,(u32)len5);
-        writeFile(flen,2,(u32)"\r\n");
+        writeLine(&flen, len5, 5);
 
         if ((++count % 1000)==0)
             xil_printf("  %lu entries...\r\n",(unsigned long)count);
     }
-
-    closeFile(fin);
-    closeFile(fsym);
-    closeFile(fcode);
-    closeFile(flen);
-
-    return 0;
+    rc = 0;
+
+table_end:
+    closeReader(&fin);
+    if (closeWriter(&fsym)  != XST_SUCCESS ||
+        closeWriter(&fcode) != XST_SUCCESS ||
+        closeWriter(&flen)  != XST_SUCCESS)
+        rc = -1;
+    return rc;
 }
 
 // ==========================================================================
 // Part 4: Generate OUTCW / OUTLEN from OUTPUT.txt
 // ==========================================================================
 int generate_out_stream_files_from_OUTPUT() {
-    FIL *fin  = openFile(OUTPUT_FILE,  'r');   // OUTPUT.txt
-    FIL *fcw  = openFile(OUTCW_FILE,   'w');   // OUTCW.txt
-    FIL *flen = openFile(OUTLEN_FILE,  'w');   // OUTLEN.txt
-
-    if (!fin || !fcw || !flen) {
+    LineReader fin  = {0};   // OUTPUT.txt
+    LineWriter fcw  = {0};   // OUTCW.txt
+    LineWriter flen = {0};   // OUTLEN.txt
+    int rc = -1;
+
+    if (openReader(&fin, OUTPUT_FILE) != XST_SUCCESS ||
+        openWriter(&fcw,  OUTCW_FILE,  'w') != XST_SUCCESS ||
+        openWriter(&flen, OUTLEN_FILE, 'w') != XST_SUCCESS) {
         xil_printf("ERROR: opening %s or creating helper files\r\n", OUTPUT_FILE);
-        if (fin)  closeFile(fin);
-        if (fcw)  closeFile(fcw);
-        if (flen) closeFile(flen);
-        return -1;
+        goto stream_files_end;
     }
 
-    char line[MAX_LINE_LEN];
+    char *line;
     uint32_t total = 0;
 
-    while (f_readline(fin, line, MAX_LINE_LEN)) {
+    while (readLine(&fin, &line) >= 0) {
         rstrip(line);
 
         // Keep only 0/1 characters
@@ -387,10 +1188,7 @@ int generate_out_stream_files_from_OUTPUT() {
         int len = strlen(line);
         if (len > 16) {
             xil_printf("ERROR: Codeword longer than 16 bits in %s\r\n", OUTPUT_FILE);
-            closeFile(fin);
-            closeFile(fcw);
-            closeFile(flen);
-            return -1;
+            goto stream_files_end;
         }
 
         // Convert binary string to int
@@ -401,83 +1199,128 @@ int generate_out_stream_files_from_OUTPUT() {
         // Write 16-bit codeword
         char code16[17];
         uint_to_binstr(codeval, 16, code16);
-        writeFile(fcw, 16, (u32)code16);
-        writeFile(fcw, 2, (u32)"\r\n");
+        writeLine(&fcw, code16, 16);
 
         // Write 5-bit length
         char len5[6];
         uint_to_binstr((uint32_t)len, 5, len5);
-        writeFile(flen, 5, (u32)len5);
-        writeFile(flen, 2, (u32)"\r\n");
+        writeLine(&flen, len5, 5);
     }
-
-    closeFile(fin);
-    closeFile(fcw);
-    closeFile(flen);
-
+    rc = 0;
     xil_printf("---- Helper Files Regenerated ----\r\n",
                OUTPUT_FILE, (unsigned long)total);
-    return 0;
+
+stream_files_end:
+    closeReader(&fin);
+    if (closeWriter(&fcw) != XST_SUCCESS || closeWriter(&flen) != XST_SUCCESS)
+        rc = -1;
+    return rc;
 }
 
 // ==========================================================================
 // Part 5: Load Huffman Table into Huffman Decompressor IP
 // ==========================================================================
+// Whole codebook into the decoder at base (Huffman decoder IP or
+// stream chain, same table window): one posted write per symbol,
+// length 0 for unused ones. A stream decoder then fills its lookup
+// table from the window on the commit, one slot per clock (at most
+// 2^STREAM_LUT_BITS + 512 cycles); huffman_decoder needs no commit.
+static int load_codebook(u32 base, const uint8_t *lengths, const uint32_t *codes, int stream) {
+    for (int s = 0; s < 256; s++)
+        Xil_Out32(base + REG_TABLE_BASE + 4 * s,
+                  lengths[s] ? ((u32)lengths[s] << 16) | (codes[s] & 0xFFFF) : 0);
+    if (!stream)
+        return 0;
+
+    Xil_Out32(base + REG_TABLE_COMMIT, 1);
+    Xil_Out32(base + REG_TABLE_COMMIT, 0);
+
+    u32 status, to = STREAM_TIMEOUT;
+    while (((status = Xil_In32(base + REG_SD_STATUS)) & SD_STATUS_TABLE_BUSY) && --to)
+        ;
+    perf_polls(STREAM_TIMEOUT - to);
+    if (!to || (status & SD_STATUS_ERROR)) {
+        xil_printf("ERROR: %s filling the decode table\r\n", to ? "invalid entry" : "timeout");
+        return -1;
+    }
+    return 0;
+}
+
+// Codebook id (0: unknown) into the decoder at base. A bank that holds
+// id already is selected and nothing is written; otherwise the least
+// recently used bank is refilled. huffman_decoder has the one bank.
+static int select_codebook(u32 base, const u8 *lengths, const u32 *codes, int stream, u32 id) {
+    int banks = stream ? DECODER_BANKS : 1;
+    int bank = -1, victim = 0;
+
+    for (int b = 0; b < banks; b++) {
+        if (id && resident[b].id == id)
+            bank = b;
+        if (resident[b].last_use < resident[victim].last_use)
+            victim = b;
+    }
+    int hit = bank >= 0;
+    if (!hit)
+        bank = victim;
+
+    if (stream && (u32)bank != current_bank) {
+        Xil_Out32(base + REG_TABLE_BANK, bank);
+        current_bank = bank;
+    }
+    resident[bank].last_use = ++resident_clock;
+    if (hit) {
+        xil_printf("Codebook %08X resident in bank %d, load skipped\r\n", id, bank);
+        return 0;
+    }
+
+    resident[bank].id = 0;          // until the load has succeeded
+    if (load_codebook(base, lengths, codes, stream) != 0)
+        return -1;
+    resident[bank].id = id;
+    memcpy(resident[bank].lengths, lengths, 256);
+    return 0;
+}
+
 int load_huffman_table_from_files() {
-    FIL *fsym  = openFile(SYMIN_FILE,   'r');   // SYMIN.txt
-    FIL *fcode = openFile(CODEWIN_FILE, 'r');   // CODEWIN.txt
-    FIL *flen  = openFile(CODELEN_FILE, 'r');   // CODELEN.txt
+    LineReader fsym = {0}, fcode = {0}, flen = {0};   // SYMIN / CODEWIN / CODELEN
 
-    if (!fsym || !fcode || !flen) {
+    if (openReader(&fsym,  SYMIN_FILE)   != XST_SUCCESS ||
+        openReader(&fcode, CODEWIN_FILE) != XST_SUCCESS ||
+        openReader(&flen,  CODELEN_FILE) != XST_SUCCESS) {
         xil_printf("ERROR: opening Huffman helper files (%s, %s, %s)\r\n",
                    SYMIN_FILE, CODEWIN_FILE, CODELEN_FILE);
-        if (fsym)  closeFile(fsym);
-        if (fcode) closeFile(fcode);
-        if (flen)  closeFile(flen);
+        closeReader(&fsym);
+        closeReader(&fcode);
+        closeReader(&flen);
         return -1;
     }
 
-    char lsym[MAX_LINE_LEN], lcode[MAX_LINE_LEN], llen[MAX_LINE_LEN];
+    static uint8_t  lengths[256];
+    static uint32_t codes[256];
+    char *lsym, *lcode, *llen;
     xil_printf("---- Loading Huffman Table ----\r\n");
 
-    while (f_readline(fsym, lsym, MAX_LINE_LEN) &&
-           f_readline(fcode, lcode, MAX_LINE_LEN) &&
-           f_readline(flen, llen, MAX_LINE_LEN))
+    memset(lengths, 0, sizeof(lengths));
+    while (readLine(&fsym,  &lsym)  >= 0 &&
+           readLine(&fcode, &lcode) >= 0 &&
+           readLine(&flen,  &llen)  >= 0)
     {
         // Validate field lengths: 8-bit symbol, 16-bit codeword, 5-bit length
         if (strlen(lsym) != 8 || strlen(lcode) != 16 || strlen(llen) != 5)
             continue;
 
-        uint8_t  symbol = (uint8_t)binstr_to_int(lsym);
-        uint32_t code   = (uint32_t)binstr_to_int(lcode);
-        uint8_t  len    = (uint8_t)binstr_to_int(llen);
-
-        // Write entry into Huffman IP
-        IP_WRITE(REG_LOAD_SYMBOL, symbol);
-        IP_WRITE(REG_LOAD_CODE,   code);
-        IP_WRITE(REG_LOAD_LENGTH, len);
-        IP_WRITE(REG_LOAD_VALID,  1);
-
-        // Wait for done flag
-        int to = 10000;
-        while (!IP_READ(REG_LOAD_DONE) && to--)
-            usleep(10);
-
-        // Clear valid strobe
-        IP_WRITE(REG_LOAD_VALID, 0);
-
-        if (!to) {
-            xil_printf("Timeout loading symbol %02X\r\n", symbol);
-            closeFile(fsym);
-            closeFile(fcode);
-            closeFile(flen);
-            return -1;
-        }
+        uint8_t symbol = (uint8_t)binstr_to_int(lsym);
+        codes[symbol]   = (uint32_t)binstr_to_int(lcode);
+        lengths[symbol] = (uint8_t)binstr_to_int(llen);
     }
 
-    closeFile(fsym);
-    closeFile(fcode);
-    closeFile(flen);
+    closeReader(&fsym);
+    closeReader(&fcode);
+    closeReader(&flen);
+
+    // Whole table into the Huffman IP
+    if (load_codebook(HUFFDEC_BASE_ADDR, lengths, codes, STREAM_DECODER) != 0)
+        return -1;
 
     xil_printf("---- Huffman Table Loaded ----\r\n");
     return 0;
@@ -486,27 +1329,36 @@ int load_huffman_table_from_files() {
 // ==========================================================================
 // Part 6: Decompress OUTCW / OUTLEN -> PARRGN.txt
 // ==========================================================================
+// Send codeword + length to Huffman Decompressor IP, read back the symbol
+static uint8_t decode_codeword(uint32_t code, uint8_t len) {
+    IP_WRITE(REG_CODEWORD_IN, code);
+    IP_WRITE(REG_CODELEN_IN, len);
+    return IP_READ(REG_SYMBOL_OUT) & 0xFF;
+}
+
 int decompress_from_files() {
-    FIL *fcw  = openFile(OUTCW_FILE,  'r');   // OUTCW.txt
-    FIL *flen = openFile(OUTLEN_FILE, 'r');   // OUTLEN.txt
-    FIL *fout = openFile(PARRGN_FILE, 'w');   // PARRGN.txt
+    LineReader fcw  = {0};   // OUTCW.txt
+    LineReader flen = {0};   // OUTLEN.txt
+    LineWriter fout = {0};   // PARRGN.txt
 
-    if (!fcw || !flen || !fout) {
+    if (openReader(&fcw,  OUTCW_FILE)  != XST_SUCCESS ||
+        openReader(&flen, OUTLEN_FILE) != XST_SUCCESS ||
+        openWriter(&fout, PARRGN_FILE, 'w') != XST_SUCCESS) {
         xil_printf("ERROR: opening %s, %s or creating %s\r\n",
                    OUTCW_FILE, OUTLEN_FILE, PARRGN_FILE);
-        if (fcw)  closeFile(fcw);
-        if (flen) closeFile(flen);
-        if (fout) closeFile(fout);
+        closeReader(&fcw);
+        closeReader(&flen);
+        closeWriter(&fout);
         return -1;
     }
 
-    char lcode[MAX_LINE_LEN], llen[MAX_LINE_LEN], outbin[9];
+    char *lcode, *llen, outbin[9];
     uint32_t total = 0;
 
     xil_printf("---- Decompressing ----\r\n");
 
-    while (f_readline(fcw, lcode, MAX_LINE_LEN) &&
-           f_readline(flen, llen, MAX_LINE_LEN)) {
+    while (readLine(&fcw,  &lcode) >= 0 &&
+           readLine(&flen, &llen)  >= 0) {
 
         if (strlen(lcode) != 16 || strlen(llen) != 5) {
             xil_printf("WARN: bad widths in %s/%s; skipping\r\n",
@@ -517,73 +1369,206 @@ int decompress_from_files() {
         uint32_t code = (uint32_t)binstr_to_int(lcode);
         uint8_t  len  = (uint8_t)binstr_to_int(llen);
 
-        // Send codeword + length to Huffman Decompressor IP
-        IP_WRITE(REG_CODEWORD_IN, code);
-        IP_WRITE(REG_CODELEN_IN, len);
-
-        // Read back symbol
-        uint8_t sym = IP_READ(REG_SYMBOL_OUT) & 0xFF;
+        uint8_t sym = decode_codeword(code, len);
 
         // Write symbol (8-bit binary string) to output file
-        uint_to_binstr(sym, 8, outbin);
-        writeFile(fout, 8, (u32)outbin);
-        writeFile(fout, 2, (u32)"\r\n");
+        rbt_unpack_byte(sym, outbin);
+        writeLine(&fout, outbin, 8);
 
         if (++total % 500000 == 0)
             xil_printf("  %u symbols decompressed\r\n", total);
     }
 
-    closeFile(fcw);
-    closeFile(flen);
-    closeFile(fout);
+    closeReader(&fcw);
+    closeReader(&flen);
+    if (closeWriter(&fout) != XST_SUCCESS) {
+        xil_printf("ERROR: writing %s\r\n", PARRGN_FILE);
+        return -1;
+    }
 
     xil_printf("---- Decompression Done: %u symbols ----\r\n", total);
     return 0;
 }
 
+// ==========================================================================
+// Part 6b: Decode packed PAYLD.bin -> PARRGN.txt with the stream decoder
+// ==========================================================================
+// Pop one decoded symbol into PARRGN.txt, or into dst[index] when fout
+// is NULL; returns 1 if one was available
+static int sd_pop_symbol(LineWriter *fout, u8 *dst, u32 index) {
+    u32 out = IP_READ(REG_SD_SYMBOL_OUT);
+    if (!(out & SD_SYMBOL_VALID))
+        return 0;
+
+    if (!fout) {
+        dst[index] = out & 0xFF;
+        return 1;
+    }
+
+    char outbin[8];
+    rbt_unpack_byte(out & 0xFF, outbin);
+    writeLine(fout, outbin, 8);
+    return 1;
+}
+
+static void sd_start(u32 symbol_count) {
+    IP_WRITE(REG_SD_COUNT, symbol_count);
+    IP_WRITE(REG_SD_CTRL, 1);
+    IP_WRITE(REG_SD_CTRL, 0);
+}
+
+// Push n payload words, draining decoded symbols whenever the decoder
+// cannot take a word. Returns 1 once it is done (only pad words
+// remain), failed or timed out, 0 if it wants more words.
+static int sd_push_words(const u32 *words, u32 n, LineWriter *fout, u8 *dst,
+                         u32 *total, u32 *st) {
+    int to;
+    for (u32 w = 0; w < n; w++) {
+        for (to = STREAM_TIMEOUT; to > 0; to--) {
+            perf_polls(1);
+            *st = IP_READ(REG_SD_STATUS);
+            if (*st & SD_STATUS_ERROR)
+                return 1;
+            if (*st & SD_STATUS_SYMBOL_VALID) {
+                *total += sd_pop_symbol(fout, dst, *total);
+                if (*total % 500000 == 0)
+                    xil_printf("  %u symbols decompressed\r\n", *total);
+                continue;
+            }
+            if (*st & (SD_STATUS_WORD_READY | SD_STATUS_DONE))
+                break;
+        }
+        if (to == 0 || (*st & SD_STATUS_DONE))
+            return 1;
+
+        IP_WRITE(REG_SD_WORD_IN, words[w]);
+    }
+    return 0;
+}
+
+// Symbols decoded from the last words pushed; 0 once all have arrived
+static int sd_finish(LineWriter *fout, u8 *dst, u32 *total, u32 *st, u32 symbol_count) {
+    for (int to = STREAM_TIMEOUT; to > 0 && *total < symbol_count; to--) {
+        perf_polls(1);
+        *st = IP_READ(REG_SD_STATUS);
+        if (*st & SD_STATUS_ERROR)
+            break;
+        if (*st & SD_STATUS_SYMBOL_VALID)
+            *total += sd_pop_symbol(fout, dst, *total);
+    }
+
+    if (*st & SD_STATUS_ERROR)
+        xil_printf("ERROR: stream decoder reported an invalid codeword\r\n");
+    return (*total == symbol_count) ? 0 : -1;
+}
+
+int decompress_packed_stream() {
+    LineReader fin  = {0};   // PAYLD.bin
+    LineWriter fout = {0};   // PARRGN.txt
+
+    if (openReader(&fin, PAYLOAD_FILE) != XST_SUCCESS ||
+        openWriter(&fout, PARRGN_FILE, 'w') != XST_SUCCESS) {
+        xil_printf("ERROR: opening %s or creating %s\r\n",
+                   PAYLOAD_FILE, PARRGN_FILE);
+        closeReader(&fin);
+        closeWriter(&fout);
+        return -1;
+    }
+
+    const u8 *words;
+    uint32_t total = 0;
+    u32 st = 0;
+    u32 n;
+
+    xil_printf("---- Decompressing (stream decoder) ----\r\n");
+    sd_start(packed_symbol_count);
+
+    // Spans stay word aligned: the payload file is a whole number of
+    // words and every span but the last ends on an SD_BUF_SIZE block
+    while ((n = readSpan(&fin, &words, SD_BUF_SIZE)) > 0) {
+        if (sd_push_words((const u32 *)words, n / 4, &fout, NULL, &total, &st))
+            break;
+    }
+
+    int rc = sd_finish(&fout, NULL, &total, &st, packed_symbol_count);
+    xil_printf("---- Decompression Done: %u symbols ----\r\n", total);
+
+    closeReader(&fin);
+    if (closeWriter(&fout) != XST_SUCCESS)
+        rc = -1;
+    return rc;
+}
+
 // ==========================================================================
 // Part 7: Merge PARRGN -> MERGED.txt
 // ==========================================================================
+// Four symbols through the Merger IP -> one 32-bit word
+static uint32_t merge_four(const uint8_t *symbols) {
+    IP_WRITE8(SLV_REG0, symbols[0]);
+    IP_WRITE8(SLV_REG1, symbols[1]);
+    IP_WRITE8(SLV_REG2, symbols[2]);
+    IP_WRITE8(SLV_REG3, symbols[3]);
+    return IP_READ32(OUT_WORD_REG);
+}
+
+// Words in MERGED.txt, for the .bit header of merge_header_and_data()
+static uint32_t merged_word_count = 0;
+
 int merge_symbols_to_words() {
-    FIL *fp_in  = openFile(PARRGN_FILE, 'r');   // PARRGN.txt
-    FIL *fp_out = openFile(MERGED_FILE, 'w');   // MERGED.txt
+    LineReader fp_in  = {0};   // PARRGN.txt
+    LineWriter fp_out = {0};   // MERGED.txt
 
-    if (!fp_in || !fp_out) {
+    if (openReader(&fp_in, PARRGN_FILE) != XST_SUCCESS ||
+        openWriter(&fp_out, MERGED_FILE, 'w') != XST_SUCCESS) {
         xil_printf("ERROR: opening %s or creating %s\r\n",
                    PARRGN_FILE, MERGED_FILE);
-        if (fp_in)  closeFile(fp_in);
-        if (fp_out) closeFile(fp_out);
+        closeReader(&fp_in);
+        closeWriter(&fp_out);
         return -1;
     }
 
-    char line[MAX_LINE_LEN];
+    char *line;
     uint8_t symbols[4];
     int idx = 0;
     uint32_t merged_count = 0;
+    int failed = 0;
 
-    xil_printf("==== Bit Merger IP ====\r\n");
+    // Zero-run tokens expand to the symbols merged below
+    static u8 expanded[ZRLE_EXPAND_MAX];
+    int zrle = (archive_flags & COMPBIN_FLAG_ZRLE) != 0;
+    ZrleExpander z;
+    zrle_expand_init(&z, archive_escape);
 
-    while (f_readline(fp_in, line, sizeof(line))) {
-        if (!is_binstr(line) || strlen(line) != 8) continue;
+    xil_printf("==== Bit Merger IP ====\r\n");
 
-        uint8_t val = binstr_to_byte(line);
-        symbols[idx++] = val;
+    int len;
+    while (!failed && (len = readLine(&fp_in, &line)) >= 0) {
+        uint8_t val;
+        if (len != 8 || rbt_pack_byte(line, &val) != 0) continue;
+
+        int n = 1;
+        if (zrle) {
+            n = zrle_expand_token(&z, val, expanded);
+            if (n < 0) {
+                xil_printf("ERROR: malformed zero-run token in %s\r\n", PARRGN_FILE);
+                failed = 1;
+                break;
+            }
+        } else {
+            expanded[0] = val;
+        }
 
-        if (idx == 4) {
-            // Write 4 bytes into Merger IP
-            IP_WRITE8(SLV_REG0, symbols[0]);
-            IP_WRITE8(SLV_REG1, symbols[1]);
-            IP_WRITE8(SLV_REG2, symbols[2]);
-            IP_WRITE8(SLV_REG3, symbols[3]);
+        for (int k = 0; k < n; k++) {
+            symbols[idx++] = expanded[k];
+            if (idx < 4)
+                continue;
 
-            // Read merged 32-bit word
-            uint32_t merged = IP_READ32(OUT_WORD_REG);
+            uint32_t merged = merge_four(symbols);
 
             // Write as binary string to MERGED.txt
             char bin32[33];
             uint32_to_binstr(merged, bin32);
-            writeFile(fp_out, 32, (u32)bin32);
-            writeFile(fp_out, 2, (u32)"\r\n");
+            writeLine(&fp_out, bin32, 32);
 
             merged_count++;
             idx = 0;
@@ -595,57 +1580,936 @@ int merge_symbols_to_words() {
             }
         }
     }
+    if (zrle && z.pending) {
+        xil_printf("ERROR: %s ends inside a zero-run token\r\n", PARRGN_FILE);
+        failed = 1;
+    }
 
-    closeFile(fp_in);
-    closeFile(fp_out);
+    closeReader(&fp_in);
+    if (closeWriter(&fp_out) != XST_SUCCESS) {
+        xil_printf("ERROR: writing %s\r\n", MERGED_FILE);
+        return -1;
+    }
+    if (failed)
+        return -1;
 
     xil_printf("Total number of 32-bit words merged: %lu\r\n",
                (unsigned long)merged_count);
 
+    merged_word_count = merged_count;
     return 0;
 }
 
 // ==========================================================================
-// Part 8: Merge HEADER.txt and MERGED.txt into DECOMP.rbt
+// Part 8: Merge HEADER.txt and MERGED.txt into DECOMP_FILE
 // ==========================================================================
-int merge_header_and_data() {
-    FIL *fp_header = openFile(HEADER_FILE, 'r');   // HEADER.txt
-    FIL *fp_data   = openFile(MERGED_FILE, 'r');   // MERGED.txt
-    FIL *fp_out    = openFile(DECOMP_FILE, 'w');   // DECOMP.rbt
+// An .rbt output from an .rbt archive keeps the header text as it is.
+// Otherwise the header of the output format is built here from the
+// archive's header section (n bytes, flags from CompBinHeader): a .bit
+// header is kept for .bit output with the payload length of this
+// output, and converted for .rbt output; .rbt text is converted for
+// .bit output. A .bin archive has no header, so the fields stay empty.
+static int convert_header(const u8 *section, u32 n, u16 flags, u32 n_words,
+                          u8 *dst, u32 *out_bytes) {
+    BitHeader h;
+    memset(&h, 0, sizeof(h));
+
+    if (flags & COMPBIN_FLAG_BIT_HEADER) {
+        if (bit_parse_header(section, n, &h) != 0 || h.header_bytes != n) {
+            xil_printf("ERROR: malformed .bit header in the archive\r\n");
+            return -1;
+        }
+        if (OUTPUT_FORMAT == BIT_FORMAT_BIT) {
+            memcpy(dst, section, n);
+            bit_store_be32(dst + n - 4, n_words * 4);
+            *out_bytes = n;
+            return 0;
+        }
+    } else if (n > 0) {
+        bit_header_from_rbt((const char *)section, n, &h);
+    }
+
+    *out_bytes = (OUTPUT_FORMAT == BIT_FORMAT_BIT)
+                     ? bit_write_header(dst, &h, n_words * 4)
+                     : rbt_header_from_bit((char *)dst, &h, n_words);
+    return 0;
+}
+
+// One configuration word in the byte order of OUTPUT_FORMAT: .bit and
+// .bin are big-endian, OUTPUT_WORDS keeps the CPU (little-endian) order
+static inline void store_output_word(u8 *dst, u32 word) {
+    if (OUTPUT_FORMAT == OUTPUT_WORDS)
+        memcpy(dst, &word, 4);
+    else
+        bit_store_be32(dst, word);
+}
 
-    if (!fp_header || !fp_data || !fp_out) {
+int merge_header_and_data() {
+    LineReader fp_header = {0};   // HEADER.txt
+    LineReader fp_data   = {0};   // MERGED.txt
+    LineWriter fp_out    = {0};   // DECOMP_FILE
+
+    if (openReader(&fp_header, HEADER_FILE) != XST_SUCCESS ||
+        openReader(&fp_data,   MERGED_FILE) != XST_SUCCESS ||
+        openWriterSized(&fp_out, DECOMP_FILE,
+                        2 * f_size(fp_header.fp) + BIT_HEADER_MAX +
+                        merged_word_count * (OUTPUT_FORMAT == BIT_FORMAT_RBT ? 34 : 4)) != XST_SUCCESS) {
         xil_printf("ERROR: opening %s, %s, or creating %s\r\n",
                    HEADER_FILE, MERGED_FILE, DECOMP_FILE);
-        if (fp_header) closeFile(fp_header);
-        if (fp_data)   closeFile(fp_data);
-        if (fp_out)    closeFile(fp_out);
+        closeReader(&fp_header);
+        closeReader(&fp_data);
+        closeWriter(&fp_out);
         return -1;
     }
 
-    char line[MAX_LINE_LEN];
+    char *line;
+    int len;
+    int rc = 0;
     xil_printf("==== Merging Files to create %s ====\r\n",
                DECOMP_FILE);
 
-    // Copy HEADER file content into DECOMP.rbt
-    while (f_readline(fp_header, line, MAX_LINE_LEN)) {
-        writeFile(fp_out, strlen(line), (u32)line);
-        writeFile(fp_out, 2, (u32)"\r\n");  // preserve CRLF
+    int text_header = !(archive_flags & COMPBIN_FLAG_BIT_HEADER) &&
+                      f_size(fp_header.fp) > 0;
+
+    if (OUTPUT_FORMAT == BIT_FORMAT_RBT && text_header) {
+        // Copy HEADER file content into DECOMP.rbt
+        while ((len = readLine(&fp_header, &line)) >= 0)
+            writeLine(&fp_out, line, len);  // preserve CRLF
+    } else if (OUTPUT_FORMAT == BIT_FORMAT_RBT || OUTPUT_FORMAT == BIT_FORMAT_BIT) {
+        // Fields of an .rbt header sit in its first lines, so the
+        // first BIT_HEADER_MAX bytes are enough for the conversion
+        static u8 section[BIT_HEADER_MAX];
+        static u8 head[BIT_HEADER_MAX > RBT_HEADER_MAX ? BIT_HEADER_MAX : RBT_HEADER_MAX];
+        const u8 *span;
+        u32 n = 0, got, head_bytes;
+
+        while (n < sizeof(section) && (got = readSpan(&fp_header, &span, sizeof(section) - n)) > 0) {
+            memcpy(section + n, span, got);
+            n += got;
+        }
+
+        rc = convert_header(section, n, archive_flags, merged_word_count, head, &head_bytes);
+        if (rc == 0 && OUTPUT_FORMAT == BIT_FORMAT_BIT) {
+            writeBuffered(&fp_out, head, head_bytes);
+        } else if (rc == 0) {
+            for (u32 i = 0, start = 0; i < head_bytes; i++) {
+                if (head[i] == '\n') {
+                    writeLine(&fp_out, (const char *)head + start, i - start);
+                    start = i + 1;
+                }
+            }
+        }
     }
 
-    // Append MERGED file content into DECOMP.rbt
-    while (f_readline(fp_data, line, MAX_LINE_LEN)) {
-        writeFile(fp_out, strlen(line), (u32)line);
-        writeFile(fp_out, 2, (u32)"\r\n");
+    // Append MERGED file content
+    while (rc == 0 && (len = readLine(&fp_data, &line)) >= 0) {
+        if (OUTPUT_FORMAT == BIT_FORMAT_RBT) {
+            writeLine(&fp_out, line, len);
+        } else {
+            u8 bytes[4];
+            u32 word;
+            if (len != 32 || rbt_pack_word(line, &word) != 0)
+                word = binstr_to_u32(line);
+            store_output_word(bytes, word);
+            writeBuffered(&fp_out, bytes, 4);
+        }
     }
 
-    closeFile(fp_header);
-    closeFile(fp_data);
-    closeFile(fp_out);
+    closeReader(&fp_header);
+    closeReader(&fp_data);
+    if (closeWriter(&fp_out) != XST_SUCCESS) {
+        xil_printf("ERROR: writing %s\r\n", DECOMP_FILE);
+        return -1;
+    }
+    if (rc != 0)
+        return -1;
 
     xil_printf("==== Created final decompressed file: %s ====\r\n", DECOMP_FILE);
     return 0;
 }
 
+// ==========================================================================
+// Part 9: ENCR.bin -> DDR -> stream chain -> DDR -> PCAP (AXIS_DMA)
+// ==========================================================================
+// The archive is read once into DDR. Only the header and codebook
+// sections are decrypted by software; the payload section is streamed
+// by MM2S through decrypt -> stream decoder -> bit merger, and S2MM
+// writes the configuration words to CONFIG_BUF_ADDR as u32 values
+// (sync word reads 0xAA995566), which is the layout the PCAP expects.
+// Only block archives with payload CRCs (BLOCK_WORDS in compression.c)
+// are checked before the PCAP; any other archive is configured as it
+// decodes, and the run says so.
+#if AXIS_DMA
+static XAxiDma dma;
+static XScuGic gic;
+static volatile int s2mm_irq_seen = 0;
+static volatile int dma_error     = 0;
+
+static void dchain_irq_handler(void *ref) {
+    (void)ref;
+    if (DC_READ(REG_SD_STATUS) & SD_STATUS_ERROR)
+        dma_error = 1;
+}
+
+static void s2mm_irq_handler(void *ref) {
+    XAxiDma *d = (XAxiDma *)ref;
+    u32 irq = XAxiDma_IntrGetIrq(d, XAXIDMA_DEVICE_TO_DMA);
+    XAxiDma_IntrAckIrq(d, irq, XAXIDMA_DEVICE_TO_DMA);
+
+    if (irq & XAXIDMA_IRQ_ERROR_MASK)
+        dma_error = 1;
+    if (irq & XAXIDMA_IRQ_IOC_MASK)
+        s2mm_irq_seen = 1;
+}
+
+static int dma_ready = 0;
+
+// Once per session: a batch streams every archive through the same set-up
+static int dma_init(void) {
+    if (dma_ready)
+        return 0;
+
+    XAxiDma_Config *cfg = XAxiDma_LookupConfig(DMA_DEV_ID);
+    if (!cfg || XAxiDma_CfgInitialize(&dma, cfg) != XST_SUCCESS || XAxiDma_HasSg(&dma)) {
+        xil_printf("ERROR: AXI DMA init failed (simple mode required)\r\n");
+        return -1;
+    }
+
+    XScuGic_Config *gcfg = XScuGic_LookupConfig(GIC_DEV_ID);
+    if (!gcfg || XScuGic_CfgInitialize(&gic, gcfg, gcfg->CpuBaseAddress) != XST_SUCCESS) {
+        xil_printf("ERROR: interrupt controller init failed\r\n");
+        return -1;
+    }
+
+    // The chain IRQ is a one-cycle pulse (rising edge), the DMA IRQ a level
+    XScuGic_SetPriorityTriggerType(&gic, DCHAIN_IRQ_ID,   0xA0, 0x3);
+    XScuGic_SetPriorityTriggerType(&gic, DMA_S2MM_IRQ_ID, 0xA0, 0x1);
+    if (XScuGic_Connect(&gic, DCHAIN_IRQ_ID, dchain_irq_handler, NULL) != XST_SUCCESS ||
+        XScuGic_Connect(&gic, DMA_S2MM_IRQ_ID, s2mm_irq_handler, &dma) != XST_SUCCESS) {
+        xil_printf("ERROR: connecting DMA interrupts failed\r\n");
+        return -1;
+    }
+    XScuGic_Enable(&gic, DCHAIN_IRQ_ID);
+    XScuGic_Enable(&gic, DMA_S2MM_IRQ_ID);
+
+    Xil_ExceptionInit();
+    Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT,
+                                 (Xil_ExceptionHandler)XScuGic_InterruptHandler, &gic);
+    Xil_ExceptionEnable();
+
+    XAxiDma_IntrDisable(&dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DMA_TO_DEVICE);
+    XAxiDma_IntrEnable(&dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DEVICE_TO_DMA);
+    dma_ready = 1;
+    return 0;
+}
+
+// One start of the chain: n_symbols symbols from in_words payload
+// words at src, n_out configuration words to dst. Returns 0 once S2MM
+// has written all of them.
+static int dchain_stream(const u32 *src, u32 in_words, u32 n_symbols, u32 dst, u32 n_out) {
+    s2mm_irq_seen = 0;
+    dma_error     = 0;
+    DC_WRITE(REG_SD_COUNT, n_symbols);
+    DC_WRITE(REG_SD_CTRL, 1);
+    DC_WRITE(REG_SD_CTRL, 0);
+
+    Xil_DCacheFlushRange((UINTPTR)src, in_words * 4);
+    Xil_DCacheInvalidateRange(dst, n_out * 4);
+
+    if (XAxiDma_SimpleTransfer(&dma, dst, n_out * 4, XAXIDMA_DEVICE_TO_DMA) != XST_SUCCESS ||
+        XAxiDma_SimpleTransfer(&dma, (UINTPTR)src, in_words * 4,
+                               XAXIDMA_DMA_TO_DEVICE) != XST_SUCCESS) {
+        xil_printf("ERROR: DMA transfer rejected\r\n");
+        return -1;
+    }
+
+    u32 to = DMA_TIMEOUT;
+    while (!s2mm_irq_seen && !dma_error && --to) ;
+    perf_polls(DMA_TIMEOUT - to);
+    u32 words = DC_READ(REG_DC_WORDS);
+    if (dma_error || !to || words != n_out) {
+        xil_printf("ERROR: stream chain %s after %lu of %lu words\r\n",
+                   dma_error ? "failed" : "stalled",
+                   (unsigned long)words, (unsigned long)n_out);
+        return -1;
+    }
+    Xil_DCacheInvalidateRange(dst, n_out * 4);
+    return 0;
+}
+
+// COMPBIN_FLAG_BLOCKS: one start of the chain per block, its words to
+// their place at CONFIG_BUF_ADDR. The chain checksums the payload words
+// it decodes, so a corrupted block stops the stream right there,
+// before any word reaches the PCAP.
+static int dchain_stream_blocks(const CompBinHeader *hdr, const u8 *archive, u32 payload_off) {
+    u32 n_local;
+    if (block_index(hdr, archive, payload_off, &n_local) != 0)
+        return -1;
+    if (n_local) {
+        xil_printf("ERROR: %lu blocks carry a local codebook; decode them with AXIS_DMA = 0\r\n",
+                   (unsigned long)n_local);
+        return -1;
+    }
+
+    for (u32 b = 0; b < block_hdr.block_count; b++) {
+        BlockRef r;
+        block_ref(hdr, archive, payload_off, b, &r);
+        int rc = dchain_stream(r.data, (r.blk.payload_bits + 31) / 32, r.blk.symbol_count,
+                               CONFIG_BUF_ADDR + 4 * r.w0, r.n_words);
+        if (rc != 0) {
+            block_error(b, AMP_JOB_DECODE, &r);
+            return -1;
+        }
+        if (r.has_payload_crc && DC_READ(REG_SD_CRC) != r.payload_crc) {
+            block_error(b, AMP_JOB_PAYLOAD, &r);
+            return -1;
+        }
+    }
+
+    xil_printf("Blocks: %lu of %lu words streamed, %s\r\n",
+               (unsigned long)block_hdr.block_count, (unsigned long)block_hdr.block_words,
+               block_crc_off ? "payload CRCs OK" : "no payload CRCs to check");
+    return 0;
+}
+
+#if PCAP_CONFIG
+#define SLCR_LOCK          0xF8000004
+#define SLCR_UNLOCK        0xF8000008
+#define SLCR_PCAP_CLK_CTRL 0xF8000168
+#define SLCR_LVL_SHFTR_EN  0xF8000900
+#define SLCR_LOCK_VAL      0x767B
+#define SLCR_UNLOCK_VAL    0xDF0D
+
+static XDcfg dcfg;
+
+static void slcr_write(u32 addr, u32 value) {
+    Xil_Out32(SLCR_UNLOCK, SLCR_UNLOCK_VAL);
+    Xil_Out32(addr, value);
+    Xil_Out32(SLCR_LOCK, SLCR_LOCK_VAL);
+}
+
+// Full PL configuration from n_words at addr. The fabric (and with it
+// the decompression chain) is replaced, so this must run last.
+// Wait for PCFG_INIT to read high (1) or low (0), at most DMA_TIMEOUT polls
+static int pcap_wait_init(int high) {
+    u32 want = high ? XDCFG_STATUS_PCFG_INIT_MASK : 0;
+    u32 to = DMA_TIMEOUT;
+    while ((XDcfg_GetStatusRegister(&dcfg) & XDCFG_STATUS_PCFG_INIT_MASK) != want && --to) ;
+    perf_polls(DMA_TIMEOUT - to);
+    if (!to) {
+        xil_printf("ERROR: PL INIT did not go %s after PROG_B (status 0x%08x)\r\n",
+                   high ? "high" : "low", XDcfg_GetStatusRegister(&dcfg));
+        return -1;
+    }
+    return 0;
+}
+
+static int pcap_configure(u32 addr, u32 n_words) {
+    XDcfg_Config *cfg = XDcfg_LookupConfig(DCFG_DEV_ID);
+    if (!cfg || XDcfg_CfgInitialize(&dcfg, cfg, cfg->BaseAddr) != XST_SUCCESS) {
+        xil_printf("ERROR: DevC init failed\r\n");
+        return -1;
+    }
+
+    u32 clk = Xil_In32(SLCR_PCAP_CLK_CTRL);
+    if (!(clk & 0x1))
+        slcr_write(SLCR_PCAP_CLK_CTRL, clk | 0x1);
+    slcr_write(SLCR_LVL_SHFTR_EN, 0xA);          // PS-to-PL level shifters off
+
+    XDcfg_EnablePCAP(&dcfg);
+    XDcfg_SetControlRegister(&dcfg, XDCFG_CTRL_PCAP_PR_MASK);
+
+    // Clear the PL (PROG_B pulse) and wait for INIT to come back
+    XDcfg_SetControlRegister(&dcfg, XDCFG_CTRL_PCFG_PROG_B_MASK);
+    XDcfg_ClearControlRegister(&dcfg, XDCFG_CTRL_PCFG_PROG_B_MASK);
+    if (pcap_wait_init(0) != 0)
+        return -1;
+    XDcfg_SetControlRegister(&dcfg, XDCFG_CTRL_PCFG_PROG_B_MASK);
+    if (pcap_wait_init(1) != 0)
+        return -1;
+
+    XDcfg_IntrClear(&dcfg, XDCFG_IXR_PCFG_DONE_MASK | XDCFG_IXR_D_P_DONE_MASK |
+                           XDCFG_IXR_DMA_DONE_MASK);
+
+    Xil_DCacheFlushRange(addr, n_words * 4);
+    if (XDcfg_Transfer(&dcfg, (u8 *)addr, n_words, (u8 *)XDCFG_DMA_INVALID_ADDRESS,
+                       0, XDCFG_NON_SECURE_PCAP_WRITE) != XST_SUCCESS) {
+        xil_printf("ERROR: PCAP transfer rejected\r\n");
+        return -1;
+    }
+
+    u32 to = DMA_TIMEOUT;
+    while (!(XDcfg_IntrGetStatus(&dcfg) & XDCFG_IXR_PCFG_DONE_MASK) && --to) ;
+    perf_polls(DMA_TIMEOUT - to);
+    if (!to) {
+        xil_printf("ERROR: PL did not report DONE (status 0x%08x)\r\n",
+                   XDcfg_IntrGetStatus(&dcfg));
+        return -1;
+    }
+
+    slcr_write(SLCR_LVL_SHFTR_EN, 0xF);          // level shifters back on
+    return 0;
+}
+#endif
+#endif
+
+int stream_decompress_to_config() {
+#if AXIS_DMA
+    XTime tStart, tDecoded, tConfigured;
+    static u8  lengths[256];
+    static u32 codes[256];
+
+    u32 size;
+    perf_begin("read");
+    if (read_archive(&size) != 0 || archive_wait(size) != 0)
+        return -1;
+    perf_end(size, size, 0);
+
+    xil_printf("---- Streaming decompression (AXI DMA) ----\r\n");
+    perf_begin("load_table");
+    perf_ip(DCHAIN_BASE_ADDR);
+    XTime_GetTime(&tStart);
+
+    // Header first, to find the codebook and payload sections
+    u8 *archive = (u8 *)ARCHIVE_BUF_ADDR;
+    CompBinHeader hdr;
+    decrypt_bytes(archive, sizeof(hdr));
+    memcpy(&hdr, archive, sizeof(hdr));
+    if (!compbin_header_ok(&hdr)) {
+        xil_printf("ERROR: %s is not a supported packed archive\r\n", archive_name);
+        return -1;
+    }
+    if (hdr.flags & COMPBIN_FLAG_ZRLE) {
+        xil_printf("ERROR: zero-run archives need AXIS_DMA = 0\r\n");
+        return -1;
+    }
+    int blocks = (hdr.flags & COMPBIN_FLAG_BLOCKS) != 0;
+    if (blocks)
+        decrypt_bytes(archive + sizeof(hdr), hdr.header_bytes - sizeof(hdr));
+
+    u32 cb_off, payload_off;
+    if (compbin_sections(&hdr, size, &cb_off, &payload_off) != 0)
+        return -1;
+    u32 cb_bytes  = compbin_codebook_bytes(&hdr);
+    u32 in_bytes  = hdr.payload_words * 4;
+    u32 out_bytes = hdr.word_count * 4;
+
+    decrypt_bytes(archive + cb_off, cb_bytes);
+    if (codebook_from_section(&hdr, archive + cb_off, lengths, codes) != 0)
+        return -1;
+
+    for (int s = 0; s < 256; s++) {
+        if (lengths[s] > STREAM_LUT_BITS) {
+            xil_printf("ERROR: %d-bit codeword exceeds the %d-bit decode table\r\n",
+                       lengths[s], STREAM_LUT_BITS);
+            return -1;
+        }
+    }
+    if (select_codebook(DCHAIN_BASE_ADDR, lengths, codes, 1, archive_codebook_id(&hdr, lengths)) != 0)
+        return -1;
+
+    if (dma_init() != 0)
+        return -1;
+    perf_end(sizeof(hdr) + cb_bytes, sizeof(lengths), 0);
+
+    perf_begin("stream");
+    perf_ip(DCHAIN_BASE_ADDR);
+    DC_WRITE(REG_DC_KEY, DECRYPT_KEY * 0x01010101u);
+
+    int rc = blocks ? dchain_stream_blocks(&hdr, archive, payload_off)
+                    : dchain_stream((const u32 *)(archive + payload_off), hdr.payload_words,
+                                    hdr.symbol_count, CONFIG_BUF_ADDR, hdr.word_count);
+    if (rc != 0)
+        return -1;
+    // Only COMPBIN_FLAG_PAYLOAD_CRC archives are checked on this path
+    if (!(hdr.flags & COMPBIN_FLAG_PAYLOAD_CRC) && PCAP_CONFIG)
+        xil_printf("NOTE: %s has no payload CRCs, the fabric is configured unchecked\r\n",
+                   archive_name);
+    u32 words = hdr.word_count;
+    XTime_GetTime(&tDecoded);
+    perf_end(in_bytes, out_bytes, hdr.symbol_count);
+    record_run(size, out_bytes, &hdr, size + out_bytes);
+
+    xil_printf("Decoded %lu configuration words to 0x%08x in %lu us\r\n",
+               (unsigned long)words, CONFIG_BUF_ADDR,
+               (unsigned long)((tDecoded - tStart) / (COUNTS_PER_SECOND / 1000000)));
+
+#if PCAP_CONFIG
+    perf_begin("pcap");
+    if (pcap_configure(CONFIG_BUF_ADDR, words) != 0)
+        return -1;
+    perf_end(out_bytes, out_bytes, 0);
+    XTime_GetTime(&tConfigured);
+    xil_printf("Fabric configured: %lu us from archive in DDR to PL DONE\r\n",
+               (unsigned long)((tConfigured - tStart) / (COUNTS_PER_SECOND / 1000000)));
+#else
+    perf_begin("write");
+    if (out_begin(output_name, CONFIG_BUF_ADDR, out_bytes) != 0 || out_end(out_bytes) != 0)
+        return -1;
+    perf_end(out_bytes, out_bytes, 0);
+    (void)tConfigured;
+    xil_printf("Configuration words written to %s\r\n", output_name);
+#endif
+    return 0;
+#else
+    xil_printf("ERROR: built without AXIS_DMA\r\n");
+    return -1;
+#endif
+}
+
+// ==========================================================================
+// Part 10: ENCR.bin -> DDR -> IP cores -> DDR -> DECOMP_FILE (STAGE_FILES = 0)
+// ==========================================================================
+// The archive is read once and decrypted in place. The header and
+// codebook are parsed where they lie, the payload is decoded into one
+// byte per symbol at CONFIG_BUF_ADDR and merged there in place (word i
+// overwrites the four symbols it is built from), and the result is
+// written with a single writeFile.
+
+// n_symbols symbols from payload_bits bits of packed payload, through
+// the stream decoder IP
+static int mem_decode_stream(const u32 *payload, u32 payload_bits, u32 n_symbols, u8 *dst) {
+    u32 total = 0, st = 0;
+
+    sd_start(n_symbols);
+    sd_push_words(payload, (payload_bits + 31) / 32, NULL, dst, &total, &st);
+    return sd_finish(NULL, dst, &total, &st, n_symbols);
+}
+
+// Same, with codeword boundaries from dec_tree and the symbols looked
+// up by the Huffman decoder IP
+static int mem_decode_codewords(const u32 *payload, u32 payload_bits, u32 n_symbols, u8 *dst) {
+    uint32_t bits_left = payload_bits;
+    uint32_t symbols = 0;
+    uint32_t code = 0;
+    int code_len = 0;
+    int node = 0;
+
+    for (u32 w = 0; bits_left > 0; w++) {
+        u32 word = payload[w];
+        int nbits = bits_left < 32 ? (int)bits_left : 32;
+        for (int b = 31; b > 31 - nbits; b--) {
+            int bit = (word >> b) & 1;
+            int16_t next = dec_tree[node][bit];
+            code = (code << 1) | bit;
+            code_len++;
+            if (next == 0 || (next < 0 && symbols == n_symbols)) {
+                xil_printf("ERROR: invalid codeword at symbol %lu\r\n",
+                           (unsigned long)symbols);
+                return -1;
+            }
+            if (next < 0) {
+                dst[symbols++] = decode_codeword(code, code_len);
+                if (symbols % 500000 == 0)
+                    xil_printf("  %u symbols decompressed\r\n", symbols);
+                code = 0;
+                code_len = 0;
+                node = 0;
+            } else {
+                node = next;
+            }
+        }
+        bits_left -= nbits;
+    }
+    return (symbols == n_symbols) ? 0 : -1;
+}
+
+static int mem_decode(const u32 *payload, u32 payload_bits, u32 n_symbols, u8 *dst) {
+    return STREAM_DECODER ? mem_decode_stream(payload, payload_bits, n_symbols, dst)
+                          : mem_decode_codewords(payload, payload_bits, n_symbols, dst);
+}
+
+// Decode tree and decoder table for one codebook (id: see select_codebook)
+static int use_codebook(const u8 *lengths, const u32 *codes, u32 id) {
+    if (build_decode_tree(lengths, codes) != 0)
+        return -1;
+    if (STREAM_DECODER && !stream_lut_fits(lengths))
+        return -1;
+
+    // Every entry is rewritten, so huffman_decoder keeps nothing of
+    // the previous codebook
+    return select_codebook(HUFFDEC_BASE_ADDR, lengths, codes, STREAM_DECODER, id);
+}
+
+// Block b through the IP on CPU0; tokens (zero-run archives) are
+// decoded to *tokens, which moves past them
+static int decode_block_ip(u32 b, const BlockRef *r, const u8 *lengths, const u32 *codes,
+                           u32 global_id, int zrle, u8 **tokens, int *global_loaded) {
+    static u8  local_lengths[256];
+    static u32 local_codes[256];
+
+    if (r->lengths) {
+        memcpy(local_lengths, r->lengths, 256);
+        if (codebook_canonical(local_lengths, local_codes) != 0 ||
+            use_codebook(local_lengths, local_codes, codebook_id(local_lengths)) != 0) {
+            xil_printf("ERROR: invalid codebook in block %lu\r\n", (unsigned long)b);
+            return -1;
+        }
+        *global_loaded = 0;
+    } else if (!*global_loaded) {
+        if (use_codebook(lengths, codes, global_id) != 0)
+            return -1;
+        *global_loaded = 1;
+    }
+
+    // huffman_decoder is handed the codewords by software, which checks
+    // them first; the stream decoder checksums the words it takes in
+    u32 n_data = (r->blk.payload_bits + 31) / 32;
+    if (r->has_payload_crc && !STREAM_DECODER &&
+        bit_crc32_words(r->data, n_data) != r->payload_crc) {
+        block_error(b, AMP_JOB_PAYLOAD, r);
+        return -1;
+    }
+
+    u32 *words = (u32 *)CONFIG_BUF_ADDR;
+    u8  *block_symbols = (u8 *)CONFIG_BUF_ADDR + 4 * r->w0;
+    u8  *decoded = zrle ? *tokens : block_symbols;
+    int rc = mem_decode(r->data, r->blk.payload_bits, r->blk.symbol_count, decoded);
+    if (rc != 0) {
+        block_error(b, AMP_JOB_DECODE, r);
+        return -1;
+    }
+    if (r->has_payload_crc && STREAM_DECODER && IP_READ(REG_SD_CRC) != r->payload_crc) {
+        block_error(b, AMP_JOB_PAYLOAD, r);
+        return -1;
+    }
+    *tokens += r->blk.symbol_count;
+
+    if (zrle &&
+        zrle_expand(decoded, r->blk.symbol_count, archive_escape, block_symbols, r->n_words * 4) !=
+            (int)(r->n_words * 4)) {
+        block_error(b, AMP_JOB_EXPAND, r);
+        return -1;
+    }
+
+    // Word i overwrites its own four symbols
+    for (u32 w = r->w0; w < r->w0 + r->n_words; w++)
+        words[w] = merge_four((u8 *)CONFIG_BUF_ADDR + 4 * w);
+
+    if (bit_crc32_words(words + r->w0, r->n_words) != r->blk.crc32) {
+        block_error(b, AMP_JOB_CRC, r);
+        return -1;
+    }
+    return 0;
+}
+
+#if AMP_MODE
+// Hand block b to CPU1. Its words must not share a cache line with
+// CPU0's, which the caller guarantees (block_words % 8 == 0).
+static int post_block(const BlockRef *r, const u8 *lengths, int zrle) {
+    volatile AmpBlockJob *job = &AMP_SHARED->job;
+    u32 bytes = r->n_words * 4;
+    u32 symbols = CONFIG_BUF_ADDR + 4 * r->w0;
+
+    job->payload         = (u32)r->data;
+    job->payload_bits    = r->blk.payload_bits;
+    job->symbol_count    = r->blk.symbol_count;
+    job->lengths         = (u32)(r->lengths ? r->lengths : lengths);
+    job->zrle            = zrle;
+    job->escape          = archive_escape;
+    job->symbols         = symbols;
+    job->n_words         = r->n_words;
+    job->crc32           = r->blk.crc32;
+    job->has_payload_crc = r->has_payload_crc;
+    job->payload_crc     = r->payload_crc;
+    job->status          = AMP_JOB_OK;
+
+    Xil_DCacheInvalidateRange(symbols, bytes);
+    return amp_decode_start();
+}
+#endif
+
+// COMPBIN_FLAG_BLOCKS: each block is decoded, expanded and merged on
+// its own and checked against its CRCs. The global codebook (lengths,
+// codes) is in the decoder on entry; tokens are decoded to
+// RBT_BUF_ADDR, symbols and words go to CONFIG_BUF_ADDR. With
+// AMP_MODE, CPU1 takes blocks from the tail in software while CPU0
+// works from the front through the IP.
+static int mem_decode_blocks(const CompBinHeader *hdr, const u8 *archive, u32 payload_off,
+                             const u8 *lengths, const u32 *codes) {
+    int zrle = (hdr->flags & COMPBIN_FLAG_ZRLE) != 0;
+    u32 n_local;
+    if (block_index(hdr, archive, payload_off, &n_local) != 0)
+        return -1;
+
+    u8 *tokens = (u8 *)RBT_BUF_ADDR;
+    u32 global_id = archive_codebook_id(hdr, lengths);
+    int global_loaded = 1;
+    u32 front = 0, back = block_hdr.block_count;
+    u32 by_cpu1 = 0;
+    int cpu1_busy = 0;
+
+#if AMP_MODE
+    u32 on_cpu1 = 0;
+    int dual = (hdr->flags & COMPBIN_FLAG_CANONICAL) && block_hdr.block_count > 1 &&
+               block_hdr.block_words % 8 == 0;
+    if (dual) {
+        // CPU1 reads the decrypted archive and the global lengths
+        Xil_DCacheFlushRange((UINTPTR)archive, payload_off + hdr->payload_words * 4);
+        Xil_DCacheFlushRange((UINTPTR)lengths, 256);
+    }
+#else
+    int dual = 0;
+#endif
+
+    while (front < back || cpu1_busy) {
+#if AMP_MODE
+        if (cpu1_busy) {
+            int done = amp_decode_poll();
+            if (done < 0)
+                return -1;
+            if (done) {
+                BlockRef r;
+                block_ref(hdr, archive, payload_off, on_cpu1, &r);
+                if (AMP_SHARED->job.status != AMP_JOB_OK) {
+                    block_error(on_cpu1, AMP_SHARED->job.status, &r);
+                    return -1;
+                }
+                Xil_DCacheInvalidateRange(CONFIG_BUF_ADDR + 4 * r.w0, r.n_words * 4);
+                cpu1_busy = 0;
+                by_cpu1++;
+            }
+        }
+        if (dual && !cpu1_busy && back - front > 1) {
+            BlockRef r;
+            on_cpu1 = --back;
+            block_ref(hdr, archive, payload_off, on_cpu1, &r);
+            if (post_block(&r, lengths, zrle) != 0)
+                return -1;
+            cpu1_busy = 1;
+        }
+#endif
+        if (front < back) {
+            BlockRef r;
+            block_ref(hdr, archive, payload_off, front, &r);
+            if (decode_block_ip(front, &r, lengths, codes, global_id, zrle, &tokens,
+                                &global_loaded) != 0)
+                return -1;
+            front++;
+        }
+    }
+
+    xil_printf("Blocks: %lu of %lu words, %lu with a local codebook, CRCs OK\r\n",
+               (unsigned long)block_hdr.block_count, (unsigned long)block_hdr.block_words,
+               (unsigned long)n_local);
+    if (dual)
+        xil_printf("CPU1 decoded %lu of the blocks\r\n", (unsigned long)by_cpu1);
+    return 0;
+}
+
+// Header lines (CRLF) and one 32-character line per word -> RBT_BUF_ADDR,
+// committed to the output as it grows
+static int mem_format_rbt(const char *header, u32 header_bytes,
+                          const u32 *words, u32 n_words, u32 *out_bytes) {
+    char *out = (char *)RBT_BUF_ADDR;
+    u32 n = 0;
+
+    for (u32 i = 0; i < header_bytes; i++) {
+        if (header[i] == '\r')
+            continue;
+        if (header[i] == '\n') {
+            out[n++] = '\r';
+            out[n++] = '\n';
+        } else {
+            out[n++] = header[i];
+        }
+    }
+    if (header_bytes > 0 && header[header_bytes - 1] != '\n') {
+        out[n++] = '\r';
+        out[n++] = '\n';
+    }
+
+    for (u32 w = 0; w < n_words; w++) {
+        uint32_to_binstr(words[w], out + n);
+        out[n + 32] = '\r';
+        out[n + 33] = '\n';
+        n += 34;
+        if ((w & 0xFFF) == 0xFFF && out_commit(n) != 0)
+            return -1;
+    }
+    *out_bytes = n;
+    return 0;
+}
+
+int decompress_in_memory() {
+    static u8  lengths[256];
+    static u32 codes[256];
+    u32 size;
+
+    // AMP_MODE: "read" only posts the request, decrypt waits for the data
+    perf_begin("read");
+    if (read_archive(&size) != 0)
+        return -1;
+    perf_end(size, size, 0);
+
+    // Chunk by chunk, as the archive arrives (AMP_MODE)
+    xil_printf("---- Decrypting %s in DDR ----\r\n", archive_name);
+    perf_begin("decrypt");
+    perf_ip(PERF_IP_DECRYPT);
+    u8 *archive = (u8 *)ARCHIVE_BUF_ADDR;
+    for (u32 off = 0; off < size; off += AMP_CHUNK_BYTES) {
+        u32 n = size - off < AMP_CHUNK_BYTES ? size - off : AMP_CHUNK_BYTES;
+        if (archive_wait(off + n) != 0)
+            return -1;
+        decrypt_bytes(archive + off, n);
+    }
+    perf_end(size, size, 0);
+
+    perf_begin("load_table");
+    perf_ip(HUFFDEC_BASE_ADDR);
+    CompBinHeader hdr;
+    memcpy(&hdr, archive, sizeof(hdr));
+    if (hdr.magic != COMPBIN_MAGIC) {
+        xil_printf("ERROR: legacy text archive needs STAGE_FILES = 1\r\n");
+        return -1;
+    }
+    if (!compbin_header_ok(&hdr)) {
+        xil_printf("ERROR: unsupported %s header (version %u)\r\n",
+                   archive_name, hdr.version);
+        return -1;
+    }
+
+    u32 cb_off, payload_off;
+    if (compbin_sections(&hdr, size, &cb_off, &payload_off) != 0)
+        return -1;
+    int zrle = (hdr.flags & COMPBIN_FLAG_ZRLE) != 0;
+
+    xil_printf("---- Packed archive v%u: %lu symbols, %lu payload bits ----\r\n",
+               hdr.version, (unsigned long)hdr.symbol_count,
+               (unsigned long)hdr.payload_bits);
+
+    if (zrle) {
+        CompBinZrle z;
+        memcpy(&z, archive + sizeof(hdr), sizeof(z));
+        archive_escape = z.escape;
+    }
+
+    if (codebook_from_section(&hdr, archive + cb_off, lengths, codes) != 0)
+        return -1;
+
+    xil_printf("---- Loading Huffman Table ----\r\n");
+    if (use_codebook(lengths, codes, archive_codebook_id(&hdr, lengths)) != 0)
+        return -1;
+    xil_printf("---- Huffman Table Loaded ----\r\n");
+    perf_end(payload_off, sizeof(lengths), 0);
+
+    // Symbols, then words, at CONFIG_BUF_ADDR. Zero-run tokens are
+    // decoded to RBT_BUF_ADDR first and expanded into the symbols.
+    const u32 *payload = (const u32 *)(archive + payload_off);
+    u8  *symbols = (u8 *)CONFIG_BUF_ADDR;
+    u32 *words   = (u32 *)CONFIG_BUF_ADDR;
+    u8  *decoded = zrle ? (u8 *)RBT_BUF_ADDR : symbols;
+    int rc;
+
+    xil_printf(STREAM_DECODER ? "---- Decompressing (stream decoder) ----\r\n"
+                              : "---- Decompressing ----\r\n");
+    if (hdr.flags & COMPBIN_FLAG_BLOCKS) {
+        // Blocks are decoded, expanded and merged one at a time
+        perf_begin("decode");
+        perf_ip(HUFFDEC_BASE_ADDR);
+        if (mem_decode_blocks(&hdr, archive, payload_off, lengths, codes) != 0)
+            return -1;
+        perf_end(hdr.payload_words * 4, hdr.word_count * 4, hdr.symbol_count);
+        xil_printf("---- Decompression Done: %lu symbols ----\r\n",
+                   (unsigned long)hdr.symbol_count);
+    } else {
+        perf_begin("decode");
+        perf_ip(HUFFDEC_BASE_ADDR);
+        rc = mem_decode(payload, hdr.payload_bits, hdr.symbol_count, decoded);
+        if (rc != 0)
+            return -1;
+        perf_end(hdr.payload_words * 4, hdr.symbol_count, hdr.symbol_count);
+        xil_printf("---- Decompression Done: %lu symbols ----\r\n",
+                   (unsigned long)hdr.symbol_count);
+
+        if (zrle) {
+            perf_begin("zrle");
+            int n = zrle_expand(decoded, hdr.symbol_count, archive_escape, symbols, hdr.word_count * 4);
+            if (n != (int)(hdr.word_count * 4)) {
+                xil_printf("ERROR: zero-run tokens do not expand to %lu symbols\r\n",
+                           (unsigned long)hdr.word_count * 4);
+                return -1;
+            }
+            perf_end(hdr.symbol_count, n, n);
+            xil_printf("Zero-run expansion: %lu tokens -> %d symbols\r\n",
+                       (unsigned long)hdr.symbol_count, n);
+        }
+
+        xil_printf("==== Bit Merger IP ====\r\n");
+        perf_begin("merge");
+        perf_ip(MERGE_BASE_ADDR);
+        for (u32 w = 0; w < hdr.word_count; w++)
+            words[w] = merge_four(symbols + 4 * w);
+        perf_end(hdr.word_count * 4, hdr.word_count * 4, hdr.word_count * 4);
+        xil_printf("Total number of 32-bit words merged: %lu\r\n",
+                   (unsigned long)hdr.word_count);
+    }
+
+    const u8 *section = archive + hdr.header_bytes;
+    int text_header = !(hdr.flags & COMPBIN_FLAG_BIT_HEADER) && hdr.rbt_header_bytes > 0;
+    u32 out_addr, out_bytes;
+
+    // AMP_MODE: the formatter hands chunks to CPU1 as it goes
+    perf_begin("format");
+    if (OUTPUT_FORMAT == OUTPUT_WORDS) {
+        out_addr  = CONFIG_BUF_ADDR;
+        out_bytes = hdr.word_count * 4;
+        if (out_begin(output_name, out_addr, out_bytes) != 0)
+            return -1;
+    } else if (OUTPUT_FORMAT == BIT_FORMAT_RBT) {
+        static char made[RBT_HEADER_MAX];
+        const char *text = (const char *)section;
+        u32 text_bytes = hdr.rbt_header_bytes;
+
+        if (!text_header) {
+            if (convert_header(section, hdr.rbt_header_bytes, hdr.flags, hdr.word_count,
+                               (u8 *)made, &text_bytes) != 0)
+                return -1;
+            text = made;
+        }
+        if ((u64)text_bytes * 2 + (u64)hdr.word_count * 34 > RBT_MAX_BYTES) {
+            xil_printf("ERROR: %s would exceed the %u-byte text buffer\r\n",
+                       output_name, RBT_MAX_BYTES);
+            return -1;
+        }
+        out_addr = RBT_BUF_ADDR;
+        if (out_begin(output_name, out_addr, text_bytes * 2 + hdr.word_count * 34) != 0 ||
+            mem_format_rbt(text, text_bytes, words, hdr.word_count, &out_bytes) != 0)
+            return -1;
+    } else {
+        u8 *out = (u8 *)RBT_BUF_ADDR;
+        u32 n = 0;
+        if (OUTPUT_FORMAT == BIT_FORMAT_BIT &&
+            convert_header(section, hdr.rbt_header_bytes, hdr.flags, hdr.word_count, out, &n) != 0)
+            return -1;
+        out_addr = RBT_BUF_ADDR;
+        if (out_begin(output_name, out_addr, n + hdr.word_count * 4) != 0)
+            return -1;
+        for (u32 w = 0; w < hdr.word_count; w++) {
+            store_output_word(out + n + 4 * w, words[w]);
+            if ((w & 0xFFFF) == 0xFFFF && out_commit(n + 4 * w + 4) != 0)
+                return -1;
+        }
+        out_bytes = n + hdr.word_count * 4;
+    }
+    perf_end(hdr.word_count * 4, out_bytes, 0);
+
+    perf_begin("write");
+    if (out_end(out_bytes) != 0)
+        return -1;
+    perf_end(out_bytes, out_bytes, 0);
+
+    // Archive, words, and the image or the zero-run tokens before it
+    u32 rbt_bytes = out_addr == RBT_BUF_ADDR ? out_bytes : 0;
+    if ((hdr.flags & COMPBIN_FLAG_ZRLE) && hdr.symbol_count > rbt_bytes)
+        rbt_bytes = hdr.symbol_count;
+    record_run(size, out_bytes, &hdr, size + hdr.word_count * 4 + rbt_bytes);
+
+    xil_printf("==== Created final decompressed file: %s (%lu bytes) ====\r\n",
+               output_name, (unsigned long)out_bytes);
+    return 0;
+}
+
 // ============================ File Cleanup Stage ===========================
 void cleanup_helper_files() {
     if (CLEANUP == 0) {
@@ -665,6 +2529,7 @@ void cleanup_helper_files() {
 		HEADER_FILE,
 		OUTPUT_FILE,
 		PARRGN_FILE,
+		PAYLOAD_FILE,
 		DECRYPTED_FILE
     };
 
@@ -681,29 +2546,159 @@ void cleanup_helper_files() {
     }
     xil_printf("Cleanup complete\r\n");
 }
+// CPU1 owns the card in AMP_MODE: the profile goes to the UART only
+static void perf_report_run(void) {
+    if (PERF_REPORT)
+        perf_report("decompression", AMP_MODE ? NULL : PERF_FILE);
+}
+
+static void run_result(void) {
+    if (PERF_REPORT)
+        perf_run_report("decompression", AMP_MODE ? NULL : RUN_FILE);
+}
+
+static void card_release(void) {
+#if AMP_MODE
+    amp_stop();
+#else
+    SD_Eject();
+#endif
+}
+
+// ============================ Batch Mode ===================================
+// BATCH_MODE = 1: every archive of BATCH_DIR through the single-pass
+// pipeline, with the card mounted once. The DDR buffers are fixed and
+// reused as they are; the decoder keeps its resident codebooks from
+// one archive to the next (select_codebook), so archives that share a
+// trained codebook read and load it once, and the DMA is set up once.
+// Each archive is profiled on its own, then one table sums up the batch.
+static BatchList batch;
+
+static int run_batch(void) {
+    if (batch_list(&batch, BATCH_DIR, BATCH_IN_EXT, BATCH_MANIFEST, BATCH_OUT_DIR, BATCH_OUT_EXT) <= 0) {
+        xil_printf("ERROR: no archives in %s\r\n", BATCH_DIR);
+        return -1;
+    }
+
+    int failed = 0;
+    for (u32 i = 0; i < batch.n; i++) {
+        BatchEntry *e = &batch.e[i];
+        XTime t0, t1;
+
+        xil_printf("\n==== [%u/%u] %s -> %s ====\r\n", i + 1, batch.n, e->in, e->out);
+        archive_name   = e->in;
+        output_name    = e->out;
+        archive_flags  = 0;
+        archive_escape = 0;
+        perf_reset();
+
+        XTime_GetTime(&t0);
+        e->status = AXIS_DMA ? stream_decompress_to_config() : decompress_in_memory();
+        XTime_GetTime(&t1);
+        e->us           = (u32)((t1 - t0) / (COUNTS_PER_SECOND / 1000000));
+        e->plain_bytes  = perf_run.plain_bytes;
+        e->packed_bytes = perf_run.packed_bytes;
+        failed |= e->status != 0;
+        if (e->status != 0)
+            xil_printf("%s failed, going on with the next archive\r\n", e->in);
+
+        perf_report_run();
+        if (e->status == 0)
+            run_result();
+    }
+
+    batch_report("decompression", &batch);
+    return failed ? -1 : 0;
+}
+
 // ============================ Main Function ================================
 int main() {
     XTime tStart, tEnd;
     xil_printf("==== Decryption & Huffman Decompression Pipeline START ====\r\n");
 
+#if AMP_MODE
+    // CPU1 mounts the card and serves every file access
+    amp_map_ocm();
+    if (amp_start_cpu1() != 0) {
+        xil_printf("ERROR: CPU1 did not start (is amp_io.elf loaded at 0x%08X?)\r\n", AMP_CPU1_ENTRY);
+        return -1;
+    }
+#else
     if (SD_Init() != XST_SUCCESS) {
         xil_printf("ERROR: SD card initialization failed\r\n");
         return -1;
     }
+#endif
 
     XTime_GetTime(&tStart);
 
+    if (BATCH_MODE) {
+        int rc = run_batch();   // reports every archive itself
+        card_release();
+        return rc;
+    }
+
+    if (AXIS_DMA) {
+        if (stream_decompress_to_config() != 0) goto fail;
+        goto finished;
+    }
+
+    if (!STAGE_FILES) {
+        if (decompress_in_memory() != 0) goto fail;
+        goto finished;
+    }
+
+    // Every stage reads and writes files: its data volume is in the fs columns
+    perf_begin("decrypt");
+    perf_ip(PERF_IP_DECRYPT);
     if (decrypt_file() != 0) goto fail;
+    perf_end(0, 0, 0);
+
+    perf_begin("split");
     if (split_comp_bin() != 0) goto fail;
+    perf_end(0, 0, 0);
+
+    perf_begin("table_files");
     if (generate_huffman_table_files_from_HMCODES() != 0) goto fail;
-    if (generate_out_stream_files_from_OUTPUT() != 0) goto fail;
+    perf_end(0, 0, 0);
+
+    if (!STREAM_DECODER) {
+        perf_begin("stream_files");
+        if (generate_out_stream_files_from_OUTPUT() != 0) goto fail;
+        perf_end(0, 0, 0);
+    }
+
+    perf_begin("load_table");
+    perf_ip(HUFFDEC_BASE_ADDR);
     if (load_huffman_table_from_files() != 0) goto fail;
-    if (decompress_from_files() != 0) goto fail;
+    perf_end(0, 0, 0);
+
+    perf_begin("decode");
+    perf_ip(HUFFDEC_BASE_ADDR);
+    if (STREAM_DECODER) {
+        if (decompress_packed_stream() != 0) goto fail;
+    } else {
+        if (decompress_from_files() != 0) goto fail;
+    }
+    perf_end(0, packed_symbol_count, packed_symbol_count);
+
+    perf_begin("merge");
+    perf_ip(MERGE_BASE_ADDR);
     if (merge_symbols_to_words() != 0) goto fail;
+    perf_end(0, 0, 0);
+
+    perf_begin("format");
     if (merge_header_and_data() != 0) goto fail;
+    perf_end(0, 0, 0);
+
+    perf_run.input        = ENCRYPT_FILE;
+    perf_run.symbols      = packed_symbol_count;
+    perf_run.payload_bits = packed_payload_bits;
+    perf_run_files(DECOMP_FILE, ENCRYPT_FILE);
 
     cleanup_helper_files();
 
+finished:
     XTime_GetTime(&tEnd);
 
     double elapsed_sec = 1.0 * (tEnd - tStart) / COUNTS_PER_SECOND;
@@ -714,11 +2709,14 @@ int main() {
                minutes, seconds);
     xil_printf("==== Huffman Decompression Pipeline COMPLETE ====\r\n");
 
-    SD_Eject();
+    perf_report_run();
+    run_result();
+    card_release();
     return 0;
 
 fail:
     xil_printf("Pipeline failed. Aborting.\r\n");
-    SD_Eject();
+    perf_report_run();
+    card_release();
     return -1;
 }
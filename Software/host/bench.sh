@@ -0,0 +1,210 @@
+#!/bin/sh
+#
+# bench.sh
+#
+# Compression benchmark and round-trip check over a corpus of
+# bitstreams.
+#
+#   bench.sh run    CORPUS [RESULTS]   host model: compress and decompress
+#                                      every file of CORPUS, then report
+#   bench.sh report CORPUS [RESULTS]   report on RESULTS only (board runs)
+#
+# Every bitstream NAME.ext of CORPUS whose ext is the one the
+# applications read (INPUT_FORMAT of compression.c, or BENCH_EXT=rbt,
+# bit or bin) gets a directory RESULTS/NAME.ext (default RESULTS =
+# bench) holding what a run leaves on the card; bitstreams of the
+# other formats are listed as skipped:
+#
+#   RUNC.CSV  RUND.CSV      run results (perf_run_report)
+#   PERFC.CSV PERFD.CSV     stage profiles (perf_report)
+#   DECOMP.*  / CONFIG.bin  decompressed bitstream
+#
+# "run" fills them from the host build (make before); on the board,
+# run both applications on a card holding the design as ZFO.ext and
+# copy those files into RESULTS/NAME.ext. Only the last run in each CSV
+# counts.
+#
+# The report goes to the terminal and to RESULTS/bench.csv (one line
+# per bitstream) and RESULTS/stages.csv (one line per stage). The exit
+# status is 1 if any bitstream failed to run or to round-trip, so the
+# script can gate a change. .rbt files compare without their CRs on
+# either side (the decompressor writes CRLF lines, the input may have
+# either); .bit and .bin compare byte for byte.
+
+set -u
+
+HOST_DIR=$(cd "$(dirname "$0")" && pwd)
+
+usage() {
+    echo "usage: $0 run|report CORPUS [RESULTS]" >&2
+    exit 2
+}
+
+[ $# -ge 2 ] || usage
+MODE=$1
+CORPUS=$2
+RESULTS=${3:-bench}
+
+case $MODE in
+    run|report) ;;
+    *) usage ;;
+esac
+[ -d "$CORPUS" ] || { echo "$0: no corpus directory $CORPUS" >&2; exit 2; }
+mkdir -p "$RESULTS" || exit 2
+RESULTS=$(cd "$RESULTS" && pwd)
+
+# Extension the applications read
+if [ -z "${BENCH_EXT:-}" ]; then
+    case $(sed -n 's/^#define INPUT_FORMAT *BIT_FORMAT_\([A-Z]*\).*/\1/p' "$HOST_DIR/../compression.c") in
+        BIT) BENCH_EXT=bit ;;
+        BIN) BENCH_EXT=bin ;;
+        *)   BENCH_EXT=rbt ;;
+    esac
+fi
+case $BENCH_EXT in
+    rbt|bit|bin) ;;
+    *) echo "$0: BENCH_EXT must be rbt, bit or bin" >&2; exit 2 ;;
+esac
+
+# Extension of a corpus file in lower case, empty if not a bitstream
+bitstream_ext() {
+    ext=$(echo "${1##*.}" | tr 'A-Z' 'a-z')
+    case $ext in rbt|bit|bin) echo "$ext" ;; esac
+}
+
+# ----------------------------------------------------------------------
+# Host runs
+# ----------------------------------------------------------------------
+# The card directory is the result directory itself; the input and
+# archive are removed again, the rest stays for the report
+run_one() {
+    src=$1 dir=$2 ext=$3
+
+    rm -rf "$dir" && mkdir -p "$dir" || return 1
+    cp "$src" "$dir/ZFO.$ext" || return 1
+
+    if ! "$HOST_DIR/compression_host" "$dir" > "$dir/comp.log" 2>&1; then
+        echo "  compression failed, see $dir/comp.log"
+        return 1
+    fi
+    mv "$dir/ENCRZFO.BIN" "$dir/ENCR.bin" || return 1
+    if ! "$HOST_DIR/decompression_host" "$dir" > "$dir/decomp.log" 2>&1; then
+        echo "  decompression failed, see $dir/decomp.log"
+        return 1
+    fi
+    rm -f "$dir/ZFO.$ext" "$dir/ENCR.bin"
+}
+
+if [ "$MODE" = run ]; then
+    for bin in compression_host decompression_host; do
+        [ -x "$HOST_DIR/$bin" ] || { echo "$0: build $bin first (make -C $HOST_DIR)" >&2; exit 2; }
+    done
+    for src in "$CORPUS"/*; do
+        name=$(basename "$src")
+        ext=$(bitstream_ext "$name")
+        [ -n "$ext" ] || continue
+        if [ "$ext" != "$BENCH_EXT" ]; then
+            echo "skip: $name (this build reads .$BENCH_EXT)"
+            continue
+        fi
+        echo "run: $name"
+        run_one "$src" "$RESULTS/$name" "$ext"
+    done
+fi
+
+# ----------------------------------------------------------------------
+# Report
+# ----------------------------------------------------------------------
+# Last data line of a run CSV
+last_run() {
+    [ -f "$1" ] && awk -F, 'NR > 1 { line = $0 } END { if (line != "") print line }' "$1" | tr -d '\r'
+}
+
+# Stage lines of the last run of a stage CSV (a run ends with "total")
+last_stages() {
+    [ -f "$1" ] && awk -F, 'NR > 1 { if (done) { n = 0; done = 0 } rows[n++] = $0
+                                         if ($2 == "total") done = 1 }
+                            END { for (i = 0; i < n; i++) print rows[i] }' "$1" | tr -d '\r'
+}
+
+# Decompressed file of a run, for the input's extension
+decomp_file() {
+    for f in "$1/DECOMP.$2" "$1/CONFIG.bin"; do
+        [ -f "$f" ] && { echo "$f"; return; }
+    done
+}
+
+round_trip() {
+    src=$1 out=$2 ext=$3
+    [ -n "$out" ] || { echo missing; return; }
+    if [ "$ext" = rbt ]; then
+        plain=$(mktemp) || { echo MISMATCH; return; }
+        tr -d '\r' < "$src" > "$plain"
+        tr -d '\r' < "$out" | cmp -s - "$plain"
+        same=$?
+        rm -f "$plain"
+        [ $same -eq 0 ]
+    else
+        cmp -s "$out" "$src"
+    fi && echo ok || echo MISMATCH
+}
+
+BENCH_CSV=$RESULTS/bench.csv
+STAGES_CSV=$RESULTS/stages.csv
+echo "design,input_bytes,archive_bytes,ratio,entropy_bits,coded_bits,coding_eff_pct,comp_peak_bytes,decomp_peak_bytes,comp_us,decomp_us,comp_mbps,decomp_mbps,round_trip" > "$BENCH_CSV"
+echo "design,app,stage,time_us,bytes_in,bytes_out,mbps" > "$STAGES_CSV"
+
+status=0
+for src in "$CORPUS"/*; do
+    name=$(basename "$src")
+    ext=$(bitstream_ext "$name")
+    [ -n "$ext" ] || continue
+    design=$name
+    dir=$RESULTS/$design
+    if [ "$ext" != "$BENCH_EXT" ]; then
+        echo "$design,,,,,,,,,,,,,skipped" >> "$BENCH_CSV"
+        continue
+    fi
+
+    runc=$(last_run "$dir/RUNC.CSV")
+    rund=$(last_run "$dir/RUND.CSV")
+    rt=$(round_trip "$src" "$(decomp_file "$dir" "$ext")" "$ext")
+    if [ -z "$runc" ] || [ -z "$rund" ] || [ "$rt" != ok ]; then
+        status=1
+        [ -n "$runc" ] && [ -n "$rund" ] || rt=FAILED
+    fi
+
+    # RUN*.CSV: app,input,plain_bytes,packed_bytes,ratio_x1000,symbols,payload_bits,
+    #           coded_mbits,entropy_mbits,peak_bytes,time_us,plain_kbps
+    printf '%s\n%s\n' "${runc:-,,,,,,,,,,,}" "${rund:-,,,,,,,,,,,}" |
+    awk -F, -v design="$design" -v rt="$rt" '
+        NR == 1 { c_plain = $3; c_packed = $4; ent = $9; coded = $8; c_peak = $10; c_us = $11 }
+        NR == 2 { d_peak = $10; d_us = $11; d_plain = $3 }
+        function mbps(bytes, us) { return (us > 0) ? sprintf("%.2f", bytes / us) : "" }
+        END {
+            printf "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s\n", design, c_plain, c_packed,
+                   (c_packed > 0 ? sprintf("%.3f", c_plain / c_packed) : ""),
+                   (ent != "" ? sprintf("%.3f", ent / 1000) : ""),
+                   (coded != "" ? sprintf("%.3f", coded / 1000) : ""),
+                   (coded > 0 ? sprintf("%.1f", 100 * ent / coded) : ""),
+                   c_peak, d_peak, c_us, d_us, mbps(c_plain, c_us), mbps(d_plain, d_us), rt
+        }' >> "$BENCH_CSV"
+
+    # PERF*.CSV: app,stage,time_us,bytes_in,bytes_out,...
+    for perf in "$dir/PERFC.CSV" "$dir/PERFD.CSV"; do
+        last_stages "$perf" | awk -F, -v design="$design" '{
+            bytes = ($4 > $5) ? $4 : $5
+            printf "%s,%s,%s,%s,%s,%s,%s\n", design, $1, $2, $3, $4, $5,
+                   ($3 > 0 ? sprintf("%.2f", bytes / $3) : "")
+        }' >> "$STAGES_CSV"
+    done
+done
+
+echo
+column -s, -t < "$BENCH_CSV" 2>/dev/null || cat "$BENCH_CSV"
+echo
+column -s, -t < "$STAGES_CSV" 2>/dev/null || cat "$STAGES_CSV"
+echo
+echo "Results in $BENCH_CSV and $STAGES_CSV (MB/s = 10^6 bytes per second)"
+[ $status -eq 0 ] || echo "FAILED: at least one bitstream did not run or round-trip"
+exit $status
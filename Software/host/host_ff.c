@@ -0,0 +1,198 @@
+/*
+ * host_ff.c
+ *
+ * Host build: the FatFs subset of ff.h on POSIX files. Paths are
+ * relative to the working directory, which stands in for the card
+ * (host_main.c changes into it). A read-only file is mapped whole at
+ * f_open; files opened for writing go through the descriptor.
+ */
+
+// dirent.h's DIR would clash with the FatFs one
+#define DIR POSIX_DIR
+#include <dirent.h>
+#undef DIR
+
+#include "ff.h"
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static FRESULT from_errno(void) {
+    switch (errno) {
+    case ENOENT: return FR_NO_FILE;
+    case EEXIST: return FR_EXIST;
+    case EACCES:
+    case EPERM:  return FR_DENIED;
+    default:     return FR_DISK_ERR;
+    }
+}
+
+FRESULT f_mount(FATFS *fs, const TCHAR *path, BYTE opt) {
+    (void)fs; (void)path; (void)opt;
+    return FR_OK;
+}
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode) {
+    int flags;
+    struct stat st;
+
+    memset(fp, 0, sizeof(*fp));
+    fp->fd = -1;
+
+    if (!(mode & FA_WRITE))
+        flags = O_RDONLY;
+    else if (mode & FA_CREATE_NEW)
+        flags = O_RDWR | O_CREAT | O_EXCL;
+    else if (mode & FA_CREATE_ALWAYS)
+        flags = O_RDWR | O_CREAT | O_TRUNC;
+    else if (mode & FA_OPEN_ALWAYS)
+        flags = O_RDWR | O_CREAT;
+    else
+        flags = O_RDWR;
+
+    int fd = open(path, flags, 0644);
+    if (fd < 0)
+        return from_errno();
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return FR_DISK_ERR;
+    }
+
+    fp->fd    = fd;
+    fp->fsize = (FSIZE_t)st.st_size;
+    if (!(mode & FA_WRITE) && st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return FR_DISK_ERR;
+        }
+        fp->map = map;
+    }
+    if ((mode & FA_OPEN_APPEND) == FA_OPEN_APPEND)
+        fp->fptr = fp->fsize;
+    return FR_OK;
+}
+
+FRESULT f_close(FIL *fp) {
+    if (fp->fd < 0)
+        return FR_INVALID_OBJECT;
+    if (fp->map)
+        munmap((void *)fp->map, fp->fsize);
+    close(fp->fd);
+    fp->fd  = -1;
+    fp->map = NULL;
+    return FR_OK;
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br) {
+    *br = 0;
+    if (fp->fd < 0)
+        return FR_INVALID_OBJECT;
+    if (fp->fptr >= fp->fsize)
+        return FR_OK;
+    if (btr > fp->fsize - fp->fptr)
+        btr = fp->fsize - fp->fptr;
+
+    if (fp->map) {
+        memcpy(buff, fp->map + fp->fptr, btr);
+    } else {
+        ssize_t n = pread(fp->fd, buff, btr, fp->fptr);
+        if (n < 0)
+            return FR_DISK_ERR;
+        btr = (UINT)n;
+    }
+    fp->fptr += btr;
+    *br = btr;
+    return FR_OK;
+}
+
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw) {
+    *bw = 0;
+    if (fp->fd < 0)
+        return FR_INVALID_OBJECT;
+    if (fp->map)
+        return FR_DENIED;
+
+    ssize_t n = pwrite(fp->fd, buff, btw, fp->fptr);
+    if (n < 0)
+        return FR_DISK_ERR;
+    fp->fptr += (FSIZE_t)n;
+    if (fp->fptr > fp->fsize)
+        fp->fsize = fp->fptr;
+    *bw = (UINT)n;
+    return (UINT)n == btw ? FR_OK : FR_DISK_ERR;
+}
+
+// As FatFs: seeking past the end of a writable file extends it
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs) {
+    if (fp->fd < 0)
+        return FR_INVALID_OBJECT;
+    if (ofs > fp->fsize) {
+        if (fp->map)
+            ofs = fp->fsize;
+        else if (ftruncate(fp->fd, ofs) != 0)
+            return FR_DISK_ERR;
+        else
+            fp->fsize = ofs;
+    }
+    fp->fptr = ofs;
+    return FR_OK;
+}
+
+FRESULT f_truncate(FIL *fp) {
+    if (fp->fd < 0)
+        return FR_INVALID_OBJECT;
+    if (fp->map)
+        return FR_DENIED;
+    if (ftruncate(fp->fd, fp->fptr) != 0)
+        return FR_DISK_ERR;
+    fp->fsize = fp->fptr;
+    return FR_OK;
+}
+
+FRESULT f_unlink(const TCHAR *path) {
+    return unlink(path) == 0 ? FR_OK : from_errno();
+}
+
+FRESULT f_mkdir(const TCHAR *path) {
+    return mkdir(path, 0755) == 0 ? FR_OK : from_errno();
+}
+
+FRESULT f_opendir(DIR *dp, const TCHAR *path) {
+    // FatFs names the root "/", the card is the working directory
+    dp->dir = opendir(strcmp(path, "/") == 0 ? "." : path);
+    return dp->dir ? FR_OK : (errno == ENOENT ? FR_NO_PATH : from_errno());
+}
+
+FRESULT f_readdir(DIR *dp, FILINFO *fno) {
+    struct dirent *de;
+    struct stat st;
+
+    memset(fno, 0, sizeof(*fno));
+    do {
+        errno = 0;
+        de = readdir((POSIX_DIR *)dp->dir);
+        if (!de)
+            return errno ? FR_DISK_ERR : FR_OK;
+    } while (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0 ||
+             strlen(de->d_name) >= sizeof(fno->fname));
+
+    snprintf(fno->fname, sizeof(fno->fname), "%s", de->d_name);
+    if (fstatat(dirfd((POSIX_DIR *)dp->dir), de->d_name, &st, 0) == 0) {
+        fno->fsize   = (FSIZE_t)st.st_size;
+        fno->fattrib = S_ISDIR(st.st_mode) ? AM_DIR : 0;
+    }
+    return FR_OK;
+}
+
+FRESULT f_closedir(DIR *dp) {
+    if (!dp->dir)
+        return FR_INVALID_OBJECT;
+    closedir((POSIX_DIR *)dp->dir);
+    dp->dir = NULL;
+    return FR_OK;
+}
@@ -0,0 +1,90 @@
+/*
+ * host_main.c
+ *
+ * Host build entry point. compression.c / decompression.c are built
+ * with -Dmain=app_main; this main sets up what the Zynq would provide
+ * and runs it:
+ *
+ *   - DDR: the pipeline buffers are absolute addresses (MEMORY_BASE_ADDR,
+ *     ARCHIVE_BUF_ADDR, ...), so HOST_DDR_BASE .. + HOST_DDR_SIZE is
+ *     mapped at the same place
+ *   - 32-bit pointers: the code passes buffer addresses as u32, so the
+ *     binary is linked non-PIE, the heap stays in brk (below 4 GB) and
+ *     app_main gets a stack in the low 2 GB. The process re-executes
+ *     itself once without address randomisation, which could otherwise
+ *     start the brk heap anywhere in the first GB, DDR window included
+ *   - the SD card: the directory given on the command line (default:
+ *     the current one) becomes the working directory
+ *
+ * usage: compression_host [card_dir]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/personality.h>
+
+#define HOST_DDR_BASE    0x10000000UL   // lowest buffer of either application
+#define HOST_DDR_SIZE    0x10000000UL   // up to RBT_BUF_ADDR + RBT_MAX_BYTES
+#define HOST_STACK_SIZE  (64UL << 20)
+
+int app_main(void);
+
+static int app_rc;
+
+static void *run_app(void *arg) {
+    (void)arg;
+    app_rc = app_main();
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int persona = personality(0xffffffff);
+    if (persona != -1 && !(persona & ADDR_NO_RANDOMIZE)) {
+        personality(persona | ADDR_NO_RANDOMIZE);
+        execv("/proc/self/exe", argv);
+        perror("re-executing without address randomisation");
+        return 2;
+    }
+
+    if (argc > 1 && chdir(argv[1]) != 0) {
+        perror(argv[1]);
+        return 2;
+    }
+
+    // Every allocation from the main arena's brk heap, never from a
+    // high mmap or a per-thread arena
+    mallopt(M_MMAP_THRESHOLD, 1 << 30);
+    mallopt(M_ARENA_MAX, 1);
+
+    void *ddr = mmap((void *)HOST_DDR_BASE, HOST_DDR_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (ddr != (void *)HOST_DDR_BASE) {
+        perror("mapping the DDR window");
+        return 2;
+    }
+
+    void *stack = mmap(NULL, HOST_STACK_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (stack == MAP_FAILED) {
+        perror("mapping the stack");
+        return 2;
+    }
+
+    pthread_attr_t attr;
+    pthread_t app;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, HOST_STACK_SIZE);
+    if (pthread_create(&app, &attr, run_app, NULL) != 0) {
+        perror("starting the application");
+        return 2;
+    }
+    pthread_join(app, NULL);
+
+    fflush(stdout);
+    return app_rc;
+}
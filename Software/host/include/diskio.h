@@ -0,0 +1,18 @@
+/*
+ * diskio.h (host build)
+ *
+ * Declared for perf.h only: the host ff.h has neither FF_USE_EXPAND
+ * nor FF_USE_FASTSEEK, so sdcard.c never issues sector commands.
+ */
+
+#ifndef DISKIO_H
+#define DISKIO_H
+
+#include "ff.h"
+
+typedef enum { RES_OK = 0, RES_ERROR, RES_WRPRT, RES_NOTRDY, RES_PARERR } DRESULT;
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count);
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count);
+
+#endif
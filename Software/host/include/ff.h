@@ -0,0 +1,81 @@
+/*
+ * ff.h (host build)
+ *
+ * The FatFs calls the applications make, on POSIX files in the
+ * current directory (see host_ff.c). A file opened for reading is
+ * mapped, so f_read is a copy out of the page cache. Directory
+ * entries come back with their POSIX names, which may be long.
+ */
+
+#ifndef FF_H
+#define FF_H
+
+#include "xil_types.h"
+
+#define FF_USE_EXPAND    0    // sdcard.c: no contiguous preallocation
+#define FF_USE_FASTSEEK  0    // sdcard.c: no cluster map, f_read only
+
+typedef unsigned int  UINT;
+typedef unsigned char BYTE;
+typedef char          TCHAR;
+typedef u16           WORD;
+typedef u32           DWORD;
+typedef u32           FSIZE_t;
+
+typedef enum {
+    FR_OK = 0, FR_DISK_ERR, FR_INT_ERR, FR_NOT_READY, FR_NO_FILE,
+    FR_NO_PATH, FR_INVALID_NAME, FR_DENIED, FR_EXIST, FR_INVALID_OBJECT,
+    FR_WRITE_PROTECTED, FR_INVALID_DRIVE, FR_NOT_ENABLED, FR_NO_FILESYSTEM,
+    FR_MKFS_ABORTED, FR_TIMEOUT, FR_LOCKED, FR_NOT_ENOUGH_CORE,
+    FR_TOO_MANY_OPEN_FILES, FR_INVALID_PARAMETER
+} FRESULT;
+
+#define FA_READ           0x01
+#define FA_WRITE          0x02
+#define FA_OPEN_EXISTING  0x00
+#define FA_CREATE_NEW     0x04
+#define FA_CREATE_ALWAYS  0x08
+#define FA_OPEN_ALWAYS    0x10
+#define FA_OPEN_APPEND    0x30
+
+typedef struct {
+    int dummy;
+} FATFS;
+
+typedef struct {
+    int       fd;          // -1: closed
+    const u8 *map;         // whole file, read-only opens
+    FSIZE_t   fsize;
+    FSIZE_t   fptr;
+} FIL;
+
+#define AM_DIR            0x10
+
+typedef struct {
+    void     *dir;         // the POSIX directory stream
+} DIR;
+
+typedef struct {
+    FSIZE_t   fsize;
+    BYTE      fattrib;
+    TCHAR     fname[256];  // "" after the last entry
+} FILINFO;
+
+FRESULT f_mount(FATFS *fs, const TCHAR *path, BYTE opt);
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode);
+FRESULT f_close(FIL *fp);
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br);
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw);
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs);
+FRESULT f_truncate(FIL *fp);
+FRESULT f_unlink(const TCHAR *path);
+FRESULT f_mkdir(const TCHAR *path);
+FRESULT f_opendir(DIR *dp, const TCHAR *path);
+FRESULT f_readdir(DIR *dp, FILINFO *fno);
+FRESULT f_closedir(DIR *dp);
+
+#define f_size(fp)  ((fp)->fsize)
+#define f_tell(fp)  ((fp)->fptr)
+#define f_eof(fp)   ((fp)->fptr >= (fp)->fsize)
+
+#endif
@@ -0,0 +1,8 @@
+/*
+ * sdCard.h (host build)
+ *
+ * The applications include "sdCard.h"; the header in this tree is
+ * sdcard.h, which a case-sensitive file system does not match.
+ */
+
+#include "sdcard.h"
@@ -0,0 +1,16 @@
+/*
+ * xil_cache.h (host build)
+ *
+ * The models read and write host memory directly: nothing to maintain.
+ */
+
+#ifndef XIL_CACHE_H
+#define XIL_CACHE_H
+
+#include "xil_types.h"
+
+static inline void Xil_DCacheFlush(void) {}
+static inline void Xil_DCacheFlushRange(UINTPTR addr, u32 len) { (void)addr; (void)len; }
+static inline void Xil_DCacheInvalidateRange(UINTPTR addr, u32 len) { (void)addr; (void)len; }
+
+#endif
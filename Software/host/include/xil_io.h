@@ -0,0 +1,18 @@
+/*
+ * xil_io.h (host build)
+ *
+ * Register accesses go to the IP models (ip_compression.c or
+ * ip_decompression.c, whichever the application is linked with).
+ */
+
+#ifndef XIL_IO_H
+#define XIL_IO_H
+
+#include "xil_types.h"
+
+void Xil_Out32(UINTPTR addr, u32 value);
+u32  Xil_In32(UINTPTR addr);
+void Xil_Out8(UINTPTR addr, u8 value);
+u8   Xil_In8(UINTPTR addr);
+
+#endif
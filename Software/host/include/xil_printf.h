@@ -0,0 +1,12 @@
+/*
+ * xil_printf.h (host build)
+ */
+
+#ifndef XIL_PRINTF_H
+#define XIL_PRINTF_H
+
+#include <stdio.h>
+
+#define xil_printf printf
+
+#endif
@@ -0,0 +1,10 @@
+/*
+ * xparameters.h (host build)
+ */
+
+#ifndef XPARAMETERS_H
+#define XPARAMETERS_H
+
+#define XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ  666666687
+
+#endif
@@ -0,0 +1,11 @@
+/*
+ * xpseudo_asm.h (host build)
+ */
+
+#ifndef XPSEUDO_ASM_H
+#define XPSEUDO_ASM_H
+
+#define dmb()  __sync_synchronize()
+#define sev()  do { } while (0)
+
+#endif
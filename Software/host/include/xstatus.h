@@ -0,0 +1,11 @@
+/*
+ * xstatus.h (host build)
+ */
+
+#ifndef XSTATUS_H
+#define XSTATUS_H
+
+#define XST_SUCCESS  0L
+#define XST_FAILURE  1L
+
+#endif
@@ -0,0 +1,23 @@
+/*
+ * xtime_l.h (host build)
+ *
+ * The global timer is CLOCK_MONOTONIC in nanoseconds.
+ */
+
+#ifndef XTIME_L_H
+#define XTIME_L_H
+
+#include <time.h>
+#include "xil_types.h"
+
+typedef u64 XTime;
+
+#define COUNTS_PER_SECOND  1000000000ULL
+
+static inline void XTime_GetTime(XTime *t) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    *t = (u64)ts.tv_sec * COUNTS_PER_SECOND + (u64)ts.tv_nsec;
+}
+
+#endif
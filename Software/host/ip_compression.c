@@ -0,0 +1,302 @@
+/*
+ * ip_compression.c
+ *
+ * Host build: C models of the compression IP cores behind Xil_In32 /
+ * Xil_Out32, at the base addresses and register offsets compression.c
+ * uses. Each model follows the register behaviour of its RTL core
+ * (Hardware/RTL/Compression), not its timing: every result is ready
+ * by the time software reads it.
+ *
+ *   0x43C00000  bit_parser         word at 0x00, symbols at 0x04-0x10
+ *   0x43C10000  frequency_counter  load handshake, symbol_we, burst
+ *   0x43C20000  huffman            lookups, load handshake, table
+ *                                  window + commit, bit packer,
+ *                                  CRC of the popped words
+ *   0x43C30000  Encrypt            (~data) ^ key
+ *
+ * The perf_counters block (0x200-0x218) of every core reads as zero.
+ * axis_compression_chain is not modelled: build with AXIS_DMA = 0.
+ */
+
+#include "xil_io.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BITPARSER_BASE  0x43C00000
+#define FREQ_BASE       0x43C10000
+#define HUFFMAN_BASE    0x43C20000
+#define ENCRYPT_BASE    0x43C30000
+#define IP_SPAN         0x10000
+
+#define PERF_BLOCK_LO   0x200
+#define PERF_BLOCK_HI   0x218
+#define TABLE_WINDOW    0x400
+#define PACK_FIFO_DEPTH 16
+
+// ----------------------------------------------------------------------
+// bit_parser
+// ----------------------------------------------------------------------
+static u32 bp_word;
+
+static u32 bit_parser_read(u32 off) {
+    if (off >= 0x04 && off <= 0x10)
+        return (bp_word >> (32 - 2 * off)) & 0xFF;   // 0x04: bits 31:24 ... 0x10: bits 7:0
+    return 0;
+}
+
+// ----------------------------------------------------------------------
+// frequency_counter
+// ----------------------------------------------------------------------
+static struct {
+    u32 table[256];
+    u32 symbol, addr, load, done, saturated;
+    u32 burst_ctrl, block_words, words_in, block_done;
+} fc;
+
+static void fc_count(u32 symbol) {
+    if (fc.table[symbol] == 0xFFFFFFFF)
+        fc.saturated = 1;
+    else
+        fc.table[symbol]++;
+}
+
+static void freq_write(u32 off, u32 v) {
+    switch (off) {
+    case 0x00:                                   // symbol register, symbol_we
+        fc.symbol = v & 0xFF;
+        fc_count(fc.symbol);
+        break;
+    case 0x04:                                   // load (level)
+        if ((v & 1) && !fc.load) {
+            fc_count(fc.symbol);
+            fc.done = 1;
+        } else if (!(v & 1)) {
+            fc.done = 0;
+        }
+        fc.load = v & 1;
+        break;
+    case 0x10:
+        fc.addr = v & 0xFF;
+        break;
+    case 0x14:                                   // {clear[1], burst[0]}
+        if ((v & 2) && !(fc.burst_ctrl & 2)) {
+            memset(fc.table, 0, sizeof(fc.table));
+            fc.saturated  = 0;
+            fc.done       = 0;
+            fc.words_in   = 0;
+            fc.block_done = 0;
+        }
+        fc.burst_ctrl = v;
+        if ((v & 1) && fc.block_words == 0)      // an empty block is done at once
+            fc.block_done = 1;
+        break;
+    case 0x18:
+        fc.block_words = v;
+        break;
+    case 0x1C:                                   // one word to the stream port
+        if ((fc.burst_ctrl & 1) && fc.words_in < fc.block_words) {
+            for (int k = 0; k < 4; k++)
+                fc_count((v >> (24 - 8 * k)) & 0xFF);
+            if (++fc.words_in == fc.block_words)
+                fc.block_done = 1;
+        }
+        break;
+    }
+}
+
+static u32 freq_read(u32 off) {
+    switch (off) {
+    case 0x08: return fc.done;
+    case 0x0C: return fc.table[fc.addr];
+    case 0x20: return (fc.saturated << 1) | fc.block_done;
+    }
+    return 0;
+}
+
+// ----------------------------------------------------------------------
+// huffman (encoder + bit_packer)
+// ----------------------------------------------------------------------
+static struct {
+    u16 code[2][256];
+    u8  length[2][256];
+    u32 bank;
+    u32 symbol, valid_in, valid_out, held, seq;
+    u32 code_word, code_length;
+    u32 load_symbol, load_code, load_length, load_valid, load_done;
+    u32 commit, pack_ctrl;
+    // bit_packer
+    u64 acc;
+    u32 acc_bits, total_bits, overflow;
+    u32 fifo[PACK_FIFO_DEPTH], fifo_rd, fifo_count;
+    u32 pack_crc;                                // running, inverted on read
+} he;
+
+// One word into a running CRC-32 (reflected, top byte first), as
+// crc32_words in the RTL; the register reads ~state
+static u32 crc32_fold(u32 state, u32 word) {
+    for (int i = 0; i < 32; i++) {
+        u32 bit = (word >> (24 - 8 * (i / 8) + (i % 8))) & 1;
+        state = (state >> 1) ^ (((state ^ bit) & 1) ? 0xEDB88320u : 0);
+    }
+    return state;
+}
+
+static void pack_push(u32 word) {
+    if (he.fifo_count == PACK_FIFO_DEPTH) {
+        he.overflow = 1;
+        return;
+    }
+    he.fifo[(he.fifo_rd + he.fifo_count++) % PACK_FIFO_DEPTH] = word;
+}
+
+static void pack_append(u32 code, u32 length) {
+    he.acc = (he.acc << length) | code;
+    he.acc_bits   += length;
+    he.total_bits += length;
+    if (he.acc_bits >= 32) {
+        he.acc_bits -= 32;
+        pack_push((u32)(he.acc >> he.acc_bits));
+    }
+}
+
+static void huffman_lookup(u32 symbol, int held) {
+    he.code_word   = he.code[he.bank][symbol];
+    he.code_length = he.length[he.bank][symbol];
+    he.valid_out   = 1;
+    he.held        = held;
+    he.seq        ^= 1;
+    pack_append(he.code_word, he.code_length);
+}
+
+static void huffman_write(u32 off, u32 v) {
+    if (off >= TABLE_WINDOW && off < TABLE_WINDOW + 4 * 256) {
+        u32 s = (off - TABLE_WINDOW) / 4;
+        he.code[!he.bank][s]   = v & 0xFFFF;
+        he.length[!he.bank][s] = (v >> 16) & 0x1F;
+        return;
+    }
+
+    switch (off) {
+    case 0x00:                                   // symbol register, symbol_we
+        he.symbol = v & 0xFF;
+        huffman_lookup(he.symbol, 1);
+        break;
+    case 0x04:                                   // valid_in (level)
+        if ((v & 1) && !he.valid_in)
+            huffman_lookup(he.symbol, 0);
+        else if (!(v & 1) && !he.held)
+            he.valid_out = 0;
+        he.valid_in = v & 1;
+        break;
+    case 0x14: he.load_symbol = v & 0xFF;   break;
+    case 0x18: he.load_code   = v & 0xFFFF; break;
+    case 0x1C: he.load_length = v & 0x1F;   break;
+    case 0x20:                                   // load_valid (level)
+        if ((v & 1) && !he.load_valid) {
+            he.code[he.bank][he.load_symbol]   = he.load_code;
+            he.length[he.bank][he.load_symbol] = he.load_length;
+            he.load_done = 1;
+        } else if (!(v & 1)) {
+            he.load_done = 0;
+        }
+        he.load_valid = v & 1;
+        break;
+    case 0x28: {                                 // {flush[1], clear[0]}
+        u32 rise = v & ~he.pack_ctrl;
+        if (rise & 1) {
+            he.acc = 0;
+            he.acc_bits = he.total_bits = he.overflow = 0;
+            he.fifo_rd = he.fifo_count = 0;
+            he.pack_crc = 0xFFFFFFFF;
+        }
+        if ((rise & 2) && he.acc_bits) {
+            pack_push((u32)(he.acc << (32 - he.acc_bits)));
+            he.acc = 0;
+            he.acc_bits = 0;
+        }
+        he.pack_ctrl = v;
+        break;
+    }
+    case 0x38:                                   // table_commit (level)
+        if ((v & 1) && !he.commit)
+            he.bank ^= 1;
+        he.commit = v & 1;
+        break;
+    }
+}
+
+static u32 huffman_read(u32 off) {
+    switch (off) {
+    case 0x08: return he.valid_out;
+    case 0x0C: return he.code_word;
+    case 0x10: return he.code_length;
+    case 0x24: return he.load_done;
+    case 0x2C: {                                 // pops the FIFO
+        u32 w = he.fifo[he.fifo_rd];
+        if (he.fifo_count) {
+            he.fifo_rd = (he.fifo_rd + 1) % PACK_FIFO_DEPTH;
+            he.fifo_count--;
+            he.pack_crc = crc32_fold(he.pack_crc, w);
+        }
+        return w;
+    }
+    case 0x30: return (he.overflow << 5) | he.fifo_count;
+    case 0x34: return he.total_bits;
+    case 0x3C: return (he.valid_out << 31) | (he.seq << 30) |
+                      (he.code_length << 16) | he.code_word;
+    case 0x40: return ~he.pack_crc;
+    }
+    return 0;
+}
+
+// ----------------------------------------------------------------------
+// Encrypt
+// ----------------------------------------------------------------------
+static u32 enc_data, enc_key;
+
+// ----------------------------------------------------------------------
+// Register access
+// ----------------------------------------------------------------------
+void Xil_Out32(UINTPTR addr, u32 value) {
+    u32 base = addr & ~(IP_SPAN - 1), off = addr & (IP_SPAN - 1);
+
+    if (off >= PERF_BLOCK_LO && off <= PERF_BLOCK_HI)
+        return;
+
+    switch (base) {
+    case BITPARSER_BASE: if (off == 0x00) bp_word = value; return;
+    case FREQ_BASE:      freq_write(off, value);          return;
+    case HUFFMAN_BASE:   huffman_write(off, value);       return;
+    case ENCRYPT_BASE:
+        if (off == 0x00)
+            enc_data = value;
+        else if (off == 0x04)
+            enc_key = value;
+        return;
+    }
+    fprintf(stderr, "host: write to unmapped address 0x%08lx\n", (unsigned long)addr);
+}
+
+u32 Xil_In32(UINTPTR addr) {
+    u32 base = addr & ~(IP_SPAN - 1), off = addr & (IP_SPAN - 1);
+
+    if (off >= PERF_BLOCK_LO && off <= PERF_BLOCK_HI)
+        return 0;
+
+    switch (base) {
+    case BITPARSER_BASE: return bit_parser_read(off);
+    case FREQ_BASE:      return freq_read(off);
+    case HUFFMAN_BASE:   return huffman_read(off);
+    case ENCRYPT_BASE:   return off == 0x08 ? (~enc_data) ^ enc_key : 0;
+    }
+    fprintf(stderr, "host: read from unmapped address 0x%08lx\n", (unsigned long)addr);
+    return 0;
+}
+
+void Xil_Out8(UINTPTR addr, u8 value) {
+    Xil_Out32(addr, value);
+}
+
+u8 Xil_In8(UINTPTR addr) {
+    return (u8)Xil_In32(addr);
+}
@@ -0,0 +1,286 @@
+/*
+ * ip_decompression.c
+ *
+ * Host build: C models of the decompression IP cores behind Xil_In32
+ * / Xil_Out32 / Xil_Out8, at the base addresses and register offsets
+ * decompression.c uses. As in ip_compression.c the models follow the
+ * register behaviour of the RTL (Hardware/RTL/Decompression), not its
+ * timing.
+ *
+ *   0x43C00000  bit_merger   bytes at 0x00-0x0C, word at 0x10
+ *   0x43C10000  Huffman decoder, chosen at build time like the
+ *               bitstream: HOST_STREAM_DECODER = 1 models
+ *               huffman_stream_decoder, 0 huffman_decoder (must match
+ *               STREAM_DECODER in decompression.c); the stream
+ *               decoder keeps the CRC of the words pushed since start
+ *   0x43C20000  decrypt      ~(data ^ key)
+ *
+ * The perf_counters block (0x200-0x218) of every core reads as zero.
+ * axis_decompression_chain is not modelled: build with AXIS_DMA = 0.
+ */
+
+#include "xil_io.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifndef HOST_STREAM_DECODER
+#define HOST_STREAM_DECODER 1
+#endif
+
+#define MERGE_BASE      0x43C00000
+#define HUFFDEC_BASE    0x43C10000
+#define DECRYPT_BASE    0x43C20000
+#define IP_SPAN         0x10000
+
+#define PERF_BLOCK_LO   0x200
+#define PERF_BLOCK_HI   0x218
+#define TABLE_WINDOW    0x400
+#define LUT_BITS        12          // STREAM_LUT_BITS of decompression.c
+#define LUT_BANKS       4           // DECODER_BANKS of decompression.c
+
+// ----------------------------------------------------------------------
+// bit_merger
+// ----------------------------------------------------------------------
+static u8 merge_in[4];
+
+// ----------------------------------------------------------------------
+// Huffman decoder: registers both cores share
+// ----------------------------------------------------------------------
+static struct {
+    u32 load_valid, load_length, load_code, load_symbol, load_done;
+    u32 window[256];
+    u32 commit;
+    // huffman_decoder
+    u16 code[256];
+    u8  length[256];
+    u32 code_in, length_in;
+    // huffman_stream_decoder
+    u16 lut[LUT_BANKS][1 << LUT_BITS];   // {length[12:8], symbol[7:0]}
+    u32 bank;                        // table_bank
+    u64 bitbuf;                      // left-aligned, bitcnt bits valid
+    u32 bitcnt, remaining, symbol_count;
+    u32 running, done, error, start;
+    u32 symbol_valid, symbol_out;    // {length[12:8], symbol[7:0]}
+    u32 word_crc;                    // running, inverted on read
+} hd;
+
+// One word into a running CRC-32 (reflected, top byte first), as
+// crc32_words in the RTL; the register reads ~state
+static u32 crc32_fold(u32 state, u32 word) {
+    for (int i = 0; i < 32; i++) {
+        u32 bit = (word >> (24 - 8 * (i / 8) + (i % 8))) & 1;
+        state = (state >> 1) ^ (((state ^ bit) & 1) ? 0xEDB88320u : 0);
+    }
+    return state;
+}
+
+static void lut_fill(u32 symbol, u32 code, u32 length) {
+    if (length == 0 || length > LUT_BITS) {
+        hd.error = 1;
+        return;
+    }
+    u32 first = (code & ((1u << length) - 1)) << (LUT_BITS - length);
+    for (u32 k = 0; k < (1u << (LUT_BITS - length)); k++)
+        hd.lut[hd.bank][first + k] = (u16)((length << 8) | symbol);
+}
+
+// Decode as far as the output slot and the buffered bits allow; the
+// core does this every clock
+static void stream_step(void) {
+    while (hd.running && !hd.symbol_valid) {
+        u32 entry  = hd.lut[hd.bank][hd.bitbuf >> (64 - LUT_BITS)];
+        u32 length = entry >> 8;
+        if (length == 0) {
+            if (hd.bitcnt >= LUT_BITS) {
+                hd.running = 0;
+                hd.error   = 1;
+            }
+            return;
+        }
+        if (hd.bitcnt < length)
+            return;
+        hd.symbol_out   = entry;
+        hd.symbol_valid = 1;
+        hd.bitbuf     <<= length;
+        hd.bitcnt      -= length;
+        if (--hd.remaining == 0) {
+            hd.running = 0;
+            hd.done    = 1;
+        }
+    }
+}
+
+static int word_ready(void) {
+    return hd.running && hd.bitcnt <= 32;
+}
+
+static void huffdec_write(u32 off, u32 v) {
+    if (off >= TABLE_WINDOW && off < TABLE_WINDOW + 4 * 256) {
+        u32 s = (off - TABLE_WINDOW) / 4;
+        hd.window[s] = v;
+        if (!HOST_STREAM_DECODER) {               // written straight into the table
+            hd.code[s]   = v & 0xFFFF;
+            hd.length[s] = (v >> 16) & 0x1F;
+        }
+        return;
+    }
+
+    switch (off) {
+    case 0x00:                                   // load_valid (level)
+        if ((v & 1) && !hd.load_valid) {
+            if (HOST_STREAM_DECODER) {
+                lut_fill(hd.load_symbol, hd.load_code, hd.load_length);
+            } else {
+                hd.code[hd.load_symbol]   = hd.load_code;
+                hd.length[hd.load_symbol] = hd.load_length;
+            }
+            hd.load_done = 1;
+        } else if (!(v & 1)) {
+            hd.load_done = 0;
+        }
+        hd.load_valid = v & 1;
+        return;
+    case 0x04: hd.load_length = v & 0x1F;   return;
+    case 0x08: hd.load_code   = v & 0xFFFF; return;
+    case 0x0C: hd.load_symbol = v & 0xFF;   return;
+    }
+
+    if (!HOST_STREAM_DECODER) {
+        if (off == 0x18)
+            hd.length_in = v & 0x1F;
+        else if (off == 0x1C)
+            hd.code_in = v & 0xFFFF;
+        return;
+    }
+
+    switch (off) {
+    case 0x14:                                   // start (level)
+        if ((v & 1) && !hd.start) {
+            hd.bitbuf       = 0;
+            hd.bitcnt       = 0;
+            hd.remaining    = hd.symbol_count;
+            hd.running      = hd.symbol_count != 0;
+            hd.done         = hd.symbol_count == 0;
+            hd.error        = 0;
+            hd.symbol_valid = 0;
+            hd.word_crc     = 0xFFFFFFFF;
+        }
+        hd.start = v & 1;
+        break;
+    case 0x18:
+        hd.symbol_count = v;
+        break;
+    case 0x1C:                                   // push one payload word
+        if (!word_ready()) {
+            fprintf(stderr, "host: stream decoder word pushed while not ready\n");
+            return;
+        }
+        hd.bitbuf |= ((u64)v << 32) >> hd.bitcnt;
+        hd.bitcnt += 32;
+        hd.word_crc = crc32_fold(hd.word_crc, v);
+        stream_step();
+        break;
+    case 0x28:                                   // table_commit (level)
+        if ((v & 1) && !hd.commit) {
+            for (u32 s = 0; s < 256; s++)
+                if ((hd.window[s] >> 16) & 0x1F)
+                    lut_fill(s, hd.window[s] & 0xFFFF, (hd.window[s] >> 16) & 0x1F);
+        }
+        hd.commit = v & 1;
+        break;
+    case 0x2C:                                   // table_bank
+        hd.bank = v % LUT_BANKS;
+        break;
+    }
+}
+
+static u32 huffdec_read(u32 off) {
+    if (off == 0x10)
+        return hd.load_done;
+
+    if (!HOST_STREAM_DECODER) {
+        if (off != 0x20)
+            return 0;
+        u32 symbol = 0;                          // linear search, last match wins
+        for (u32 s = 0; s < 256; s++)
+            if (hd.length[s] == hd.length_in && hd.code[s] == hd.code_in)
+                symbol = s;
+        return symbol;
+    }
+
+    stream_step();
+    switch (off) {
+    case 0x20: {                                 // pops when valid
+        u32 r = hd.symbol_valid ? 0x80000000 | hd.symbol_out : 0;
+        hd.symbol_valid = 0;
+        stream_step();
+        return r;
+    }
+    case 0x24:                                   // table_busy never shows: fills are instant
+        return (hd.symbol_valid << 3) | (word_ready() << 2) | (hd.error << 1) | hd.done;
+    case 0x30:
+        return ~hd.word_crc;
+    }
+    return 0;
+}
+
+// ----------------------------------------------------------------------
+// decrypt
+// ----------------------------------------------------------------------
+static u32 dec_data, dec_key;
+
+// ----------------------------------------------------------------------
+// Register access
+// ----------------------------------------------------------------------
+void Xil_Out32(UINTPTR addr, u32 value) {
+    u32 base = addr & ~(IP_SPAN - 1), off = addr & (IP_SPAN - 1);
+
+    if (off >= PERF_BLOCK_LO && off <= PERF_BLOCK_HI)
+        return;
+
+    switch (base) {
+    case MERGE_BASE:
+        if (off <= 0x0C)
+            merge_in[off / 4] = (u8)value;
+        return;
+    case HUFFDEC_BASE:
+        huffdec_write(off, value);
+        return;
+    case DECRYPT_BASE:
+        if (off == 0x00)
+            dec_data = value;
+        else if (off == 0x04)
+            dec_key = value;
+        return;
+    }
+    fprintf(stderr, "host: write to unmapped address 0x%08lx\n", (unsigned long)addr);
+}
+
+u32 Xil_In32(UINTPTR addr) {
+    u32 base = addr & ~(IP_SPAN - 1), off = addr & (IP_SPAN - 1);
+
+    if (off >= PERF_BLOCK_LO && off <= PERF_BLOCK_HI)
+        return 0;
+
+    switch (base) {
+    case MERGE_BASE:
+        if (off != 0x10)
+            return 0;
+        return ((u32)merge_in[0] << 24) | ((u32)merge_in[1] << 16) |
+               ((u32)merge_in[2] << 8) | merge_in[3];
+    case HUFFDEC_BASE:
+        return huffdec_read(off);
+    case DECRYPT_BASE:
+        return off == 0x08 ? ~(dec_data ^ dec_key) : 0;
+    }
+    fprintf(stderr, "host: read from unmapped address 0x%08lx\n", (unsigned long)addr);
+    return 0;
+}
+
+void Xil_Out8(UINTPTR addr, u8 value) {
+    Xil_Out32(addr, value);
+}
+
+u8 Xil_In8(UINTPTR addr) {
+    return (u8)Xil_In32(addr);
+}
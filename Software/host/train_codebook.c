@@ -0,0 +1,160 @@
+/*
+ * train_codebook.c
+ *
+ * Host tool: builds a trained codebook (codebook.h) from the FREZFO.txt
+ * histograms of a corpus of bitstreams, for compression with
+ * TRAINED_CODEBOOK.
+ *
+ * The histograms are summed, so the code minimises the total payload
+ * of the corpus. Every symbol then gets at least a count of 1: the
+ * compressor never looks at its input, so the codebook has to code
+ * all 256 symbols. Code lengths are limited to MAX_BITS (default 12,
+ * the stream decoder's LUT_BITS) and must not exceed MAX_CODE_LEN of
+ * the compressor.
+ *
+ * The codebook is written to DIR/XXXXXXXX.CB, XXXXXXXX being its ID:
+ * copy it to the card of both applications and set TRAINED_CODEBOOK to
+ * 0xXXXXXXXX. For each histogram the tool prints the bits per symbol
+ * of the trained code against those of the file's own codebook, i.e.
+ * what skipping the histogram pass costs on that bitstream.
+ *
+ * FREZFO.txt is written by the compressor's file stages (STAGE_FILES
+ * = 1, CLEANUP = 0): a two-line header, then one "SYMBOL FREQUENCY"
+ * line per used symbol, the symbol as 8 '0'/'1' characters.
+ *
+ * usage: train_codebook [-b MAX_BITS] DIR FREZFO.txt...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "codebook.h"
+
+#define MAX_INPUTS  1024
+
+typedef struct {
+    const char *name;
+    u32 freqs[CODEBOOK_SYMBOLS];
+    u64 symbols;
+} Histogram;
+
+static Histogram hist[MAX_INPUTS];
+
+// FREZFO.txt -> h; lines that are not "SYMBOL FREQUENCY" are skipped
+static int read_histogram(const char *name, Histogram *h) {
+    FILE *f = fopen(name, "r");
+    if (!f) {
+        perror(name);
+        return -1;
+    }
+
+    char line[128], sym[16];
+    unsigned long freq;
+    memset(h, 0, sizeof(*h));
+    h->name = name;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%15s %lu", sym, &freq) != 2 || strlen(sym) != 8 ||
+            strspn(sym, "01") != 8)
+            continue;
+        u32 s = (u32)strtoul(sym, NULL, 2);
+        h->freqs[s] += (u32)freq;
+        h->symbols  += freq;
+    }
+    fclose(f);
+
+    if (h->symbols == 0) {
+        fprintf(stderr, "%s: no histogram lines\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+// Payload bits of histogram freqs coded with lengths, per symbol
+static double bits_per_symbol(const u32 *freqs, const u8 *lengths, u64 symbols) {
+    u64 bits = 0;
+    for (int s = 0; s < CODEBOOK_SYMBOLS; s++)
+        bits += (u64)freqs[s] * lengths[s];
+    return (double)bits / symbols;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [-b MAX_BITS] DIR FREZFO.txt...\n", argv0);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    int max_bits = 12, arg = 1;
+
+    if (arg + 1 < argc && strcmp(argv[arg], "-b") == 0) {
+        max_bits = atoi(argv[arg + 1]);
+        arg += 2;
+    }
+    if (argc - arg < 2 || max_bits < 8 || max_bits > CODEBOOK_LIMIT_BITS)
+        usage(argv[0]);
+    const char *dir = argv[arg++];
+
+    int n = argc - arg;
+    if (n > MAX_INPUTS) {
+        fprintf(stderr, "at most %d histograms\n", MAX_INPUTS);
+        return 2;
+    }
+
+    u64 total[CODEBOOK_SYMBOLS] = {0}, peak = 0;
+    for (int i = 0; i < n; i++) {
+        if (read_histogram(argv[arg + i], &hist[i]) != 0)
+            return 1;
+        for (int s = 0; s < CODEBOOK_SYMBOLS; s++)
+            total[s] += hist[i].freqs[s];
+    }
+
+    // Scale the sums into the u32 counts package-merge takes, then
+    // give every symbol a codeword
+    int shift = 0;
+    for (int s = 0; s < CODEBOOK_SYMBOLS; s++)
+        if (total[s] > peak)
+            peak = total[s];
+    while ((peak >> shift) > 0x7FFFFFFFu)
+        shift++;
+
+    static CodebookFile cb;
+    u32 freqs[CODEBOOK_SYMBOLS];
+    for (int s = 0; s < CODEBOOK_SYMBOLS; s++)
+        freqs[s] = (u32)(total[s] >> shift) + 1;
+
+    if (codebook_limit_lengths(freqs, max_bits, cb.lengths) != 0) {
+        fprintf(stderr, "cannot build codes of at most %d bits\n", max_bits);
+        return 1;
+    }
+    cb.magic = CODEBOOK_FILE_MAGIC;
+    cb.id    = codebook_id(cb.lengths);
+
+    char name[CODEBOOK_NAME_MAX], path[4096];
+    codebook_file_name(cb.id, name);
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(&cb, sizeof(cb), 1, f) != 1 || fclose(f) != 0) {
+        perror(path);
+        return 1;
+    }
+
+    int longest = 0;
+    for (int s = 0; s < CODEBOOK_SYMBOLS; s++)
+        if (cb.lengths[s] > longest)
+            longest = cb.lengths[s];
+    printf("Trained codebook %08X from %d histograms, longest codeword %d bits: %s\n",
+           cb.id, n, longest, path);
+    printf("Compress with TRAINED_CODEBOOK 0x%08X (MAX_CODE_LEN >= %d)\n\n", cb.id, longest);
+
+    printf("%-32s %12s %10s %10s %8s\n", "histogram", "symbols", "own b/s", "trained", "cost");
+    for (int i = 0; i < n; i++) {
+        u8 own[CODEBOOK_SYMBOLS];
+        if (codebook_limit_lengths(hist[i].freqs, max_bits, own) != 0)
+            continue;
+        double b_own     = bits_per_symbol(hist[i].freqs, own, hist[i].symbols);
+        double b_trained = bits_per_symbol(hist[i].freqs, cb.lengths, hist[i].symbols);
+        printf("%-32s %12llu %10.4f %10.4f %7.2f%%\n", hist[i].name,
+               (unsigned long long)hist[i].symbols, b_own, b_trained,
+               100.0 * (b_trained - b_own) / b_own);
+    }
+    return 0;
+}
@@ -0,0 +1,315 @@
+/*
+ * perf.c
+ *
+ * Per-stage instrumentation shared by the compression and
+ * decompression applications. See perf.h.
+ */
+
+#include "perf.h"
+#include "xil_printf.h"
+#include "sdCard.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TICKS_PER_US  (COUNTS_PER_SECOND / 1000000)
+
+PerfCounters perf_now;
+PerfRun      perf_run;
+
+static PerfStage    stages[PERF_MAX_STAGES];
+static u32          n_stages = 0;
+static const char  *open_name = NULL;
+static XTime        open_start;
+static PerfCounters open_base;
+static UINTPTR      open_ip;
+
+void perf_begin(const char *name) {
+    open_name = name;
+    open_ip   = 0;
+    open_base = perf_now;
+    XTime_GetTime(&open_start);
+}
+
+// The counter block is accessed through the parenthesised library
+// names, which the counting macros of perf.h do not expand: reading the
+// IP counters does not show up in the stage's mmio columns
+void perf_ip(UINTPTR ip_base) {
+    if (!PERF_HW || !open_name || !ip_base)
+        return;
+    open_ip = ip_base;
+    (Xil_Out32)(ip_base + PERF_HW_CLEAR, 1);
+    (Xil_Out32)(ip_base + PERF_HW_CLEAR, 0);
+}
+
+static void read_ip(UINTPTR base, PerfHw *hw) {
+    hw->active    = (Xil_In32)(base + PERF_HW_ACTIVE);
+    hw->idle      = (Xil_In32)(base + PERF_HW_IDLE);
+    hw->items     = (Xil_In32)(base + PERF_HW_ITEMS);
+    hw->in_stall  = (Xil_In32)(base + PERF_HW_IN_STALL);
+    hw->out_stall = (Xil_In32)(base + PERF_HW_OUT_STALL);
+    hw->bits      = (Xil_In32)(base + PERF_HW_BITS);
+}
+
+void perf_end(u32 bytes_in, u32 bytes_out, u32 symbols) {
+    XTime now;
+    XTime_GetTime(&now);
+
+    if (!open_name || n_stages == PERF_MAX_STAGES) {
+        open_name = NULL;
+        return;
+    }
+
+    PerfStage *s = &stages[n_stages++];
+    s->name      = open_name;
+    s->ticks     = now - open_start;
+    s->bytes_in  = bytes_in;
+    s->bytes_out = bytes_out;
+    s->symbols   = symbols;
+    s->c.mmio_reads     = perf_now.mmio_reads     - open_base.mmio_reads;
+    s->c.mmio_writes    = perf_now.mmio_writes    - open_base.mmio_writes;
+    s->c.fs_reads       = perf_now.fs_reads       - open_base.fs_reads;
+    s->c.fs_read_bytes  = perf_now.fs_read_bytes  - open_base.fs_read_bytes;
+    s->c.fs_writes      = perf_now.fs_writes      - open_base.fs_writes;
+    s->c.fs_write_bytes = perf_now.fs_write_bytes - open_base.fs_write_bytes;
+    s->c.polls          = perf_now.polls          - open_base.polls;
+
+    s->ip = open_ip;
+    if (open_ip)
+        read_ip(open_ip, &s->hw);
+    else
+        memset(&s->hw, 0, sizeof(s->hw));
+    open_name = NULL;
+}
+
+static void add_stage(PerfStage *sum, const PerfStage *s) {
+    sum->ticks     += s->ticks;
+    sum->bytes_in  += s->bytes_in;
+    sum->bytes_out += s->bytes_out;
+    sum->symbols   += s->symbols;
+    sum->c.mmio_reads     += s->c.mmio_reads;
+    sum->c.mmio_writes    += s->c.mmio_writes;
+    sum->c.fs_reads       += s->c.fs_reads;
+    sum->c.fs_read_bytes  += s->c.fs_read_bytes;
+    sum->c.fs_writes      += s->c.fs_writes;
+    sum->c.fs_write_bytes += s->c.fs_write_bytes;
+    sum->c.polls          += s->c.polls;
+    sum->hw.active    += s->hw.active;
+    sum->hw.idle      += s->hw.idle;
+    sum->hw.items     += s->hw.items;
+    sum->hw.in_stall  += s->hw.in_stall;
+    sum->hw.out_stall += s->hw.out_stall;
+    sum->hw.bits      += s->hw.bits;
+}
+
+// KB per second of wall time, on the larger side of the stage
+static u32 stage_kbps(const PerfStage *s) {
+    u32 bytes = s->bytes_in > s->bytes_out ? s->bytes_in : s->bytes_out;
+    if (s->ticks == 0)
+        return 0;
+    return (u32)((u64)bytes * COUNTS_PER_SECOND / s->ticks / 1024);
+}
+
+static void print_stage(const PerfStage *s) {
+    xil_printf("  %-12s %10u us %10u in %10u out %10u sym %7u KB/s"
+               "  mmio %u/%u  fs %u/%u (%u/%u KB)  polls %u\r\n",
+               s->name, (u32)(s->ticks / TICKS_PER_US), s->bytes_in, s->bytes_out,
+               s->symbols, stage_kbps(s), s->c.mmio_reads, s->c.mmio_writes,
+               s->c.fs_reads, s->c.fs_writes,
+               s->c.fs_read_bytes / 1024, s->c.fs_write_bytes / 1024, s->c.polls);
+
+    const PerfHw *hw = &s->hw;
+    u64 cycles = (u64)hw->active + hw->idle + hw->in_stall + hw->out_stall;
+    if (cycles == 0)
+        return;
+    xil_printf("  %-12s ip cycles: %u active (%u%%) %u idle %u in-stall %u out-stall"
+               "  %u items %u bits\r\n",
+               "", hw->active, (u32)((u64)hw->active * 100 / cycles), hw->idle,
+               hw->in_stall, hw->out_stall, hw->items, hw->bits);
+}
+
+static int csv_line(LineWriter *w, const char *app, const PerfStage *s) {
+    char line[320];
+    int n = sprintf(line, "%s,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,"
+                    "%lu,%lu,%lu,%lu,%lu,%lu\r\n",
+                    app, s->name,
+                    (unsigned long)(s->ticks / TICKS_PER_US),
+                    (unsigned long)s->bytes_in, (unsigned long)s->bytes_out,
+                    (unsigned long)s->symbols,
+                    (unsigned long)s->c.mmio_reads, (unsigned long)s->c.mmio_writes,
+                    (unsigned long)s->c.fs_reads, (unsigned long)s->c.fs_read_bytes,
+                    (unsigned long)s->c.fs_writes, (unsigned long)s->c.fs_write_bytes,
+                    (unsigned long)s->c.polls,
+                    (unsigned long)s->hw.active, (unsigned long)s->hw.idle,
+                    (unsigned long)s->hw.items, (unsigned long)s->hw.in_stall,
+                    (unsigned long)s->hw.out_stall, (unsigned long)s->hw.bits);
+    return writeBuffered(w, line, n);
+}
+
+static int write_csv(const char *app, const char *csv_file, const PerfStage *total) {
+    static const char header[] =
+        "app,stage,time_us,bytes_in,bytes_out,symbols,mmio_reads,mmio_writes,"
+        "fs_reads,fs_read_bytes,fs_writes,fs_write_bytes,polls,"
+        "ip_active,ip_idle,ip_items,ip_in_stall,ip_out_stall,ip_bits\r\n";
+    LineWriter w = {0};
+
+    if (openWriter(&w, (char *)csv_file, 'a') != XST_SUCCESS)
+        return -1;
+
+    int rc = XST_SUCCESS;
+    if (f_size(w.fp) == 0)
+        rc = writeBuffered(&w, header, sizeof(header) - 1);
+    for (u32 i = 0; i < n_stages && rc == XST_SUCCESS; i++)
+        rc = csv_line(&w, app, &stages[i]);
+    if (rc == XST_SUCCESS)
+        rc = csv_line(&w, app, total);
+
+    if (closeWriter(&w) != XST_SUCCESS)
+        rc = XST_FAILURE;
+    return rc == XST_SUCCESS ? 0 : -1;
+}
+
+static void sum_stages(PerfStage *total) {
+    memset(total, 0, sizeof(*total));
+    total->name = "total";
+    for (u32 i = 0; i < n_stages; i++)
+        add_stage(total, &stages[i]);
+}
+
+void perf_report(const char *app, const char *csv_file) {
+    PerfStage total;
+    sum_stages(&total);
+
+    xil_printf("\n---- Stage profile (%s) ----\r\n", app);
+    xil_printf("  mmio reads/writes, fs read/write calls (KB); ip = the stage's IP core counters\r\n");
+    for (u32 i = 0; i < n_stages; i++)
+        print_stage(&stages[i]);
+    print_stage(&total);
+
+    if (!csv_file)
+        return;
+    if (write_csv(app, csv_file, &total) != 0)
+        xil_printf("ERROR: Writing the stage profile to %s\r\n", csv_file);
+    else
+        xil_printf("Stage profile appended to %s\r\n", csv_file);
+}
+
+void perf_reset(void) {
+    n_stages  = 0;
+    open_name = NULL;
+    memset(&perf_run, 0, sizeof(perf_run));
+}
+
+// ----------------------------------------------------------------------
+// Run results
+// ----------------------------------------------------------------------
+// log2(x) in 16.16 fixed point, x > 0: the fraction bit by bit, by
+// squaring the mantissa (no libm on the target)
+static u32 log2_q16(u64 x) {
+    u32 k = 63 - __builtin_clzll(x);
+    u64 m = k > 31 ? x >> (k - 31) : x << (31 - k);   // [2^31, 2^32): 1.0 .. 2.0
+    u32 frac = 0;
+
+    for (int i = 15; i >= 0; i--) {
+        m = (m * m) >> 31;
+        if (m >= (1ULL << 32)) {
+            m >>= 1;
+            frac |= 1u << i;
+        }
+    }
+    return (k << 16) | frac;
+}
+
+// H = log2(N) - sum(f * log2 f) / N
+u32 perf_entropy_mbits(const u32 *freqs, u32 n) {
+    u64 total = 0, weighted = 0;
+    for (u32 i = 0; i < n; i++) {
+        if (freqs[i] == 0)
+            continue;
+        total    += freqs[i];
+        weighted += (u64)freqs[i] * log2_q16(freqs[i]);
+    }
+    if (total == 0)
+        return 0;
+    u64 h = log2_q16(total) - weighted / total;
+    return (u32)((h * 1000 + 0x8000) >> 16);
+}
+
+static u32 file_bytes(const char *name) {
+    FIL f;
+    if (f_open(&f, name, FA_READ) != FR_OK)
+        return 0;
+    u32 n = f_size(&f);
+    f_close(&f);
+    return n;
+}
+
+void perf_run_files(const char *plain_file, const char *packed_file) {
+    perf_run.plain_bytes  = file_bytes(plain_file);
+    perf_run.packed_bytes = file_bytes(packed_file);
+}
+
+static u32 ratio_x1000(void) {
+    return perf_run.packed_bytes ?
+        (u32)((u64)perf_run.plain_bytes * 1000 / perf_run.packed_bytes) : 0;
+}
+
+static u32 coded_mbits(void) {
+    return perf_run.symbols ?
+        (u32)((u64)perf_run.payload_bits * 1000 / perf_run.symbols) : 0;
+}
+
+static int write_run_csv(const char *csv_file, const char *line, int n) {
+    static const char header[] =
+        "app,input,plain_bytes,packed_bytes,ratio_x1000,symbols,payload_bits,"
+        "coded_mbits,entropy_mbits,peak_bytes,time_us,plain_kbps\r\n";
+    LineWriter w = {0};
+
+    if (openWriter(&w, (char *)csv_file, 'a') != XST_SUCCESS)
+        return -1;
+
+    int rc = XST_SUCCESS;
+    if (f_size(w.fp) == 0)
+        rc = writeBuffered(&w, header, sizeof(header) - 1);
+    if (rc == XST_SUCCESS)
+        rc = writeBuffered(&w, line, n);
+
+    if (closeWriter(&w) != XST_SUCCESS)
+        rc = XST_FAILURE;
+    return rc == XST_SUCCESS ? 0 : -1;
+}
+
+void perf_run_report(const char *app, const char *csv_file) {
+    const PerfRun *r = &perf_run;
+    const char *input = r->input ? r->input : "";
+    PerfStage total;
+    sum_stages(&total);
+    total.bytes_in = total.bytes_out = r->plain_bytes;
+
+    u32 ratio = ratio_x1000(), coded = coded_mbits();
+    u32 us    = (u32)(total.ticks / TICKS_PER_US);
+
+    xil_printf("\n---- Run result (%s) ----\r\n", app);
+    xil_printf("  %s: %u bytes plain, %u packed, ratio %u.%03u : 1\r\n",
+               input, r->plain_bytes, r->packed_bytes, ratio / 1000, ratio % 1000);
+    xil_printf("  %u symbols, %u.%03u bits/symbol coded, %u.%03u entropy\r\n",
+               r->symbols, coded / 1000, coded % 1000,
+               r->entropy_mbits / 1000, r->entropy_mbits % 1000);
+    xil_printf("  peak buffers %u bytes, %u us in stages, %u KB/s of plain bitstream\r\n",
+               r->peak_bytes, us, stage_kbps(&total));
+
+    if (!csv_file)
+        return;
+
+    char line[320];
+    int n = sprintf(line, "%s,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n",
+                    app, input,
+                    (unsigned long)r->plain_bytes, (unsigned long)r->packed_bytes,
+                    (unsigned long)ratio, (unsigned long)r->symbols,
+                    (unsigned long)r->payload_bits, (unsigned long)coded,
+                    (unsigned long)r->entropy_mbits, (unsigned long)r->peak_bytes,
+                    (unsigned long)us, (unsigned long)stage_kbps(&total));
+    if (write_run_csv(csv_file, line, n) != 0)
+        xil_printf("ERROR: Writing the run result to %s\r\n", csv_file);
+    else
+        xil_printf("Run result appended to %s\r\n", csv_file);
+}
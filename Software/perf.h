@@ -0,0 +1,197 @@
+/*
+ * perf.h
+ *
+ * Per-stage instrumentation shared by the compression and
+ * decompression applications.
+ *
+ * A stage is bracketed by perf_begin() / perf_end(). It records its
+ * wall time (global timer) and what it moved: the bytes and symbols
+ * the caller passes to perf_end(), plus the change of every running
+ * counter in perf_now:
+ *
+ *   mmio_reads / mmio_writes  AXI-Lite register accesses (Xil_In32,
+ *                             Xil_Out32, Xil_Out8)
+ *   fs_reads / fs_writes      f_read / f_write calls, and the whole-
+ *                             sector disk_read / disk_write commands
+ *                             of sdcard.c's direct transfers
+ *   fs_*_bytes                bytes those calls moved
+ *   polls                     iterations of the loops that wait on an
+ *                             IP, the DMA, the PCAP or CPU1
+ *
+ * perf_report() prints one line per stage on the UART and appends the
+ * same figures to a CSV file on the card, one line per stage, so runs
+ * can be compared side by side.
+ *
+ * The register and FatFs calls are counted by the macros at the end of
+ * this header, which wrap the library calls of every file that
+ * includes it (after xil_io.h, ff.h and diskio.h, included here). The
+ * Xilinx drivers' own accesses are not counted. PERF_COUNTERS = 0
+ * leaves the calls alone; stages are still timed.
+ *
+ * perf_ip() attaches the counter block of one IP core (perf_counters,
+ * Hardware/RTL/Common) to the open stage: it is cleared there and read
+ * by perf_end(), so the stage also reports the core's active, idle
+ * and stall cycles, items and payload bits. PERF_HW = 0 (a bitstream
+ * built with the counters disabled) skips those accesses.
+ *
+ * perf_run holds the results of the whole run (sizes, symbols, the
+ * order-0 entropy of the histogram, peak buffer use), filled in by the
+ * application; perf_run_report() prints them with the ratio, bits per
+ * symbol and throughput and appends one CSV line per run. Together
+ * with the stage CSV this is what host/bench.sh collects over a corpus.
+ *
+ * A batch run (batch.h) reports every file on its own: perf_reset()
+ * starts the next one.
+ *
+ * Only one stage is open at a time. With AMP_MODE = 1 the card belongs
+ * to CPU1, whose image has its own counters: CPU0's report shows no
+ * file-system traffic, only its waits for CPU1 (as polls).
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <xil_types.h>
+#include "xil_io.h"
+#include "ff.h"
+#include "diskio.h"
+#include "xtime_l.h"
+
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS      1      // 1 = count register and FatFs calls, 0 = times only
+#endif
+
+#ifndef PERF_HW
+#define PERF_HW            1      // 1 = the IP cores carry the perf_counters block
+#endif
+
+#define PERF_MAX_STAGES    24     // stages kept for the report
+#define PERF_SECTOR        512    // bytes per disk_read / disk_write sector
+
+// perf_counters block, from the IP base (see perf_counters.v)
+#define PERF_HW_ACTIVE     0x200  // cycles doing work
+#define PERF_HW_IDLE       0x204  // cycles with nothing to do
+#define PERF_HW_ITEMS      0x208  // symbols / words finished
+#define PERF_HW_IN_STALL   0x20C  // cycles waiting for input
+#define PERF_HW_OUT_STALL  0x210  // cycles holding a result the output did not take
+#define PERF_HW_BITS       0x214  // payload bits produced or consumed
+#define PERF_HW_CLEAR      0x218  // bit 0: zero the counters (edge-detected)
+
+typedef struct {
+    u32 mmio_reads;
+    u32 mmio_writes;
+    u32 fs_reads;
+    u32 fs_read_bytes;
+    u32 fs_writes;
+    u32 fs_write_bytes;
+    u32 polls;
+} PerfCounters;
+
+typedef struct {
+    u32 active;
+    u32 idle;
+    u32 items;
+    u32 in_stall;
+    u32 out_stall;
+    u32 bits;
+} PerfHw;
+
+typedef struct {
+    const char  *name;
+    XTime        ticks;
+    u32          bytes_in;
+    u32          bytes_out;
+    u32          symbols;
+    PerfCounters c;               // counters spent in the stage
+    UINTPTR      ip;              // IP core read by perf_end(), 0 = none
+    PerfHw       hw;              // its counters over the stage
+} PerfStage;
+
+// Results of a run; fields the application does not know stay 0
+typedef struct {
+    const char  *input;           // file the run started from
+    u32          plain_bytes;     // bitstream: compression input, decompression output
+    u32          packed_bytes;    // archive
+    u32          symbols;         // symbols coded
+    u32          payload_bits;    // their codeword bits
+    u32          entropy_mbits;   // order-0 entropy of the histogram, 1/1000 bit per symbol
+    u32          peak_bytes;      // DDR buffer bytes in use at the peak
+} PerfRun;
+
+extern PerfCounters perf_now;     // running totals since start-up
+extern PerfRun      perf_run;
+
+void perf_begin(const char *name);
+void perf_end(u32 bytes_in, u32 bytes_out, u32 symbols);
+
+// Report the counters of the IP core at ip_base (0: none) with the
+// open stage; call right after perf_begin()
+void perf_ip(UINTPTR ip_base);
+
+// UART table of the stages so far; csv_file (NULL: none) gets one
+// line per stage, after a column header if the file is new
+void perf_report(const char *app, const char *csv_file);
+
+// UART summary of perf_run and the stage times; csv_file (NULL: none)
+// gets one line per run, after a column header if the file is new
+void perf_run_report(const char *app, const char *csv_file);
+
+// Sizes of the two files of a run, for the STAGE_FILES pipelines
+void perf_run_files(const char *plain_file, const char *packed_file);
+
+// Drop the stages and run result so far, for the next file of a batch
+// (batch.h); the running counters carry on
+void perf_reset(void);
+
+// Order-0 entropy of a histogram of n bins, 1/1000 bit per symbol
+u32 perf_entropy_mbits(const u32 *freqs, u32 n);
+
+static inline void perf_polls(u32 n) {
+    perf_now.polls += n;
+}
+
+// ----------------------------------------------------------------------
+// Call counting
+// ----------------------------------------------------------------------
+// The byte counts are read after the call has returned
+static inline int perf_fs_read(int rc, const UINT *br) {
+    perf_now.fs_reads++;
+    perf_now.fs_read_bytes += *br;
+    return rc;
+}
+
+static inline int perf_fs_write(int rc, const UINT *bw) {
+    perf_now.fs_writes++;
+    perf_now.fs_write_bytes += *bw;
+    return rc;
+}
+
+static inline int perf_disk_read(int rc, UINT sectors) {
+    perf_now.fs_reads++;
+    perf_now.fs_read_bytes += rc ? 0 : sectors * PERF_SECTOR;
+    return rc;
+}
+
+static inline int perf_disk_write(int rc, UINT sectors) {
+    perf_now.fs_writes++;
+    perf_now.fs_write_bytes += rc ? 0 : sectors * PERF_SECTOR;
+    return rc;
+}
+
+#if PERF_COUNTERS
+// A macro is not expanded inside its own replacement, so each of these
+// still calls the library function of the same name
+#define Xil_In32(addr)          (perf_now.mmio_reads++, Xil_In32(addr))
+#define Xil_Out32(addr, value)  (perf_now.mmio_writes++, Xil_Out32((addr), (value)))
+#define Xil_Out8(addr, value)   (perf_now.mmio_writes++, Xil_Out8((addr), (value)))
+
+#define f_read(fp, buff, btr, br)   perf_fs_read(f_read((fp), (buff), (btr), (br)), (br))
+#define f_write(fp, buff, btw, bw)  perf_fs_write(f_write((fp), (buff), (btw), (bw)), (bw))
+
+#define disk_read(drv, buff, sector, count) \
+    perf_disk_read(disk_read((drv), (buff), (sector), (count)), (count))
+#define disk_write(drv, buff, sector, count) \
+    perf_disk_write(disk_write((drv), (buff), (sector), (count)), (count))
+#endif
+
+#endif
@@ -10,7 +10,9 @@
  */
 
 #include "sdCard.h"
-#include <stdlib.h> // for malloc and free
+#include "perf.h"   // counts the f_read/f_write and disk_read/disk_write calls
+#include <stdlib.h> // for free
+#include <string.h>
 
 static FATFS fatfs;
 
@@ -38,10 +40,127 @@ int SD_Eject()
     return XST_SUCCESS;
 }
 
+// FIL first, so FIL* and SdFile* are the same pointer
+typedef struct {
+    FIL   fil;
+    u32   reserved;     // bytes preallocated by createFile()
+    int   direct;       // createFile(): nothing has gone through f_write yet
+    int   mapped;       // 1: clmt holds the fragments, -1: mapping failed
+    int   in_use;       // slot of file_pool taken by an open file
+    DWORD clmt[SD_CLMT_LEN];
+} SdFile;
+
+// Open files come from a fixed pool instead of the heap
+static SdFile file_pool[SD_MAX_FILES];
+
+static SdFile *takeFile(const char *FileName)
+{
+    for (int i = 0; i < SD_MAX_FILES; i++) {
+        if (!file_pool[i].in_use) {
+            memset(&file_pool[i], 0, sizeof(file_pool[i]));
+            file_pool[i].in_use = 1;
+            return &file_pool[i];
+        }
+    }
+    xil_printf(" ERROR : %s: all %d file slots are open\r\n", FileName, SD_MAX_FILES);
+    return NULL;
+}
+
+#if FF_USE_EXPAND || FF_USE_FASTSEEK
+#include "diskio.h"
+
+// First sector of cluster clst
+static u32 clusterSector(FIL *fil, u32 clst)
+{
+    FATFS *fs = fil->obj.fs;
+    return fs->database + (u32)fs->csize * (clst - 2);
+}
+#endif
+
+#if FF_USE_FASTSEEK
+static int mapFragments(SdFile *sf)
+{
+    if (sf->mapped == 0) {
+        sf->clmt[0] = SD_CLMT_LEN;
+        sf->fil.cltbl = sf->clmt;
+        if (f_lseek(&sf->fil, CREATE_LINKMAP) == FR_OK) {
+            sf->mapped = 1;
+        } else {
+            sf->fil.cltbl = NULL;   // too many fragments: plain f_read
+            sf->mapped = -1;
+        }
+    }
+    return sf->mapped == 1 ? XST_SUCCESS : XST_FAILURE;
+}
+
+// Sector of byte offset pos (a multiple of SD_SECTOR) and the number
+// of sectors that follow it in the same fragment
+static u32 fragmentRun(SdFile *sf, u32 pos, u32 *sectors)
+{
+    u32 csize = sf->fil.obj.fs->csize;
+    u32 cl = pos / SD_SECTOR / csize;       // cluster index in the file
+    const DWORD *t = sf->clmt + 1;
+
+    while (t[0] && cl >= t[0]) {
+        cl -= t[0];
+        t += 2;
+    }
+    if (!t[0])
+        return 0;
+    *sectors = (t[0] - cl) * csize - (pos / SD_SECTOR) % csize;
+    return clusterSector(&sf->fil, t[1] + cl) + (pos / SD_SECTOR) % csize;
+}
+#endif
+
+// size bytes from the current position to DestinationAddress. Returns
+// the number read (size unless the file ends first), or -1.
+int readChunk(FIL *fil, u32 DestinationAddress, u32 size)
+{
+    FRESULT rc;
+    UINT br = 0;
+    u32 pos = f_tell(fil);
+    u32 done = 0;
+
+    if (size > f_size(fil) - pos)
+        size = f_size(fil) - pos;
+
+#if FF_USE_FASTSEEK
+    SdFile *sf = (SdFile *)fil;
+    if ((DestinationAddress & 3) == 0 && pos % SD_SECTOR == 0 &&
+        size >= SD_SECTOR && mapFragments(sf) == XST_SUCCESS) {
+        while (size - done >= SD_SECTOR) {
+            u32 run, sector = fragmentRun(sf, pos + done, &run);
+            u32 n = (size - done) / SD_SECTOR;
+            if (n > run)             n = run;
+            if (n > SD_XFER_SECTORS) n = SD_XFER_SECTORS;
+            if (!sector || disk_read(fil->obj.fs->pdrv, (BYTE *)(DestinationAddress + done),
+                                     sector, n) != RES_OK) {
+                xil_printf(" ERROR : disk_read of sector %lu failed\r\n", (unsigned long)sector);
+                return -1;
+            }
+            done += n * SD_SECTOR;
+        }
+        rc = f_lseek(fil, pos + done);
+        if (rc) {
+            xil_printf(" ERROR : f_lseek returned %d\r\n", rc);
+            return -1;
+        }
+    }
+#endif
+
+    if (done < size) {
+        rc = f_read(fil, (void *)(DestinationAddress + done), size - done, &br);
+        if (rc) {
+            xil_printf(" ERROR : f_read returned %d\r\n", rc);
+            return -1;
+        }
+    }
+    return done + br;
+}
+
 int readFile(FIL *fil, u32 DestinationAddress)
 {
     FRESULT rc;
-    UINT br;
     u32 file_size;
 
     file_size = f_size(fil);
@@ -52,11 +171,8 @@ int readFile(FIL *fil, u32 DestinationAddress)
         return XST_FAILURE;
     }
 
-    rc = f_read(fil, (void *)DestinationAddress, file_size, &br);
-    if (rc) {
-        xil_printf(" ERROR : f_read returned %d\r\n", rc);
+    if (readChunk(fil, DestinationAddress, file_size) != (int)file_size)
         return XST_FAILURE;
-    }
 
     Xil_DCacheFlush();
     return file_size;
@@ -64,21 +180,40 @@ int readFile(FIL *fil, u32 DestinationAddress)
 
 u32 closeFile(FIL *fptr)
 {
-    FRESULT rc;
+    SdFile *sf = (SdFile *)fptr;
+    FRESULT rc = FR_OK;
+
+    // Drop the unused end of a preallocation
+    if (sf->reserved && f_tell(fptr) < f_size(fptr))
+        rc = f_truncate(fptr);
+    if (rc) {
+        xil_printf(" ERROR : f_truncate returned %d\r\n", rc);
+        f_close(fptr);
+        sf->in_use = 0;
+        return XST_FAILURE;
+    }
+
+#if FF_USE_FASTSEEK
+    fptr->cltbl = NULL;
+#endif
     rc = f_close(fptr);
+    sf->in_use = 0;     // the slot is free either way
     if (rc) {
         xil_printf(" ERROR : f_close returned %d\r\n", rc);
         return XST_FAILURE;
     }
-    free(fptr); // Free the dynamically allocated FIL
     return XST_SUCCESS;
 }
 
 FIL *openFile(char *FileName, char mode)
 {
-    FIL *fil = (FIL *)malloc(sizeof(FIL)); // dynamically allocate a new FIL
+    SdFile *sf = takeFile(FileName);
     FRESULT rc;
 
+    if (!sf)
+        return NULL;
+    FIL *fil = &sf->fil;
+
     if (mode == 'r') {
         rc = f_open(fil, FileName, FA_READ);
     } else if (mode == 'w') {
@@ -94,27 +229,300 @@ FIL *openFile(char *FileName, char mode)
         } else {
             rc = f_lseek(fil, f_size(fil));
         }
+    } else {
+        rc = FR_INVALID_PARAMETER;
     }
 
     if (rc) {
         xil_printf(" ERROR : f_open returned %d\r\n", rc);
-        free(fil);
+        sf->in_use = 0;
         return NULL;
     }
 
     return fil;
 }
 
+// New file with bytes (a size estimate is fine: the file is trimmed at
+// close, and written on past the reservation if it was too small)
+// preallocated in one contiguous run
+FIL *createFile(char *FileName, u32 bytes)
+{
+    FIL *fil = openFile(FileName, 'w');
+    if (!fil)
+        return NULL;
+
+#if FF_USE_EXPAND
+    SdFile *sf = (SdFile *)fil;
+    bytes = (bytes + SD_SECTOR - 1) & ~(SD_SECTOR - 1);
+    if (bytes > 0) {
+        FRESULT rc = f_expand(fil, bytes, 1);
+        if (rc == FR_OK) {
+            sf->reserved = bytes;
+            sf->direct   = 1;
+        } else {
+            // Fragmented card: the file grows write by write instead
+            xil_printf(" NOTE : no contiguous %lu bytes for %s (f_expand returned %d)\r\n",
+                       (unsigned long)bytes, FileName, rc);
+        }
+    }
+#else
+    (void)bytes;
+#endif
+    return fil;
+}
+
 int writeFile(FIL *fptr, u32 size, u32 SourceAddress)
 {
-    UINT btw;
+    UINT btw = 0;
+    FRESULT rc;
+    u32 done = 0;
+
+#if FF_USE_EXPAND
+    // Whole sectors inside the reservation go straight to the card,
+    // until the first write that FatFs has to buffer
+    SdFile *sf = (SdFile *)fptr;
+    u32 pos = f_tell(fptr);
+    if (sf->direct && pos % SD_SECTOR == 0 && pos < sf->reserved && (SourceAddress & 3) == 0) {
+        u32 room = sf->reserved - pos;
+        u32 sectors = (size < room ? size : room) / SD_SECTOR;
+        u32 first = clusterSector(fptr, fptr->obj.sclust) + pos / SD_SECTOR;
+
+        while (sectors > 0) {
+            u32 n = sectors < SD_XFER_SECTORS ? sectors : SD_XFER_SECTORS;
+            if (disk_write(fptr->obj.fs->pdrv, (const BYTE *)(SourceAddress + done),
+                           first + done / SD_SECTOR, n) != RES_OK) {
+                xil_printf(" ERROR : disk_write of %lu sectors failed\r\n", (unsigned long)n);
+                return XST_FAILURE;
+            }
+            done    += n * SD_SECTOR;
+            sectors -= n;
+        }
+        if (done > 0) {
+            rc = f_lseek(fptr, pos + done);
+            if (rc) {
+                xil_printf(" ERROR : f_lseek returned %d\r\n", rc);
+                return XST_FAILURE;
+            }
+        }
+    }
+#endif
+
+    if (done < size) {
+#if FF_USE_EXPAND
+        sf->direct = 0;     // FatFs now caches a sector of the file
+#endif
+        rc = f_write(fptr, (const void *)(SourceAddress + done), size - done, &btw);
+        if (rc) {
+            xil_printf(" ERROR : f_write returned %d\r\n", rc);
+            return XST_FAILURE;
+        }
+    }
+
+    return done + btw;
+}
+
+// ----------------------------------------------------------------------
+// Buffered line I/O
+// ----------------------------------------------------------------------
+#include <malloc.h>   // memalign
+
+int openReader(LineReader *r, char *FileName)
+{
+    r->fp = openFile(FileName, 'r');
+    if (!r->fp)
+        return XST_FAILURE;
+
+    r->buf = (char *)memalign(32, SD_LINE_MAX + SD_BUF_SIZE + 1);
+    if (!r->buf) {
+        xil_printf(" ERROR : no memory for %s read buffer\r\n", FileName);
+        closeFile(r->fp);
+        r->fp = NULL;
+        return XST_FAILURE;
+    }
+    r->pos = r->end = SD_LINE_MAX;
+    r->eof = 0;
+    return XST_SUCCESS;
+}
+
+void closeReader(LineReader *r)
+{
+    if (r->fp)
+        closeFile(r->fp);
+    free(r->buf);
+    r->fp  = NULL;
+    r->buf = NULL;
+}
+
+// Move the unread tail in front of the data area and read the next
+// block behind it. Returns XST_FAILURE at end of file or on error.
+static int fillReader(LineReader *r)
+{
     FRESULT rc;
+    UINT br;
+    u32 left = r->end - r->pos;
 
-    rc = f_write(fptr, (const void *)SourceAddress, size, &btw);
+    if (r->eof || left > SD_LINE_MAX)
+        return XST_FAILURE;
+
+    memmove(r->buf + SD_LINE_MAX - left, r->buf + r->pos, left);
+    r->pos = SD_LINE_MAX - left;
+
+    rc = f_read(r->fp, r->buf + SD_LINE_MAX, SD_BUF_SIZE, &br);
     if (rc) {
-        xil_printf(" ERROR : f_write returned %d\r\n", rc);
+        xil_printf(" ERROR : f_read returned %d\r\n", rc);
+        br = 0;
+    }
+    if (br < SD_BUF_SIZE)
+        r->eof = 1;
+    r->end = SD_LINE_MAX + br;
+    return br ? XST_SUCCESS : XST_FAILURE;
+}
+
+// Next line without its "\r\n", NUL-terminated inside the reader's
+// buffer (valid until the next call). Lines longer than SD_LINE_MAX
+// come back in SD_LINE_MAX pieces. Returns the length, or -1 at end of
+// file.
+int readLine(LineReader *r, char **line)
+{
+    u32 scan = r->pos;
+
+    for (;;) {
+        // A newline can be at most SD_LINE_MAX bytes ahead
+        u32 limit = r->pos + SD_LINE_MAX + 1;
+        if (limit > r->end)
+            limit = r->end;
+
+        char *nl = memchr(r->buf + scan, '\n', limit - scan);
+        if (nl) {
+            u32 n = nl - (r->buf + r->pos);
+            *line = r->buf + r->pos;
+            r->pos += n + 1;
+            if (n > 0 && (*line)[n - 1] == '\r')
+                n--;
+            (*line)[n] = '\0';
+            return n;
+        }
+
+        if (r->end - r->pos > SD_LINE_MAX)
+            break;
+
+        scan = r->end;
+        u32 before = r->pos;
+        if (fillReader(r) != XST_SUCCESS)
+            break;
+        scan -= before - r->pos;
+    }
+
+    u32 n = r->end - r->pos;
+    if (n == 0)
+        return -1;
+
+    // Overlong line: copied out, the terminator would clobber the rest
+    if (n > SD_LINE_MAX) {
+        memcpy(r->spill, r->buf + r->pos, SD_LINE_MAX);
+        r->spill[SD_LINE_MAX] = '\0';
+        r->pos += SD_LINE_MAX;
+        *line = r->spill;
+        return SD_LINE_MAX;
+    }
+
+    // Last line without a newline; buf has one spare byte past the data
+    *line = r->buf + r->pos;
+    r->pos = r->end;
+    if ((*line)[n - 1] == '\r')
+        n--;
+    (*line)[n] = '\0';
+    return n;
+}
+
+// Up to max raw bytes at the current position, in place. Returns the
+// span length, 0 at end of file.
+u32 readSpan(LineReader *r, const u8 **span, u32 max)
+{
+    if (r->pos == r->end && fillReader(r) != XST_SUCCESS)
+        return 0;
+
+    u32 n = r->end - r->pos;
+    if (n > max)
+        n = max;
+    *span = (const u8 *)r->buf + r->pos;
+    r->pos += n;
+    return n;
+}
+
+static int attachWriter(LineWriter *w, char *FileName)
+{
+    if (!w->fp)
         return XST_FAILURE;
+
+    w->buf = (char *)memalign(32, SD_BUF_SIZE);
+    if (!w->buf) {
+        xil_printf(" ERROR : no memory for %s write buffer\r\n", FileName);
+        closeFile(w->fp);
+        w->fp = NULL;
+        return XST_FAILURE;
+    }
+    w->len   = 0;
+    w->error = 0;
+    return XST_SUCCESS;
+}
+
+int openWriter(LineWriter *w, char *FileName, char mode)
+{
+    w->fp = openFile(FileName, mode);
+    return attachWriter(w, FileName);
+}
+
+// New file, bytes preallocated (see createFile)
+int openWriterSized(LineWriter *w, char *FileName, u32 bytes)
+{
+    w->fp = createFile(FileName, bytes);
+    return attachWriter(w, FileName);
+}
+
+static void flushWriter(LineWriter *w)
+{
+    if (w->len > 0 && writeFile(w->fp, w->len, (u32)w->buf) != (int)w->len) {
+        xil_printf(" ERROR : writing %lu buffered bytes failed\r\n", (unsigned long)w->len);
+        w->error = 1;
+    }
+    w->len = 0;
+}
+
+// Flushes the tail and closes the file; XST_FAILURE if any write failed
+int closeWriter(LineWriter *w)
+{
+    if (w->fp) {
+        flushWriter(w);
+        closeFile(w->fp);
+    }
+    free(w->buf);
+    w->fp  = NULL;
+    w->buf = NULL;
+    return w->error ? XST_FAILURE : XST_SUCCESS;
+}
+
+int writeBuffered(LineWriter *w, const void *data, u32 size)
+{
+    const char *src = (const char *)data;
+
+    while (size > 0) {
+        u32 n = SD_BUF_SIZE - w->len;
+        if (n > size)
+            n = size;
+        memcpy(w->buf + w->len, src, n);
+        w->len += n;
+        src    += n;
+        size   -= n;
+        if (w->len == SD_BUF_SIZE)
+            flushWriter(w);
     }
+    return w->error ? XST_FAILURE : XST_SUCCESS;
+}
 
-    return btw;
+// line followed by "\r\n"
+int writeLine(LineWriter *w, const char *line, u32 size)
+{
+    writeBuffered(w, line, size);
+    return writeBuffered(w, "\r\n", 2);
 }
@@ -15,9 +15,71 @@
 #include <xstatus.h>
 #include "xil_cache.h"
 
+// openFile() takes its FIL from a static pool: at most SD_MAX_FILES
+// files are open at a time
+#define SD_MAX_FILES     8
+
 int SD_Init();
 int SD_Eject();
 FIL* openFile(char *FileName,char mode);
 u32 closeFile(FIL* fptr);
 int readFile(FIL *fil, u32 DestinationAddress);
-int writeFile(FIL* fptr, u32 size, u32 SourceAddress);
\ No newline at end of file
+int writeFile(FIL* fptr, u32 size, u32 SourceAddress);
+
+// ----------------------------------------------------------------------
+// Large sequential transfers
+// ----------------------------------------------------------------------
+// f_read/f_write stop at every cluster boundary (32 KB on a typical
+// FAT32 card), so a long file costs one SD command per cluster. Where
+// the clusters are known to be consecutive the data goes straight to
+// disk_read/disk_write in runs of up to SD_XFER_SECTORS instead:
+//   - createFile() preallocates one contiguous run (f_expand, needs
+//     FF_USE_EXPAND) for an output of known or estimated size;
+//     writeFile() then writes whole sectors directly and closeFile()
+//     trims the file to the bytes written
+//   - readFile() / readChunk() map the fragments of the file (fast
+//     seek, needs FF_USE_FASTSEEK) and read each one directly
+// Without those FatFs options, or for unaligned buffers, both fall back
+// to f_read/f_write. Buffers must be 4-byte aligned for the SD DMA.
+#define SD_SECTOR        512
+#define SD_XFER_SECTORS  2048   // 1 MB per command, within the SD driver's ADMA2 table
+#define SD_CLMT_LEN      64     // fast-seek map: 31 fragments
+
+FIL* createFile(char *FileName, u32 bytes);
+int  readChunk(FIL *fil, u32 DestinationAddress, u32 size);
+
+// ----------------------------------------------------------------------
+// Buffered line I/O
+// ----------------------------------------------------------------------
+// The SD card is read and written in SD_BUF_SIZE blocks at block-aligned
+// file offsets, so FatFs moves whole sectors straight between the card
+// and the (cache-line aligned) buffer. Lines are handed out in place.
+#define SD_BUF_SIZE    (32 * 1024)   // multiple of the 512-byte sector
+#define SD_LINE_MAX    256           // longer lines are returned in pieces
+
+typedef struct {
+    FIL  *fp;
+    char *buf;       // SD_LINE_MAX carry-over area, then SD_BUF_SIZE data
+    u32   pos;       // next unread byte
+    u32   end;       // end of valid data
+    int   eof;       // last block read
+    char  spill[SD_LINE_MAX + 1];   // pieces of overlong lines
+} LineReader;
+
+typedef struct {
+    FIL  *fp;
+    char *buf;       // SD_BUF_SIZE
+    u32   len;       // bytes buffered
+    int   error;     // a write failed since openWriter
+} LineWriter;
+
+int  openReader(LineReader *r, char *FileName);
+void closeReader(LineReader *r);
+int  readLine(LineReader *r, char **line);
+u32  readSpan(LineReader *r, const u8 **span, u32 max);
+
+int  openWriter(LineWriter *w, char *FileName, char mode);
+int  openWriterSized(LineWriter *w, char *FileName, u32 bytes);
+int  closeWriter(LineWriter *w);
+int  writeBuffered(LineWriter *w, const void *data, u32 size);
+int  writeLine(LineWriter *w, const char *line, u32 size);
@@ -0,0 +1,138 @@
+/*
+ * zrle.c
+ *
+ * Zero-run model shared by the compression and decompression
+ * applications. See zrle.h.
+ */
+
+#include "zrle.h"
+
+static int word_is_zero(const u8 *s) {
+    return (s[0] | s[1] | s[2] | s[3]) == 0;
+}
+
+static int word_equal(const u8 *a, const u8 *b) {
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2] && a[3] == b[3];
+}
+
+u8 zrle_pick_escape(const u8 *symbols, u32 n) {
+    static u32 hist[256];
+    for (int s = 0; s < 256; s++)
+        hist[s] = 0;
+    for (u32 i = 0; i < n; i++)
+        hist[symbols[i]]++;
+
+    int best = 0;
+    for (int s = 1; s < 256; s++)
+        if (hist[s] < hist[best])
+            best = s;
+    return (u8)best;
+}
+
+u32 zrle_encode(const u8 *symbols, u32 n_words, u8 escape, u8 *tokens) {
+    u32 t = 0;
+    u32 w = 0;
+
+    while (w < n_words) {
+        const u8 *s = symbols + 4 * w;
+        u32 run = 0;
+
+        if (word_is_zero(s)) {
+            while (w + run < n_words && run < ZRLE_ZERO_MAX && word_is_zero(s + 4 * run))
+                run++;
+            tokens[t++] = escape;
+            tokens[t++] = (u8)run;
+        } else if (w > 0 && word_equal(s, s - 4)) {
+            // s - 4 is the previous word for the whole run
+            while (w + run < n_words && run < ZRLE_REPEAT_MAX && word_equal(s + 4 * run, s - 4))
+                run++;
+            tokens[t++] = escape;
+            tokens[t++] = (u8)(ZRLE_REPEAT_BASE + run);
+        } else {
+            for (int k = 0; k < 4; k++) {
+                tokens[t++] = s[k];
+                if (s[k] == escape)
+                    tokens[t++] = 0;
+            }
+            run = 1;
+        }
+        w += run;
+    }
+    return t;
+}
+
+void zrle_expand_init(ZrleExpander *z, u8 escape) {
+    z->escape  = escape;
+    z->pending = 0;
+    z->out     = 0;
+    for (int k = 0; k < 4; k++)
+        z->cur[k] = z->prev[k] = 0;
+}
+
+static void expand_put(ZrleExpander *z, u8 symbol, u8 *out) {
+    z->cur[z->out % 4] = symbol;
+    *out = symbol;
+    if (++z->out % 4 == 0)
+        for (int k = 0; k < 4; k++)
+            z->prev[k] = z->cur[k];
+}
+
+int zrle_expand_token(ZrleExpander *z, u8 token, u8 *out) {
+    if (!z->pending) {
+        if (token == z->escape) {
+            z->pending = 1;
+            return 0;
+        }
+        expand_put(z, token, out);
+        return 1;
+    }
+
+    z->pending = 0;
+    if (token == 0) {
+        expand_put(z, z->escape, out);
+        return 1;
+    }
+
+    // Runs are whole words
+    if (z->out % 4 != 0)
+        return -1;
+
+    u8  word[4] = {0, 0, 0, 0};
+    u32 n = token;
+    if (token > ZRLE_ZERO_MAX) {
+        if (z->out < 4)
+            return -1;
+        n = token - ZRLE_REPEAT_BASE;
+        for (int k = 0; k < 4; k++)
+            word[k] = z->prev[k];
+    }
+
+    for (u32 i = 0; i < n; i++)
+        for (int k = 0; k < 4; k++)
+            out[4 * i + k] = word[k];
+    for (int k = 0; k < 4; k++)
+        z->prev[k] = word[k];
+    z->out += 4 * n;
+    return (int)(4 * n);
+}
+
+int zrle_expand(const u8 *tokens, u32 n_tokens, u8 escape, u8 *symbols, u32 max_symbols) {
+    static u8 tail[ZRLE_EXPAND_MAX];
+    ZrleExpander z;
+    u32 n = 0;
+
+    zrle_expand_init(&z, escape);
+    for (u32 i = 0; i < n_tokens; i++) {
+        // Near the end of the buffer a token is expanded aside first
+        int direct = (max_symbols - n >= ZRLE_EXPAND_MAX);
+        u8 *dst = direct ? symbols + n : tail;
+        int got = zrle_expand_token(&z, tokens[i], dst);
+        if (got < 0 || (u32)got > max_symbols - n)
+            return -1;
+        if (!direct)
+            for (int k = 0; k < got; k++)
+                symbols[n + k] = tail[k];
+        n += got;
+    }
+    return z.pending ? -1 : (int)n;
+}
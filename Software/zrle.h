@@ -0,0 +1,61 @@
+/*
+ * zrle.h
+ *
+ * Zero-run model shared by the compression and decompression
+ * applications (ZRLE_MODEL = 1).
+ *
+ * Configuration data is mostly 0x00000000 words, which an 8-bit
+ * Huffman code cannot store in less than 4 bits per word. The model
+ * rewrites the parsed symbols (4 per word) into tokens of the same
+ * 8-bit alphabet before they are counted and encoded:
+ *
+ *   b       literal symbol b (b != escape)
+ *   E 00    literal escape symbol
+ *   E 01-7F 1..127 zero words
+ *   E 80-FF 1..128 repeats of the previous word
+ *
+ * E is the least frequent symbol of the block. Runs always start on a
+ * word boundary, so the expansion is a plain byte stream again.
+ */
+
+#ifndef ZRLE_H
+#define ZRLE_H
+
+#include <xil_types.h>
+
+#define ZRLE_ZERO_MAX       127   // zero words in one E 01-7F token
+#define ZRLE_REPEAT_MAX     128   // repeated words in one E 80-FF token
+#define ZRLE_REPEAT_BASE    0x7F  // E (ZRLE_REPEAT_BASE + n): n repeats
+#define ZRLE_EXPAND_MAX     (ZRLE_REPEAT_MAX * 4)   // symbols one token expands to
+
+// Worst case token count for n_words words: every symbol is the escape
+#define ZRLE_MAX_TOKENS(n_words)  ((n_words) * 8)
+
+typedef struct {
+    u8  escape;
+    u8  pending;            // last token was the escape
+    u8  cur[4];             // word being assembled
+    u8  prev[4];            // last complete word
+    u32 out;                // symbols produced so far
+} ZrleExpander;
+
+// Least frequent symbol of the n symbols (lowest value on a tie)
+u8 zrle_pick_escape(const u8 *symbols, u32 n);
+
+// Tokens for n_words words (4 symbols each) at symbols; tokens must
+// hold ZRLE_MAX_TOKENS(n_words). Returns the token count.
+u32 zrle_encode(const u8 *symbols, u32 n_words, u8 escape, u8 *tokens);
+
+void zrle_expand_init(ZrleExpander *z, u8 escape);
+
+// Expand one token into out (room for ZRLE_EXPAND_MAX symbols).
+// Returns the number of symbols written, or -1 if the token is not
+// valid here (a run off a word boundary, or a repeat before any word).
+int zrle_expand_token(ZrleExpander *z, u8 token, u8 *out);
+
+// Expand n_tokens tokens into at most max_symbols symbols. Returns
+// the symbol count, or -1 if the tokens are malformed, end on an
+// escape or do not fit.
+int zrle_expand(const u8 *tokens, u32 n_tokens, u8 escape, u8 *symbols, u32 max_symbols);
+
+#endif